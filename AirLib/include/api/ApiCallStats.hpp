@@ -0,0 +1,127 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_ApiCallStats_hpp
+#define air_ApiCallStats_hpp
+
+#include "common/Common.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace msr { namespace airlib {
+
+/*
+    Server side latency of API calls, measured in wall clock time from entering the call to returning
+    from it. Recording is a few relaxed atomics so it can stay on for high rate calls.
+*/
+class ApiCallStats {
+public:
+    struct Entry {
+        std::string name;
+        uint64_t count = 0;
+        uint64_t fast_path_count = 0;   //calls that didn't need the call lock or the offboard thread
+        double mean_ms = 0;
+        double max_ms = 0;
+        double last_ms = 0;
+    };
+
+    //records the call when it goes out of scope
+    class Timer {
+    public:
+        template<typename TCall>
+        Timer(ApiCallStats& stats, TCall call)
+            : stats_(stats), call_(static_cast<uint>(call)), start_(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~Timer()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            stats_.record(call_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), fast_path_);
+        }
+
+        void setFastPath()
+        {
+            fast_path_ = true;
+        }
+
+    private:
+        ApiCallStats& stats_;
+        uint call_;
+        std::chrono::steady_clock::time_point start_;
+        bool fast_path_ = false;
+    };
+
+    //calls are recorded by index into names
+    ApiCallStats(const vector<std::string>& names)
+        : names_(names), counters_(new Counters[names.size()])
+    {
+    }
+
+    void record(uint call, uint64_t nanos, bool fast_path)
+    {
+        if (call >= names_.size())
+            return;
+
+        Counters& counters = counters_[call];
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        if (fast_path)
+            counters.fast_path_count.fetch_add(1, std::memory_order_relaxed);
+        counters.total_nanos.fetch_add(nanos, std::memory_order_relaxed);
+        counters.last_nanos.store(nanos, std::memory_order_relaxed);
+
+        uint64_t max_nanos = counters.max_nanos.load(std::memory_order_relaxed);
+        while (nanos > max_nanos && !counters.max_nanos.compare_exchange_weak(max_nanos, nanos, std::memory_order_relaxed))
+            ;
+    }
+
+    //calls that were never made are left out
+    vector<Entry> getEntries() const
+    {
+        vector<Entry> entries;
+        for (size_t i = 0; i < names_.size(); ++i) {
+            const Counters& counters = counters_[i];
+            uint64_t count = counters.count.load(std::memory_order_relaxed);
+            if (count == 0)
+                continue;
+
+            Entry entry;
+            entry.name = names_[i];
+            entry.count = count;
+            entry.fast_path_count = counters.fast_path_count.load(std::memory_order_relaxed);
+            entry.mean_ms = counters.total_nanos.load(std::memory_order_relaxed) * 1E-6 / count;
+            entry.max_ms = counters.max_nanos.load(std::memory_order_relaxed) * 1E-6;
+            entry.last_ms = counters.last_nanos.load(std::memory_order_relaxed) * 1E-6;
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    void reset()
+    {
+        for (size_t i = 0; i < names_.size(); ++i) {
+            Counters& counters = counters_[i];
+            counters.count = 0;
+            counters.fast_path_count = 0;
+            counters.total_nanos = 0;
+            counters.max_nanos = 0;
+            counters.last_nanos = 0;
+        }
+    }
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> fast_path_count{ 0 };
+        std::atomic<uint64_t> total_nanos{ 0 };
+        std::atomic<uint64_t> max_nanos{ 0 };
+        std::atomic<uint64_t> last_nanos{ 0 };
+    };
+
+    vector<std::string> names_;
+    std::unique_ptr<Counters[]> counters_;
+};
+
+}} //namespace
+#endif
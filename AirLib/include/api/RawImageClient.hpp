@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RawImageClient_hpp
+#define air_RawImageClient_hpp
+
+#include "common/Common.hpp"
+#include "controllers/VehicleCameraBase.hpp"
+#include "api/RawImageFrame.hpp"
+
+
+namespace msr { namespace airlib {
+
+/*
+    Client for RawImageServer. getImages() receives the whole response into one buffer and returns views
+    into it, so the only copy on this side is the socket read. Use one client per thread, each
+    client is one connection and requests on it are answered in order.
+*/
+class RawImageClient {
+public:
+    //port is the RPC port of the vehicle plus RawImageFrame::kPortOffset
+    RawImageClient(const string& ip_address = "localhost", uint16_t port = 41451 + RawImageFrame::kPortOffset);
+    ~RawImageClient();
+
+    //throws std::runtime_error if the connection fails or the server reports an error
+    RawImageBatch getImages(const vector<VehicleCameraBase::ImageRequest>& request);
+    void close();
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl_;
+};
+
+
+}} //namespace
+#endif
@@ -0,0 +1,318 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RawImageFrame_hpp
+#define air_RawImageFrame_hpp
+
+#include "common/Common.hpp"
+#include "controllers/VehicleCameraBase.hpp"
+#include <cstring>
+#include <memory>
+
+namespace msr { namespace airlib {
+
+/*
+    One image of a RawImageBatch. The pixels are not copied out of the received frame: data points into
+    the batch buffer, which buffer keeps alive, so the view can be handed straight to OpenCV or numpy.
+    For uncompressed images channels is the number of values per pixel (4 for RGBA scene images, 1 for
+    float or DepthU16 depth), for compressed images it is 0 and data is the encoded file.
+*/
+struct RawImage {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::shared_ptr<const vector<uint8_t>> buffer;
+
+    Vector3r camera_position = Vector3r::Zero();
+    Quaternionr camera_orientation = Quaternionr::Identity();
+    TTimePoint time_stamp = 0;
+    std::string message;
+    bool pixels_as_float = false;
+    bool compress = true;
+    int width = 0, height = 0;
+    uint channels = 0;
+    VehicleCameraBase::ImageType image_type = VehicleCameraBase::ImageType::Scene;
+    VehicleCameraBase::ImageEncoding encoding = VehicleCameraBase::ImageEncoding::Default;
+
+    //pixels of a pixels_as_float image, payloads are 16 byte aligned in the buffer so this is safe to dereference
+    const float* asFloat() const
+    {
+        return reinterpret_cast<const float*>(data);
+    }
+    size_t floatCount() const
+    {
+        return size / sizeof(float);
+    }
+};
+
+struct RawImageBatch {
+    std::shared_ptr<const vector<uint8_t>> buffer;
+    vector<RawImage> images;
+};
+
+/*
+    Wire format of the raw image channel. All values are little endian.
+    request:  uint32 magic, uint16 version, uint16 count,
+              then count times uint8 camera_id, uint8 image_type, uint8 pixels_as_float, uint8 compress, uint8 encoding
+    response: uint32 magic, uint16 version, uint16 count, uint32 error length, uint32 reserved, uint64 body size,
+              then the body: error text, count image headers of kImageHeaderSize bytes, the messages back to back,
+              and the payloads, each starting at a multiple of kPayloadAlignment from the start of the body.
+    image header: uint64 payload offset, uint64 payload size, uint64 time_stamp, float position x,y,z,
+              float orientation w,x,y,z, int32 width, int32 height, uint8 image_type, uint8 pixels_as_float,
+              uint8 compress, uint8 channels, uint32 message length, uint8 encoding, 3 bytes reserved
+    Float images are sent as the raw bytes of image_data_float, encoded images as image_data_uint8.
+*/
+class RawImageFrame {
+public:
+    static constexpr uint32_t kRequestMagic = 0x51524941;  //"AIRQ"
+    static constexpr uint32_t kResponseMagic = 0x53524941; //"AIRS"
+    static constexpr uint16_t kVersion = 1;
+    static constexpr size_t kRequestHeaderSize = 8;
+    static constexpr size_t kRequestItemSize = 5;
+    static constexpr size_t kResponseHeaderSize = 24;
+    static constexpr size_t kImageHeaderSize = 72;
+    static constexpr size_t kPayloadAlignment = 16;
+    //the raw image server listens on the RPC server port plus this
+    static constexpr uint16_t kPortOffset = 10000;
+
+    //a piece of the response to send, pieces are written back to back with a gather write
+    struct Segment {
+        const uint8_t* data;
+        size_t size;
+    };
+
+    static void encodeRequest(const vector<VehicleCameraBase::ImageRequest>& request, vector<uint8_t>& out)
+    {
+        out.clear();
+        put<uint32_t>(out, kRequestMagic);
+        put<uint16_t>(out, kVersion);
+        put<uint16_t>(out, static_cast<uint16_t>(request.size()));
+        for (const auto& item : request) {
+            out.push_back(item.camera_id);
+            out.push_back(static_cast<uint8_t>(item.image_type));
+            out.push_back(item.pixels_as_float ? 1 : 0);
+            out.push_back(item.compress ? 1 : 0);
+            out.push_back(static_cast<uint8_t>(item.encoding));
+        }
+    }
+
+    //returns the number of requests that follow the header or -1 if header is not a request this version understands
+    static int decodeRequestHeader(const uint8_t* header)
+    {
+        if (get<uint32_t>(header) != kRequestMagic || get<uint16_t>(header + 4) != kVersion)
+            return -1;
+        return get<uint16_t>(header + 6);
+    }
+
+    static void decodeRequestItems(const uint8_t* data, uint count, vector<VehicleCameraBase::ImageRequest>& request)
+    {
+        request.resize(count);
+        for (uint i = 0; i < count; ++i) {
+            const uint8_t* item = data + i * kRequestItemSize;
+            request[i] = VehicleCameraBase::ImageRequest(item[0],
+                static_cast<VehicleCameraBase::ImageType>(item[1]), item[2] != 0, item[3] != 0,
+                static_cast<VehicleCameraBase::ImageEncoding>(item[4]));
+        }
+    }
+
+    /*
+        Lays out the response to response. Everything except the payloads goes into head, the payloads are
+        referenced where they are, so response must outlive segments. segments is head followed by
+        padding and payload for each image.
+    */
+    static void encodeResponse(const vector<VehicleCameraBase::ImageResponse>& response, vector<uint8_t>& head,
+        vector<Segment>& segments)
+    {
+        encodeHead(response, "", head);
+        segments.clear();
+        segments.push_back(Segment{ head.data(), head.size() });
+
+        size_t offset = head.size() - kResponseHeaderSize;
+        for (const auto& image : response) {
+            size_t padding = paddingFor(offset);
+            if (padding > 0)
+                segments.push_back(Segment{ zeros(), padding });
+            offset += padding;
+
+            Segment payload = payloadOf(image);
+            if (payload.size > 0)
+                segments.push_back(payload);
+            offset += payload.size;
+        }
+    }
+
+    static void encodeError(const std::string& error, vector<uint8_t>& out)
+    {
+        encodeHead(vector<VehicleCameraBase::ImageResponse>(), error, out);
+    }
+
+    //reads the response header, returns false if it is not a response this version understands
+    static bool decodeResponseHeader(const uint8_t* header, uint& count, uint& error_length, uint64_t& body_size)
+    {
+        if (get<uint32_t>(header) != kResponseMagic || get<uint16_t>(header + 4) != kVersion)
+            return false;
+        count = get<uint16_t>(header + 6);
+        error_length = get<uint32_t>(header + 8);
+        body_size = get<uint64_t>(header + 16);
+        return true;
+    }
+
+    /*
+        Parses a body received after a header into views. body must stay unchanged for as long as the
+        images are used, which their buffer member takes care of. Returns false if the body is malformed,
+        error is set if the server reported one.
+    */
+    static bool decodeResponseBody(std::shared_ptr<const vector<uint8_t>> body, uint count, uint error_length,
+        RawImageBatch& batch, std::string& error)
+    {
+        const uint8_t* data = body->data();
+        size_t size = body->size();
+        batch.buffer = body;
+        batch.images.clear();
+
+        if (size < error_length)
+            return false;
+        error.assign(reinterpret_cast<const char*>(data), error_length);
+
+        size_t headers = error_length;
+        if ((size - headers) / kImageHeaderSize < count)
+            return false;
+        size_t message_offset = headers + count * kImageHeaderSize;
+
+        batch.images.resize(count);
+        for (uint i = 0; i < count; ++i) {
+            const uint8_t* h = data + headers + i * kImageHeaderSize;
+            RawImage& image = batch.images[i];
+
+            uint64_t payload_offset = get<uint64_t>(h);
+            uint64_t payload_size = get<uint64_t>(h + 8);
+            if (payload_offset > size || payload_size > size - payload_offset)
+                return false;
+            image.data = data + payload_offset;
+            image.size = static_cast<size_t>(payload_size);
+            image.buffer = body;
+
+            image.time_stamp = get<uint64_t>(h + 16);
+            image.camera_position = Vector3r(get<float>(h + 24), get<float>(h + 28), get<float>(h + 32));
+            image.camera_orientation = Quaternionr(get<float>(h + 36), get<float>(h + 40), get<float>(h + 44), get<float>(h + 48));
+            image.width = get<int32_t>(h + 52);
+            image.height = get<int32_t>(h + 56);
+            image.image_type = static_cast<VehicleCameraBase::ImageType>(h[60]);
+            image.pixels_as_float = h[61] != 0;
+            image.compress = h[62] != 0;
+            image.channels = h[63];
+
+            uint32_t message_length = get<uint32_t>(h + 64);
+            image.encoding = static_cast<VehicleCameraBase::ImageEncoding>(h[68]);
+            if (size - message_offset < message_length)
+                return false;
+            image.message.assign(reinterpret_cast<const char*>(data + message_offset), message_length);
+            message_offset += message_length;
+        }
+        return true;
+    }
+
+private:
+    static void encodeHead(const vector<VehicleCameraBase::ImageResponse>& response, const std::string& error,
+        vector<uint8_t>& out)
+    {
+        size_t messages_size = 0;
+        for (const auto& image : response)
+            messages_size += image.message.size();
+        size_t body_prefix = error.size() + response.size() * kImageHeaderSize + messages_size;
+
+        //payload offsets are relative to the body, which starts after the response header
+        vector<uint64_t> offsets(response.size());
+        size_t body_size = body_prefix;
+        for (size_t i = 0; i < response.size(); ++i) {
+            body_size += paddingFor(body_size);
+            offsets[i] = body_size;
+            body_size += payloadOf(response[i]).size;
+        }
+
+        out.clear();
+        out.reserve(kResponseHeaderSize + body_prefix);
+        put<uint32_t>(out, kResponseMagic);
+        put<uint16_t>(out, kVersion);
+        put<uint16_t>(out, static_cast<uint16_t>(response.size()));
+        put<uint32_t>(out, static_cast<uint32_t>(error.size()));
+        put<uint32_t>(out, 0);
+        put<uint64_t>(out, body_size);
+        out.insert(out.end(), error.begin(), error.end());
+
+        for (size_t i = 0; i < response.size(); ++i) {
+            const auto& image = response[i];
+            Segment payload = payloadOf(image);
+            put<uint64_t>(out, offsets[i]);
+            put<uint64_t>(out, payload.size);
+            put<uint64_t>(out, image.time_stamp);
+            put<float>(out, image.camera_position.x());
+            put<float>(out, image.camera_position.y());
+            put<float>(out, image.camera_position.z());
+            put<float>(out, image.camera_orientation.w());
+            put<float>(out, image.camera_orientation.x());
+            put<float>(out, image.camera_orientation.y());
+            put<float>(out, image.camera_orientation.z());
+            put<int32_t>(out, image.width);
+            put<int32_t>(out, image.height);
+            out.push_back(static_cast<uint8_t>(image.image_type));
+            out.push_back(image.pixels_as_float ? 1 : 0);
+            out.push_back(image.compress ? 1 : 0);
+            out.push_back(static_cast<uint8_t>(channelsOf(image)));
+            put<uint32_t>(out, static_cast<uint32_t>(image.message.size()));
+            out.push_back(static_cast<uint8_t>(image.encoding));
+            out.insert(out.end(), 3, 0);
+        }
+        for (const auto& image : response)
+            out.insert(out.end(), image.message.begin(), image.message.end());
+    }
+
+    static Segment payloadOf(const VehicleCameraBase::ImageResponse& image)
+    {
+        if (image.hasFloatData())
+            return Segment{ reinterpret_cast<const uint8_t*>(image.image_data_float.data()),
+                image.image_data_float.size() * sizeof(float) };
+        else
+            return Segment{ image.image_data_uint8.data(), image.image_data_uint8.size() };
+    }
+
+    static uint channelsOf(const VehicleCameraBase::ImageResponse& image)
+    {
+        size_t pixels = static_cast<size_t>(std::max(image.width, 0)) * static_cast<size_t>(std::max(image.height, 0));
+        if (pixels == 0 || image.compress)
+            return 0;
+        if (image.hasFloatData())
+            return static_cast<uint>(image.image_data_float.size() / pixels);
+        if (image.encoding == VehicleCameraBase::ImageEncoding::DepthU16)
+            return 1;
+        return static_cast<uint>(image.image_data_uint8.size() / pixels);
+    }
+
+    static size_t paddingFor(size_t offset)
+    {
+        return (kPayloadAlignment - offset % kPayloadAlignment) % kPayloadAlignment;
+    }
+
+    static const uint8_t* zeros()
+    {
+        static const uint8_t padding[kPayloadAlignment] = {};
+        return padding;
+    }
+
+    template<typename T>
+    static void put(vector<uint8_t>& out, T val)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&val);
+        out.insert(out.end(), p, p + sizeof(T));
+    }
+
+    template<typename T>
+    static T get(const uint8_t* p)
+    {
+        T val;
+        std::memcpy(&val, p, sizeof(T));
+        return val;
+    }
+};
+
+}} //namespace
+#endif
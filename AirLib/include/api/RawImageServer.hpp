@@ -0,0 +1,36 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RawImageServer_hpp
+#define air_RawImageServer_hpp
+
+#include "common/Common.hpp"
+#include "api/ControlServerBase.hpp"
+#include "api/VehicleApiBase.hpp"
+
+
+namespace msr { namespace airlib {
+
+/*
+    Binary image channel next to the RPC server. Clients send a request frame (see RawImageFrame) and get
+    the images back as one framed response in which the pixel buffers are written straight from the
+    ImageResponse vectors with a gather write, so images are neither copied into msgpack nor converted
+    element by element. Each connection is served by its own thread and handles one request at a time.
+*/
+class RawImageServer : public ControlServerBase {
+public:
+    RawImageServer(VehicleApiBase* vehicle, string server_address, uint16_t port);
+    virtual void start(bool block = false) override;
+    virtual void stop() override;
+    virtual ~RawImageServer() override;
+
+    uint16_t getPort() const;
+
+private:
+    struct impl;
+    std::unique_ptr<impl> pimpl_;
+};
+
+
+}} //namespace
+#endif
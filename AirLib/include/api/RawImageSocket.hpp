@@ -0,0 +1,233 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RawImageSocket_hpp
+#define air_RawImageSocket_hpp
+
+//Socket calls used by RawImageServer and RawImageClient, only include this from their .cpp files
+//because it pulls in the platform socket headers.
+
+#include "common/Common.hpp"
+#include "api/RawImageFrame.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment (lib, "Ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace msr { namespace airlib {
+
+class RawImageSocket {
+public:
+#ifdef _WIN32
+    typedef SOCKET Handle;
+    static constexpr Handle kInvalid = INVALID_SOCKET;
+#else
+    typedef int Handle;
+    static constexpr Handle kInvalid = -1;
+#endif
+
+    //call once before using sockets, the matching cleanup is left to process exit like the rest of AirLib
+    static void initialize()
+    {
+#ifdef _WIN32
+        static bool initialized = []() {
+            WSADATA wsa;
+            return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+        }();
+        unused(initialized);
+#endif
+    }
+
+    //bound and listening socket, address "" means any adapter
+    static Handle listen(const std::string& address, uint16_t port)
+    {
+        initialize();
+        Handle sock = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == kInvalid)
+            throw std::runtime_error("Can't create socket for raw image server");
+
+        int reuse = 1;
+        ::setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (address != "" && ::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+            close(sock);
+            throw std::runtime_error(Utils::stringf("Raw image server address %s is not an IPv4 address", address.c_str()));
+        }
+        if (::bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(sock, 4) != 0) {
+            close(sock);
+            throw std::runtime_error(Utils::stringf("Can't listen for raw image clients on port %d", port));
+        }
+        return sock;
+    }
+
+    static Handle connect(const std::string& host, uint16_t port)
+    {
+        initialize();
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* result = nullptr;
+        if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || result == nullptr)
+            throw std::runtime_error(Utils::stringf("Can't resolve raw image server %s", host.c_str()));
+
+        Handle sock = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        bool connected = sock != kInvalid && ::connect(sock, result->ai_addr, static_cast<int>(result->ai_addrlen)) == 0;
+        ::freeaddrinfo(result);
+        if (!connected) {
+            close(sock);
+            throw std::runtime_error(Utils::stringf("Can't connect to raw image server %s:%d", host.c_str(), port));
+        }
+        setNoDelay(sock);
+        return sock;
+    }
+
+    //returns kInvalid if nobody connected within timeout_ms
+    static Handle accept(Handle listener, int timeout_ms)
+    {
+        if (!waitReadable(listener, timeout_ms))
+            return kInvalid;
+        Handle sock = ::accept(listener, nullptr, nullptr);
+        if (sock != kInvalid)
+            setNoDelay(sock);
+        return sock;
+    }
+
+    static bool waitReadable(Handle sock, int timeout_ms)
+    {
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(sock, &read_set);
+        timeval timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        return ::select(static_cast<int>(sock) + 1, &read_set, nullptr, nullptr, &timeout) > 0;
+    }
+
+    //reads exactly size bytes, false if the connection closed or failed first
+    static bool receive(Handle sock, uint8_t* data, size_t size)
+    {
+        while (size > 0) {
+            int chunk = static_cast<int>(std::min<size_t>(size, 1 << 30));
+            int count = ::recv(sock, reinterpret_cast<char*>(data), chunk, 0);
+            if (count <= 0)
+                return false;
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    //writes all segments with as few calls as the OS allows, the payloads are sent from where they are
+    static bool send(Handle sock, const vector<RawImageFrame::Segment>& segments)
+    {
+#ifdef _WIN32
+        vector<WSABUF> buffers;
+        for (const auto& segment : segments) {
+            WSABUF buffer;
+            buffer.buf = const_cast<char*>(reinterpret_cast<const char*>(segment.data));
+            buffer.len = static_cast<ULONG>(segment.size);
+            buffers.push_back(buffer);
+        }
+        //blocking sockets only return from WSASend once everything is sent or the connection failed
+        DWORD sent = 0;
+        return ::WSASend(sock, buffers.data(), static_cast<DWORD>(buffers.size()), &sent, 0, nullptr, nullptr) == 0;
+#else
+        vector<iovec> buffers;
+        for (const auto& segment : segments) {
+            iovec buffer;
+            buffer.iov_base = const_cast<uint8_t*>(segment.data);
+            buffer.iov_len = segment.size;
+            buffers.push_back(buffer);
+        }
+
+        size_t first = 0;
+        while (first < buffers.size()) {
+            msghdr message = {};
+            message.msg_iov = buffers.data() + first;
+            message.msg_iovlen = buffers.size() - first;
+            if (message.msg_iovlen > kMaxGather)
+                message.msg_iovlen = kMaxGather;
+            ssize_t count = ::sendmsg(sock, &message, kSendFlags);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            //skip what was written, partially written buffer is trimmed in place
+            size_t written = static_cast<size_t>(count);
+            while (first < buffers.size() && written >= buffers[first].iov_len) {
+                written -= buffers[first].iov_len;
+                ++first;
+            }
+            if (written > 0) {
+                buffers[first].iov_base = static_cast<uint8_t*>(buffers[first].iov_base) + written;
+                buffers[first].iov_len -= written;
+            }
+        }
+        return true;
+#endif
+    }
+
+    //wakes up threads blocked on the socket
+    static void shutdown(Handle sock)
+    {
+        if (sock == kInvalid)
+            return;
+#ifdef _WIN32
+        ::shutdown(sock, SD_BOTH);
+#else
+        ::shutdown(sock, SHUT_RDWR);
+#endif
+    }
+
+    static void close(Handle sock)
+    {
+        if (sock == kInvalid)
+            return;
+#ifdef _WIN32
+        ::closesocket(sock);
+#else
+        ::close(sock);
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    static constexpr size_t kMaxGather = 64;
+#ifdef MSG_NOSIGNAL
+    //a client going away must not raise SIGPIPE in the simulator
+    static constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+    static constexpr int kSendFlags = 0;
+#endif
+#endif
+
+    static void setNoDelay(Handle sock)
+    {
+        //the small head and padding segments must not wait for the ack of the previous payload
+        int no_delay = 1;
+        ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+    }
+};
+
+}} //namespace
+#endif
@@ -202,8 +202,9 @@ public:
         msr::airlib::VehicleCameraBase::ImageType image_type;
         bool pixels_as_float;
         bool compress;
+        msr::airlib::VehicleCameraBase::ImageEncoding encoding = msr::airlib::VehicleCameraBase::ImageEncoding::Default;
 
-        MSGPACK_DEFINE_MAP(camera_id, image_type, pixels_as_float, compress);
+        MSGPACK_DEFINE_MAP(camera_id, image_type, pixels_as_float, compress, encoding);
 
         ImageRequest()
         {}
@@ -214,6 +215,7 @@ public:
             image_type = s.image_type;
             pixels_as_float = s.pixels_as_float;
             compress = s.compress;
+            encoding = s.encoding;
         }
 
         msr::airlib::VehicleCameraBase::ImageRequest to() const
@@ -223,6 +225,7 @@ public:
             d.image_type = image_type;
             d.pixels_as_float = pixels_as_float;
             d.compress = compress;
+            d.encoding = encoding;
 
             return d;
         }
@@ -259,9 +262,10 @@ public:
         bool compress;
         int width, height;
         msr::airlib::VehicleCameraBase::ImageType image_type;
+        msr::airlib::VehicleCameraBase::ImageEncoding encoding = msr::airlib::VehicleCameraBase::ImageEncoding::Default;
 
         MSGPACK_DEFINE_MAP(image_data_uint8, image_data_float, camera_position, 
-            camera_orientation, time_stamp, message, pixels_as_float, compress, width, height, image_type);
+            camera_orientation, time_stamp, message, pixels_as_float, compress, width, height, image_type, encoding);
 
         ImageResponse()
         {}
@@ -287,6 +291,7 @@ public:
             width = s.width;
             height = s.height;
             image_type = s.image_type;
+            encoding = s.encoding;
         }
 
         msr::airlib::VehicleCameraBase::ImageResponse to() const
@@ -294,8 +299,9 @@ public:
             msr::airlib::VehicleCameraBase::ImageResponse d;
 
             d.pixels_as_float = pixels_as_float;
+            d.encoding = encoding;
 
-            if (! pixels_as_float)
+            if (! d.hasFloatData())
                 d.image_data_uint8 = image_data_uint8;
             else
                 d.image_data_float = image_data_float;
@@ -338,6 +344,7 @@ public:
 MSGPACK_ADD_ENUM(msr::airlib::SafetyEval::SafetyViolationType_);
 MSGPACK_ADD_ENUM(msr::airlib::SafetyEval::ObsAvoidanceStrategy);
 MSGPACK_ADD_ENUM(msr::airlib::VehicleCameraBase::ImageType);
+MSGPACK_ADD_ENUM(msr::airlib::VehicleCameraBase::ImageEncoding);
 
 
 #endif
@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RpcLibAsyncCall_hpp
+#define air_RpcLibAsyncCall_hpp
+
+#include "common/Common.hpp"
+#include <future>
+#include <chrono>
+#include <stdexcept>
+#include "rpc/client.h"
+
+
+namespace msr { namespace airlib_rpclib {
+
+/*
+    Helpers for the *Async methods of RPC clients. The request is written to the connection right away
+    and rpclib matches replies to requests by id, so many calls can be in flight on one connection.
+    The returned future is deferred: the reply is converted to the API type on the thread that calls
+    wait() or get(), so no thread is created per call. Because of that wait_for() on the future reports
+    future_status::deferred instead of waiting, use wait() or get(). Waiting for the reply uses the same
+    timeout as blocking calls, counted from when wait() or get() is called.
+*/
+class RpcLibAsyncCall {
+public:
+    //convert is called with the reply as RPCLIB_MSGPACK::object_handle and returns TResult
+    template<typename TResult, typename TConvert, typename... TArgs>
+    static std::future<TResult> call(rpc::client* client, int64_t timeout_ms, TConvert convert,
+        const std::string& func_name, TArgs&&... args)
+    {
+        typedef std::future<RPCLIB_MSGPACK::object_handle> Reply;
+        auto reply = std::make_shared<Reply>(client->async_call(func_name, std::forward<TArgs>(args)...));
+
+        return std::async(std::launch::deferred, [reply, timeout_ms, convert, func_name]() -> TResult {
+            if (timeout_ms > 0 && reply->wait_for(std::chrono::milliseconds(timeout_ms)) == std::future_status::timeout)
+                throw std::runtime_error(common_utils::Utils::stringf("Timeout of %lldms while waiting for reply to %s",
+                    static_cast<long long>(timeout_ms), func_name.c_str()));
+            return convert(reply->get());
+        });
+    }
+
+    //call whose reply is a plain msgpack type
+    template<typename TResult, typename... TArgs>
+    static std::future<TResult> callAs(rpc::client* client, int64_t timeout_ms, const std::string& func_name, TArgs&&... args)
+    {
+        return call<TResult>(client, timeout_ms, [](const RPCLIB_MSGPACK::object_handle& result) {
+            return result.as<TResult>();
+        }, func_name, std::forward<TArgs>(args)...);
+    }
+
+    //call whose reply is an adaptor type that converts to the API type with to()
+    template<typename TAdaptor, typename... TArgs>
+    static auto callAdaptor(rpc::client* client, int64_t timeout_ms, const std::string& func_name, TArgs&&... args)
+        -> std::future<decltype(std::declval<TAdaptor>().to())>
+    {
+        typedef decltype(std::declval<TAdaptor>().to()) TResult;
+        return call<TResult>(client, timeout_ms, [](const RPCLIB_MSGPACK::object_handle& result) {
+            return result.as<TAdaptor>().to();
+        }, func_name, std::forward<TArgs>(args)...);
+    }
+
+    //call without a result, get() still throws if the server reported an error
+    template<typename... TArgs>
+    static std::future<void> callVoid(rpc::client* client, int64_t timeout_ms, const std::string& func_name, TArgs&&... args)
+    {
+        return call<void>(client, timeout_ms, [](const RPCLIB_MSGPACK::object_handle& result) {
+            unused(result);
+        }, func_name, std::forward<TArgs>(args)...);
+    }
+};
+
+}} //namespace
+#endif
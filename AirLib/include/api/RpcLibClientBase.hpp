@@ -7,10 +7,44 @@
 #include "common/Common.hpp"
 #include "common/CommonStructs.hpp"
 #include "controllers/VehicleCameraBase.hpp"
+#include "physics/WorldSnapshot.hpp"
+#include <future>
+#include <functional>
 
 
 namespace msr { namespace airlib {
 
+/*
+    Waits for many pipelined calls at once. Add the futures returned by *Async methods as the calls are
+    sent, then wait() blocks until every reply is in. Results and errors stay in the shared futures that
+    add() returns, so get() on them after wait() doesn't block.
+*/
+class RpcLibCallBatch {
+public:
+    template<typename T>
+    std::shared_future<T> add(std::future<T>&& call)
+    {
+        std::shared_future<T> shared = call.share();
+        waits_.push_back([shared]() { shared.wait(); });
+        return shared;
+    }
+
+    void wait()
+    {
+        for (auto& wait_call : waits_)
+            wait_call();
+        waits_.clear();
+    }
+
+    size_t size() const
+    {
+        return waits_.size();
+    }
+
+private:
+    vector<std::function<void()>> waits_;
+};
+
 class RpcLibClientBase {
 public:
     enum class ConnectionState : uint {
@@ -35,14 +69,37 @@ public:
 
     CollisionInfo getCollisionInfo();
 
+    //state of every vehicle in the world at one physics step, fields is WorldSnapshotFields combined with |
+    WorldSnapshot simGetWorldSnapshot(uint fields = static_cast<uint>(WorldSnapshotFields::All));
+
     bool simSetSegmentationObjectID(const std::string& mesh_name, int object_id, bool is_name_regex = false);
     int simGetSegmentationObjectID(const std::string& mesh_name);
     void simPrintLogMessage(const std::string& message, std::string message_param = "", unsigned char severity = 0);
 
+    //Async versions of above calls. Each sends its request without waiting for replies to earlier ones so many
+    //calls can be pipelined on this connection, call get() on returned future for the result (see RpcLibAsyncCall).
+    //Server may run pipelined calls in parallel and in any order, so wait for a result before sending a call
+    //that depends on it.
+    std::future<bool> pingAsync();
+    std::future<vector<VehicleCameraBase::ImageResponse>> simGetImagesAsync(vector<VehicleCameraBase::ImageRequest> request);
+    std::future<vector<uint8_t>> simGetImageAsync(int camera_id, VehicleCameraBase::ImageType type);
+    std::future<msr::airlib::GeoPoint> getHomeGeoPointAsync();
+    std::future<void> simSetPoseAsync(const Pose& pose, bool ignore_collision);
+    std::future<Pose> simGetPoseAsync();
+    std::future<bool> isApiControlEnabledAsync();
+    std::future<void> enableApiControlAsync(bool is_enabled);
+    std::future<void> resetAsync();
+    std::future<CollisionInfo> getCollisionInfoAsync();
+    std::future<WorldSnapshot> simGetWorldSnapshotAsync(uint fields = static_cast<uint>(WorldSnapshotFields::All));
+    std::future<bool> simSetSegmentationObjectIDAsync(const std::string& mesh_name, int object_id, bool is_name_regex = false);
+    std::future<int> simGetSegmentationObjectIDAsync(const std::string& mesh_name);
+    std::future<void> simPrintLogMessageAsync(const std::string& message, std::string message_param = "", unsigned char severity = 0);
+
     virtual ~RpcLibClientBase();    //required for pimpl
 
 protected:
     void* getClient();
+    uint getTimeoutMs() const;
 
 private:
     struct impl;
@@ -6,6 +6,7 @@
 
 #include "common/CommonStructs.hpp"
 #include "controllers/VehicleCameraBase.hpp"
+#include "physics/WorldSnapshot.hpp"
 
 namespace msr { namespace airlib {
 
@@ -30,6 +31,9 @@ public:
     
     virtual CollisionInfo getCollisionInfo() = 0;
 
+    //state of every vehicle in the world at one physics step, fields is WorldSnapshotFields combined with |
+    virtual WorldSnapshot simGetWorldSnapshot(uint fields) = 0;
+
     virtual ~VehicleApiBase() = default;
 };
 
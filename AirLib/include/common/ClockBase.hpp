@@ -51,6 +51,13 @@ public:
         return step_count_;
     }
 
+    //how much wall clock time passes while this clock advances by dt, threads waiting on
+    //this clock use it to block instead of spinning
+    virtual TTimeDelta wallTimeFor(TTimeDelta dt) const
+    {
+        return dt;
+    }
+
     virtual void sleep_for(TTimeDelta dt)
     {
         if (dt <= 0)
@@ -14,6 +14,12 @@ public:
     //output of this function should not be stored as pointer might change
     static ClockBase* get(std::shared_ptr<ClockBase> val = nullptr)
     {
+        //clock set for current thread takes precedence so that independent
+        //worlds with their own clocks can run on different threads
+        ClockBase* thread_clock = threadClock();
+        if (val == nullptr && thread_clock != nullptr)
+            return thread_clock;
+
         static std::shared_ptr<ClockBase> clock;
 
         if (val != nullptr)
@@ -25,6 +31,33 @@ public:
         return clock.get();
     }
 
+    //override clock for calling thread only, nullptr reverts to process wide clock
+    //caller owns the clock and must keep it alive while it is set
+    static void setThreadClock(ClockBase* val)
+    {
+        threadClock() = val;
+    }
+
+    //sets thread clock for the lifetime of this object and restores previous one after
+    class ThreadClockScope {
+    public:
+        ThreadClockScope(ClockBase* val)
+            : previous_(threadClock())
+        {
+            threadClock() = val;
+        }
+        ~ThreadClockScope()
+        {
+            threadClock() = previous_;
+        }
+
+        ThreadClockScope(ThreadClockScope const&) = delete;
+        void operator=(ThreadClockScope const&) = delete;
+
+    private:
+        ClockBase* previous_;
+    };
+
     //don't allow multiple instances of this class
     ClockFactory(ClockFactory const&) = delete;
     void operator=(ClockFactory const&) = delete;
@@ -32,6 +65,12 @@ public:
 private:
     //disallow instance creation
     ClockFactory(){}
+
+    static ClockBase*& threadClock()
+    {
+        static thread_local ClockBase* clock = nullptr;
+        return clock;
+    }
 };
 
 }} //namespace
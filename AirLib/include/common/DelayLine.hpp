@@ -6,13 +6,20 @@
 
 #include "common/Common.hpp"
 #include "UpdatableObject.hpp"
-#include <list>
+#include <vector>
 
 namespace msr { namespace airlib {
 
+/*
+    Holds values back for delay seconds. Values are kept in a ring buffer that is allocated once and
+    only grows (doubling) if more values are in flight than it can hold, so a sensor pushing at a fixed
+    rate stops allocating after the first few samples.
+*/
 template<typename T>
 class DelayLine : UpdatableObject {
 public:
+    static constexpr uint kInitialCapacity = 16;
+
     DelayLine()
     {}
     DelayLine(TTimeDelta delay) //in seconds
@@ -22,6 +29,12 @@ public:
     void initialize(TTimeDelta delay)  //in seconds
     {
         setDelay(delay);
+        if (values_.size() < kInitialCapacity) {
+            values_.resize(kInitialCapacity);
+            times_.resize(kInitialCapacity);
+        }
+        head_ = 0;
+        count_ = 0;
     }
     void setDelay(TTimeDelta delay)
     {
@@ -37,8 +50,8 @@ public:
     {
         UpdatableObject::reset();
 
-        values_.clear();
-        times_.clear();
+        head_ = 0;
+        count_ = 0;
         last_time_ = 0;
         last_value_ = T();
     }
@@ -47,14 +60,14 @@ public:
     {
         UpdatableObject::update();
 
-        if (!times_.empty() && 
-            ClockBase::elapsedBetween(clock()->nowNanos(), times_.front()) >= delay_) {
-
-            last_value_ = values_.front();
-            last_time_ = times_.front();
+        //release everything that is due, caller may not update us on every tick
+        TTimePoint now = clock()->nowNanos();
+        while (count_ > 0 && ClockBase::elapsedBetween(now, times_[head_]) >= delay_) {
+            last_value_ = values_[head_];
+            last_time_ = times_[head_];
 
-            times_.pop_front();
-            values_.pop_front();
+            head_ = (head_ + 1) & (static_cast<uint>(values_.size()) - 1);
+            --count_;
         }
     }
     //*** End: UpdatableState implementation ***//
@@ -71,16 +84,41 @@ public:
 
     void push_back(const T& val, TTimePoint time_offset = 0)
     {
-        values_.push_back(val);
-        times_.push_back(clock()->nowNanos() + time_offset);
+        if (count_ == values_.size())
+            grow();
+
+        uint tail = (head_ + count_) & (static_cast<uint>(values_.size()) - 1);
+        values_[tail] = val;
+        times_[tail] = clock()->nowNanos() + time_offset;
+        ++count_;
+    }
+
+    uint size() const
+    {
+        return count_;
     }
 
 private:
-    template<typename TItem>
-    using list = std::list<TItem>;
+    void grow()
+    {
+        uint capacity = values_.empty() ? kInitialCapacity : static_cast<uint>(values_.size()) * 2;
+        std::vector<T> values(capacity);
+        std::vector<TTimePoint> times(capacity);
+        for (uint i = 0; i < count_; ++i) {
+            uint index = (head_ + i) & (static_cast<uint>(values_.size()) - 1);
+            values[i] = values_[index];
+            times[i] = times_[index];
+        }
+        values_.swap(values);
+        times_.swap(times);
+        head_ = 0;
+    }
 
-    list<T> values_;
-    list<TTimePoint> times_;
+    //capacity is always a power of two so wrapping is a mask
+    std::vector<T> values_;
+    std::vector<TTimePoint> times_;
+    uint head_ = 0;
+    uint count_ = 0;
     TTimeDelta delay_;
 
     T last_value_;
@@ -111,6 +111,14 @@ public:
         return update_count_;
     }
 
+    //time at which update() will next see a complete interval (or the end of startup delay),
+    //calling update() earlier than this only advances the elapsed time
+    TTimePoint getNextCompletionTime()
+    {
+        bool in_startup = !startup_complete_ && Utils::isDefinitelyGreaterThan(startup_delay_, 0.0f);
+        return clock()->addTo(last_time_, in_startup ? startup_delay_ : interval_size_sec_);
+    }
+
 private:
     real_T interval_size_sec_;
     TTimeDelta elapsed_total_sec_;
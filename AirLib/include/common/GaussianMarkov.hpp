@@ -24,6 +24,7 @@ public:
         tau_ = tau;
         sigma_ = sigma;
         rand_ = RandomGeneratorGausianR(0.0f, 1.0f);
+        alpha_dt_ = -1;
         
         if (std::isnan(initial_output))
             initial_output_ = getNextRandom() * sigma_;
@@ -56,8 +57,12 @@ public:
         
         TTimeDelta dt = clock()->updateSince(last_time_);
 
-        double alpha = exp(-dt / tau_);
-        output_ = static_cast<real_T>(alpha * output_ + (1 - alpha) * getNextRandom() * sigma_);
+        //update period is nearly always the same so only redo exp() when it changes
+        if (dt != alpha_dt_) {
+            alpha_ = exp(-dt / tau_);
+            alpha_dt_ = dt;
+        }
+        output_ = static_cast<real_T>(alpha_ * output_ + (1 - alpha_) * getNextRandom() * sigma_);
     }
     //*** End: UpdatableState implementation ***//
 
@@ -77,6 +82,8 @@ private:
     real_T tau_, sigma_;
     real_T output_, initial_output_;
     TTimePoint last_time_;
+    double alpha_ = 0;
+    TTimeDelta alpha_dt_ = -1;
 
 };
 
@@ -36,6 +36,11 @@ public:
         }
     }
 
+    virtual TTimeDelta wallTimeFor(TTimeDelta dt) const override
+    {
+        return fromWallDelta(dt);
+    }
+
     virtual void sleep_for(TTimeDelta dt) override
     {
         //for intervals > 2ms just sleep otherwise do spilling otherwise delay won't be accurate
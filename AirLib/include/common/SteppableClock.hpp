@@ -46,6 +46,12 @@ public:
         return current_;
     }
 
+    //the clock may be stepped faster than real time, so waiters look again after one step worth of wall time
+    virtual TTimeDelta wallTimeFor(TTimeDelta dt) const override
+    {
+        return std::min(dt, step_);
+    }
+
 private:
     std::atomic<TTimePoint> current_;
     TTimeDelta step_;
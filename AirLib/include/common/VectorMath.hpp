@@ -36,10 +36,9 @@ public:
 
     typedef common_utils::Utils Utils;
     //use different seeds for each component
-    //TODO: below we are using double instead of RealT becaise of VC++2017 bug in random implementation
-    typedef common_utils::RandomGenerator<RealT, std::normal_distribution<double>, 1> RandomGeneratorGausianXT;
-    typedef common_utils::RandomGenerator<RealT, std::normal_distribution<double>, 2> RandomGeneratorGausianYT;
-    typedef common_utils::RandomGenerator<RealT, std::normal_distribution<double>, 3> RandomGeneratorGausianZT;
+    typedef common_utils::GaussianRandomGenerator<RealT, 1> RandomGeneratorGausianXT;
+    typedef common_utils::GaussianRandomGenerator<RealT, 2> RandomGeneratorGausianYT;
+    typedef common_utils::GaussianRandomGenerator<RealT, 3> RandomGeneratorGausianZT;
     typedef common_utils::RandomGenerator<RealT, std::uniform_real_distribution<RealT>, 1> RandomGeneratorXT;
     typedef common_utils::RandomGenerator<RealT, std::uniform_real_distribution<RealT>, 2> RandomGeneratorYT;
     typedef common_utils::RandomGenerator<RealT, std::uniform_real_distribution<RealT>, 3> RandomGeneratorZT;
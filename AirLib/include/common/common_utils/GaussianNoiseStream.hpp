@@ -0,0 +1,180 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef commn_utils_GaussianNoiseStream_hpp
+#define commn_utils_GaussianNoiseStream_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+namespace common_utils {
+
+/*
+    Counter based random number generator (Philox4x32-10 from Salmon et al, "Parallel Random Numbers: As Easy as 1, 2, 3").
+    The output is a pure function of (key, counter) so there is no state to carry from one call to the next
+    and any block of the sequence can be generated independently. fill() runs kLanes counters side by side,
+    each round is a loop over the lanes with no dependency between them so the compiler can keep a lane per
+    SIMD element.
+*/
+class Philox4x32 {
+public:
+    static constexpr unsigned int kRounds = 10;
+    static constexpr size_t kLanes = 8;
+
+    //generates 4 random words for each of the count consecutive counters starting at counter,
+    //out must have space for 4 * count words and is written in the order counter, counter + 1, ...
+    //counter_high is the upper half of the 128 bit counter, counting doesn't carry into it.
+    static void fill(uint64_t key, uint64_t counter, uint32_t* out, size_t count, uint64_t counter_high = 0)
+    {
+        for (size_t start = 0; start < count; start += kLanes) {
+            uint32_t c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes];
+            for (size_t l = 0; l < kLanes; ++l) {
+                uint64_t c = counter + start + l;
+                c0[l] = static_cast<uint32_t>(c);
+                c1[l] = static_cast<uint32_t>(c >> 32);
+                c2[l] = static_cast<uint32_t>(counter_high);
+                c3[l] = static_cast<uint32_t>(counter_high >> 32);
+            }
+
+            uint32_t key0 = static_cast<uint32_t>(key), key1 = static_cast<uint32_t>(key >> 32);
+            for (unsigned int r = 0; r < kRounds; ++r) {
+                for (size_t l = 0; l < kLanes; ++l) {
+                    uint64_t p0 = static_cast<uint64_t>(kMultiplier0) * c0[l];
+                    uint64_t p1 = static_cast<uint64_t>(kMultiplier1) * c2[l];
+                    c0[l] = static_cast<uint32_t>(p1 >> 32) ^ c1[l] ^ key0;
+                    c2[l] = static_cast<uint32_t>(p0 >> 32) ^ c3[l] ^ key1;
+                    c1[l] = static_cast<uint32_t>(p1);
+                    c3[l] = static_cast<uint32_t>(p0);
+                }
+                key0 += kWeyl0;
+                key1 += kWeyl1;
+            }
+
+            size_t lanes = count - start < kLanes ? count - start : kLanes;
+            for (size_t l = 0; l < lanes; ++l) {
+                uint32_t* o = out + 4 * (start + l);
+                o[0] = c0[l];
+                o[1] = c1[l];
+                o[2] = c2[l];
+                o[3] = c3[l];
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t kMultiplier0 = 0xD2511F53;
+    static constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+    static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+    static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+};
+
+/*
+    Stream of standard normal samples (mean 0, stddev 1) for sensor noise.
+    Samples are made kBlockSize at a time: Philox words for the whole block, then Box-Muller over the block,
+    both as plain loops over arrays so the compiler can use SIMD, and next() just reads the next slot until
+    the block runs out. The stream is fully determined by its seed, reset() starts it over from the first sample
+    and two streams with different seeds are independent. Not thread safe, give each consumer its own stream.
+*/
+template <typename RealT>
+class GaussianNoiseStream {
+public:
+    static constexpr size_t kBlockSize = 128;
+
+    explicit GaussianNoiseStream(uint64_t seed = 0)
+        : seed_(seed)
+    {
+        reset();
+    }
+
+    void seed(uint64_t val)
+    {
+        seed_ = val;
+        reset();
+    }
+
+    void reset()
+    {
+        counter_ = 0;
+        //block is generated lazily so constructing or copying a stream is cheap
+        index_ = kBlockSize;
+    }
+
+    RealT next()
+    {
+        if (index_ == kBlockSize)
+            refill();
+        return block_[index_++];
+    }
+
+    //copies the next count samples to out
+    void next(RealT* out, size_t count)
+    {
+        while (count > 0) {
+            if (index_ == kBlockSize)
+                refill();
+            size_t n = kBlockSize - index_;
+            if (n > count)
+                n = count;
+            for (size_t i = 0; i < n; ++i)
+                out[i] = block_[index_ + i];
+            index_ += n;
+            out += n;
+            count -= n;
+        }
+    }
+
+private:
+    //each Philox call gives 4 words, Box-Muller turns a pair of uniforms into a pair of normals
+    static constexpr size_t kWordsPerBlock = kBlockSize * (sizeof(RealT) > 4 ? 2 : 1);
+    static_assert(kBlockSize % 2 == 0, "Box-Muller makes samples in pairs");
+
+    void refill()
+    {
+        static constexpr size_t kPairs = kBlockSize / 2;
+        static constexpr double kTwoPi = 6.283185307179586476925286766559;
+
+        uint32_t words[kWordsPerBlock];
+        Philox4x32::fill(seed_, counter_, words, kWordsPerBlock / 4);
+        counter_ += kWordsPerBlock / 4;
+
+        RealT u1[kPairs], u2[kPairs];
+        toUniform(words, u1, u2);
+
+        for (size_t i = 0; i < kPairs; ++i) {
+            RealT radius = std::sqrt(RealT(-2) * std::log(u1[i]));
+            RealT theta = static_cast<RealT>(kTwoPi) * u2[i];
+            block_[2 * i] = radius * std::cos(theta);
+            block_[2 * i + 1] = radius * std::sin(theta);
+        }
+        index_ = 0;
+    }
+
+    //u1 is in (0, 1] so log never sees 0, u2 is in [0, 1)
+    static void toUniform(const uint32_t* words, float* u1, float* u2)
+    {
+        static constexpr float kScale = 1.0f / 16777216.0f; //2^-24
+        for (size_t i = 0; i < kBlockSize / 2; ++i) {
+            u1[i] = static_cast<float>((words[2 * i] >> 8) + 1) * kScale;
+            u2[i] = static_cast<float>(words[2 * i + 1] >> 8) * kScale;
+        }
+    }
+    static void toUniform(const uint32_t* words, double* u1, double* u2)
+    {
+        static constexpr double kScale = 1.0 / 9007199254740992.0; //2^-53
+        for (size_t i = 0; i < kBlockSize / 2; ++i) {
+            uint64_t a = (static_cast<uint64_t>(words[4 * i]) << 21) ^ (words[4 * i + 1] >> 11);
+            uint64_t b = (static_cast<uint64_t>(words[4 * i + 2]) << 21) ^ (words[4 * i + 3] >> 11);
+            u1[i] = static_cast<double>(a + 1) * kScale;
+            u2[i] = static_cast<double>(b) * kScale;
+        }
+    }
+
+    RealT block_[kBlockSize];
+    size_t index_;
+    uint64_t counter_;
+    uint64_t seed_;
+};
+
+}  //namespace
+#endif
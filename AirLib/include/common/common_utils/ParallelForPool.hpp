@@ -0,0 +1,153 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef commn_utils_ParallelForPool_hpp
+#define commn_utils_ParallelForPool_hpp
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace common_utils {
+
+/*
+    Fork-join pool for running fixed number of independent work items per step.
+    Workers are persistent and claim next item index from shared atomic counter so
+    idle workers keep taking work from busy ones. Calling thread also participates and
+    run() returns only after all items are done (step barrier). First exception thrown
+    by any item is re-thrown from run().
+*/
+class ParallelForPool {
+public:
+    //thread_count includes calling thread, so 1 means everything runs serially on caller
+    ParallelForPool(unsigned int thread_count = 0)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        for (unsigned int i = 1; i < thread_count; ++i)
+            workers_.emplace_back(&ParallelForPool::workerLoop, this);
+    }
+
+    ~ParallelForPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_signal_.notify_all();
+
+        for (auto& worker : workers_) {
+            if (worker.joinable())
+                worker.join();
+        }
+    }
+
+    unsigned int getThreadCount() const
+    {
+        return static_cast<unsigned int>(workers_.size()) + 1;
+    }
+
+    void run(size_t count, const std::function<void(size_t)>& func)
+    {
+        if (count == 0)
+            return;
+
+        if (workers_.size() == 0 || count == 1) {
+            for (size_t i = 0; i < count; ++i)
+                func(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            func_ = &func;
+            count_ = count;
+            next_index_ = 0;
+            pending_workers_ = workers_.size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        start_signal_.notify_all();
+
+        work();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_signal_.wait(lock, [this] { return pending_workers_ == 0; });
+            func_ = nullptr;
+            error = error_;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    //don't allow copies
+    ParallelForPool(ParallelForPool const&) = delete;
+    void operator=(ParallelForPool const&) = delete;
+
+private:
+    void work()
+    {
+        size_t index;
+        while ((index = next_index_.fetch_add(1)) < count_) {
+            try {
+                (*func_)(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        uint64_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                start_signal_.wait(lock, [this, seen_generation] { return stop_ || generation_ != seen_generation; });
+                if (stop_)
+                    return;
+                seen_generation = generation_;
+            }
+
+            work();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--pending_workers_ == 0)
+                    done_signal_.notify_one();
+            }
+        }
+    }
+
+private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable start_signal_;
+    std::condition_variable done_signal_;
+
+    const std::function<void(size_t)>* func_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_index_ {0};
+    size_t pending_workers_ = 0;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+} //namespace
+#endif
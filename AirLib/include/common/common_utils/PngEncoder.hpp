@@ -0,0 +1,330 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_PngEncoder_hpp
+#define common_utils_PngEncoder_hpp
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+namespace common_utils {
+
+/*
+    Fast PNG writer without external dependency, for 8 bit gray, RGB or RGBA and 16 bit gray images.
+    Speed is chosen over size: every row uses the Up filter and the deflate stream is one block of
+    fixed Huffman codes fed by a greedy LZ77 with a single hash probe. Rendered images with big flat
+    areas still compress well while encoding is several times faster than zlib's default level.
+*/
+class PngEncoder {
+public:
+    //pixels are rows of width * channels samples, 16 bit samples are given in host order
+    static void encode(const uint8_t* pixels, int width, int height, int channels, int bit_depth, std::vector<uint8_t>& out)
+    {
+        const size_t sample_bytes = bit_depth == 16 ? 2 : 1;
+        const size_t row_bytes = static_cast<size_t>(width) * channels * sample_bytes;
+
+        //filtered scanlines: filter type byte then the row minus the row above, samples big endian as PNG wants
+        std::vector<uint8_t> filtered(static_cast<size_t>(height) * (row_bytes + 1));
+        std::vector<uint8_t> previous(row_bytes, 0), current(row_bytes);
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* row = pixels + y * row_bytes;
+            if (sample_bytes == 2) {
+                for (size_t i = 0; i < row_bytes; i += 2) {
+                    uint16_t sample;
+                    std::memcpy(&sample, row + i, 2);
+                    current[i] = static_cast<uint8_t>(sample >> 8);
+                    current[i + 1] = static_cast<uint8_t>(sample);
+                }
+            }
+            else
+                std::memcpy(current.data(), row, row_bytes);
+
+            uint8_t* line = filtered.data() + y * (row_bytes + 1);
+            line[0] = 2;    //Up
+            for (size_t i = 0; i < row_bytes; ++i)
+                line[i + 1] = static_cast<uint8_t>(current[i] - previous[i]);
+            previous.swap(current);
+        }
+
+        out.clear();
+        static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+        out.insert(out.end(), signature, signature + 8);
+
+        uint8_t header[13];
+        putUInt32BE(header, static_cast<uint32_t>(width));
+        putUInt32BE(header + 4, static_cast<uint32_t>(height));
+        header[8] = static_cast<uint8_t>(bit_depth);
+        header[9] = colorType(channels);
+        header[10] = header[11] = header[12] = 0;
+        writeChunk(out, "IHDR", header, sizeof(header));
+
+        std::vector<uint8_t> zlib;
+        deflate(filtered.data(), filtered.size(), zlib);
+        writeChunk(out, "IDAT", zlib.data(), zlib.size());
+        writeChunk(out, "IEND", nullptr, 0);
+    }
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static const std::vector<uint32_t> table = makeCrcTable();
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+private:
+    static constexpr int kHashBits = 15;
+    static constexpr size_t kWindow = 32768;
+    static constexpr size_t kMinMatch = 3;
+    static constexpr size_t kMaxMatch = 258;
+
+    //writes into memory reserved up front so the per symbol path has no bounds checks or reallocation
+    struct BitWriter {
+        uint8_t* out;
+        uint64_t bits = 0;
+        uint32_t count = 0;
+
+        explicit BitWriter(uint8_t* out_val)
+            : out(out_val)
+        {}
+
+        //value is written least significant bit first as deflate requires, length is at most 32
+        void put(uint32_t value, uint32_t length)
+        {
+            bits |= static_cast<uint64_t>(value) << count;
+            count += length;
+            if (count >= 32) {
+                out[0] = static_cast<uint8_t>(bits);
+                out[1] = static_cast<uint8_t>(bits >> 8);
+                out[2] = static_cast<uint8_t>(bits >> 16);
+                out[3] = static_cast<uint8_t>(bits >> 24);
+                out += 4;
+                bits >>= 32;
+                count -= 32;
+            }
+        }
+
+        void flush()
+        {
+            for (; count > 0; count = count > 8 ? count - 8 : 0) {
+                *out++ = static_cast<uint8_t>(bits);
+                bits >>= 8;
+            }
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    //bit reversed code ready for BitWriter, extra bits already appended for lengths and distances
+    struct Code {
+        uint32_t bits;
+        uint32_t length;
+    };
+
+    //fixed Huffman codes, built once
+    struct Tables {
+        Code literals[257];         //bytes and end of block
+        Code lengths[kMaxMatch + 1];
+        Code distances[512];        //by distanceSlot, code and extra bit count
+        uint16_t distance_bases[512];   //by distanceSlot, first distance of the code
+
+        Tables()
+        {
+            static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+            static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+            static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+            static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+            for (uint32_t symbol = 0; symbol < 257; ++symbol)
+                literals[symbol] = symbolCode(symbol);
+
+            for (uint32_t length = kMinMatch; length <= kMaxMatch; ++length) {
+                uint32_t l = 28;
+                while (length_base[l] > length)
+                    --l;
+                Code code = symbolCode(257 + l);
+                code.bits |= (length - length_base[l]) << code.length;
+                code.length += length_extra[l];
+                lengths[length] = code;
+            }
+
+            for (uint32_t d = 0; d < 30; ++d) {
+                for (uint32_t distance = distance_base[d]; distance < (d < 29 ? distance_base[d + 1] : kWindow + 1u); ++distance) {
+                    Code& slot = distances[distanceSlot(distance)];
+                    slot.bits = reverse(d, 5);     //fixed distance codes are 5 bits
+                    slot.length = 5 + distance_extra[d];
+                    distance_bases[distanceSlot(distance)] = distance_base[d];
+                }
+            }
+        }
+
+        //zlib's trick: distances up to 256 map directly, longer ones by their high bits
+        static size_t distanceSlot(size_t distance)
+        {
+            return distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7);
+        }
+
+        static Code symbolCode(uint32_t symbol)
+        {
+            uint32_t code;
+            uint32_t length;
+            if (symbol < 144) { code = 0x30 + symbol; length = 8; }
+            else if (symbol < 256) { code = 0x190 + symbol - 144; length = 9; }
+            else if (symbol < 280) { code = symbol - 256; length = 7; }
+            else { code = 0xC0 + symbol - 280; length = 8; }
+            return Code{ reverse(code, length), length };
+        }
+    };
+
+    static void deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+    {
+        //worst case is every byte a 9 bit literal
+        out.resize(size + size / 8 + 64);
+        out[0] = 0x78;  //deflate, 32K window
+        out[1] = 0x01;  //fastest level, no dictionary
+
+        static const Tables tables;
+        BitWriter writer(out.data() + 2);
+        writer.put(1, 1);       //last block
+        writer.put(1, 2);       //fixed Huffman
+
+        std::vector<uint32_t> table(size_t(1) << kHashBits, UINT32_MAX);
+        size_t ip = 0;
+        while (ip < size) {
+            size_t match_length = 0, distance = 0;
+            if (ip + kMinMatch <= size) {
+                uint32_t h = hash(data + ip);
+                uint32_t candidate = table[h];
+                table[h] = static_cast<uint32_t>(ip);
+                if (candidate != UINT32_MAX && ip - candidate <= kWindow
+                    && data[candidate] == data[ip] && data[candidate + 1] == data[ip + 1] && data[candidate + 2] == data[ip + 2]) {
+                    size_t limit = size - ip;
+                    if (limit > kMaxMatch)
+                        limit = kMaxMatch;
+                    match_length = kMinMatch;
+                    while (match_length < limit && data[candidate + match_length] == data[ip + match_length])
+                        ++match_length;
+                    distance = ip - candidate;
+                }
+            }
+
+            if (match_length == 0) {
+                const Code& code = tables.literals[data[ip]];
+                writer.put(code.bits, code.length);
+                ++ip;
+            }
+            else {
+                //length code with extra bits is at most 13 bits and distance at most 18, so one write
+                const Code& length_code = tables.lengths[match_length];
+                size_t slot = Tables::distanceSlot(distance);
+                const Code& distance_code = tables.distances[slot];
+                uint32_t distance_bits = distance_code.bits | static_cast<uint32_t>((distance - tables.distance_bases[slot]) << 5);
+                writer.put(length_code.bits | (distance_bits << length_code.length), length_code.length + distance_code.length);
+
+                //index a few positions inside the match so later data finds it
+                size_t end = ip + match_length;
+                for (size_t p = ip + 1; p < end && p + kMinMatch <= size; p += 2)
+                    table[hash(data + p)] = static_cast<uint32_t>(p);
+                ip = end;
+            }
+        }
+        writer.put(tables.literals[256].bits, tables.literals[256].length);    //end of block
+        writer.flush();
+        out.resize(writer.out - out.data());
+
+        uint32_t adler = adler32(data, size);
+        out.push_back(static_cast<uint8_t>(adler >> 24));
+        out.push_back(static_cast<uint8_t>(adler >> 16));
+        out.push_back(static_cast<uint8_t>(adler >> 8));
+        out.push_back(static_cast<uint8_t>(adler));
+    }
+
+    static std::vector<uint32_t> makeCrcTable()
+    {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+
+    static uint32_t adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t a = 1, b = 0;
+        while (size > 0) {
+            //5552 is the most bytes before b can overflow 32 bits
+            size_t chunk = std::min<size_t>(size, 5552);
+            for (size_t i = 0; i < chunk; ++i) {
+                a += data[i];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+            data += chunk;
+            size -= chunk;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t reverse(uint32_t code, uint32_t length)
+    {
+        uint32_t result = 0;
+        for (uint32_t i = 0; i < length; ++i) {
+            result = (result << 1) | (code & 1);
+            code >>= 1;
+        }
+        return result;
+    }
+
+    static uint32_t hash(const uint8_t* p)
+    {
+        uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    static uint8_t colorType(int channels)
+    {
+        switch (channels) {
+        case 1: return 0;   //gray
+        case 2: return 4;   //gray and alpha
+        case 3: return 2;   //RGB
+        default: return 6;  //RGBA
+        }
+    }
+
+    static void writeChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+    {
+        uint8_t length[4];
+        putUInt32BE(length, static_cast<uint32_t>(size));
+        out.insert(out.end(), length, length + 4);
+        size_t type_start = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size > 0)
+            out.insert(out.end(), data, data + size);
+        uint8_t crc[4];
+        putUInt32BE(crc, crc32(out.data() + type_start, size + 4));
+        out.insert(out.end(), crc, crc + 4);
+    }
+
+    static void putUInt32BE(uint8_t* p, uint32_t val)
+    {
+        p[0] = static_cast<uint8_t>(val >> 24);
+        p[1] = static_cast<uint8_t>(val >> 16);
+        p[2] = static_cast<uint8_t>(val >> 8);
+        p[3] = static_cast<uint8_t>(val);
+    }
+};
+
+} //namespace
+#endif
@@ -5,6 +5,7 @@
 #define commn_utils_sincos_hpp
 
 #include <random>
+#include "GaussianNoiseStream.hpp"
 
 namespace common_utils {
 
@@ -40,12 +41,41 @@ private:
     std::mt19937 rand_;
 };
 
+//Same interface as RandomGenerator with normal distribution but samples come from a GaussianNoiseStream
+//so the per sample cost is a buffer read and the sequence only depends on the seed, not on the std library.
+template<typename TReturn, unsigned int Seed=42>
+class GaussianRandomGenerator {
+public:
+    GaussianRandomGenerator(TReturn mean = 0, TReturn stddev = 1)
+        : mean_(mean), stddev_(stddev), stream_(Seed)
+    {
+    }
+
+    void seed(int val)
+    {
+        stream_.seed(static_cast<uint64_t>(val));
+    }
+
+    TReturn next()
+    {
+        return mean_ + stddev_ * stream_.next();
+    }
+
+    void reset()
+    {
+        stream_.seed(Seed);
+    }
+
+private:
+    TReturn mean_, stddev_;
+    GaussianNoiseStream<TReturn> stream_;
+};
+
 typedef RandomGenerator<double, std::uniform_real_distribution<double>> RandomGeneratorD;
 typedef RandomGenerator<float, std::uniform_real_distribution<float>> RandomGeneratorF;
 typedef RandomGenerator<int, std::uniform_int_distribution<int>> RandomGeneratorI;
-//TODO: below we should have float instead of double but VC++2017 has a bug :(
-typedef RandomGenerator<float, std::normal_distribution<double>> RandomGeneratorGaussianF;
-typedef RandomGenerator<double, std::normal_distribution<double>> RandomGeneratorGaussianD;
+typedef GaussianRandomGenerator<float> RandomGeneratorGaussianF;
+typedef GaussianRandomGenerator<double> RandomGeneratorGaussianD;
 
 }
 #endif
@@ -11,15 +11,51 @@
 #include <system_error>
 #include <mutex>
 #include <cstdint>
+#include <array>
+#include <string>
+#include "Utils.hpp"
+
+#ifdef __linux__
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace common_utils {
 
 class ScheduledExecutor {
 public:
+    struct PacingParams {
+        //wait for absolute deadline of each period so callback time doesn't cause drift,
+        //on Linux this sleeps using clock_nanosleep instead of spinning
+        bool absolute_deadline = true;
+        //spin for this long at the end of each wait for better precision, 0 = never spin
+        uint64_t spin_nanos = 0;
+        //SCHED_FIFO priority (1-99) for executor thread, 0 = keep default scheduler (Linux only)
+        int realtime_priority = 0;
+        //pin executor thread to this CPU, -1 = no pinning (Linux only)
+        int cpu_affinity = -1;
+    };
+
+    static constexpr size_t kJitterBucketCount = 16;
+    struct JitterStats {
+        //bucket 0 counts wakeups that were late by less than 1us, bucket i by [2^(i-1), 2^i) us,
+        //last bucket gets everything larger
+        std::array<uint64_t, kJitterBucketCount> late_wakeup_histogram;
+        uint64_t max_late_nanos;
+        //periods where callback took longer than period so there was no wait at all
+        uint64_t overrun_count;
+        uint64_t period_count;
+    };
+
     ScheduledExecutor()
-    {}
+    {
+        resetJitterStats();
+    }
     ScheduledExecutor(const std::function<bool(uint64_t)>& callback, uint64_t period_nanos)
     {
+        resetJitterStats();
         initialize(callback, period_nanos);
     }
     ~ScheduledExecutor()
@@ -33,11 +69,22 @@ public:
         started_ = false;
     }
 
+    //takes effect on next start()
+    void setPacingParams(const PacingParams& params)
+    {
+        pacing_params_ = params;
+    }
+    const PacingParams& getPacingParams() const
+    {
+        return pacing_params_;
+    }
+
     void start()
     {
         started_ = true;
         sleep_time_avg_ = 0;
         period_count_ = 0;
+        resetJitterStats();
         Utils::cleanupThread(th_);
         th_ = std::thread(&ScheduledExecutor::executorLoop, this);
     }
@@ -63,15 +110,24 @@ public:
 
     double getSleepTimeAvg()
     {
-        //TODO: make this function thread safe by using atomic types
-        //right now this is not implemented for performance and that
-        //return of this function is purely informational/debugging purposes
-        return sleep_time_avg_;
+        return sleep_time_avg_.load(std::memory_order_relaxed);
     }
 
     uint64_t getPeriodCount()
     {
-        return period_count_;
+        return period_count_.load(std::memory_order_relaxed);
+    }
+
+    //can be called from any thread while executor is running
+    JitterStats getJitterStats() const
+    {
+        JitterStats stats;
+        for (size_t i = 0; i < kJitterBucketCount; ++i)
+            stats.late_wakeup_histogram[i] = late_wakeup_histogram_[i].load(std::memory_order_relaxed);
+        stats.max_late_nanos = max_late_nanos_.load(std::memory_order_relaxed);
+        stats.overrun_count = overrun_count_.load(std::memory_order_relaxed);
+        stats.period_count = period_count_.load(std::memory_order_relaxed);
+        return stats;
     }
 
     void lock()
@@ -84,7 +140,6 @@ public:
     }
 
 private:
-    typedef std::chrono::high_resolution_clock clock;
     typedef uint64_t TTimePoint;
     typedef uint64_t TTimeDelta;
     template <typename T>
@@ -92,7 +147,15 @@ private:
 
     static TTimePoint nanos()
     {
-        return clock::now().time_since_epoch().count();
+#ifdef __linux__
+        //must be same clock as used by clock_nanosleep
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<TTimePoint>(ts.tv_sec) * 1000000000ULL + static_cast<TTimePoint>(ts.tv_nsec);
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
     }
 
     static void sleep_for(TTimePoint delay_nanos)
@@ -118,9 +181,85 @@ private:
         }
     }
 
+    void sleepUntil(TTimePoint deadline_nanos) const
+    {
+        TTimePoint now = nanos();
+        if (deadline_nanos <= now)
+            return;
+
+#ifdef __linux__
+        if (deadline_nanos - now > pacing_params_.spin_nanos) {
+            TTimePoint wake_nanos = deadline_nanos - pacing_params_.spin_nanos;
+            timespec ts;
+            ts.tv_sec = static_cast<time_t>(wake_nanos / 1000000000ULL);
+            ts.tv_nsec = static_cast<long>(wake_nanos % 1000000000ULL);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+                ;
+        }
+        while (nanos() < deadline_nanos)
+            std::this_thread::yield();
+#else
+        sleep_for(deadline_nanos - now);
+#endif
+    }
+
+    void applyThreadParams()
+    {
+#ifdef __linux__
+        if (pacing_params_.realtime_priority > 0) {
+            sched_param param;
+            param.sched_priority = pacing_params_.realtime_priority;
+            int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+            if (err != 0)
+                Utils::log(Utils::stringf("ScheduledExecutor could not set SCHED_FIFO priority %d, error %d",
+                    pacing_params_.realtime_priority, err), Utils::kLogLevelWarn);
+        }
+        if (pacing_params_.cpu_affinity >= 0) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(pacing_params_.cpu_affinity, &cpu_set);
+            int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+            if (err != 0)
+                Utils::log(Utils::stringf("ScheduledExecutor could not pin thread to CPU %d, error %d",
+                    pacing_params_.cpu_affinity, err), Utils::kLogLevelWarn);
+        }
+#else
+        if (pacing_params_.realtime_priority > 0 || pacing_params_.cpu_affinity >= 0)
+            Utils::log("ScheduledExecutor thread priority and affinity are only supported on Linux", Utils::kLogLevelWarn);
+#endif
+    }
+
+    void resetJitterStats()
+    {
+        for (auto& bucket : late_wakeup_histogram_)
+            bucket.store(0, std::memory_order_relaxed);
+        max_late_nanos_.store(0, std::memory_order_relaxed);
+        overrun_count_.store(0, std::memory_order_relaxed);
+    }
+
+    //only executor thread writes these so there is no need for read-modify-write atomics
+    void recordLateWakeup(TTimeDelta late_nanos)
+    {
+        size_t bucket = 0;
+        for (TTimeDelta late_micros = late_nanos / 1000; late_micros > 0 && bucket < kJitterBucketCount - 1; late_micros >>= 1)
+            ++bucket;
+
+        late_wakeup_histogram_[bucket].store(
+            late_wakeup_histogram_[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (late_nanos > max_late_nanos_.load(std::memory_order_relaxed))
+            max_late_nanos_.store(late_nanos, std::memory_order_relaxed);
+    }
+    void recordOverrun()
+    {
+        overrun_count_.store(overrun_count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
     void executorLoop()
     {
+        applyThreadParams();
+
         TTimePoint call_end = nanos();
+        TTimePoint deadline = call_end;
         while (started_) {
             TTimePoint period_start = nanos();
             TTimeDelta since_last_call = period_start - call_end;
@@ -142,10 +281,32 @@ private:
             //prevent underflow: https://github.com/Microsoft/AirSim/issues/617
             TTimeDelta delay_nanos = period_nanos_ > elapsed_period ? period_nanos_ - elapsed_period : 0;
             //moving average of how much we are sleeping
-            sleep_time_avg_ = 0.25f * sleep_time_avg_ + 0.75f * delay_nanos;
-            ++period_count_;
-            if (delay_nanos > 0 && started_)
-                sleep_for(delay_nanos);
+            sleep_time_avg_.store(0.25f * sleep_time_avg_.load(std::memory_order_relaxed) + 0.75f * delay_nanos,
+                std::memory_order_relaxed);
+            period_count_.store(period_count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+            if (pacing_params_.absolute_deadline) {
+                deadline += period_nanos_;
+                if (call_end >= deadline) {
+                    //we are behind, start next period right away instead of trying to catch up
+                    recordOverrun();
+                    deadline = call_end;
+                }
+                else if (started_) {
+                    sleepUntil(deadline);
+                    recordLateWakeup(nanos() - deadline);
+                }
+            }
+            else {
+                if (delay_nanos == 0)
+                    recordOverrun();
+                else if (started_) {
+                    TTimePoint wakeup = nanos() + delay_nanos;
+                    sleep_for(delay_nanos);
+                    TTimePoint now = nanos();
+                    recordLateWakeup(now > wakeup ? now - wakeup : 0);
+                }
+            }
         }
     }
 
@@ -155,8 +316,13 @@ private:
     std::function<bool(uint64_t)> callback_;
     std::atomic_bool started_;
 
-    double sleep_time_avg_;
-    uint64_t period_count_;
+    std::atomic<double> sleep_time_avg_ {0};
+    std::atomic<uint64_t> period_count_ {0};
+
+    PacingParams pacing_params_;
+    std::array<std::atomic<uint64_t>, kJitterBucketCount> late_wakeup_histogram_;
+    std::atomic<uint64_t> max_late_nanos_;
+    std::atomic<uint64_t> overrun_count_;
 
     std::mutex mutex_;
 };
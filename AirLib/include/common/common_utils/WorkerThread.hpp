@@ -12,6 +12,7 @@
 #include <exception>
 #include <future>
 #include <mutex>
+#include <condition_variable>
 #include "Utils.hpp"
 #include "common/ClockFactory.hpp" //TODO: move this out of common_utils
 
@@ -37,6 +38,7 @@ public:
 
     void cancel() {
         is_cancelled_ = true;
+        wakeUp();
     }
 
     virtual void execute() = 0;
@@ -50,13 +52,27 @@ public:
             return false;
         }
 
-        TTimePoint start = ClockFactory::get()->nowNanos();
+        //Most of the time is spent blocked on wait_cv_ which cancel() and complete() signal, only the
+        //last SpinDuration is spun because timed waits can oversleep by a scheduler tick.
+        static constexpr TTimeDelta SpinDuration = 2E-3;
         static constexpr std::chrono::duration<double> MinSleepDuration(0);
-
-        while(secs > 0 && !isCancelled() && !is_complete_ && 
-            ClockFactory::get()->elapsedSince(start) < secs) {
-
-            std::this_thread::sleep_for(MinSleepDuration);
+        ClockBase* clock = ClockFactory::get();
+        TTimePoint start = clock->nowNanos();
+
+        while (secs > 0 && !isCancelled() && !is_complete_) {
+            TTimeDelta remaining = secs - clock->elapsedSince(start);
+            if (remaining <= 0)
+                break;
+
+            TTimeDelta wall_remaining = clock->wallTimeFor(remaining);
+            if (wall_remaining > SpinDuration) {
+                std::unique_lock<std::mutex> lock(wait_mutex_);
+                wait_cv_.wait_for(lock, std::chrono::duration<double>(wall_remaining - SpinDuration), [this] {
+                    return isCancelled() || isComplete();
+                });
+            }
+            else
+                std::this_thread::sleep_for(MinSleepDuration);
         }
 
         return !isCancelled();
@@ -64,12 +80,23 @@ public:
 
     void complete() {
         is_complete_ = true;
+        wakeUp();
     }
 
     bool isComplete() {
         return is_complete_;
     }
 
+private:
+    void wakeUp()
+    {
+        //taking the mutex makes sure a thread that just checked the flags is waiting before we notify
+        { std::lock_guard<std::mutex> lock(wait_mutex_); }
+        wait_cv_.notify_all();
+    }
+
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
 };
 
 // This wraps a condition_variable so we can handle the case where we may signal before wait
@@ -96,13 +123,12 @@ public:
     template<class _Predicate>
     void wait(_Predicate cancel)
     {
-        // wait for signal or cancel predicate
-        while (!signaled_) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            cv_.wait_for(lock, std::chrono::milliseconds(1), [this, cancel] {
-                return cancel();
-            });
-        }
+        // wait for signal or cancel predicate, whoever makes cancel true signals afterwards
+        // so there is no need to wake up and poll it
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, cancel] {
+            return signaled_ || cancel();
+        });
         signaled_ = false;
     }
 
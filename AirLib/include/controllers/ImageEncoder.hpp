@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_ImageEncoder_hpp
+#define air_ImageEncoder_hpp
+
+#include "common/Common.hpp"
+#include "controllers/VehicleCameraBase.hpp"
+#include "common/common_utils/ctpl_stl.h"
+#include "common/common_utils/PngEncoder.hpp"
+#include "Lz4Codec.hpp"
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace msr { namespace airlib {
+
+/*
+    Encoder stage for camera images. For requests with an encoding other than Default the camera is asked
+    for uncompressed pixels and the encoding happens here on a thread pool, so the images of one
+    simGetImages call are encoded in parallel and each one while the next is being captured.
+    Default requests are passed to the camera unchanged.
+*/
+class ImageEncoder {
+public:
+    typedef VehicleCameraBase::ImageRequest ImageRequest;
+    typedef VehicleCameraBase::ImageResponse ImageResponse;
+    typedef VehicleCameraBase::ImageEncoding ImageEncoding;
+
+    //DepthU16 resolution, 1 unit is 1 mm
+    static constexpr float kDepthUnitsPerMeter = 1000.0f;
+
+    //with thread_count 0 images are encoded on the calling thread
+    ImageEncoder(unsigned int thread_count = std::thread::hardware_concurrency())
+        : thread_count_(thread_count)
+    {
+    }
+
+    //what to ask the camera for so that request's encoding can be made from it
+    static ImageRequest toCaptureRequest(const ImageRequest& request)
+    {
+        ImageRequest capture = request;
+        switch (request.encoding) {
+        case ImageEncoding::Default:
+            break;
+        case ImageEncoding::DepthU16:
+            capture.pixels_as_float = true;
+            capture.compress = false;
+            break;
+        default:
+            capture.compress = false;
+            break;
+        }
+        return capture;
+    }
+
+    //turns uncompressed response, as captured for toCaptureRequest, into encoding in place
+    static void encode(ImageEncoding encoding, ImageResponse& response)
+    {
+        switch (encoding) {
+        case ImageEncoding::Default:
+            return;
+        case ImageEncoding::Raw:
+            break;
+        case ImageEncoding::PngFast:
+            if (response.pixels_as_float) {
+                vector<uint8_t> depth;
+                quantizeDepth(response.image_data_float, depth);
+                common_utils::PngEncoder::encode(depth.data(), response.width, response.height, 1, 16, response.image_data_uint8);
+                response.pixels_as_float = false;
+            }
+            else {
+                uint channels = channelsOf(response);
+                if (channels < 1 || channels > 4) {
+                    response.message = "PngFast needs uncompressed pixels with 1 to 4 channels";
+                    return;
+                }
+                vector<uint8_t> png;
+                common_utils::PngEncoder::encode(response.image_data_uint8.data(), response.width, response.height,
+                    static_cast<int>(channels), 8, png);
+                response.image_data_uint8.swap(png);
+            }
+            response.compress = true;
+            break;
+        case ImageEncoding::Lz4:
+            if (response.pixels_as_float)
+                mavlinkcom::Lz4Codec::compress(reinterpret_cast<const uint8_t*>(response.image_data_float.data()),
+                    response.image_data_float.size() * sizeof(float), response.image_data_uint8);
+            else {
+                vector<uint8_t> compressed;
+                mavlinkcom::Lz4Codec::compress(response.image_data_uint8.data(), response.image_data_uint8.size(), compressed);
+                response.image_data_uint8.swap(compressed);
+            }
+            response.compress = true;
+            break;
+        case ImageEncoding::DepthU16:
+            quantizeDepth(response.image_data_float, response.image_data_uint8);
+            response.pixels_as_float = false;
+            response.compress = false;
+            break;
+        default:
+            //toCaptureRequest captured an encoding we don't know uncompressed, so it goes out as Raw
+            encoding = ImageEncoding::Raw;
+            break;
+        }
+        response.encoding = encoding;
+        if (!response.hasFloatData())
+            response.image_data_float.clear();
+    }
+
+    //samples are little endian uint16, NaN becomes 0
+    static void quantizeDepth(const vector<float>& depth, vector<uint8_t>& out)
+    {
+        out.resize(depth.size() * 2);
+        for (size_t i = 0; i < depth.size(); ++i) {
+            float units = depth[i] * kDepthUnitsPerMeter + 0.5f;
+            uint16_t value = units >= 65535.0f ? 0xFFFF : (units > 0 ? static_cast<uint16_t>(units) : 0);
+            out[2 * i] = static_cast<uint8_t>(value);
+            out[2 * i + 1] = static_cast<uint8_t>(value >> 8);
+        }
+    }
+
+    /*
+        Captures the requested images one after another with get_camera(camera_id)->getImage and encodes
+        each on the pool while the next is captured. Safe to call from several threads, the pool is shared.
+    */
+    vector<ImageResponse> getImages(const vector<ImageRequest>& request,
+        const std::function<VehicleCameraBase*(uint8_t)>& get_camera)
+    {
+        vector<ImageResponse> response(request.size());
+        vector<std::future<void>> pending;
+
+        try {
+            for (size_t i = 0; i < request.size(); ++i) {
+                ImageRequest capture = toCaptureRequest(request[i]);
+                response[i] = get_camera(capture.camera_id)->getImage(capture.image_type, capture.pixels_as_float, capture.compress);
+
+                ImageEncoding encoding = request[i].encoding;
+                if (encoding == ImageEncoding::Default || !response[i].message.empty())
+                    continue;
+                ctpl::thread_pool* pool = getPool();
+                if (pool == nullptr)
+                    encode(encoding, response[i]);
+                else {
+                    ImageResponse* item = &response[i];
+                    pending.push_back(pool->push([item, encoding](int thread_id) {
+                        unused(thread_id);
+                        encode(encoding, *item);
+                    }));
+                }
+            }
+        }
+        catch (...) {
+            //pending work points into response
+            for (auto& item : pending)
+                item.wait();
+            throw;
+        }
+
+        for (auto& item : pending)
+            item.get();
+        return response;
+    }
+
+    unsigned int getThreadCount() const
+    {
+        return thread_count_;
+    }
+
+private:
+    static uint channelsOf(const ImageResponse& response)
+    {
+        size_t pixels = static_cast<size_t>(std::max(response.width, 0)) * static_cast<size_t>(std::max(response.height, 0));
+        return pixels == 0 ? 0 : static_cast<uint>(response.image_data_uint8.size() / pixels);
+    }
+
+    //threads are only started once an encoding actually needs them
+    ctpl::thread_pool* getPool()
+    {
+        if (thread_count_ == 0)
+            return nullptr;
+        std::lock_guard<std::mutex> guard(pool_mutex_);
+        if (pool_ == nullptr)
+            pool_.reset(new ctpl::thread_pool(static_cast<int>(thread_count_)));
+        return pool_.get();
+    }
+
+private:
+    unsigned int thread_count_;
+    std::mutex pool_mutex_;
+    std::unique_ptr<ctpl::thread_pool> pool_;
+};
+
+}} //namespace
+#endif
@@ -24,21 +24,33 @@ public: //types
         Count //must be last
     };
 
+    //how the pixels of a response are stored, encodings other than Default and Raw are made by ImageEncoder
+    enum class ImageEncoding : uint {
+        Default = 0,    //compress decides, PNG made by the camera or uncompressed pixels
+        Raw,            //uncompressed pixels
+        PngFast,        //fast PNG, float images become 16 bit gray PNG of DepthU16 values
+        Lz4,            //uncompressed pixel bytes as an LZ4 block prefixed with their uint32 size
+        DepthU16        //float pixels quantized to uint16 millimeters, 0xFFFF for anything farther
+    };
+
     struct ImageRequest {
         uint8_t camera_id;
         VehicleCameraBase::ImageType image_type;
         bool pixels_as_float;
         bool compress;
+        ImageEncoding encoding = ImageEncoding::Default;
 
         ImageRequest()
         {}
 
-        ImageRequest(uint8_t camera_id_val, VehicleCameraBase::ImageType image_type_val, bool pixels_as_float_val = false, bool compress_val = true)
+        ImageRequest(uint8_t camera_id_val, VehicleCameraBase::ImageType image_type_val, bool pixels_as_float_val = false, bool compress_val = true,
+            ImageEncoding encoding_val = ImageEncoding::Default)
         {
             camera_id = camera_id_val;
             image_type = image_type_val;
             pixels_as_float = pixels_as_float_val;
             compress = compress_val;
+            encoding = encoding_val;
         }
     };
 
@@ -54,6 +66,13 @@ public: //types
         bool compress = true;
         int width = 0, height = 0;
         ImageType image_type;
+        //pixels_as_float tells the pixel type after decoding, encoded pixels are always in image_data_uint8
+        ImageEncoding encoding = ImageEncoding::Default;
+
+        bool hasFloatData() const
+        {
+            return pixels_as_float && (encoding == ImageEncoding::Default || encoding == ImageEncoding::Raw);
+        }
     };
 
 public: //methods
@@ -7,6 +7,7 @@
 #include "VehicleControllerBase.hpp"
 #include "VehicleCameraBase.hpp"
 #include "common/UpdatableObject.hpp"
+#include "physics/WorldSnapshotSource.hpp"
 
 namespace msr { namespace airlib {
 
@@ -33,6 +34,11 @@ public:
     virtual int getSegmentationObjectID(const std::string& mesh_name) = 0;
     virtual void printLogMessage(const std::string& message, std::string message_param = "", unsigned char severity = 0) = 0;
 
+    //registers this vehicle with the world's snapshot source, called once before API server starts
+    virtual void addToWorldSnapshot(WorldSnapshotSource* source) = 0;
+    //source this vehicle was added to, nullptr if it is not part of a simulated world
+    virtual WorldSnapshotSource* getWorldSnapshotSource() = 0;
+
 };
 
 
@@ -0,0 +1,483 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_BatchedFastPhysicsEngine_hpp
+#define airsim_core_BatchedFastPhysicsEngine_hpp
+
+#include "common/Common.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace msr { namespace airlib {
+
+/*
+    Same integrator as FastPhysicsEngine but all bodies are stepped together. Kinematics, wrench vertices
+    and drag vertices of all bodies are kept in contiguous structure-of-arrays buffers so each stage of
+    getNextKinematicsNoCollision runs as a flat loop over N bodies (or over all vertices) that compiler can
+    vectorize. Bodies are only touched through virtual interface to gather inputs and to commit results.
+    Collision response is rare and stays per-body using FastPhysicsEngine code.
+
+    Drag vertices are assumed to be rigid geometry, i.e., they are read when body is inserted or
+    engine is reset. Wrench vertices are read on every update.
+*/
+class BatchedFastPhysicsEngine : public FastPhysicsEngine {
+public:
+    BatchedFastPhysicsEngine(bool enable_ground_lock = true)
+        : FastPhysicsEngine(enable_ground_lock)
+    {
+    }
+
+    //*** Start: UpdatableState implementation ***//
+    virtual void reset() override
+    {
+        FastPhysicsEngine::reset();
+
+        rebuildLayout();
+    }
+
+    virtual void update() override
+    {
+        //skip per-body loop in FastPhysicsEngine::update
+        PhysicsEngineBase::update();
+
+        if (body_count_ == 0)
+            return;
+
+        gatherState();
+        integrate();
+        scatterState();
+    }
+
+    virtual void reportState(StateReporter& reporter) override
+    {
+        reporter.writeValue("Batch Size", body_count_);
+        reporter.writeValue("Wrench Vertices", static_cast<uint>(wrench_vertices_.body.size()));
+        reporter.writeValue("Drag Vertices", static_cast<uint>(drag_vertices_.body.size()));
+
+        FastPhysicsEngine::reportState(reporter);
+    }
+    //*** End: UpdatableState implementation ***//
+
+    virtual void insert(PhysicsBody* body_ptr) override
+    {
+        FastPhysicsEngine::insert(body_ptr);
+
+        rebuildLayout();
+    }
+    virtual void erase_remove(PhysicsBody* body_ptr) override
+    {
+        FastPhysicsEngine::erase_remove(body_ptr);
+
+        rebuildLayout();
+    }
+    virtual void clear() override
+    {
+        FastPhysicsEngine::clear();
+
+        rebuildLayout();
+    }
+
+private: //SoA containers
+    struct Vector3Array {
+        vector<real_T> x, y, z;
+
+        void resize(size_t n)
+        {
+            x.resize(n); y.resize(n); z.resize(n);
+        }
+        void set(size_t i, const Vector3r& v)
+        {
+            x[i] = v.x(); y[i] = v.y(); z[i] = v.z();
+        }
+        Vector3r get(size_t i) const
+        {
+            return Vector3r(x[i], y[i], z[i]);
+        }
+    };
+
+    struct QuaternionArray {
+        vector<real_T> w, x, y, z;
+
+        void resize(size_t n)
+        {
+            w.resize(n); x.resize(n); y.resize(n); z.resize(n);
+        }
+        void set(size_t i, const Quaternionr& q)
+        {
+            w[i] = q.w(); x[i] = q.x(); y[i] = q.y(); z[i] = q.z();
+        }
+        Quaternionr get(size_t i) const
+        {
+            return Quaternionr(w[i], x[i], y[i], z[i]);
+        }
+    };
+
+    //row major 3x3 matrices
+    struct Matrix3x3Array {
+        std::array<vector<real_T>, 9> m;
+
+        void resize(size_t n)
+        {
+            for (auto& e : m)
+                e.resize(n);
+        }
+        void set(size_t i, const Matrix3x3r& mat)
+        {
+            for (uint r = 0; r < 3; ++r)
+                for (uint c = 0; c < 3; ++c)
+                    m[r * 3 + c][i] = mat(r, c);
+        }
+    };
+
+    struct BodyBuffers {
+        vector<real_T> dt, mass, air_density;
+        Matrix3x3Array inertia, inertia_inv;
+        Vector3Array gravity;
+
+        //current state
+        Vector3Array position, linear_vel, angular_vel, linear_acc, angular_acc;
+        QuaternionArray orientation;
+
+        //intermediates
+        Vector3Array avg_linear, avg_angular, avg_linear_body;
+        Vector3Array body_force, body_torque, drag_force, drag_torque;
+
+        //next state
+        Vector3Array next_position, next_linear_vel, next_angular_vel, next_linear_acc, next_angular_acc;
+        Vector3Array next_force, next_torque;
+        QuaternionArray next_orientation;
+
+        void resize(size_t n)
+        {
+            dt.resize(n); mass.resize(n); air_density.resize(n);
+            inertia.resize(n); inertia_inv.resize(n); gravity.resize(n);
+
+            position.resize(n); linear_vel.resize(n); angular_vel.resize(n);
+            linear_acc.resize(n); angular_acc.resize(n); orientation.resize(n);
+
+            avg_linear.resize(n); avg_angular.resize(n); avg_linear_body.resize(n);
+            body_force.resize(n); body_torque.resize(n); drag_force.resize(n); drag_torque.resize(n);
+
+            next_position.resize(n); next_linear_vel.resize(n); next_angular_vel.resize(n);
+            next_linear_acc.resize(n); next_angular_acc.resize(n);
+            next_force.resize(n); next_torque.resize(n); next_orientation.resize(n);
+        }
+    };
+
+    struct VertexBuffers {
+        //vertices of body i are in range [offset[i], offset[i+1])
+        vector<uint> offset;
+        //index of body owning the vertex
+        vector<uint> body;
+        Vector3Array position, normal, force, torque;
+        vector<real_T> drag_factor;
+
+        void resize(size_t n)
+        {
+            body.resize(n);
+            position.resize(n); normal.resize(n); force.resize(n); torque.resize(n);
+            drag_factor.resize(n);
+        }
+    };
+
+private:
+    void rebuildLayout()
+    {
+        body_count_ = size();
+        bodies_.resize(body_count_);
+
+        wrench_vertices_.offset.assign(body_count_ + 1, 0);
+        drag_vertices_.offset.assign(body_count_ + 1, 0);
+        for (uint i = 0; i < body_count_; ++i) {
+            const PhysicsBody* body = at(i);
+            wrench_vertices_.offset[i + 1] = wrench_vertices_.offset[i] + body->wrenchVertexCount();
+            drag_vertices_.offset[i + 1] = drag_vertices_.offset[i] + body->dragVertexCount();
+        }
+        wrench_vertices_.resize(wrench_vertices_.offset[body_count_]);
+        drag_vertices_.resize(drag_vertices_.offset[body_count_]);
+
+        //mass, inertia and drag geometry don't change between updates
+        for (uint i = 0; i < body_count_; ++i) {
+            const PhysicsBody* body = at(i);
+
+            bodies_.mass[i] = body->getMass();
+            bodies_.inertia.set(i, body->getInertia());
+            bodies_.inertia_inv.set(i, body->getInertiaInv());
+
+            for (uint vi = wrench_vertices_.offset[i]; vi < wrench_vertices_.offset[i + 1]; ++vi)
+                wrench_vertices_.body[vi] = i;
+
+            for (uint vi = 0; vi < body->dragVertexCount(); ++vi) {
+                const PhysicsBodyVertex& vertex = body->getDragVertex(vi);
+                const uint k = drag_vertices_.offset[i] + vi;
+                drag_vertices_.body[k] = i;
+                drag_vertices_.position.set(k, vertex.getPosition());
+                drag_vertices_.normal.set(k, vertex.getNormal());
+                drag_vertices_.drag_factor[k] = vertex.getDragFactor();
+            }
+        }
+    }
+
+    void gatherState()
+    {
+        forEachBody([this](size_t index) {
+            const uint i = static_cast<uint>(index);
+            PhysicsBody* body = at(i);
+
+            bodies_.dt[i] = static_cast<real_T>(clock()->updateSince(body->last_kinematics_time));
+
+            const Kinematics::State& current = body->getKinematics();
+            bodies_.position.set(i, current.pose.position);
+            bodies_.orientation.set(i, current.pose.orientation);
+            bodies_.linear_vel.set(i, current.twist.linear);
+            bodies_.angular_vel.set(i, current.twist.angular);
+            bodies_.linear_acc.set(i, current.accelerations.linear);
+            bodies_.angular_acc.set(i, current.accelerations.angular);
+
+            const Environment::State& env = body->getEnvironment().getState();
+            bodies_.gravity.set(i, env.gravity);
+            bodies_.air_density[i] = env.air_density;
+
+            for (uint vi = 0; vi < body->wrenchVertexCount(); ++vi) {
+                const PhysicsBodyVertex& vertex = body->getWrenchVertex(vi);
+                const Wrench vertex_wrench = vertex.getWrench();
+                const uint k = wrench_vertices_.offset[i] + vi;
+                wrench_vertices_.position.set(k, vertex.getPosition());
+                wrench_vertices_.force.set(k, vertex_wrench.force);
+                wrench_vertices_.torque.set(k, vertex_wrench.torque);
+            }
+        });
+    }
+
+    //commit also runs vehicle controllers, which is where most of the time goes
+    void scatterState()
+    {
+        forEachBody([this](size_t index) {
+            const uint i = static_cast<uint>(index);
+            PhysicsBody* body = at(i);
+
+            Kinematics::State next;
+            next.pose.position = bodies_.next_position.get(i);
+            next.pose.orientation = bodies_.next_orientation.get(i);
+            next.twist.linear = bodies_.next_linear_vel.get(i);
+            next.twist.angular = bodies_.next_angular_vel.get(i);
+            next.accelerations.linear = bodies_.next_linear_acc.get(i);
+            next.accelerations.angular = bodies_.next_angular_acc.get(i);
+
+            if (VectorMath::hasNan(next.pose.orientation)) {
+                //Utils::DebugBreak();
+                Utils::log("orientation had NaN!", Utils::kLogLevelError);
+            }
+
+            Wrench next_wrench;
+            next_wrench.force = bodies_.next_force.get(i);
+            next_wrench.torque = bodies_.next_torque.get(i);
+
+            //current is still unmodified in body until commit
+            commitKinematics(bodies_.dt[i], *body, body->getKinematics(), next, next_wrench);
+        });
+    }
+
+    void integrate()
+    {
+        const uint n = body_count_;
+        BodyBuffers& b = bodies_;
+
+        /************************* Body wrench ************************/
+        //tau = r X F for each vertex, vertex torque is added on top
+        {
+            VertexBuffers& v = wrench_vertices_;
+            const uint vn = static_cast<uint>(v.body.size());
+            for (uint k = 0; k < vn; ++k) {
+                const real_T px = v.position.x[k], py = v.position.y[k], pz = v.position.z[k];
+                const real_T fx = v.force.x[k], fy = v.force.y[k], fz = v.force.z[k];
+                v.torque.x[k] += py * fz - pz * fy;
+                v.torque.y[k] += pz * fx - px * fz;
+                v.torque.z[k] += px * fy - py * fx;
+            }
+            sumPerBody(v, v.force, b.body_force);
+            sumPerBody(v, v.torque, b.body_torque);
+        }
+
+        /************************* Average velocities over dt ************************/
+        for (uint i = 0; i < n; ++i) {
+            const real_T half_dt = 0.5f * b.dt[i];
+            b.avg_linear.x[i] = b.linear_vel.x[i] + b.linear_acc.x[i] * half_dt;
+            b.avg_linear.y[i] = b.linear_vel.y[i] + b.linear_acc.y[i] * half_dt;
+            b.avg_linear.z[i] = b.linear_vel.z[i] + b.linear_acc.z[i] * half_dt;
+            b.avg_angular.x[i] = b.angular_vel.x[i] + b.angular_acc.x[i] * half_dt;
+            b.avg_angular.y[i] = b.angular_vel.y[i] + b.angular_acc.y[i] * half_dt;
+            b.avg_angular.z[i] = b.angular_vel.z[i] + b.angular_acc.z[i] * half_dt;
+        }
+        rotate(b.orientation, b.avg_linear, b.avg_linear_body, true);
+
+        /************************* Drag wrench ************************/
+        //see FastPhysicsEngine::getDragWrench; culled faces contribute zero
+        {
+            VertexBuffers& v = drag_vertices_;
+            const uint vn = static_cast<uint>(v.body.size());
+            for (uint k = 0; k < vn; ++k) {
+                const uint i = v.body[k];
+                const real_T px = v.position.x[k], py = v.position.y[k], pz = v.position.z[k];
+                const real_T wx = b.avg_angular.x[i], wy = b.avg_angular.y[i], wz = b.avg_angular.z[i];
+                const real_T vel_x = b.avg_linear_body.x[i] + (wy * pz - wz * py);
+                const real_T vel_y = b.avg_linear_body.y[i] + (wz * px - wx * pz);
+                const real_T vel_z = b.avg_linear_body.z[i] + (wx * py - wy * px);
+                const real_T vel_comp = v.normal.x[k] * vel_x + v.normal.y[k] * vel_y + v.normal.z[k] * vel_z;
+                const real_T drag_mag = vel_comp > kDragMinVelocity ?
+                    -v.drag_factor[k] * b.air_density[i] * vel_comp * vel_comp : 0.0f;
+
+                const real_T fx = v.normal.x[k] * drag_mag, fy = v.normal.y[k] * drag_mag, fz = v.normal.z[k] * drag_mag;
+                v.force.x[k] = fx; v.force.y[k] = fy; v.force.z[k] = fz;
+                v.torque.x[k] = py * fz - pz * fy;
+                v.torque.y[k] = pz * fx - px * fz;
+                v.torque.z[k] = px * fy - py * fx;
+            }
+            sumPerBody(v, v.force, b.drag_force);
+            sumPerBody(v, v.torque, b.drag_torque);
+        }
+
+        //convert forces to world frame, leave torques in body frame
+        rotate(b.orientation, b.body_force, b.body_force, false);
+        rotate(b.orientation, b.drag_force, b.drag_force, false);
+
+        /************************* Accelerations due to force and torque ************************/
+        for (uint i = 0; i < n; ++i) {
+            b.next_force.x[i] = b.body_force.x[i] + b.drag_force.x[i];
+            b.next_force.y[i] = b.body_force.y[i] + b.drag_force.y[i];
+            b.next_force.z[i] = b.body_force.z[i] + b.drag_force.z[i];
+            b.next_torque.x[i] = b.body_torque.x[i] + b.drag_torque.x[i];
+            b.next_torque.y[i] = b.body_torque.y[i] + b.drag_torque.y[i];
+            b.next_torque.z[i] = b.body_torque.z[i] + b.drag_torque.z[i];
+
+            b.next_linear_acc.x[i] = b.next_force.x[i] / b.mass[i] + b.gravity.x[i];
+            b.next_linear_acc.y[i] = b.next_force.y[i] / b.mass[i] + b.gravity.y[i];
+            b.next_linear_acc.z[i] = b.next_force.z[i] / b.mass[i] + b.gravity.z[i];
+        }
+
+        //Euler's rotation equation, see FastPhysicsEngine::getNextKinematicsNoCollision
+        {
+            const auto& I = b.inertia.m;
+            const auto& Iinv = b.inertia_inv.m;
+            for (uint i = 0; i < n; ++i) {
+                const real_T wx = b.avg_angular.x[i], wy = b.avg_angular.y[i], wz = b.avg_angular.z[i];
+                const real_T lx = I[0][i] * wx + I[1][i] * wy + I[2][i] * wz;
+                const real_T ly = I[3][i] * wx + I[4][i] * wy + I[5][i] * wz;
+                const real_T lz = I[6][i] * wx + I[7][i] * wy + I[8][i] * wz;
+                const real_T rx = b.next_torque.x[i] - (wy * lz - wz * ly);
+                const real_T ry = b.next_torque.y[i] - (wz * lx - wx * lz);
+                const real_T rz = b.next_torque.z[i] - (wx * ly - wy * lx);
+                b.next_angular_acc.x[i] = Iinv[0][i] * rx + Iinv[1][i] * ry + Iinv[2][i] * rz;
+                b.next_angular_acc.y[i] = Iinv[3][i] * rx + Iinv[4][i] * ry + Iinv[5][i] * rz;
+                b.next_angular_acc.z[i] = Iinv[6][i] * rx + Iinv[7][i] * ry + Iinv[8][i] * rz;
+            }
+        }
+
+        /************************* Update pose and twist after dt ************************/
+        //Verlet integration
+        for (uint i = 0; i < n; ++i) {
+            const real_T half_dt = 0.5f * b.dt[i];
+            b.next_linear_vel.x[i] = b.linear_vel.x[i] + (b.linear_acc.x[i] + b.next_linear_acc.x[i]) * half_dt;
+            b.next_linear_vel.y[i] = b.linear_vel.y[i] + (b.linear_acc.y[i] + b.next_linear_acc.y[i]) * half_dt;
+            b.next_linear_vel.z[i] = b.linear_vel.z[i] + (b.linear_acc.z[i] + b.next_linear_acc.z[i]) * half_dt;
+            b.next_angular_vel.x[i] = b.angular_vel.x[i] + (b.angular_acc.x[i] + b.next_angular_acc.x[i]) * half_dt;
+            b.next_angular_vel.y[i] = b.angular_vel.y[i] + (b.angular_acc.y[i] + b.next_angular_acc.y[i]) * half_dt;
+            b.next_angular_vel.z[i] = b.angular_vel.z[i] + (b.angular_acc.z[i] + b.next_angular_acc.z[i]) * half_dt;
+
+            b.next_position.x[i] = b.position.x[i] + b.avg_linear.x[i] * b.dt[i];
+            b.next_position.y[i] = b.position.y[i] + b.avg_linear.y[i] * b.dt[i];
+            b.next_position.z[i] = b.position.z[i] + b.avg_linear.z[i] * b.dt[i];
+        }
+
+        //if controller has bug, velocities can increase idenfinitely so we need to clip this
+        clipToSpeedOfLight(b.next_linear_vel, b.next_linear_acc);
+        clipToSpeedOfLight(b.next_angular_vel, b.next_angular_acc);
+
+        //orientation, see FastPhysicsEngine::computeNextPose
+        for (uint i = 0; i < n; ++i) {
+            const real_T wx = b.avg_angular.x[i], wy = b.avg_angular.y[i], wz = b.avg_angular.z[i];
+            const real_T angle_per_unit = std::sqrt(wx * wx + wy * wy + wz * wz);
+            const real_T qw = b.orientation.w[i], qx = b.orientation.x[i], qy = b.orientation.y[i], qz = b.orientation.z[i];
+
+            if (angle_per_unit > std::numeric_limits<real_T>::epsilon()) {
+                //angle-axis to unit quaternion
+                const real_T half_angle = 0.5f * angle_per_unit * b.dt[i];
+                const real_T s = std::sin(half_angle) / angle_per_unit;
+                const real_T dw = std::cos(half_angle), dx = wx * s, dy = wy * s, dz = wz * s;
+
+                //q0 * q1
+                real_T nw = qw * dw - qx * dx - qy * dy - qz * dz;
+                real_T nx = qw * dx + qx * dw + qy * dz - qz * dy;
+                real_T ny = qw * dy - qx * dz + qy * dw + qz * dx;
+                real_T nz = qw * dz + qx * dy - qy * dx + qz * dw;
+
+                //re-normalize quaternion to avoid accumulating error
+                const real_T norm = std::sqrt(nw * nw + nx * nx + ny * ny + nz * nz);
+                b.next_orientation.w[i] = nw / norm;
+                b.next_orientation.x[i] = nx / norm;
+                b.next_orientation.y[i] = ny / norm;
+                b.next_orientation.z[i] = nz / norm;
+            }
+            else { //no change in angle
+                b.next_orientation.w[i] = qw;
+                b.next_orientation.x[i] = qx;
+                b.next_orientation.y[i] = qy;
+                b.next_orientation.z[i] = qz;
+            }
+        }
+    }
+
+    //reduce per-vertex values to per-body sums
+    void sumPerBody(const VertexBuffers& v, const Vector3Array& vertex_values, Vector3Array& body_values) const
+    {
+        for (uint i = 0; i < body_count_; ++i) {
+            real_T x = 0, y = 0, z = 0;
+            for (uint k = v.offset[i]; k < v.offset[i + 1]; ++k) {
+                x += vertex_values.x[k];
+                y += vertex_values.y[k];
+                z += vertex_values.z[k];
+            }
+            body_values.x[i] = x; body_values.y[i] = y; body_values.z[i] = z;
+        }
+    }
+
+    //same as Eigen's Quaternion::_transformVector, reverse uses conjugate (unit quaternion assumed)
+    void rotate(const QuaternionArray& q, const Vector3Array& in, Vector3Array& out, bool reverse) const
+    {
+        const real_T sign = reverse ? -1.0f : 1.0f;
+        for (uint i = 0; i < body_count_; ++i) {
+            const real_T qw = q.w[i], qx = sign * q.x[i], qy = sign * q.y[i], qz = sign * q.z[i];
+            const real_T vx = in.x[i], vy = in.y[i], vz = in.z[i];
+            const real_T tx = 2 * (qy * vz - qz * vy);
+            const real_T ty = 2 * (qz * vx - qx * vz);
+            const real_T tz = 2 * (qx * vy - qy * vx);
+            out.x[i] = vx + qw * tx + (qy * tz - qz * ty);
+            out.y[i] = vy + qw * ty + (qz * tx - qx * tz);
+            out.z[i] = vz + qw * tz + (qx * ty - qy * tx);
+        }
+    }
+
+    void clipToSpeedOfLight(Vector3Array& vel, Vector3Array& acc) const
+    {
+        const real_T c = static_cast<real_T>(EarthUtils::SpeedOfLight);
+        for (uint i = 0; i < body_count_; ++i) {
+            const real_T sq = vel.x[i] * vel.x[i] + vel.y[i] * vel.y[i] + vel.z[i] * vel.z[i];
+            if (sq > c * c) {
+                const real_T scale = std::sqrt(sq) / c;
+                vel.x[i] /= scale; vel.y[i] /= scale; vel.z[i] /= scale;
+                acc.x[i] = acc.y[i] = acc.z[i] = 0;
+            }
+        }
+    }
+
+private:
+    uint body_count_ = 0;
+    BodyBuffers bodies_;
+    VertexBuffers wrench_vertices_;
+    VertexBuffers drag_vertices_;
+};
+
+}} //namespace
+#endif
@@ -44,9 +44,10 @@ public:
     {
         PhysicsEngineBase::update();
 
-        for (PhysicsBody* body_ptr : *this) {
-            updatePhysics(*body_ptr);
-        }
+        //bodies are independent of each other so order doesn't change results
+        forEachBody([this](size_t i) {
+            updatePhysics(*at(static_cast<uint>(i)));
+        });
     }
     virtual void reportState(StateReporter& reporter) override
     {
@@ -80,6 +81,14 @@ private:
         //this is necessory to take in to account forces and torques generated by body
         getNextKinematicsNoCollision(dt, body, current, next, next_wrench);
 
+        commitKinematics(dt, body, current, next, next_wrench);
+    }
+
+protected:
+    //apply collision response, if any, on top of no-collision state and write it back to body
+    void commitKinematics(TTimeDelta dt, PhysicsBody& body, const Kinematics::State& current,
+        Kinematics::State& next, Wrench& next_wrench)
+    {
         //if there is collision, see if we need collision response
         const CollisionInfo collision_info = body.getCollisionInfo();
         CollisionResponseInfo& collision_response_info = body.getCollisionResponseInfo();
@@ -394,12 +403,13 @@ private:
             next.pose.orientation = current_pose.orientation;
     }
 
-private:
+protected:
     static constexpr uint kCollisionResponseCycles = 1;
     static constexpr float kAxisTolerance = 0.25f;
     static constexpr float kRestingVelocityMax = 0.1f;
     static constexpr float kDragMinVelocity = 0.1f;
 
+private:
     std::stringstream debug_string_;
     int grounded_;
     bool enable_ground_lock_;
@@ -7,6 +7,8 @@
 #include "common/UpdatableContainer.hpp"
 #include "common/Common.hpp"
 #include "PhysicsBody.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/common_utils/ParallelForPool.hpp"
 
 namespace msr { namespace airlib {
 
@@ -41,7 +43,7 @@ public:
     const_iterator begin() const { return members_.begin(); }
     const_iterator end() const { return members_.end(); }
     uint size() const { return static_cast<uint>(members_.size()); }
-    const TUpdatableObjectPtr &at(uint index) const { members_.at(index);  }
+    const TUpdatableObjectPtr &at(uint index) const { return members_.at(index);  }
     TUpdatableObjectPtr &at(uint index) { return members_.at(index);  }
     //allow to override membership modifications
     virtual void clear() { members_.clear(); }
@@ -49,8 +51,33 @@ public:
     virtual void erase_remove(TUpdatableObjectPtr obj) { 
         members_.erase(std::remove(members_.begin(), members_.end(), obj), members_.end()); }
 
+    //when set, engines may update independent bodies in parallel on this pool
+    void setWorkerPool(common_utils::ParallelForPool* worker_pool)
+    {
+        worker_pool_ = worker_pool;
+    }
+
+protected:
+    //run func for each body index, in parallel if worker pool is available
+    void forEachBody(const std::function<void(size_t)>& func)
+    {
+        if (worker_pool_) {
+            ClockBase* clock = ClockFactory::get();
+            worker_pool_->run(members_.size(), [&func, clock](size_t i) {
+                //workers must see same clock as this thread
+                ClockFactory::ThreadClockScope clock_scope(clock);
+                func(i);
+            });
+        }
+        else {
+            for (size_t i = 0; i < members_.size(); ++i)
+                func(i);
+        }
+    }
+
 private:
     MembersContainer members_;
+    common_utils::ParallelForPool* worker_pool_ = nullptr;
 };
 
 
@@ -10,6 +10,8 @@
 #include "PhysicsEngineBase.hpp"
 #include "World.hpp"
 #include "common/StateReporterWrapper.hpp"
+#include "common/SteppableClock.hpp"
+#include <stdexcept>
 
 namespace msr { namespace airlib {
 
@@ -43,15 +45,73 @@ public:
         unlock();
     }
 
+    //see World::getStepCount
+    uint64_t getStepCount() const
+    {
+        return world_.getStepCount();
+    }
+
     uint64_t getUpdatePeriodNanos() const
     {
         return update_period_nanos_;
     }
 
+    //see World::setParallelUpdate
+    void setParallelUpdate(unsigned int thread_count)
+    {
+        lock();
+        world_.setParallelUpdate(thread_count);
+        unlock();
+    }
+
+    //Lockstep mode for headless simulation: steps the world on calling thread as fast as
+    //CPU allows, without any sleeping, until sim_seconds of simulated time has elapsed.
+    //Clock must be SteppableClock and async updator must not be running. To run many
+    //independent worlds in parallel, create and run each world on its own thread with its
+    //own clock set using ClockFactory::ThreadClockScope. Returns number of steps taken.
+    uint64_t runFor(TTimeDelta sim_seconds)
+    {
+        if (world_.isAsyncUpdatorRunning())
+            throw std::logic_error("runFor cannot be used while async updator is running");
+
+        SteppableClock* clock = dynamic_cast<SteppableClock*>(ClockFactory::get());
+        if (clock == nullptr)
+            throw std::invalid_argument("runFor requires SteppableClock");
+
+        const TTimePoint end = clock->addTo(clock->nowNanos(), sim_seconds);
+        uint64_t steps = 0;
+        while (clock->nowNanos() < end) {
+            //lock each step so API calls from other threads can get in between steps
+            lock();
+            world_.update();
+            unlock();
+
+            ++steps;
+        }
+
+        return steps;
+    }
+
     void startAsyncUpdator()
     {
         world_.startAsyncUpdator(update_period_nanos_);
     }
+    //restarts async updator if it is already running so new params take effect
+    void setPacingParams(const common_utils::ScheduledExecutor::PacingParams& params)
+    {
+        bool is_running = world_.isAsyncUpdatorRunning();
+        if (is_running)
+            world_.stopAsyncUpdator();
+
+        world_.setPacingParams(params);
+
+        if (is_running)
+            world_.startAsyncUpdator(update_period_nanos_);
+    }
+    common_utils::ScheduledExecutor::JitterStats getJitterStats() const
+    {
+        return world_.getJitterStats();
+    }
     void stopAsyncUpdator()
     {
         world_.stopAsyncUpdator();
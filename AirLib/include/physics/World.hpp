@@ -10,6 +10,7 @@
 #include "PhysicsEngineBase.hpp"
 #include "PhysicsBody.hpp"
 #include "common/common_utils/ScheduledExecutor.hpp"
+#include "common/common_utils/ParallelForPool.hpp"
 #include "common/ClockFactory.hpp"
 
 namespace msr { namespace airlib {
@@ -38,9 +39,21 @@ public:
     virtual void update() override
     {
         ClockFactory::get()->step();
+        ++step_count_;
 
         //first update our objects
-        UpdatableContainer::update();
+        if (worker_pool_) {
+            //members don't share state so each can be updated on any thread
+            UpdatableObject::update();
+            ClockBase* clock = ClockFactory::get();
+            worker_pool_->run(size(), [this, clock](size_t i) {
+                //workers must see same clock as this thread
+                ClockFactory::ThreadClockScope clock_scope(clock);
+                at(static_cast<uint>(i))->update();
+            });
+        }
+        else
+            UpdatableContainer::update();
 
         //now update kinematics state
         if (physics_engine_)
@@ -50,6 +63,9 @@ public:
     virtual void reportState(StateReporter& reporter) override
     {
         reporter.writeValue("Sleep", 1.0f / executor_.getSleepTimeAvg());
+        const auto jitter_stats = executor_.getJitterStats();
+        reporter.writeValue("Overruns", jitter_stats.overrun_count);
+        reporter.writeValue("Max Late (us)", jitter_stats.max_late_nanos / 1000);
         if (physics_engine_)
             physics_engine_->reportState(reporter);
 
@@ -83,6 +99,30 @@ public:
         UpdatableContainer::erase_remove(member);
     }
 
+    //Update members and physics bodies on thread_count threads (including updator thread).
+    //Each step still completes all work before returning so results are same as serial update.
+    //Value of 1 or less switches back to serial update. Must not be called while world is updating.
+    void setParallelUpdate(unsigned int thread_count)
+    {
+        if (thread_count > 1)
+            worker_pool_.reset(new common_utils::ParallelForPool(thread_count));
+        else
+            worker_pool_.reset();
+
+        if (physics_engine_)
+            physics_engine_->setWorkerPool(worker_pool_.get());
+    }
+
+    //how async updater thread waits between periods, takes effect on next startAsyncUpdator
+    void setPacingParams(const common_utils::ScheduledExecutor::PacingParams& params)
+    {
+        executor_.setPacingParams(params);
+    }
+    common_utils::ScheduledExecutor::JitterStats getJitterStats() const
+    {
+        return executor_.getJitterStats();
+    }
+
     //async updater thread
     void startAsyncUpdator(uint64_t period)
     {
@@ -94,6 +134,15 @@ public:
     {
         executor_.stop();
     }
+    bool isAsyncUpdatorRunning()
+    {
+        return executor_.isRunning();
+    }
+    //number of updates since world was created, read under lock to get the step state belongs to
+    uint64_t getStepCount() const
+    {
+        return step_count_;
+    }
     void lock()
     {
         executor_.lock();
@@ -106,6 +155,9 @@ public:
     virtual ~World()
     {
         executor_.stop();
+
+        if (physics_engine_)
+            physics_engine_->setWorkerPool(nullptr);
     }
 
 private:
@@ -131,6 +183,8 @@ private:
 private:
     PhysicsEngineBase* physics_engine_ = nullptr;
     common_utils::ScheduledExecutor executor_;
+    std::unique_ptr<common_utils::ParallelForPool> worker_pool_;
+    uint64_t step_count_ = 0;
 };
 
 }} //namespace
@@ -0,0 +1,279 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_WorldSnapshot_hpp
+#define airsim_core_WorldSnapshot_hpp
+
+#include "common/Common.hpp"
+#include <cstring>
+
+namespace msr { namespace airlib {
+
+//which parts of vehicle state go in a world snapshot, combine with |
+enum class WorldSnapshotFields : uint {
+    Kinematics = 1,
+    Collision = 2,
+    Imu = 4,
+    Gps = 8,
+    Barometer = 16,
+    Magnetometer = 32,
+    All = 63
+};
+
+/*
+    State of every vehicle in the world taken at one physics step. Storage is columnar: each member below
+    is one column with a row per vehicle (in vehicle_names order) and multi component values such as
+    position stored x,y,z for vehicle 0, then x,y,z for vehicle 1 and so on. Columns of groups not in fields
+    are empty. The *_valid columns say whether the vehicle has that sensor (for GPS, also whether it has a fix).
+*/
+struct WorldSnapshot {
+    uint64_t step = 0;          //number of world updates so far
+    TTimePoint timestamp = 0;
+    uint fields = 0;
+    vector<string> vehicle_names;
+
+    //Kinematics
+    vector<float> position;                 //x,y,z
+    vector<float> orientation;              //w,x,y,z
+    vector<float> linear_velocity;          //x,y,z
+    vector<float> angular_velocity;         //x,y,z
+    vector<float> linear_acceleration;      //x,y,z
+    vector<float> angular_acceleration;     //x,y,z
+
+    //Collision
+    vector<uint8_t> has_collided;
+    vector<float> collision_normal;         //x,y,z
+    vector<float> collision_impact_point;   //x,y,z
+    vector<float> collision_penetration_depth;
+    vector<uint64_t> collision_time_stamp;
+    vector<uint32_t> collision_count;
+    vector<int32_t> collision_object_id;
+
+    //Imu
+    vector<uint8_t> imu_valid;
+    vector<float> imu_orientation;          //w,x,y,z
+    vector<float> imu_angular_velocity;     //x,y,z
+    vector<float> imu_linear_acceleration;  //x,y,z
+
+    //Gps
+    vector<uint8_t> gps_valid;
+    vector<double> gps_geo_point;           //latitude, longitude, altitude
+    vector<float> gps_eph;
+    vector<float> gps_epv;
+    vector<float> gps_velocity;             //x,y,z
+    vector<uint8_t> gps_fix_type;
+
+    //Barometer
+    vector<uint8_t> barometer_valid;
+    vector<float> barometer_altitude;
+    vector<float> barometer_pressure;
+    vector<float> barometer_qnh;
+
+    //Magnetometer
+    vector<uint8_t> magnetometer_valid;
+    vector<float> magnetic_field_body;      //x,y,z
+
+    bool has(WorldSnapshotFields field) const
+    {
+        return (fields & static_cast<uint>(field)) != 0;
+    }
+
+    uint getVehicleCount() const
+    {
+        return static_cast<uint>(vehicle_names.size());
+    }
+
+    //sizes every column for vehicle_count rows, columns not in fields_val are emptied (capacity is kept
+    //so a snapshot reused for each capture stops allocating)
+    void resize(uint vehicle_count, uint fields_val)
+    {
+        fields = fields_val;
+        vehicle_names.resize(vehicle_count);
+        forEachColumn(*this, Resizer{ vehicle_count, fields_val });
+    }
+
+    //calls visit(group, column, components) for every column in wire order, Snapshot may be const
+    template<typename Snapshot, typename Visitor>
+    static void forEachColumn(Snapshot& s, Visitor&& visit)
+    {
+        const WorldSnapshotFields kin = WorldSnapshotFields::Kinematics;
+        visit(kin, s.position, 3);
+        visit(kin, s.orientation, 4);
+        visit(kin, s.linear_velocity, 3);
+        visit(kin, s.angular_velocity, 3);
+        visit(kin, s.linear_acceleration, 3);
+        visit(kin, s.angular_acceleration, 3);
+
+        const WorldSnapshotFields col = WorldSnapshotFields::Collision;
+        visit(col, s.has_collided, 1);
+        visit(col, s.collision_normal, 3);
+        visit(col, s.collision_impact_point, 3);
+        visit(col, s.collision_penetration_depth, 1);
+        visit(col, s.collision_time_stamp, 1);
+        visit(col, s.collision_count, 1);
+        visit(col, s.collision_object_id, 1);
+
+        const WorldSnapshotFields imu = WorldSnapshotFields::Imu;
+        visit(imu, s.imu_valid, 1);
+        visit(imu, s.imu_orientation, 4);
+        visit(imu, s.imu_angular_velocity, 3);
+        visit(imu, s.imu_linear_acceleration, 3);
+
+        const WorldSnapshotFields gps = WorldSnapshotFields::Gps;
+        visit(gps, s.gps_valid, 1);
+        visit(gps, s.gps_geo_point, 3);
+        visit(gps, s.gps_eph, 1);
+        visit(gps, s.gps_epv, 1);
+        visit(gps, s.gps_velocity, 3);
+        visit(gps, s.gps_fix_type, 1);
+
+        const WorldSnapshotFields baro = WorldSnapshotFields::Barometer;
+        visit(baro, s.barometer_valid, 1);
+        visit(baro, s.barometer_altitude, 1);
+        visit(baro, s.barometer_pressure, 1);
+        visit(baro, s.barometer_qnh, 1);
+
+        const WorldSnapshotFields mag = WorldSnapshotFields::Magnetometer;
+        visit(mag, s.magnetometer_valid, 1);
+        visit(mag, s.magnetic_field_body, 3);
+    }
+
+private:
+    struct Resizer {
+        uint vehicle_count;
+        uint fields;
+
+        template<typename T>
+        void operator()(WorldSnapshotFields group, vector<T>& column, uint components) const
+        {
+            if ((fields & static_cast<uint>(group)) != 0)
+                column.resize(vehicle_count * components);
+            else
+                column.clear();
+        }
+    };
+};
+
+/*
+    Binary encoding of a WorldSnapshot so the whole swarm goes over RPC as one byte array. All values are little endian.
+    header: uint16 version, uint16 fields, uint32 vehicle count, uint64 step, uint64 timestamp
+    names:  for each vehicle uint16 length then that many bytes of UTF-8
+    then every column of the groups in fields, in WorldSnapshot::forEachColumn order, each column being
+    vehicle count * components values back to back with no padding.
+*/
+class WorldSnapshotCodec {
+public:
+    static constexpr uint16_t kVersion = 1;
+    static constexpr size_t kHeaderSize = 24;
+
+    static void encode(const WorldSnapshot& snapshot, vector<uint8_t>& out)
+    {
+        out.clear();
+        put<uint16_t>(out, kVersion);
+        put<uint16_t>(out, static_cast<uint16_t>(snapshot.fields));
+        put<uint32_t>(out, snapshot.getVehicleCount());
+        put<uint64_t>(out, snapshot.step);
+        put<uint64_t>(out, snapshot.timestamp);
+
+        for (const string& name : snapshot.vehicle_names) {
+            uint16_t length = static_cast<uint16_t>(std::min<size_t>(name.size(), 0xFFFF));
+            put<uint16_t>(out, length);
+            out.insert(out.end(), name.begin(), name.begin() + length);
+        }
+
+        WorldSnapshot::forEachColumn(snapshot, ColumnWriter{ out, snapshot.fields });
+    }
+
+    //returns false if data is not a snapshot this version understands
+    static bool decode(const uint8_t* data, size_t size, WorldSnapshot& snapshot)
+    {
+        if (size < kHeaderSize || get<uint16_t>(data) != kVersion)
+            return false;
+        uint fields = get<uint16_t>(data + 2);
+        uint vehicle_count = get<uint32_t>(data + 4);
+
+        //every vehicle takes at least its name length so this bounds count before we allocate for it
+        if (vehicle_count > (size - kHeaderSize) / 2)
+            return false;
+
+        snapshot.resize(vehicle_count, fields);
+        snapshot.step = get<uint64_t>(data + 8);
+        snapshot.timestamp = get<uint64_t>(data + 16);
+
+        size_t offset = kHeaderSize;
+        for (uint i = 0; i < vehicle_count; ++i) {
+            if (size - offset < 2)
+                return false;
+            uint16_t length = get<uint16_t>(data + offset);
+            offset += 2;
+            if (size - offset < length)
+                return false;
+            snapshot.vehicle_names[i].assign(reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+        }
+
+        ColumnReader reader{ data, size, offset, fields, true };
+        WorldSnapshot::forEachColumn(snapshot, reader);
+        return reader.ok;
+    }
+
+private:
+    struct ColumnWriter {
+        vector<uint8_t>& out;
+        uint fields;
+
+        template<typename T>
+        void operator()(WorldSnapshotFields group, const vector<T>& column, uint components) const
+        {
+            unused(components);
+            if ((fields & static_cast<uint>(group)) == 0 || column.empty())
+                return;
+            size_t start = out.size();
+            out.resize(start + column.size() * sizeof(T));
+            std::memcpy(out.data() + start, column.data(), column.size() * sizeof(T));
+        }
+    };
+
+    struct ColumnReader {
+        const uint8_t* data;
+        size_t size;
+        size_t offset;
+        uint fields;
+        bool ok;
+
+        template<typename T>
+        void operator()(WorldSnapshotFields group, vector<T>& column, uint components)
+        {
+            unused(components);
+            if (!ok || (fields & static_cast<uint>(group)) == 0)
+                return;
+            //column was already sized by WorldSnapshot::resize
+            size_t bytes = column.size() * sizeof(T);
+            if (size - offset < bytes) {
+                ok = false;
+                return;
+            }
+            if (bytes > 0)
+                std::memcpy(column.data(), data + offset, bytes);
+            offset += bytes;
+        }
+    };
+
+    template<typename T>
+    static void put(vector<uint8_t>& out, T val)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&val);
+        out.insert(out.end(), p, p + sizeof(T));
+    }
+
+    template<typename T>
+    static T get(const uint8_t* p)
+    {
+        T val;
+        std::memcpy(&val, p, sizeof(T));
+        return val;
+    }
+};
+
+}} //namespace
+#endif
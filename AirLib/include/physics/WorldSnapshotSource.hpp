@@ -0,0 +1,171 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_WorldSnapshotSource_hpp
+#define airsim_core_WorldSnapshotSource_hpp
+
+#include "common/Common.hpp"
+#include "common/ClockFactory.hpp"
+#include "PhysicsWorld.hpp"
+#include "PhysicsBody.hpp"
+#include "WorldSnapshot.hpp"
+#include "sensors/SensorCollection.hpp"
+#include "sensors/imu/ImuBase.hpp"
+#include "sensors/gps/GpsBase.hpp"
+#include "sensors/barometer/BarometerBase.hpp"
+#include "sensors/magnetometer/MagnetometerBase.hpp"
+
+namespace msr { namespace airlib {
+
+/*
+    Takes WorldSnapshots of all registered vehicles. The copy is done with the world locked so every
+    row comes from the same physics step, and only plain copies happen under the lock (sensors are looked up
+    once when the vehicle is added) so the physics loop is held up for as short as possible.
+    Vehicles must all be added before the first capture, capture itself may be called from any thread.
+*/
+class WorldSnapshotSource {
+public:
+    WorldSnapshotSource(PhysicsWorld* world)
+        : world_(world)
+    {
+    }
+
+    //body and sensors may be nullptr, the corresponding columns are then zero or not valid
+    void addVehicle(const std::string& name, const PhysicsBody* body, const SensorCollection* sensors)
+    {
+        VehicleEntry entry;
+        entry.name = name;
+        entry.body = body;
+        if (sensors != nullptr) {
+            entry.imu = static_cast<const ImuBase*>(findSensor(sensors, SensorCollection::SensorType::Imu));
+            entry.gps = static_cast<const GpsBase*>(findSensor(sensors, SensorCollection::SensorType::Gps));
+            entry.barometer = static_cast<const BarometerBase*>(findSensor(sensors, SensorCollection::SensorType::Barometer));
+            entry.magnetometer = static_cast<const MagnetometerBase*>(findSensor(sensors, SensorCollection::SensorType::Magnetometer));
+        }
+        vehicles_.push_back(entry);
+    }
+
+    uint getVehicleCount() const
+    {
+        return static_cast<uint>(vehicles_.size());
+    }
+
+    void capture(uint fields, WorldSnapshot& snapshot) const
+    {
+        //allocation happens before we take the lock
+        uint count = getVehicleCount();
+        snapshot.resize(count, fields & static_cast<uint>(WorldSnapshotFields::All));
+        for (uint i = 0; i < count; ++i)
+            snapshot.vehicle_names[i] = vehicles_[i].name;
+
+        world_->lock();
+        snapshot.step = world_->getStepCount();
+        snapshot.timestamp = ClockFactory::get()->nowNanos();
+        for (uint i = 0; i < count; ++i)
+            copyVehicle(vehicles_[i], i, snapshot);
+        world_->unlock();
+    }
+
+private:
+    struct VehicleEntry {
+        std::string name;
+        const PhysicsBody* body = nullptr;
+        const ImuBase* imu = nullptr;
+        const GpsBase* gps = nullptr;
+        const BarometerBase* barometer = nullptr;
+        const MagnetometerBase* magnetometer = nullptr;
+    };
+
+    static const SensorBase* findSensor(const SensorCollection* sensors, SensorCollection::SensorType type)
+    {
+        return sensors->size(type) > 0 ? sensors->getByType(type) : nullptr;
+    }
+
+    static void copyVehicle(const VehicleEntry& vehicle, uint i, WorldSnapshot& s)
+    {
+        if (s.has(WorldSnapshotFields::Kinematics)) {
+            const Kinematics::State& state = vehicle.body != nullptr ? vehicle.body->getKinematics() : Kinematics::State::zero();
+            setVector(s.position, i, state.pose.position);
+            setQuaternion(s.orientation, i, state.pose.orientation);
+            setVector(s.linear_velocity, i, state.twist.linear);
+            setVector(s.angular_velocity, i, state.twist.angular);
+            setVector(s.linear_acceleration, i, state.accelerations.linear);
+            setVector(s.angular_acceleration, i, state.accelerations.angular);
+        }
+        if (s.has(WorldSnapshotFields::Collision)) {
+            CollisionInfo none;
+            const CollisionInfo& c = vehicle.body != nullptr ? vehicle.body->getCollisionInfo() : none;
+            s.has_collided[i] = c.has_collided ? 1 : 0;
+            setVector(s.collision_normal, i, c.normal);
+            setVector(s.collision_impact_point, i, c.impact_point);
+            s.collision_penetration_depth[i] = c.penetration_depth;
+            s.collision_time_stamp[i] = c.time_stamp;
+            s.collision_count[i] = c.collision_count;
+            s.collision_object_id[i] = c.object_id;
+        }
+        if (s.has(WorldSnapshotFields::Imu)) {
+            s.imu_valid[i] = vehicle.imu != nullptr ? 1 : 0;
+            ImuBase::Output output;
+            if (vehicle.imu != nullptr)
+                output = vehicle.imu->getOutput();
+            else {
+                output.orientation = Quaternionr::Identity();
+                output.angular_velocity = output.linear_acceleration = Vector3r::Zero();
+            }
+            setQuaternion(s.imu_orientation, i, output.orientation);
+            setVector(s.imu_angular_velocity, i, output.angular_velocity);
+            setVector(s.imu_linear_acceleration, i, output.linear_acceleration);
+        }
+        if (s.has(WorldSnapshotFields::Gps)) {
+            GpsBase::GnssReport gnss;
+            gnss.eph = gnss.epv = 0;
+            gnss.velocity = Vector3r::Zero();
+            gnss.fix_type = GpsBase::GNSS_FIX_NO_FIX;
+            bool valid = vehicle.gps != nullptr && vehicle.gps->getOutput().is_valid;
+            if (valid)
+                gnss = vehicle.gps->getOutput().gnss;
+            s.gps_valid[i] = valid ? 1 : 0;
+            s.gps_geo_point[3 * i] = gnss.geo_point.latitude;
+            s.gps_geo_point[3 * i + 1] = gnss.geo_point.longitude;
+            s.gps_geo_point[3 * i + 2] = gnss.geo_point.altitude;
+            s.gps_eph[i] = gnss.eph;
+            s.gps_epv[i] = gnss.epv;
+            setVector(s.gps_velocity, i, gnss.velocity);
+            s.gps_fix_type[i] = static_cast<uint8_t>(gnss.fix_type);
+        }
+        if (s.has(WorldSnapshotFields::Barometer)) {
+            s.barometer_valid[i] = vehicle.barometer != nullptr ? 1 : 0;
+            BarometerBase::Output output = {};
+            if (vehicle.barometer != nullptr)
+                output = vehicle.barometer->getOutput();
+            s.barometer_altitude[i] = output.altitude;
+            s.barometer_pressure[i] = output.pressure;
+            s.barometer_qnh[i] = output.qnh;
+        }
+        if (s.has(WorldSnapshotFields::Magnetometer)) {
+            s.magnetometer_valid[i] = vehicle.magnetometer != nullptr ? 1 : 0;
+            if (vehicle.magnetometer != nullptr)
+                setVector(s.magnetic_field_body, i, vehicle.magnetometer->getOutput().magnetic_field_body);
+            else
+                setVector(s.magnetic_field_body, i, Vector3r::Zero());
+        }
+    }
+
+    static void setVector(vector<float>& column, uint i, const Vector3r& v)
+    {
+        float* p = column.data() + 3 * i;
+        p[0] = v.x(); p[1] = v.y(); p[2] = v.z();
+    }
+    static void setQuaternion(vector<float>& column, uint i, const Quaternionr& q)
+    {
+        float* p = column.data() + 4 * i;
+        p[0] = q.w(); p[1] = q.x(); p[2] = q.y(); p[3] = q.z();
+    }
+
+private:
+    PhysicsWorld* world_;
+    vector<VehicleEntry> vehicles_;
+};
+
+}} //namespace
+#endif
@@ -5,6 +5,7 @@
 #define air_ObstacleMap_hpp
 
 #include <mutex>
+#include <atomic>
 #include "common/Common.hpp"
 
 namespace msr { namespace airlib {
@@ -32,18 +33,62 @@ namespace msr { namespace airlib {
     so on.
 
     Another design criteria is that this class is thread safe for concurrent updates and queries.
-    We fully expect one thread to continuously update the obstacles while another to query the map.
+    We fully expect one thread to continuously update the obstacles while others query the map.
+    Queries never wait for updates: the map is kept in kBufferCount buffers, an update writes a
+    buffer no query is reading and then publishes it. Queries pin the published buffer by counting
+    themselves as its reader. Updates are serialized among themselves only and never wait for
+    queries either: if every other buffer is still being read, the update is left pending and the
+    query releasing the last read of such a buffer publishes it, so that query is the only one that
+    may wait on an update in progress. Either way an update is visible to queries that start after
+    the next query or update finishes. The writer keeps its own up to date copy of the map and a log of the windows
+    updated since then, so the buffer it writes is brought up to date by replaying only the windows
+    it missed, which keeps an update of a few ticks from a single beam O(window).
+
+    Queries scan a window as at most two contiguous spans (the window may wrap around tick 0),
+    using SSE for the minimum when available. When the same window is needed around every tick,
+    getWindowObstacles slides it around the circle keeping a monotonic queue of candidates, which
+    is O(ticks) in total instead of O(ticks * window).
 */
 
 class ObstacleMap {
 private:
-    //stores distances for each tick segment
-    vector<float> distances_;
-    //what is the confidence in these values? This should typically be the standard deviation
-    vector<float> confidences_; 
+    static constexpr int kBufferCount = 3;
+
+    struct Buffer {
+        //stores distances for each tick segment
+        vector<float> distances;
+        //what is the confidence in these values? This should typically be the standard deviation
+        vector<float> confidences;
+        //number of updates applied, only used by updates
+        uint64_t version;
+    };
+    Buffer buffers_[kBufferCount];
+    //buffer queries read from and number of queries reading each buffer
+    std::atomic<int> published_;
+    std::atomic<int> readers_[kBufferCount];
+    //latest_ has updates no buffer could take yet, the last reader of a buffer publishes them
+    std::atomic<bool> pending_;
+
+    struct WindowUpdate {
+        float distance;
+        int tick;
+        int window;
+        float confidence;
+    };
+    //rest is only used by updates: the map with all updates applied, number of updates so far,
+    //and window updates from version log_start_ on
+    Buffer latest_;
+    //a buffer that needed all of latest_ took its vectors instead of a copy, -1 if latest_ has them
+    int latest_buffer_;
+    uint64_t version_;
+    vector<WindowUpdate> log_;
+    uint64_t log_start_;
+    //ticks the log writes, once this reaches ticks_ copying latest_ is as fast as replaying the log
+    int log_ticks_;
+
     //number of ticks, this decides reolution
     int ticks_;
-    //blind spots don't get updated so we get its value from neighbours
+    //blind spots don't get updated so we get its value from neighbours, these are set up before the map is shared
     vector<bool> blindspots_;
 public:
     //this will be return result of the queries
@@ -58,13 +103,28 @@ public:
         }
     };
 
-    //private version of hasObstacle doesn't do lock or check inputs
-    ObstacleInfo hasObstacle_(int from_tick, int to_tick) const;    
+    //private version of hasObstacle doesn't check blind spots
+    ObstacleInfo hasObstacle_(int from_tick, int to_tick);
 private:
     int wrap(int tick) const;
 
-    //currently we employ simple thread safe model: just serialize queries and updates
-    std::mutex mutex_;
+    //buffer index pinned for reading, must be released, releasing publishes a pending update
+    int acquireRead();
+    void releaseRead(int index);
+    //buffer index no query is reading or -1, published by endWrite, call with update_mutex_ held
+    int beginWrite();
+    void endWrite(int index);
+    //brings a buffer no query is reading up to latest_ and publishes it or leaves the update pending,
+    //call with update_mutex_ held
+    void publish();
+    void applyWindow(Buffer& buffer, const WindowUpdate& window_update) const;
+
+    ObstacleInfo findClosest(const Buffer& buffer, int start_tick, int count) const;
+    ObstacleInfo findInWindow(const Buffer& buffer, int from_tick, int to_tick) const;
+    void extendForBlindspots(int& from_tick, int& to_tick) const;
+
+    //serializes updates, queries only take it to publish a pending update
+    std::mutex update_mutex_;
 public:
     //if odd_blindspots = true then set all odd ticks as blind spots
     ObstacleMap(int ticks, bool odd_blindspots = false);
@@ -81,6 +141,9 @@ public:
     //search entire map to find obstacle at minimum distance
     ObstacleInfo getClosestObstacle();
 
+    //obstacles[tick] is hasObstacle(tick - window, tick + window) for every tick, all from the same update
+    void getWindowObstacles(int window, vector<ObstacleInfo>& obstacles);
+
     //number of ticks the map was initialized with
     int getTicks() const;
     //convert angle (in body frame) in radians to tick number
@@ -8,6 +8,7 @@
 #include <array>
 #include <memory>
 #include "ObstacleMap.hpp"
+#include "VoxelMap.hpp"
 #include "common/common_utils/Utils.hpp"
 #include "IGeoFence.hpp"
 #include "common/Common.hpp"
@@ -42,6 +43,7 @@ public:
         bool is_safe;
         SafetyViolationType reason;
         //obstacle info around cur and towards dest, if no obs found then cur might not be evaluated
+        //tick is -1 when obstacles come from VoxelMap
         ObstacleMap::ObstacleInfo cur_obs, dest_obs, suggested_obs;
         //locations that were considered while evaluation
         Vector3r cur_pos, dest_pos;
@@ -75,27 +77,46 @@ private:
     VehicleParams vehicle_params_;
     shared_ptr<IGeoFence> fence_ptr_;
     shared_ptr<ObstacleMap> obs_xy_ptr_;
+    shared_ptr<VoxelMap> obs_voxels_ptr_;
     SafetyViolationType enable_reasons_ = SafetyEval::SafetyViolationType_::GeoFence;
     ObsAvoidanceStrategy obs_strategy_ = SafetyEval::ObsAvoidanceStrategy::RaiseException;
 
+    //obstacles looked up once when evaluating many destinations from the same position
+    struct ObstacleSnapshot {
+        ObstacleMap::ObstacleInfo cur_obs;
+        //closest obstacle within obs_window of each tick, empty with voxel map
+        vector<ObstacleMap::ObstacleInfo> window_obs;
+    };
+
     void checkFence(const Vector3r& cur_pos, const Vector3r& dest_pos, EvalResult& appendToResult);
-    void isSafeDestination(const Vector3r& dest,const Vector3r& cur_pos, const Quaternionr& quaternion, SafetyEval::EvalResult& result);
+    //snapshot is nullptr to query obstacle maps directly, suggestions are only made then
+    void isSafeDestination(const Vector3r& dest,const Vector3r& cur_pos, const Quaternionr& quaternion,
+        const ObstacleSnapshot* snapshot, SafetyEval::EvalResult& result);
     Vector3r getDestination(const Vector3r& cur_pos, const Vector3r& velocity) const;
     bool isThisRiskDistLess(float this_risk_dist, float other_risk_dist) const;
-    void isCurrentSafer(SafetyEval::EvalResult& result);
+    void isCurrentSafer(const ObstacleSnapshot* snapshot, SafetyEval::EvalResult& result);
     void setSuggestedVelocity(SafetyEval::EvalResult& result, const Quaternionr& quaternion);
+    void setSuggestedVelocityFromVoxels(SafetyEval::EvalResult& result);
     float adjustClearanceForPrStl(float base_clearance, float obs_confidence);
+    float getMaxClearance() const;
+    static ObstacleMap::ObstacleInfo toObstacleInfo(const VoxelMap::Obstacle& obs);
 public:
     SafetyEval(VehicleParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy);
     EvalResult isSafeVelocity(const Vector3r& cur_pos, const Vector3r& velocity, const Quaternionr& quaternion);
     EvalResult isSafeVelocityZ(const Vector3r& cur_pos, float vx, float vy, float z, const Quaternionr& quaternion);
     EvalResult isSafeDestination(const Vector3r& dest,const Vector3r& cur_pos, const Quaternionr& quaternion);
     EvalResult isSafePosition(const Vector3r& cur_pos, const Quaternionr& quaternion);
+    //same checks as isSafeDestination for each of dest_positions, for planners scoring many options at once.
+    //Obstacles are looked up once for all of them and no suggested_vec is computed.
+    vector<EvalResult> isSafeDestinations(const vector<Vector3r>& dest_positions, const Vector3r& cur_pos, const Quaternionr& quaternion);
     
     void setSafety(SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_strategy,
         const Vector3r& origin, float xy_length, float max_z, float min_z);
     void setObsAvoidanceStrategy(SafetyEval::ObsAvoidanceStrategy obs_strategy);
     SafetyEval::ObsAvoidanceStrategy getObsAvoidanceStrategy();
+
+    //use world frame voxel map instead of obs_xy for obstacles, nullptr goes back to obs_xy
+    void setVoxelMap(shared_ptr<VoxelMap> obs_voxels);
 };
 
 }} //namespace
@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_VoxelMap_hpp
+#define air_VoxelMap_hpp
+
+#include <mutex>
+#include <unordered_map>
+#include <bitset>
+#include "common/Common.hpp"
+
+namespace msr { namespace airlib {
+
+/*
+    VoxelMap is a sparse 3D occupancy map in world frame, the counterpart of ObstacleMap for
+    obstacles above and below the vehicle and for obstacles that have left the sensor's view.
+
+    Space is divided in to cubic voxels of voxel_size. Voxels are stored in blocks of
+    kBlockSize^3 voxels that are allocated only when a point falls in them and looked up
+    by block coordinates in a hash map, so inserting a point is O(1) and memory grows with
+    the observed surface rather than the volume. Each voxel holds the log odds of being
+    occupied, like OctoMap: sensor hits raise it and rays passing through lower it, so
+    obstacles that move away are cleared again. Rays only clear voxels in existing blocks,
+    free space the map never had an obstacle in stays unallocated.
+
+    Queries find the occupied voxel closest to a point or to a segment within a maximum
+    distance. They visit only blocks within that distance of the segment, closest first, and skip
+    blocks without occupied voxels, mostly without a hash map lookup thanks to a bitmap of blocks
+    that had occupied voxels. The cost depends on the volume around the segment and how much
+    occupied space is in it, not on map size.
+
+    Like ObstacleMap, one thread is expected to insert sensor data while others query. Point
+    clouds are inserted in chunks so queries don't wait for a whole cloud.
+*/
+class VoxelMap {
+public:
+    //this will be return result of the queries
+    struct Obstacle {
+        float distance;     //distance from query point or segment to voxel center, max/2 if nothing found
+        float confidence;   //probability that the voxel is occupied, 1 if nothing found like empty ObstacleMap ticks
+        Vector3r position;  //voxel center
+
+        string toString() const
+        {
+            return Utils::stringf("Voxel: distance=%f, confidence=%f, position=%s",
+                distance, confidence, VectorMath::toString(position).c_str());
+        }
+    };
+
+    //max_range limits how far a ray is traced, points beyond it only clear voxels up to max_range
+    VoxelMap(float voxel_size = 0.2f, float max_range = 30);
+
+    //mark voxel containing point as seen occupied, without clearing any ray
+    void insertPoint(const Vector3r& point);
+    //mark voxel at each point occupied and voxels on the ray from sensor origin to each point free
+    void insertPointCloud(const Vector3r& origin, const vector<Vector3r>& points);
+    //same for count points stored as x, y, z floats
+    void insertPointCloud(const Vector3r& origin, const float* points, size_t count);
+    void clear();
+
+    bool isOccupied(const Vector3r& point) const;
+    //closest occupied voxel within max_distance of position
+    Obstacle getClosestObstacle(const Vector3r& position, float max_distance) const;
+    //closest occupied voxel within max_distance of any point on segment from-to
+    Obstacle getSegmentObstacle(const Vector3r& from, const Vector3r& to, float max_distance) const;
+
+    //centers of all occupied voxels, meant for visualization and debugging
+    vector<Vector3r> getOccupiedVoxels() const;
+    float getVoxelSize() const;
+    size_t getBlockCount() const;
+
+private:
+    static constexpr int kBlockBits = 3;
+    static constexpr int kBlockSize = 1 << kBlockBits;
+    static constexpr int kBlockVoxels = kBlockSize * kBlockSize * kBlockSize;
+    //points inserted between releasing the lock for waiting queries
+    static constexpr size_t kInsertChunk = 4096;
+    static constexpr int kOccupiedFilterBits = 1 << 16;
+
+    //log odds added per hit and per ray passing through, clamped so voxels can change state quickly
+    static constexpr float kHitLogOdds = 0.85f;
+    static constexpr float kMissLogOdds = -0.4f;
+    static constexpr float kMinLogOdds = -2.0f;
+    static constexpr float kMaxLogOdds = 3.5f;
+
+    struct VoxelIndex {
+        int x, y, z;
+    };
+
+    struct Block {
+        float log_odds[kBlockVoxels];
+        //bit per voxel with log_odds > 0 so queries only visit those
+        uint64_t occupied[kBlockVoxels / 64];
+        //number of voxels with log_odds > 0, queries skip blocks where this is 0
+        int occupied_count;
+        //index of the voxel at offset 0
+        VoxelIndex origin;
+    };
+
+    //the last block looked up, consecutive voxels on a ray are mostly in the same block
+    struct BlockCache {
+        uint64_t key;
+        Block* block;
+    };
+
+    VoxelIndex toVoxel(const Vector3r& point) const;
+    Vector3r toPosition(const VoxelIndex& voxel) const;
+    static uint64_t blockKey(int block_x, int block_y, int block_z);
+    static int voxelOffset(const VoxelIndex& voxel);
+    static VoxelIndex blockVoxel(const Block& block, int offset);
+    static size_t filterIndex(uint64_t key);
+    static float toConfidence(float log_odds);
+
+    //call these with mutex_ held
+    void updateVoxel(const VoxelIndex& voxel, float log_odds, bool create, BlockCache& cache);
+    void insertRay(const Vector3r& origin, const Vector3r& point, BlockCache& cache);
+    Obstacle findClosest(const Vector3r& from, const Vector3r& to, float max_distance) const;
+
+    float voxel_size_;
+    float max_range_;
+    std::unordered_map<uint64_t, Block> blocks_;
+    //bit for hash of each block key that ever had occupied voxels, queries skip blocks whose bit is clear
+    std::bitset<kOccupiedFilterBits> occupied_filter_;
+    mutable std::mutex mutex_;
+};
+
+}} //namespace
+#endif
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_ZoneGeoFence_hpp
+#define air_ZoneGeoFence_hpp
+
+#include <mutex>
+#include "common/Common.hpp"
+#include "IGeoFence.hpp"
+
+namespace msr { namespace airlib {
+
+/*
+    ZoneGeoFence is a geo fence made of many zones, each a prism: a polygon in x, y extruded over
+    a band of z. Allowed zones together make up the operating area, no-fly zones are cut out of it.
+    A point is in the fence if it is in any allowed zone and in no no-fly zone. Without any allowed
+    zone the operating area is everywhere, so a set of no-fly zones alone works too.
+
+    Zones are indexed in a uniform grid over x, y: every cell lists the zones whose bounding box
+    overlaps it. A point query tests the zones of one cell, a segment query the zones of the cells
+    the segment passes through, so queries cost about the same with thousands of zones as with a
+    few as long as not many zones overlap in one place. The grid is rebuilt on the first query after
+    zones were changed.
+
+    checkFence treats the move from cur_loc to dest_loc as in the fence only if every point on it is,
+    so a move that cuts through a no-fly zone or a gap between allowed zones is out of the fence. A move
+    out of the fence is still allowed if we are already out and it gets us back in or at least away from
+    the no-fly zone we are in, or closer to the nearest allowed zone, like CubeGeoFence does with its center.
+*/
+class ZoneGeoFence : public IGeoFence {
+public:
+    enum class ZoneType : uint {
+        Allowed = 0, NoFly
+    };
+
+    struct Zone {
+        vector<Vector2r> polygon;   //x, y of the corners in order, either winding, not self intersecting
+        float min_z, max_z;         //z band in NED, the zone is where min_z <= z <= max_z
+        ZoneType type;
+
+        Zone()
+            : min_z(-Utils::max<float>()), max_z(Utils::max<float>()), type(ZoneType::Allowed)
+        {
+        }
+        Zone(const vector<Vector2r>& polygon_val, float min_z_val, float max_z_val, ZoneType type_val)
+            : polygon(polygon_val), min_z(min_z_val), max_z(max_z_val), type(type_val)
+        {
+        }
+    };
+
+    //result of the batch checkFences for one vehicle
+    struct FenceCheck {
+        bool in_fence;
+        bool allow;
+    };
+
+    //grid cells are cell_size by cell_size, zones of about that size or larger keep the cell lists short
+    ZoneGeoFence(float distance_accuracy, float cell_size = 50);
+
+    void addZone(const Zone& zone);
+    void addZones(const vector<Zone>& zones);
+    void clearZones();
+    size_t getZoneCount() const;
+
+    bool isInFence(const Vector3r& point) const;
+    //true if every point on the segment from-to is in the fence
+    bool isSegmentInFence(const Vector3r& from, const Vector3r& to) const;
+    //checkFence for a move of each vehicle, cur_locs and dest_locs have one entry per vehicle
+    vector<FenceCheck> checkFences(const vector<Vector3r>& cur_locs, const vector<Vector3r>& dest_locs) const;
+
+    //replaces all zones by one allowed box around origin like CubeGeoFence
+    virtual void setBoundry(const Vector3r& origin, float xy_length, float max_z, float min_z) override;
+    virtual void checkFence(const Vector3r& cur_loc, const Vector3r& dest_loc,
+        bool& in_fence, bool& allow) override;
+    virtual string toString() const override;
+
+    virtual ~ZoneGeoFence() {};
+
+private:
+    //cells are capped so a few far apart zones with small cells can't take all memory
+    static constexpr int kMaxCells = 1 << 22;
+
+    struct IndexedZone {
+        Zone zone;
+        Vector2r box_min, box_max;
+        Vector2r center;
+    };
+
+    //part of a segment from t = start to t = end, t going from 0 at from to 1 at to
+    struct Interval {
+        float start, end;
+    };
+
+    //call these with mutex_ held
+    void buildGrid() const;
+    bool cellOf(const Vector2r& point, int& cell_x, int& cell_y) const;
+    //visits the zones of the cells under the segment once each, returns false if visit returned false
+    template<typename TVisit>
+    bool visitZones(const Vector3r& from, const Vector3r& to, TVisit visit) const;
+    bool isInFence_(const Vector3r& point) const;
+    bool isSegmentInFence_(const Vector3r& from, const Vector3r& to) const;
+    FenceCheck checkFence_(const Vector3r& cur_loc, const Vector3r& dest_loc) const;
+
+    static bool isInZone(const IndexedZone& zone, const Vector3r& point);
+    static bool isInPolygon(const vector<Vector2r>& polygon, const Vector2r& point);
+    //appends the parts of the segment inside the zone to intervals
+    void clipToZone(const IndexedZone& zone, const Vector3r& from, const Vector3r& to, vector<Interval>& intervals) const;
+
+    float distance_accuracy_;
+    float cell_size_;
+    vector<IndexedZone> zones_;
+    uint allowed_count_ = 0;
+
+    //grid is built lazily by const queries
+    mutable bool grid_dirty_ = true;
+    mutable float grid_cell_size_;
+    mutable Vector2r grid_min_;
+    mutable int grid_width_ = 0, grid_height_ = 0;
+    //zones of cell i are cell_zones_[cell_starts_[i]] up to cell_zones_[cell_starts_[i + 1]]
+    mutable vector<uint> cell_starts_;
+    mutable vector<uint> cell_zones_;
+    //allowed zones are usually few, checkFence looks for the nearest one in these
+    mutable vector<uint> allowed_zones_;
+
+    //scratch for queries: query stamp of last visit of each zone so zones in many cells are tested once
+    mutable vector<uint> zone_stamps_;
+    mutable uint stamp_ = 0;
+    mutable vector<Interval> intervals_;
+    mutable vector<float> crossings_;
+
+    mutable std::mutex mutex_;
+};
+
+}} //namespace
+#endif
@@ -35,6 +35,14 @@ public:
     {
         return ground_truth_;
     }
+
+    //SensorCollection doesn't call update() again until clock reaches this time,
+    //sensors that only produce output at their own rate should return when the next sample is due.
+    //Default is 0 which means update on every tick.
+    virtual TTimePoint getNextUpdateTime()
+    {
+        return 0;
+    }
     
     virtual ~SensorBase() = default;
 
@@ -5,6 +5,8 @@
 #define msr_airlib_SensorCollection_hpp
 
 #include <unordered_map>
+#include <limits>
+#include <algorithm>
 #include "sensors/SensorBase.hpp"
 #include "common/UpdatableContainer.hpp"
 #include "common/Common.hpp"
@@ -33,6 +35,12 @@ public:
         else {
             it->second->insert(sensor);
         }
+
+        ScheduleEntry entry;
+        entry.sensor = sensor;
+        entry.next_update = 0;
+        schedule_.push_back(entry);
+        next_wake_ = 0;
     }
 
     const SensorBase* getByType(SensorType type, uint index = 0) const
@@ -74,17 +82,30 @@ public:
     {
         UpdatableObject::reset();
 
-        for (auto& pair : sensors_) {
-            pair.second->reset();
+        //sensors are reset and updated through schedule_, sensors_ is only for lookup by type
+        for (auto& entry : schedule_) {
+            entry.sensor->reset();
+            entry.next_update = 0;
         }
+        next_wake_ = 0;
     }
 
     virtual void update() override
     {
         UpdatableObject::update();
 
-        for (auto& pair : sensors_) {
-            pair.second->update();
+        //most ticks no sensor except IMU is due, so first check against the earliest due time
+        TTimePoint now = clock()->nowNanos();
+        if (now < next_wake_)
+            return;
+
+        next_wake_ = std::numeric_limits<TTimePoint>::max();
+        for (auto& entry : schedule_) {
+            if (now >= entry.next_update) {
+                entry.sensor->update();
+                entry.next_update = entry.sensor->getNextUpdateTime();
+            }
+            next_wake_ = std::min(next_wake_, entry.next_update);
         }
     }
 
@@ -99,6 +120,14 @@ public:
 private:
     typedef UpdatableContainer<SensorBasePtr> SensorBaseContainer;
     unordered_map<uint, unique_ptr<SensorBaseContainer>> sensors_;
+
+    //sensors in insertion order with the time each one next needs update()
+    struct ScheduleEntry {
+        SensorBasePtr sensor;
+        TTimePoint next_update;
+    };
+    vector<ScheduleEntry> schedule_;
+    TTimePoint next_wake_ = 0;
 };
 
 }} //namespace
@@ -64,6 +64,12 @@ public:
     }
     //*** End: UpdatableState implementation ***//
 
+    virtual TTimePoint getNextUpdateTime() override
+    {
+        //output only changes when frequency limiter completes an interval
+        return freq_limiter_.getNextCompletionTime();
+    }
+
     virtual ~BarometerSimple() = default;
 
 private: //methods
@@ -63,6 +63,12 @@ public: //methods
 
     //*** End: UpdatableState implementation ***//
 
+    virtual TTimePoint getNextUpdateTime() override
+    {
+        //output only changes when frequency limiter completes an interval
+        return freq_limiter_.getNextCompletionTime();
+    }
+
     virtual ~GpsSimple() = default;
 private:
     void addOutputToDelayLine(real_T eph, real_T epv)
@@ -31,6 +31,7 @@ public:
         state_.gyroscope_bias = params_.gyro.turn_on_bias;
         state_.accelerometer_bias = params_.accel.turn_on_bias;
         gauss_dist.reset();
+        sigma_dt_ = -1;
         updateOutput();
     }
 
@@ -72,23 +73,32 @@ private: //methods
         //ref: An introduction to inertial navigation, Oliver J. Woodman, Sec 3.2, pp 10-12
         //https://www.cl.cam.ac.uk/techreports/UCAM-CL-TR-696.pdf
 
-        real_T sqrt_dt = static_cast<real_T>(sqrt(std::max<TTimeDelta>(dt, params_.min_sample_time)));
+        //sensor runs at a fixed rate so the stddevs only need to be recomputed when dt changes
+        if (dt != sigma_dt_)
+            updateSigmas(dt);
 
         // Gyrosocpe
-        //convert arw to stddev
-        real_T gyro_sigma_arw = params_.gyro.arw / sqrt_dt;
-        angular_velocity += gauss_dist.next() * gyro_sigma_arw + state_.gyroscope_bias;
+        angular_velocity += gauss_dist.next() * gyro_sigma_arw_ + state_.gyroscope_bias;
         //update bias random walk
-        real_T gyro_sigma_bias = gyro_bias_stability_norm * sqrt_dt;
-        state_.gyroscope_bias += gauss_dist.next() * gyro_sigma_bias;
+        state_.gyroscope_bias += gauss_dist.next() * gyro_sigma_bias_;
 
         //accelerometer
-        //convert vrw to stddev
-        real_T accel_sigma_vrw = params_.accel.vrw / sqrt_dt;
-        linear_acceleration += gauss_dist.next() * accel_sigma_vrw + state_.accelerometer_bias;
+        linear_acceleration += gauss_dist.next() * accel_sigma_vrw_ + state_.accelerometer_bias;
         //update bias random walk
-        real_T accel_sigma_bias = accel_bias_stability_norm * sqrt_dt;
-        state_.accelerometer_bias += gauss_dist.next() * accel_sigma_bias;
+        state_.accelerometer_bias += gauss_dist.next() * accel_sigma_bias_;
+    }
+
+    void updateSigmas(TTimeDelta dt)
+    {
+        real_T sqrt_dt = static_cast<real_T>(sqrt(std::max<TTimeDelta>(dt, params_.min_sample_time)));
+
+        //convert arw and vrw to stddev
+        gyro_sigma_arw_ = params_.gyro.arw / sqrt_dt;
+        accel_sigma_vrw_ = params_.accel.vrw / sqrt_dt;
+        gyro_sigma_bias_ = gyro_bias_stability_norm * sqrt_dt;
+        accel_sigma_bias_ = accel_bias_stability_norm * sqrt_dt;
+
+        sigma_dt_ = dt;
     }
 
 
@@ -98,6 +108,8 @@ private: //fields
 
     //cached calculated values
     real_T gyro_bias_stability_norm, accel_bias_stability_norm;
+    real_T gyro_sigma_arw_, gyro_sigma_bias_, accel_sigma_vrw_, accel_sigma_bias_;
+    TTimeDelta sigma_dt_ = -1;
 
     struct State {
         Vector3r gyroscope_bias;
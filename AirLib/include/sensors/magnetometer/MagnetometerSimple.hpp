@@ -10,6 +10,7 @@
 #include "MagnetometerSimpleParams.hpp"
 #include "MagnetometerBase.hpp"
 #include "common/FrequencyLimiter.hpp"
+#include "common/DelayLine.hpp"
 
 
 namespace msr { namespace airlib {
@@ -59,6 +60,12 @@ public:
     }
     //*** End: UpdatableObject implementation ***//
 
+    virtual TTimePoint getNextUpdateTime() override
+    {
+        //output only changes when frequency limiter completes an interval
+        return freq_limiter_.getNextCompletionTime();
+    }
+
     virtual ~MagnetometerSimple() = default;
 
 private: //methods
@@ -21,6 +21,10 @@ public:
     void reset();
     CarApiBase::CarState getCarState();
 
+    //async versions of above calls, see RpcLibClientBase
+    std::future<void> setCarControlsAsync(const CarApiBase::CarControls& controls);
+    std::future<CarApiBase::CarState> getCarStateAsync();
+
     virtual ~CarRpcLibClient();    //required for pimpl
 };
 
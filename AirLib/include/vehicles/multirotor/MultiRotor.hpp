@@ -108,6 +108,9 @@ public:
             rotors_.at(rotor_index).setControlSignal(
                 getController()->getVertexControlSignal(rotor_index));
         }
+
+        //sample state for telemetry subscribers, cheap when nobody is subscribed
+        getController()->publishTelemetry();
     }
 
     //sensor getter
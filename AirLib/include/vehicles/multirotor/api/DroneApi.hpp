@@ -9,6 +9,8 @@
 #include "vehicles/multirotor/controllers/DroneControllerBase.hpp"
 #include "controllers/VehicleConnectorBase.hpp"
 #include "api/VehicleApiBase.hpp"
+#include "api/ApiCallStats.hpp"
+#include "controllers/ImageEncoder.hpp"
 #include "controllers/Waiter.hpp"
 #include <atomic>
 #include <thread>
@@ -30,12 +32,24 @@ namespace msr { namespace airlib {
 // this thread so that the RPC call does NOT block, and the client can proceed with the next command.  But we also have to guarentee
 // here that only one operation is allowed at a time and that is what the CallLock object is for.  It cancels previous operation then
 // sets up the new operation.
+// Clients that stream moveByVelocity and friends at a high rate would pay for the CallLock, the cancel and restart of the
+// control loop and the thread handoff on every call.  So these commands run as one followSetpoints loop and while it is
+// running a new call only posts its setpoint to setpoint_mailbox_, the loop picks up the latest one on its next period.
 
 class DroneApi : public VehicleApiBase {
 
 public:
+    //calls that are timed in call_stats_
+    enum class ApiCall : uint {
+        ArmDisarm = 0, SetSimulationMode, Takeoff, Land, GoHome, MoveByAngle, MoveByVelocity, MoveByVelocityZ,
+        MoveOnPath, MoveToPosition, MoveToZ, MoveByManual, SetSafety, RotateToYaw, RotateByYawRate, Hover, EnableApiControl,
+        AppendToPath
+    };
+
     DroneApi(VehicleConnectorBase* vehicle)
-        : vehicle_(vehicle)
+        : vehicle_(vehicle), call_stats_({ "armDisarm", "setSimulationMode", "takeoff", "land", "goHome", "moveByAngle",
+            "moveByVelocity", "moveByVelocityZ", "moveOnPath", "moveToPosition", "moveToZ", "moveByManual", "setSafety",
+            "rotateToYaw", "rotateByYawRate", "hover", "enableApiControl", "appendToPath" })
     {
         controller_ = static_cast<DroneControllerBase*>(vehicle->getController());
 
@@ -47,83 +61,110 @@ public:
 
     bool armDisarm(bool arm)
     {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::ArmDisarm);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         return controller_->armDisarm(arm, *pending_);
     }
 
     void setSimulationMode(bool is_set)
     {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::SetSimulationMode);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         controller_->setSimulationMode(is_set);
     }
 
     bool takeoff(float max_wait_seconds)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::Takeoff);
         // takeoff might use waitForZ which is a loop, but since this method is given max_wait_seconds argument
         // client can decide not to wait by passing zero.
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         return controller_->takeoff(max_wait_seconds, *pending_);
     }
     bool land(float max_wait_seconds)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::Land);
         // takeoff might use a loop waiting for landed state, but since this method is given max_wait_seconds argument
         // client can decide not to wait by passing zero.
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         return controller_->land(max_wait_seconds, *pending_);
     }
 
     bool goHome()
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::GoHome);
         // it is assumed this is not using offboard control loop, it is triggering an onboard "RTL" feature in the drone itself.
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         return controller_->goHome(*pending_);
     }
 
     bool moveByAngle(float pitch, float roll, float z, float yaw, float duration)
     {
-        std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveByAngle>(controller_, pitch, roll, z, yaw, duration);
-        return enqueueCommand(cmd);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveByAngle);
+        return enqueueSetpoint(OffboardSetpoint::rollPitchZ(pitch, roll, z, yaw, duration), timer);
     }
 
     bool moveByVelocity(float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
     {
-        std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveByVelocity>(controller_, vx, vy, vz, duration, drivetrain, yaw_mode);
-        return enqueueCommand(cmd);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveByVelocity);
+        return enqueueSetpoint(OffboardSetpoint::velocity(vx, vy, vz, duration, drivetrain, yaw_mode), timer);
     }
 
     bool moveByVelocityZ(float vx, float vy, float z, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
     {
-        std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveByVelocityZ>(controller_, vx, vy, z, duration, drivetrain, yaw_mode);
-        return enqueueCommand(cmd);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveByVelocityZ);
+        return enqueueSetpoint(OffboardSetpoint::velocityZ(vx, vy, z, duration, drivetrain, yaw_mode), timer);
     }
 
     bool moveOnPath(const vector<Vector3r>& path, float velocity, float max_wait_seconds, DrivetrainType drivetrain, const YawMode& yaw_mode,
         float lookahead, float adaptive_lookahead)
     {
-        std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveOnPath>(controller_, path, velocity, drivetrain, yaw_mode, lookahead, adaptive_lookahead);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveOnPath);
+        //the controller starts the path where the drone is once the command runs, appendToPath can extend it until the command is over
+        std::shared_ptr<ArcLengthPath> arc_path = std::make_shared<ArcLengthPath>();
+        arc_path->append(path);
+
+        std::shared_ptr<MoveOnPath> path_cmd = std::make_shared<MoveOnPath>(controller_, arc_path, velocity, drivetrain, yaw_mode, lookahead, adaptive_lookahead);
+        {
+            std::lock_guard<std::mutex> lock(cancel_mutex_);
+            path_command_ = path_cmd;
+        }
+        std::shared_ptr<OffboardCommand> cmd = path_cmd;
         return enqueueCommandAndWait(cmd, max_wait_seconds);
     }
 
+    //adds points to the end of the path of the last moveOnPath, false if that one isn't running anymore
+    bool appendToPath(const vector<Vector3r>& path)
+    {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::AppendToPath);
+        //commands are cancelled under cancel_mutex_ so a command that isn't cancelled here gets the points
+        std::lock_guard<std::mutex> lock(cancel_mutex_);
+        return path_command_ != nullptr && !path_command_->isCancelled() && path_command_->append(path);
+    }
+
     bool moveToPosition(float x, float y, float z, float velocity, float max_wait_seconds, DrivetrainType drivetrain,
         const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveToPosition);
         std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveToPosition>(controller_, x, y, z, velocity, drivetrain, yaw_mode, lookahead, adaptive_lookahead);
         return enqueueCommandAndWait(cmd, max_wait_seconds);
     }
 
     bool moveToZ(float z, float velocity, float max_wait_seconds, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveToZ);
         std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveToZ>(controller_, z, velocity, yaw_mode, lookahead, adaptive_lookahead);
         return enqueueCommandAndWait(cmd, max_wait_seconds);
     }
 
     bool moveByManual(float vx_max, float vy_max, float z_min, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::MoveByManual);
         std::shared_ptr<OffboardCommand> cmd = std::make_shared<MoveByManual>(controller_, vx_max, vy_max, z_min, duration, drivetrain, yaw_mode);
         return enqueueCommand(cmd);
     }
@@ -131,7 +172,8 @@ public:
     bool setSafety(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
         float obs_avoidance_vel, const Vector3r& origin, float xy_length, float max_z, float min_z)
     {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::SetSafety);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         return controller_->setSafety(enable_reasons, obs_clearance, obs_startegy,
             obs_avoidance_vel, origin, xy_length, max_z, min_z);
@@ -139,6 +181,7 @@ public:
 
     bool rotateToYaw(float yaw, float max_wait_seconds, float margin)
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::RotateToYaw);
         std::shared_ptr<OffboardCommand> cmd = std::make_shared<RotateToYaw>(controller_, yaw, margin);
         return enqueueCommandAndWait(cmd, max_wait_seconds);
     }
@@ -146,12 +189,13 @@ public:
 
     bool rotateByYawRate(float yaw_rate, float duration)
     {
-        std::shared_ptr<OffboardCommand> cmd = std::make_shared<RotateByYawRate>(controller_, yaw_rate, duration);
-        return enqueueCommand(cmd);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::RotateByYawRate);
+        return enqueueSetpoint(OffboardSetpoint::yawRate(yaw_rate, duration), timer);
     }
 
     bool hover()
     {
+        ApiCallStats::Timer timer(call_stats_, ApiCall::Hover);
         // hover is implemented using moveToZ which is also an offboard control loop.
         std::shared_ptr<OffboardCommand> cmd = std::make_shared<Hover>(controller_);
         return enqueueCommand(cmd);
@@ -189,6 +233,17 @@ public:
         return vehicle_->getSegmentationObjectID(mesh_name);
     }
 
+    virtual WorldSnapshot simGetWorldSnapshot(uint fields) override
+    {
+        WorldSnapshotSource* source = vehicle_->getWorldSnapshotSource();
+        if (source == nullptr)
+            throw std::logic_error("simGetWorldSnapshot() call is only supported for simulation");
+
+        WorldSnapshot snapshot;
+        source->capture(fields, snapshot);
+        return snapshot;
+    }
+
     Quaternionr getOrientation()
     {
         return controller_->getOrientation();
@@ -219,10 +274,36 @@ public:
         return controller_->getGpsLocation();
     }
 
+    //telemetry streaming: subscribe once, then call getTelemetryFrames in a loop instead of polling each getter.
+    //fields is a combination of DroneTelemetryFields, a frame is taken every every_n_steps physics steps and
+    //up to queue_size frames are kept for the client before the oldest ones are dropped
+    int subscribeTelemetry(uint fields, uint every_n_steps, uint queue_size)
+    {
+        return controller_->getTelemetryPublisher().subscribe(fields, every_n_steps, queue_size);
+    }
+    bool unsubscribeTelemetry(int subscription_id)
+    {
+        return controller_->getTelemetryPublisher().unsubscribe(subscription_id);
+    }
+    //blocks up to max_wait_ms until frames are available, returns them encoded by DroneTelemetryCodec
+    bool getTelemetryFrames(int subscription_id, uint max_wait_ms, vector<uint8_t>& frames)
+    {
+        return controller_->getTelemetryPublisher().fetch(subscription_id, max_wait_ms, frames);
+    }
+
     bool isSimulationMode()
     {
         return controller_->isSimulationMode();
     }
+    //server side latency of the control calls since start or the last reset
+    vector<ApiCallStats::Entry> getApiCallStats(bool reset)
+    {
+        vector<ApiCallStats::Entry> entries = call_stats_.getEntries();
+        if (reset)
+            call_stats_.reset();
+        return entries;
+    }
+
     std::string getServerDebugInfo()
     {
         //for now this method just allows to see if server was started
@@ -236,6 +317,7 @@ public:
 
     virtual void cancelAllTasks()
     {
+        setpoint_mailbox_.close();
         offboard_thread_.cancel();
     }
 
@@ -246,22 +328,17 @@ public:
     }
     virtual void enableApiControl(bool is_enabled) override
     {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_);
+        ApiCallStats::Timer timer(call_stats_, ApiCall::EnableApiControl);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_);
         pending_ = std::make_shared<DirectCancelableBase>();
         controller_->enableApiControl(is_enabled);
     }
 
     virtual vector<VehicleCameraBase::ImageResponse> simGetImages(const vector<VehicleCameraBase::ImageRequest>& request) override
     {
-        vector<VehicleCameraBase::ImageResponse> response;
-
-        for (const auto& item : request) {
-            VehicleCameraBase* camera = vehicle_->getCamera(item.camera_id);
-            const auto& item_response = camera->getImage(item.image_type, item.pixels_as_float, item.compress);
-            response.push_back(item_response);
-        }
-
-        return response;
+        return image_encoder_.getImages(request, [this](uint8_t camera_id) {
+            return vehicle_->getCamera(camera_id);
+        });
     }
     virtual vector<uint8_t> simGetImage(uint8_t camera_id, VehicleCameraBase::ImageType image_type) override
     {
@@ -301,7 +378,8 @@ private:// types
         virtual void execute() override {};
     };
     struct CallLock {
-        CallLock(DroneControllerBase* controller, std::mutex& mtx, std::mutex& cancel_mutex, std::shared_ptr<CancelableBase> pending, bool is_loop_command = false)
+        CallLock(DroneControllerBase* controller, std::mutex& mtx, std::mutex& cancel_mutex, std::shared_ptr<CancelableBase> pending,
+            OffboardSetpointMailbox& setpoint_mailbox, bool is_loop_command = false)
             : controller_(controller)
         {
             //tell other call to exit (being careful to protect the interleaving of is_cancelled_ = true/is_cancelled_ = false).
@@ -309,6 +387,8 @@ private:// types
             if (pending != nullptr) {
                 pending->cancel();
             }
+            //setpoints posted from now on must not go to the loop we just cancelled
+            setpoint_mailbox.close();
 
             //wait to acquire lock
             lock_ = std::unique_lock<std::mutex>(mtx);
@@ -348,14 +428,30 @@ private:// types
     };
 
     bool enqueueCommand(std::shared_ptr<OffboardCommand>& command) {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, true);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_, true);
+        pending_ = command;
+        offboard_thread_.enqueue(command);
+        return true;
+    }
+
+    bool enqueueSetpoint(const OffboardSetpoint& setpoint, ApiCallStats::Timer& timer) {
+        //latest command wins: the running followSetpoints loop takes the setpoint, there is nothing to cancel or hand over
+        if (setpoint_mailbox_.post(setpoint)) {
+            timer.setFastPath();
+            return true;
+        }
+
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_, true);
+        uint64_t version;
+        uint64_t session = setpoint_mailbox_.open(version);
+        std::shared_ptr<OffboardCommand> command = std::make_shared<FollowSetpoints>(controller_, setpoint, setpoint_mailbox_, session, version);
         pending_ = command;
         offboard_thread_.enqueue(command);
         return true;
     }
 
     bool enqueueCommandAndWait(std::shared_ptr<OffboardCommand>& command, float max_wait_seconds) {
-        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, true);
+        CallLock lock(controller_, action_mutex_, cancel_mutex_, pending_, setpoint_mailbox_, true);
         pending_ = command;
         if (max_wait_seconds > 0) {
             return offboard_thread_.enqueueAndWait(command, max_wait_seconds);
@@ -366,66 +462,31 @@ private:// types
         return true;
     }
 
-    class MoveByAngle : public OffboardCommand {
-        float pitch_, roll_, z_, yaw_, duration_;
+    class FollowSetpoints : public OffboardCommand {
+        OffboardSetpoint setpoint_;
+        OffboardSetpointMailbox& mailbox_;
+        uint64_t session_, version_;
     public:
-        MoveByAngle(DroneControllerBase* controller, float pitch, float roll, float z, float yaw, float duration) : OffboardCommand(controller) {
-            this->pitch_ = pitch;
-            this->roll_ = roll;
-            this->z_ = z;
-            this->yaw_ = yaw;
-            this->duration_ = duration;
-        }
-        virtual void executeImpl(DroneControllerBase* controller, CancelableBase& cancelable) override {
-            controller->moveByAngle(pitch_, roll_, z_, yaw_, duration_, cancelable);
-        }
-    };
-
-    class MoveByVelocity : public OffboardCommand {
-        float vx_, vy_, vz_, duration_;
-        YawMode yaw_mode_;
-        DrivetrainType drivetrain_;
-    public:
-        MoveByVelocity(DroneControllerBase* controller, float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode) : OffboardCommand(controller) {
-            this->vx_ = vx;
-            this->vy_ = vy;
-            this->vz_ = vz;
-            this->duration_ = duration;
-            this->drivetrain_ = drivetrain;
-            this->yaw_mode_ = yaw_mode;
+        FollowSetpoints(DroneControllerBase* controller, const OffboardSetpoint& setpoint, OffboardSetpointMailbox& mailbox,
+            uint64_t session, uint64_t version) : OffboardCommand(controller), mailbox_(mailbox) {
+            this->setpoint_ = setpoint;
+            this->session_ = session;
+            this->version_ = version;
         }
         virtual void executeImpl(DroneControllerBase* controller, CancelableBase& cancelable) override {
-            controller->moveByVelocity(vx_, vy_, vz_, duration_, drivetrain_, yaw_mode_, cancelable);
-        }
-    };
-
-    class MoveByVelocityZ : public OffboardCommand {
-        float vx_, vy_, z_, duration_;
-        YawMode yaw_mode_;
-        DrivetrainType drivetrain_;
-    public:
-        MoveByVelocityZ(DroneControllerBase* controller, float vx, float vy, float z, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode) : OffboardCommand(controller) {
-            this->vx_ = vx;
-            this->vy_ = vy;
-            this->z_ = z;
-            this->duration_ = duration;
-            this->drivetrain_ = drivetrain;
-            this->yaw_mode_ = yaw_mode;
-        }
-        virtual void executeImpl(DroneControllerBase* controller, CancelableBase& cancelable) override {
-            controller->moveByVelocityZ(vx_, vy_, z_, duration_, drivetrain_, yaw_mode_, cancelable);
+            controller->followSetpoints(setpoint_, mailbox_, session_, version_, cancelable);
         }
     };
 
     class MoveOnPath : public OffboardCommand {
-        vector<Vector3r> path_;
+        std::shared_ptr<ArcLengthPath> path_;
         float velocity_;
         DrivetrainType drivetrain_;
         YawMode yaw_mode_;
         float lookahead_;
         float adaptive_lookahead_;
     public:
-        MoveOnPath(DroneControllerBase* controller, const vector<Vector3r>& path, float velocity, DrivetrainType drivetrain, const YawMode& yaw_mode,
+        MoveOnPath(DroneControllerBase* controller, std::shared_ptr<ArcLengthPath> path, float velocity, DrivetrainType drivetrain, const YawMode& yaw_mode,
             float lookahead, float adaptive_lookahead) : OffboardCommand(controller) {
             this->path_ = path;
             this->velocity_ = velocity;
@@ -435,7 +496,10 @@ private:// types
             this->adaptive_lookahead_ = adaptive_lookahead;
         }
         virtual void executeImpl(DroneControllerBase* controller, CancelableBase& cancelable) override {
-            controller->moveOnPath(path_, velocity_, drivetrain_, yaw_mode_, lookahead_, adaptive_lookahead_, cancelable);
+            controller->moveOnPath(*path_, velocity_, drivetrain_, yaw_mode_, lookahead_, adaptive_lookahead_, cancelable);
+        }
+        bool append(const vector<Vector3r>& points) {
+            return path_->append(points);
         }
     };
 
@@ -522,19 +586,6 @@ private:// types
         }
     };
 
-    class RotateByYawRate : public OffboardCommand {
-        float yaw_rate_;
-        float duration_;
-    public:
-        RotateByYawRate(DroneControllerBase* controller, float yaw_rate, float duration) : OffboardCommand(controller) {
-            this->yaw_rate_ = yaw_rate;
-            this->duration_ = duration;
-        }
-        virtual void executeImpl(DroneControllerBase* controller, CancelableBase& cancelable) override {
-            controller->rotateByYawRate(yaw_rate_, duration_, cancelable);
-        }
-    };
-
     class Hover : public OffboardCommand {
     public:
         Hover(DroneControllerBase* controller) : OffboardCommand(controller) {
@@ -552,6 +603,11 @@ private: //vars
     std::mutex action_mutex_;
     std::mutex cancel_mutex_;
     std::shared_ptr<CancelableBase> pending_;
+    //last moveOnPath, for appendToPath
+    std::shared_ptr<MoveOnPath> path_command_;
+    ImageEncoder image_encoder_;
+    OffboardSetpointMailbox setpoint_mailbox_;
+    ApiCallStats call_stats_;
 };
 
 }} //namespace
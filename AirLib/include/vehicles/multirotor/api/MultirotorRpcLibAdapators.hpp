@@ -7,6 +7,7 @@
 #include "common/Common.hpp"
 #include "common/CommonStructs.hpp"
 #include "api/RpcLibAdapatorsBase.hpp"
+#include "api/ApiCallStats.hpp"
 #include "vehicles/multirotor/controllers/DroneCommon.hpp"
 #include "vehicles/multirotor/controllers/DroneControllerBase.hpp"
 #include "controllers/VehicleCameraBase.hpp"
@@ -37,6 +38,38 @@ public:
         }
     };
 
+    struct ApiCallStats {
+        std::string name;
+        uint64_t count = 0;
+        uint64_t fast_path_count = 0;
+        double mean_ms = 0, max_ms = 0, last_ms = 0;
+        MSGPACK_DEFINE_MAP(name, count, fast_path_count, mean_ms, max_ms, last_ms);
+
+        ApiCallStats()
+        {}
+
+        ApiCallStats(const msr::airlib::ApiCallStats::Entry& s)
+        {
+            name = s.name;
+            count = s.count;
+            fast_path_count = s.fast_path_count;
+            mean_ms = s.mean_ms;
+            max_ms = s.max_ms;
+            last_ms = s.last_ms;
+        }
+        msr::airlib::ApiCallStats::Entry to() const
+        {
+            msr::airlib::ApiCallStats::Entry d;
+            d.name = name;
+            d.count = count;
+            d.fast_path_count = fast_path_count;
+            d.mean_ms = mean_ms;
+            d.max_ms = max_ms;
+            d.last_ms = last_ms;
+            return d;
+        }
+    };
+
 };
 
 }} //namespace
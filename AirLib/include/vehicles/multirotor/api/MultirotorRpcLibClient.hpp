@@ -10,6 +10,7 @@
 #include "controllers/VehicleCameraBase.hpp"
 #include "vehicles/multirotor/controllers/DroneControllerBase.hpp"
 #include "api/RpcLibClientBase.hpp"
+#include "api/ApiCallStats.hpp"
 #include "vehicles/multirotor/controllers/DroneCommon.hpp"
 
 namespace msr { namespace airlib {
@@ -31,6 +32,8 @@ public:
         DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode());
     bool moveOnPath(const vector<Vector3r>& path, float velocity, float max_wait_seconds = 60,
         DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1);
+    //extends the path of a moveOnPath that is still running, false if it is over
+    bool appendToPath(const vector<Vector3r>& path);
     bool moveToPosition(float x, float y, float z, float velocity, float max_wait_seconds = 60,
         DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1);
     bool moveToZ(float z, float velocity, float max_wait_seconds = 60,
@@ -49,13 +52,64 @@ public:
     GeoPoint getGpsLocation();
     bool isSimulationMode();
     std::string getDebugInfo();
+    //server side latency of each control call, reset starts counting from zero after this call
+    vector<ApiCallStats::Entry> getApiCallStats(bool reset = false);
 
     DroneControllerBase::LandedState getLandedState();
     TTimePoint timestampNow();
 
+    //telemetry streaming, fields is a combination of DroneTelemetryFields and a frame is sampled every
+    //every_n_steps physics steps. getTelemetryFrames waits up to max_wait_ms and appends all frames queued
+    //since the last call, it returns number of frames the server dropped because they were not fetched in time.
+    //The server waits at most 1 second and only for two calls at a time, any others return immediately.
+    int subscribeTelemetry(uint fields, uint every_n_steps = 1, uint queue_size = 256);
+    bool unsubscribeTelemetry(int subscription_id);
+    uint getTelemetryFrames(int subscription_id, vector<DroneTelemetryFrame>& frames, uint max_wait_ms = 1000);
+
     bool setSafety(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
         float obs_avoidance_vel, const Vector3r& origin, float xy_length, float max_z, float min_z);
 
+    //async versions of above calls, see RpcLibClientBase
+    std::future<bool> armDisarmAsync(bool arm);
+    std::future<void> setSimulationModeAsync(bool is_set);
+    std::future<bool> takeoffAsync(float max_wait_seconds = 15);
+    std::future<bool> landAsync(float max_wait_seconds = 60);
+    std::future<bool> goHomeAsync();
+    std::future<bool> moveByAngleAsync(float pitch, float roll, float z, float yaw, float duration);
+    std::future<bool> moveByVelocityAsync(float vx, float vy, float vz, float duration,
+        DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode());
+    std::future<bool> moveByVelocityZAsync(float vx, float vy, float z, float duration,
+        DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode());
+    std::future<bool> moveOnPathAsync(const vector<Vector3r>& path, float velocity, float max_wait_seconds = 60,
+        DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1);
+    std::future<bool> moveToPositionAsync(float x, float y, float z, float velocity, float max_wait_seconds = 60,
+        DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1);
+    std::future<bool> moveToZAsync(float z, float velocity, float max_wait_seconds = 60,
+        const YawMode& yaw_mode = YawMode(), float lookahead = -1, float adaptive_lookahead = 1);
+    std::future<bool> moveByManualAsync(float vx_max, float vy_max, float z_min, float duration,
+        DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom, const YawMode& yaw_mode = YawMode());
+    std::future<bool> rotateToYawAsync(float yaw, float max_wait_seconds = 60, float margin = 5);
+    std::future<bool> rotateByYawRateAsync(float yaw_rate, float duration);
+    std::future<bool> hoverAsync();
+
+    std::future<Vector3r> getPositionAsync();
+    std::future<Vector3r> getVelocityAsync();
+    std::future<Quaternionr> getOrientationAsync();
+    std::future<RCData> getRCDataAsync();
+    std::future<GeoPoint> getGpsLocationAsync();
+    std::future<bool> isSimulationModeAsync();
+    std::future<std::string> getDebugInfoAsync();
+    std::future<DroneControllerBase::LandedState> getLandedStateAsync();
+    std::future<TTimePoint> timestampNowAsync();
+
+    std::future<int> subscribeTelemetryAsync(uint fields, uint every_n_steps = 1, uint queue_size = 256);
+    std::future<bool> unsubscribeTelemetryAsync(int subscription_id);
+    //frames is appended to when the future is waited on so it must stay alive until then
+    std::future<uint> getTelemetryFramesAsync(int subscription_id, vector<DroneTelemetryFrame>& frames, uint max_wait_ms = 1000);
+
+    std::future<bool> setSafetyAsync(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
+        float obs_avoidance_vel, const Vector3r& origin, float xy_length, float max_z, float min_z);
+
     virtual ~MultirotorRpcLibClient();    //required for pimpl
 
 };
@@ -6,6 +6,7 @@
 
 #include "common/Common.hpp"
 #include <functional>
+#include <atomic>
 #include "vehicles/multirotor/api/DroneApi.hpp"
 #include "api/RpcLibServerBase.hpp"
 
@@ -19,6 +20,9 @@ public:
 
 private:
     DroneApi* getDroneApi();
+
+    //getTelemetryFrames calls currently waiting on a server thread
+    std::atomic<uint> telemetry_long_polls_;
 };
 
 }} //namespace
@@ -0,0 +1,251 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_ArcLengthPath_hpp
+#define msr_airlib_ArcLengthPath_hpp
+
+#include "common/Common.hpp"
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+
+namespace msr { namespace airlib {
+
+/*
+    Path for DroneControllerBase::moveOnPath as a polyline with the arc length from the start
+    stored at each vertex, so the point at any distance along the path is found with a binary
+    search instead of walking the segments.
+
+    With smoothing_step > 0 the waypoints are joined by centripetal Catmull-Rom splines, which pass
+    through every waypoint and don't overshoot on unevenly spaced ones, sampled about every
+    smoothing_step meters. The last spline needs the waypoint after it, so until there is one it is
+    drawn towards a mirrored point and redrawn by the next append.
+
+    Points can be appended while a moveOnPath is following the path, that is why all methods lock.
+    The follower closes the path once it reached the end, appends fail from then on so a client
+    knows it has to start a new moveOnPath instead.
+*/
+class ArcLengthPath {
+public:
+    //point at some distance along the path
+    struct Location {
+        float distance;     //from the start, clipped to the path
+        uint segment;       //index of the vertex starting the segment the point is on
+        Vector3r position;
+    };
+
+    ArcLengthPath(float smoothing_step = 0)
+        : smoothing_step_(smoothing_step)
+    {
+    }
+
+    //false if the path is closed, points equal to the previous one are skipped
+    bool append(const Vector3r& point)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+            return false;
+        appendWaypoint(point);
+        return true;
+    }
+
+    bool append(const vector<Vector3r>& points)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+            return false;
+        for (const Vector3r& point : points)
+            appendWaypoint(point);
+        return true;
+    }
+
+    //puts point in front of the first waypoint, moveOnPath uses this to start the path where the drone is when
+    //it starts following. The path is rebuilt so this must not be called while anyone is following it.
+    bool prepend(const Vector3r& point)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+            return false;
+        vector<Vector3r> waypoints;
+        waypoints.swap(waypoints_);
+        points_.clear();
+        lengths_.clear();
+        length_ = fixed_length_ = 0;
+        fixed_vertices_ = 0;
+
+        appendWaypoint(point);
+        for (const Vector3r& waypoint : waypoints)
+            appendWaypoint(waypoint);
+        return true;
+    }
+
+    //O(log n) in the number of vertices, the path must not be empty
+    Location locate(float distance) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return locateFrom(distance, 0);
+    }
+
+    //same but searching forward from a location looked up before, O(log k) in the vertices in between
+    //so the small steps moveOnPath takes don't depend on the path size
+    Location locate(float distance, const Location& from) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return locateFrom(distance, from.segment);
+    }
+
+    float getLength() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lengths_.size() > 0 ? lengths_.back() : 0;
+    }
+
+    //vertex of the polyline, with smoothing there are more of these than waypoints
+    Vector3r getVertex(uint index) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return points_.at(index);
+    }
+
+    size_t getVertexCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return points_.size();
+    }
+
+    //closes the path if distance is at its end, false if there is still path ahead
+    bool closeIfEnd(float distance)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lengths_.size() > 0 && distance < lengths_.back())
+            return false;
+        closed_ = true;
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+
+    bool isClosed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
+private:
+    //call these with mutex_ held
+    Location locateFrom(float distance, size_t first) const
+    {
+        if (points_.size() == 0)
+            throw std::out_of_range("ArcLengthPath has no points to locate a distance on");
+
+        Location location;
+        location.distance = Utils::clip(distance, 0.0f, lengths_.back());
+
+        //galloping search for the range holding the vertex after the point, from the start if it is behind first
+        size_t count = lengths_.size();
+        size_t low = first < count && lengths_[first] <= location.distance ? first : 0;
+        size_t high = low + 1;
+        for (size_t step = 1; high < count && lengths_[high] <= location.distance; step *= 2) {
+            low = high;
+            high = low + step;
+        }
+
+        //vertex after the point, zero length segments are skipped as no distance falls inside them
+        auto next = std::upper_bound(lengths_.begin() + low, lengths_.begin() + std::min(high, count), location.distance);
+        if (next == lengths_.end()) {
+            location.segment = static_cast<uint>(points_.size() - 1);
+            location.position = points_.back();
+        }
+        else {
+            uint segment = static_cast<uint>(next - lengths_.begin()) - 1;
+            float offset = location.distance - lengths_[segment];
+            location.segment = segment;
+            location.position = points_[segment] + (points_[segment + 1] - points_[segment]) * (offset / (*next - lengths_[segment]));
+        }
+        return location;
+    }
+
+    void appendWaypoint(const Vector3r& point)
+    {
+        if (waypoints_.size() > 0 && waypoints_.back() == point)
+            return;
+        waypoints_.push_back(point);
+
+        size_t count = waypoints_.size();
+        if (count == 1 || !(smoothing_step_ > 0)) {
+            appendVertex(point);
+            return;
+        }
+
+        //the spline before the new waypoint was drawn towards a mirrored point, draw it again
+        if (count > 2) {
+            points_.resize(fixed_vertices_);
+            lengths_.resize(fixed_vertices_);
+            length_ = fixed_length_;
+            appendSpline(count - 3);
+        }
+        fixed_vertices_ = points_.size();
+        fixed_length_ = length_;
+        appendSpline(count - 2);
+    }
+
+    void appendVertex(const Vector3r& point)
+    {
+        //summed up in double, in float a few thousand waypoints would already be off by centimeters
+        if (points_.size() > 0)
+            length_ += (point - points_.back()).norm();
+        else
+            length_ = 0;
+        lengths_.push_back(static_cast<float>(length_));
+        points_.push_back(point);
+    }
+
+    //samples of the spline from waypoint index to the next one, without the first which is already there
+    void appendSpline(size_t index)
+    {
+        const Vector3r& p1 = waypoints_[index];
+        const Vector3r& p2 = waypoints_[index + 1];
+        const Vector3r p0 = index > 0 ? waypoints_[index - 1] : 2.0f * p1 - p2;
+        const Vector3r p3 = index + 2 < waypoints_.size() ? waypoints_[index + 2] : 2.0f * p2 - p1;
+
+        //centripetal knots, waypoints are never equal to the previous one so they are increasing
+        float t0 = 0;
+        float t1 = t0 + std::sqrt((p1 - p0).norm());
+        float t2 = t1 + std::sqrt((p2 - p1).norm());
+        float t3 = t2 + std::sqrt((p3 - p2).norm());
+
+        int samples = std::max(1, static_cast<int>(std::ceil((p2 - p1).norm() / smoothing_step_)));
+        for (int i = 1; i < samples; ++i) {
+            float t = t1 + (t2 - t1) * i / samples;
+
+            //Barry and Goldman's pyramid
+            const Vector3r a1 = (t1 - t) / (t1 - t0) * p0 + (t - t0) / (t1 - t0) * p1;
+            const Vector3r a2 = (t2 - t) / (t2 - t1) * p1 + (t - t1) / (t2 - t1) * p2;
+            const Vector3r a3 = (t3 - t) / (t3 - t2) * p2 + (t - t2) / (t3 - t2) * p3;
+            const Vector3r b1 = (t2 - t) / (t2 - t0) * a1 + (t - t0) / (t2 - t0) * a2;
+            const Vector3r b2 = (t3 - t) / (t3 - t1) * a2 + (t - t1) / (t3 - t1) * a3;
+            appendVertex((t2 - t) / (t2 - t1) * b1 + (t - t1) / (t2 - t1) * b2);
+        }
+        appendVertex(p2);
+    }
+
+private:
+    float smoothing_step_;
+    vector<Vector3r> waypoints_;
+    vector<Vector3r> points_;
+    //arc length from the first point to each of points_
+    vector<float> lengths_;
+    double length_ = 0;
+    //points_ and length before the last spline, which gets redrawn by the next append
+    size_t fixed_vertices_ = 0;
+    double fixed_length_ = 0;
+    bool closed_ = false;
+    mutable std::mutex mutex_;
+};
+
+}} //namespace
+#endif
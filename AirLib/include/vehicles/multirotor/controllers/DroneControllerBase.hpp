@@ -12,6 +12,9 @@
 #include "safety/SafetyEval.hpp"
 #include "common/CommonStructs.hpp"
 #include "DroneCommon.hpp"
+#include "DroneTelemetry.hpp"
+#include "OffboardSetpoint.hpp"
+#include "ArcLengthPath.hpp"
 
 namespace msr { namespace airlib {
 
@@ -141,6 +144,12 @@ public: //interface for outside world
     virtual bool moveOnPath(const vector<Vector3r>& path, float velocity, DrivetrainType drivetrain, const YawMode& yaw_mode,
         float lookahead, float adaptive_lookahead, CancelableBase& cancelable_action);
 
+    /// Same as above for a path that can grow. The current position is put in front of the path when the command starts.
+    /// Points appended to the path while the drone follows it extend the flight, the path is closed when the drone reaches
+    /// its end or the command ends otherwise.
+    virtual bool moveOnPath(ArcLengthPath& path, float velocity, DrivetrainType drivetrain, const YawMode& yaw_mode,
+        float lookahead, float adaptive_lookahead, CancelableBase& cancelable_action);
+
 
     /// Move the drone to the absolution x, y, z local positions at given speed and yaw.  Remember z is negative.  
     /// Positive z is under ground.  Instead of moving to the yaw before starting, the drone will move to the yaw position 
@@ -169,6 +178,13 @@ public: //interface for outside world
     /// and move back to the location it was at when this command was received and hover there.  
     virtual bool hover(CancelableBase& cancelable_action);
 
+    /// Runs moveByAngle, moveByVelocity, moveByVelocityZ and rotateByYawRate as one loop for clients streaming
+    /// setpoints at a high rate. It starts with first and switches to every newer setpoint posted to the mailbox,
+    /// which restarts the duration. The loop ends like the single commands when the duration of the latest
+    /// setpoint is over. session and version are the ones mailbox.open() returned.
+    virtual bool followSetpoints(const OffboardSetpoint& first, OffboardSetpointMailbox& mailbox, uint64_t session, uint64_t version,
+        CancelableBase& cancelable_action);
+
     /// get the current local position in NED coordinate (x=North/y=East,z=Down) so z is negative.
     virtual Vector3r getPosition() = 0;
 
@@ -214,6 +230,11 @@ public: //interface for outside world
     virtual CollisionInfo getCollisionInfo();
     virtual void setCollisionInfo(const CollisionInfo& collision_info);
 
+    /// Telemetry streams subscribed through the API. The physics body calls publishTelemetry() after every
+    /// step so subscriptions get frames at a fixed number of physics steps instead of polling each getter.
+    DroneTelemetryPublisher& getTelemetryPublisher();
+    void publishTelemetry();
+
     //safety settings
     virtual void setSafetyEval(const shared_ptr<SafetyEval> safety_eval_ptr);
     virtual bool setSafety(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
@@ -278,32 +299,6 @@ protected: //utility functions and data members for derived classes
     void logHomePoint();
 
 private:    //types
-    struct PathPosition {
-        uint seg_index;
-        float offset;
-        Vector3r position;
-    };
-
-    struct PathSegment {
-        Vector3r seg_normalized;
-        Vector3r seg;
-        float seg_length;
-        float seg_velocity;
-        float start_z;
-        float seg_path_length;
-
-        PathSegment(const Vector3r& start, const Vector3r& end, float velocity, float path_length)
-        {
-            seg = end - start;
-            seg_length = seg.norm();
-            seg_normalized = seg.normalized();
-            start_z = start.z();
-            seg_path_length = path_length;
-
-            seg_velocity = velocity;
-        }
-    };
-
     //RAII
     class ObsStrategyChanger {
     private:
@@ -323,15 +318,14 @@ private:    //types
     };
 
 private: //methods
-    float setNextPathPosition(const vector<Vector3r>& path, const vector<PathSegment>& path_segs,
-        const PathPosition& cur_path_loc, float next_dist, PathPosition& next_path_loc);
-
     void adjustYaw(const Vector3r& heading, DrivetrainType drivetrain, YawMode& yaw_mode);
 
     void adjustYaw(float x, float y, DrivetrainType drivetrain, YawMode& yaw_mode);
 
     void moveToPathPosition(const Vector3r& dest, float velocity, DrivetrainType drivetrain, /* pass by value */ YawMode yaw_mode, float last_z);
 
+    bool moveBySetpoint(const OffboardSetpoint& setpoint, const YawMode& yaw_mode, const Vector3r& hold_position);
+
     bool isYawWithinMargin(float yaw_target, float margin);
 
 private:// vars
@@ -339,6 +333,7 @@ private:// vars
     float obs_avoidance_vel_ = 0.5f;
 
     CollisionInfo collision_info_;
+    DroneTelemetryPublisher telemetry_publisher_;
 
     // we make this recursive so that DroneControllerBase subclass can grab StatusLock then call a 
     // base class method on DroneControllerBase that also grabs the StatusLock.
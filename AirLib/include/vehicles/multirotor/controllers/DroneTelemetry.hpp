@@ -0,0 +1,432 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_DroneTelemetry_hpp
+#define msr_airlib_DroneTelemetry_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "DroneCommon.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <algorithm>
+
+namespace msr { namespace airlib {
+
+//which parts of the state go in a telemetry frame, combine with |
+enum class DroneTelemetryFields : uint {
+    Kinematics = 1,     //position, velocity and orientation
+    Gps = 2,
+    RCData = 4,
+    Collision = 8,
+    LandedState = 16,
+    All = 31
+};
+
+//one sample of drone state, only the members selected by fields are meaningful
+struct DroneTelemetryFrame {
+    uint32_t sequence = 0;      //per subscription, a gap means frames were lost
+    uint64_t step = 0;          //physics step the frame was sampled at
+    TTimePoint timestamp = 0;
+    uint fields = 0;
+
+    Vector3r position = Vector3r::Zero();
+    Vector3r velocity = Vector3r::Zero();
+    Quaternionr orientation = Quaternionr::Identity();
+    GeoPoint gps_location;
+    RCData rc_data;
+    CollisionInfo collision_info;
+    uint landed_state = 0;
+
+    bool has(DroneTelemetryFields field) const
+    {
+        return (fields & static_cast<uint>(field)) != 0;
+    }
+};
+
+/*
+    Compact binary encoding of telemetry frames so a whole batch goes over RPC as one byte array
+    instead of a msgpack map per value. All values are little endian.
+    batch: uint16 version, uint16 frame count, uint32 frames dropped since last batch, then the frames
+    frame: uint16 size in bytes including this header, uint16 fields, uint32 sequence, uint64 step, uint64 timestamp,
+           then in this order only the field groups that are present:
+           Kinematics:  float position[3], velocity[3], orientation w,x,y,z
+           Gps:         double latitude, longitude, float altitude
+           RCData:      uint64 timestamp, float pitch, roll, throttle, yaw, uint32 switch1..8, uint8 is_initialized | is_valid << 1
+           Collision:   uint8 has_collided, float normal[3], impact_point[3], position[3], penetration_depth,
+                        uint64 time_stamp, uint32 collision_count, int32 object_id (object name is not sent)
+           LandedState: uint8
+*/
+class DroneTelemetryCodec {
+public:
+    static constexpr uint16_t kVersion = 1;
+    static constexpr size_t kBatchHeaderSize = 8;
+    static constexpr size_t kFrameHeaderSize = 24;
+
+    static void beginBatch(vector<uint8_t>& out, uint32_t dropped)
+    {
+        out.clear();
+        put<uint16_t>(out, kVersion);
+        put<uint16_t>(out, 0);
+        put<uint32_t>(out, dropped);
+    }
+
+    static void addFrame(vector<uint8_t>& out, const DroneTelemetryFrame& frame)
+    {
+        size_t start = out.size();
+        put<uint16_t>(out, 0);  //size, patched below
+        put<uint16_t>(out, static_cast<uint16_t>(frame.fields));
+        put<uint32_t>(out, frame.sequence);
+        put<uint64_t>(out, frame.step);
+        put<uint64_t>(out, frame.timestamp);
+
+        if (frame.has(DroneTelemetryFields::Kinematics)) {
+            putVector(out, frame.position);
+            putVector(out, frame.velocity);
+            put<float>(out, frame.orientation.w());
+            put<float>(out, frame.orientation.x());
+            put<float>(out, frame.orientation.y());
+            put<float>(out, frame.orientation.z());
+        }
+        if (frame.has(DroneTelemetryFields::Gps)) {
+            put<double>(out, frame.gps_location.latitude);
+            put<double>(out, frame.gps_location.longitude);
+            put<float>(out, frame.gps_location.altitude);
+        }
+        if (frame.has(DroneTelemetryFields::RCData)) {
+            const RCData& rc = frame.rc_data;
+            put<uint64_t>(out, rc.timestamp);
+            put<float>(out, rc.pitch);
+            put<float>(out, rc.roll);
+            put<float>(out, rc.throttle);
+            put<float>(out, rc.yaw);
+            const unsigned int switches[] = { rc.switch1, rc.switch2, rc.switch3, rc.switch4, rc.switch5, rc.switch6, rc.switch7, rc.switch8 };
+            for (unsigned int s : switches)
+                put<uint32_t>(out, s);
+            put<uint8_t>(out, static_cast<uint8_t>((rc.is_initialized ? 1 : 0) | (rc.is_valid ? 2 : 0)));
+        }
+        if (frame.has(DroneTelemetryFields::Collision)) {
+            const CollisionInfo& c = frame.collision_info;
+            put<uint8_t>(out, c.has_collided ? 1 : 0);
+            putVector(out, c.normal);
+            putVector(out, c.impact_point);
+            putVector(out, c.position);
+            put<float>(out, c.penetration_depth);
+            put<uint64_t>(out, c.time_stamp);
+            put<uint32_t>(out, c.collision_count);
+            put<int32_t>(out, c.object_id);
+        }
+        if (frame.has(DroneTelemetryFields::LandedState))
+            put<uint8_t>(out, static_cast<uint8_t>(frame.landed_state));
+
+        uint16_t size = static_cast<uint16_t>(out.size() - start);
+        std::memcpy(out.data() + start, &size, sizeof(size));
+
+        uint16_t count;
+        std::memcpy(&count, out.data() + 2, sizeof(count));
+        ++count;
+        std::memcpy(out.data() + 2, &count, sizeof(count));
+    }
+
+    //returns false if data is not a batch this version understands, dropped is frames the server had to discard
+    static bool decode(const uint8_t* data, size_t size, vector<DroneTelemetryFrame>& frames, uint32_t& dropped)
+    {
+        if (size < kBatchHeaderSize || get<uint16_t>(data) != kVersion)
+            return false;
+        uint16_t count = get<uint16_t>(data + 2);
+        dropped = get<uint32_t>(data + 4);
+
+        size_t offset = kBatchHeaderSize;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (size - offset < kFrameHeaderSize)
+                return false;
+            const uint8_t* p = data + offset;
+            uint16_t frame_size = get<uint16_t>(p);
+            if (frame_size < kFrameHeaderSize || frame_size > size - offset)
+                return false;
+            const uint8_t* end = p + frame_size;
+
+            DroneTelemetryFrame frame;
+            frame.fields = get<uint16_t>(p + 2);
+            frame.sequence = get<uint32_t>(p + 4);
+            frame.step = get<uint64_t>(p + 8);
+            frame.timestamp = get<uint64_t>(p + 16);
+            p += kFrameHeaderSize;
+
+            if (frame.has(DroneTelemetryFields::Kinematics)) {
+                if (end - p < 40) return false;
+                frame.position = getVector(p);
+                frame.velocity = getVector(p + 12);
+                frame.orientation = Quaternionr(get<float>(p + 24), get<float>(p + 28), get<float>(p + 32), get<float>(p + 36));
+                p += 40;
+            }
+            if (frame.has(DroneTelemetryFields::Gps)) {
+                if (end - p < 20) return false;
+                frame.gps_location = GeoPoint(get<double>(p), get<double>(p + 8), get<float>(p + 16));
+                p += 20;
+            }
+            if (frame.has(DroneTelemetryFields::RCData)) {
+                if (end - p < 57) return false;
+                RCData& rc = frame.rc_data;
+                rc.timestamp = get<uint64_t>(p);
+                rc.pitch = get<float>(p + 8);
+                rc.roll = get<float>(p + 12);
+                rc.throttle = get<float>(p + 16);
+                rc.yaw = get<float>(p + 20);
+                unsigned int* switches[] = { &rc.switch1, &rc.switch2, &rc.switch3, &rc.switch4, &rc.switch5, &rc.switch6, &rc.switch7, &rc.switch8 };
+                for (int s = 0; s < 8; ++s)
+                    *switches[s] = get<uint32_t>(p + 24 + 4 * s);
+                rc.is_initialized = (p[56] & 1) != 0;
+                rc.is_valid = (p[56] & 2) != 0;
+                p += 57;
+            }
+            if (frame.has(DroneTelemetryFields::Collision)) {
+                if (end - p < 57) return false;
+                CollisionInfo& c = frame.collision_info;
+                c.has_collided = p[0] != 0;
+                c.normal = getVector(p + 1);
+                c.impact_point = getVector(p + 13);
+                c.position = getVector(p + 25);
+                c.penetration_depth = get<float>(p + 37);
+                c.time_stamp = get<uint64_t>(p + 41);
+                c.collision_count = get<uint32_t>(p + 49);
+                c.object_id = get<int32_t>(p + 53);
+                p += 57;
+            }
+            if (frame.has(DroneTelemetryFields::LandedState)) {
+                if (end - p < 1) return false;
+                frame.landed_state = p[0];
+            }
+
+            frames.push_back(frame);
+            offset += frame_size;
+        }
+        return true;
+    }
+
+private:
+    //memcpy so unaligned access is fine, byte order is the host's which is little endian on all our platforms
+    template<typename T>
+    static void put(vector<uint8_t>& out, T val)
+    {
+        size_t pos = out.size();
+        out.resize(pos + sizeof(T));
+        std::memcpy(out.data() + pos, &val, sizeof(T));
+    }
+    template<typename T>
+    static T get(const uint8_t* p)
+    {
+        T val;
+        std::memcpy(&val, p, sizeof(T));
+        return val;
+    }
+    static void putVector(vector<uint8_t>& out, const Vector3r& v)
+    {
+        put<float>(out, v.x());
+        put<float>(out, v.y());
+        put<float>(out, v.z());
+    }
+    static Vector3r getVector(const uint8_t* p)
+    {
+        return Vector3r(get<float>(p), get<float>(p + 4), get<float>(p + 8));
+    }
+};
+
+/*
+    Keeps telemetry subscriptions and the frames waiting for each of them.
+    The physics thread calls publish() once per step, it samples the state only when some subscription is due
+    and copies the frame into that subscription's ring of preallocated frames, if the client doesn't fetch them
+    in time the oldest frames are overwritten and counted as dropped. fetch() is called from the RPC thread and
+    blocks until there are frames so a client can stream by calling it in a loop, one round trip per batch.
+    A subscription that is not fetched for idle_timeout_ms is removed, so clients that go away without
+    unsubscribing don't keep their queues forever.
+*/
+class DroneTelemetryPublisher {
+public:
+    //fills frame with the fields requested in frame.fields
+    typedef std::function<void(DroneTelemetryFrame& frame)> Sampler;
+
+    static constexpr uint kMaxQueueSize = 4096;
+    static constexpr uint kDefaultIdleTimeoutMs = 30000;
+
+    DroneTelemetryPublisher(uint idle_timeout_ms = kDefaultIdleTimeoutMs)
+        : idle_timeout_(std::chrono::milliseconds(idle_timeout_ms))
+    {
+    }
+
+    int subscribe(uint fields, uint every_n_steps, uint queue_size)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        removeIdle(Clock::now());
+
+        Subscription sub;
+        sub.id = next_id_++;
+        sub.fields = fields & static_cast<uint>(DroneTelemetryFields::All);
+        sub.every_n_steps = std::max(1u, every_n_steps);
+        uint capacity = std::max(1u, queue_size);
+        if (capacity > kMaxQueueSize)
+            capacity = kMaxQueueSize;
+        sub.frames.resize(capacity);
+        sub.polled = Clock::now();
+        subscriptions_.push_back(std::move(sub));
+        subscription_count_ = static_cast<uint>(subscriptions_.size());
+        return subscriptions_.back().id;
+    }
+
+    bool unsubscribe(int id)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = subscriptions_.begin(); it != subscriptions_.end(); ++it) {
+            if (it->id == id) {
+                subscriptions_.erase(it);
+                subscription_count_ = static_cast<uint>(subscriptions_.size());
+                //wake up fetch() calls waiting on this subscription
+                frames_available_.notify_all();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //called by physics thread after every step
+    void publish(const Sampler& sampler)
+    {
+        uint64_t step = step_++;
+        if (subscription_count_ == 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        //one clock read per step is cheap next to sampling, and nobody else may ever look at a forgotten subscription
+        if (removeIdle(Clock::now()))
+            frames_available_.notify_all();
+
+        uint fields = 0;
+        for (const auto& sub : subscriptions_) {
+            if (step % sub.every_n_steps == 0)
+                fields |= sub.fields;
+        }
+        if (fields == 0)
+            return;
+
+        //state getters may take controller locks so sample outside of ours
+        lock.unlock();
+        DroneTelemetryFrame sample;
+        sample.fields = fields;
+        sample.step = step;
+        sampler(sample);
+        //name is not part of the encoding, don't copy it into every queue
+        sample.collision_info.object_name.clear();
+        lock.lock();
+
+        bool added = false;
+        for (auto& sub : subscriptions_) {
+            if (step % sub.every_n_steps != 0)
+                continue;
+
+            size_t capacity = sub.frames.size();
+            if (sub.count == capacity) {
+                sub.head = (sub.head + 1) % capacity;
+                --sub.count;
+                ++sub.dropped;
+            }
+            DroneTelemetryFrame& frame = sub.frames[(sub.head + sub.count) % capacity];
+            frame = sample;
+            frame.fields = sample.fields & sub.fields;
+            frame.sequence = sub.next_sequence++;
+            ++sub.count;
+            added = true;
+        }
+        lock.unlock();
+
+        if (added)
+            frames_available_.notify_all();
+    }
+
+    //waits up to max_wait_ms for frames and encodes everything queued for the subscription into out,
+    //returns false if there is no such subscription
+    bool fetch(int id, uint max_wait_ms, vector<uint8_t>& out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        Subscription* sub = find(id);
+        if (sub == nullptr)
+            return false;
+        //a client waiting here is still polling, don't let the subscription expire under it
+        sub->polled = Clock::now() + std::chrono::milliseconds(max_wait_ms);
+
+        if (sub->count == 0 && max_wait_ms > 0) {
+            frames_available_.wait_for(lock, std::chrono::milliseconds(max_wait_ms), [this, id]() {
+                Subscription* s = find(id);
+                return s == nullptr || s->count > 0;
+            });
+            sub = find(id);
+            if (sub == nullptr)
+                return false;
+        }
+
+        DroneTelemetryCodec::beginBatch(out, sub->dropped);
+        for (size_t i = 0; i < sub->count; ++i)
+            DroneTelemetryCodec::addFrame(out, sub->frames[(sub->head + i) % sub->frames.size()]);
+        sub->head = 0;
+        sub->count = 0;
+        sub->dropped = 0;
+        sub->polled = Clock::now();
+        return true;
+    }
+
+    uint64_t getStepCount() const
+    {
+        return step_;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Subscription {
+        int id;
+        uint fields;
+        uint every_n_steps;
+        uint32_t next_sequence = 0;
+        uint32_t dropped = 0;
+        vector<DroneTelemetryFrame> frames;
+        size_t head = 0, count = 0;
+        Clock::time_point polled;   //last subscribe or fetch, or when a waiting fetch returns at the latest
+    };
+
+    //call with mutex_ held, returns true if any subscription was removed
+    bool removeIdle(Clock::time_point now)
+    {
+        size_t count = subscriptions_.size();
+        subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(), [this, now](const Subscription& sub) {
+            return now > sub.polled && now - sub.polled > idle_timeout_;
+        }), subscriptions_.end());
+        subscription_count_ = static_cast<uint>(subscriptions_.size());
+        return subscriptions_.size() != count;
+    }
+
+    Subscription* find(int id)
+    {
+        for (auto& sub : subscriptions_) {
+            if (sub.id == id)
+                return &sub;
+        }
+        return nullptr;
+    }
+
+    Clock::duration idle_timeout_;
+    std::mutex mutex_;
+    std::condition_variable frames_available_;
+    vector<Subscription> subscriptions_;
+    int next_id_ = 1;
+    //lets publish() skip the lock when nobody is subscribed
+    std::atomic<uint> subscription_count_ {0};
+    std::atomic<uint64_t> step_ {0};
+};
+
+}} //namespace
+#endif
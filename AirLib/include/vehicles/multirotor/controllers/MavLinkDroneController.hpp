@@ -293,7 +293,10 @@ public:
             is_controls_0_1_ = true;
             Utils::setValue(rotor_controls_, 0.0f);
             //TODO: main_node_->setMessageInterval(...);
-            connection_->subscribe([=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg){
+            //only the messages processMavMessages handles are dispatched to it
+            const std::vector<uint32_t> msgids = { HeartbeatMessage.msgid, StatusTextMessage.msgid, CommandLongMessage.msgid,
+                HilControlsMessage.msgid, HilActuatorControlsMessage.msgid };
+            connection_->subscribe(msgids, [=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg){
                 unused(connection);
                 processMavMessages(msg);
             });
@@ -301,7 +304,7 @@ public:
             // listen to the other mavlink connection also
             auto mavcon = mav_vehicle_->getConnection();
             if (mavcon != connection_) {
-                mavcon->subscribe([=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
+                mavcon->subscribe(msgids, [=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
                     unused(connection);
                     processMavMessages(msg);
                 });
@@ -366,7 +369,7 @@ public:
                 qgc_proxy_ = nullptr;
             }
             else {
-                connection->subscribe([=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection_val, const mavlinkcom::MavLinkMessage& msg){
+                connection->subscribe({ MocapPoseMessage.msgid }, [=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection_val, const mavlinkcom::MavLinkMessage& msg){
                     unused(connection_val);
                     processQgcMessages(msg);
                 });
@@ -0,0 +1,230 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_OffboardSetpoint_hpp
+#define msr_airlib_OffboardSetpoint_hpp
+
+#include "common/Common.hpp"
+#include "DroneCommon.hpp"
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <type_traits>
+
+namespace msr { namespace airlib {
+
+//one setpoint of the streaming move commands, which all hold a target for a duration
+struct OffboardSetpoint {
+    enum class Type : uint {
+        RollPitchZ = 0,     //x = pitch, y = roll, z = z, yaw
+        Velocity,           //x, y, z = vx, vy, vz
+        VelocityZ,          //x, y = vx, vy, z = z
+        YawRate             //yaw_mode.yaw_or_rate, position is held
+    };
+
+    Type type = Type::Velocity;
+    float x = 0, y = 0, z = 0, yaw = 0;
+    float duration = 0;
+    DrivetrainType drivetrain = DrivetrainType::MaxDegreeOfFreedom;
+    YawMode yaw_mode;
+
+    static OffboardSetpoint rollPitchZ(float pitch, float roll, float z, float yaw, float duration)
+    {
+        OffboardSetpoint setpoint;
+        setpoint.type = Type::RollPitchZ;
+        setpoint.x = pitch; setpoint.y = roll; setpoint.z = z; setpoint.yaw = yaw;
+        setpoint.duration = duration;
+        return setpoint;
+    }
+
+    static OffboardSetpoint velocity(float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
+    {
+        OffboardSetpoint setpoint;
+        setpoint.type = Type::Velocity;
+        setpoint.x = vx; setpoint.y = vy; setpoint.z = vz;
+        setpoint.duration = duration;
+        setpoint.drivetrain = drivetrain;
+        setpoint.yaw_mode = yaw_mode;
+        return setpoint;
+    }
+
+    static OffboardSetpoint velocityZ(float vx, float vy, float z, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
+    {
+        OffboardSetpoint setpoint = velocity(vx, vy, z, duration, drivetrain, yaw_mode);
+        setpoint.type = Type::VelocityZ;
+        return setpoint;
+    }
+
+    static OffboardSetpoint yawRate(float yaw_rate, float duration)
+    {
+        OffboardSetpoint setpoint;
+        setpoint.type = Type::YawRate;
+        setpoint.duration = duration;
+        setpoint.yaw_mode = YawMode(true, yaw_rate);
+        return setpoint;
+    }
+};
+
+/*
+    Latest-value-wins mailbox between API threads posting setpoints and the offboard thread running
+    DroneControllerBase::followSetpoints. While a setpoint loop is running, post() replaces its target
+    without any lock, cancel or thread handoff. Once the loop has finished or a different command took
+    over the mailbox is closed and post() returns false, the caller then starts a new loop the slow way.
+
+    It is a seqlock: state_ holds a writing bit, a closed bit, a version bumped by every post and a
+    session bumped by every open. The setpoint is stored in atomic words so readers racing a writer
+    only ever see a torn copy they then throw away. Sessions keep a loop that is on its way out from
+    closing the mailbox its successor already opened.
+*/
+class OffboardSetpointMailbox {
+public:
+    //mailbox is closed until the first open
+    OffboardSetpointMailbox()
+    {
+        for (auto& word : words_)
+            word.store(0, std::memory_order_relaxed);
+    }
+
+    //called by the API thread that starts a new loop, returns the session the loop should pass back.
+    //The loop gets its first setpoint directly, so the current version is where it starts taking from.
+    uint64_t open(uint64_t& version)
+    {
+        uint64_t state = closeAny();
+        version = versionOf(state) + 1;
+        state = pack(sessionOf(state) + 1, version);
+        state_.store(state, std::memory_order_release);
+        version = versionOf(state);
+        return sessionOf(state);
+    }
+
+    //replaces the setpoint of the running loop, false if no loop is accepting setpoints
+    bool post(const OffboardSetpoint& setpoint)
+    {
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (state & kClosed)
+                return false;
+            if (state & kWriting) {
+                std::this_thread::yield();
+                state = state_.load(std::memory_order_relaxed);
+            }
+            else if (state_.compare_exchange_weak(state, state | kWriting, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t words[kWordCount] = {};
+        std::memcpy(words, &setpoint, sizeof(setpoint));
+        for (size_t i = 0; i < kWordCount; ++i)
+            words_[i].store(words[i], std::memory_order_relaxed);
+
+        state_.store(pack(sessionOf(state), versionOf(state) + 1), std::memory_order_release);
+        return true;
+    }
+
+    //copies the setpoint if it is newer than version and updates version, for the loop of session only
+    bool take(uint64_t session, uint64_t& version, OffboardSetpoint& setpoint) const
+    {
+        for (;;) {
+            uint64_t state = state_.load(std::memory_order_acquire);
+            if (sessionOf(state) != session || versionOf(state) == version)
+                return false;
+            if (state & kWriting) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint64_t words[kWordCount];
+            for (size_t i = 0; i < kWordCount; ++i)
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            //the closed bit may have been set meanwhile, that doesn't touch the words
+            if ((state_.load(std::memory_order_relaxed) | kClosed) == (state | kClosed)) {
+                std::memcpy(&setpoint, words, sizeof(setpoint));
+                version = versionOf(state);
+                return true;
+            }
+        }
+    }
+
+    //closes session unless a setpoint newer than version came in, in which case the loop must go on
+    bool closeIfIdle(uint64_t session, uint64_t version)
+    {
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (sessionOf(state) != session || (state & kClosed))
+                return true;
+            if ((state & kWriting) || versionOf(state) != version)
+                return false;
+            if (state_.compare_exchange_weak(state, state | kClosed, std::memory_order_acq_rel, std::memory_order_relaxed))
+                return true;
+        }
+    }
+
+    //closes session whatever was posted, for loops that stop on failure
+    void close(uint64_t session)
+    {
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        while (sessionOf(state) == session && !(state & kClosed)) {
+            if (state & kWriting) {
+                std::this_thread::yield();
+                state = state_.load(std::memory_order_relaxed);
+            }
+            else
+                state_.compare_exchange_weak(state, state | kClosed, std::memory_order_acq_rel, std::memory_order_relaxed);
+        }
+    }
+
+    //closes any session, used when some other command takes over the offboard thread
+    void close()
+    {
+        closeAny();
+    }
+
+private:
+    static_assert(std::is_trivially_copyable<OffboardSetpoint>::value, "setpoint is copied as raw words");
+    static constexpr size_t kWordCount = (sizeof(OffboardSetpoint) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    //bit 0 writing, bit 1 closed, bits 2..39 version, bits 40..63 session
+    static constexpr uint64_t kWriting = 1;
+    static constexpr uint64_t kClosed = 2;
+    static constexpr int kVersionShift = 2;
+    static constexpr int kSessionShift = 40;
+    static constexpr uint64_t kVersionMask = ((uint64_t(1) << kSessionShift) - 1) & ~uint64_t(3);
+    static constexpr uint64_t kSessionMask = ~((uint64_t(1) << kSessionShift) - 1);
+
+    static uint64_t pack(uint64_t session, uint64_t version)
+    {
+        return ((session << kSessionShift) & kSessionMask) | ((version << kVersionShift) & kVersionMask);
+    }
+    static uint64_t sessionOf(uint64_t state)
+    {
+        return state >> kSessionShift;
+    }
+    static uint64_t versionOf(uint64_t state)
+    {
+        return (state & kVersionMask) >> kVersionShift;
+    }
+
+    //waits out a writer and marks the mailbox closed, returns the state from before
+    uint64_t closeAny()
+    {
+        uint64_t state = state_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (state & kWriting) {
+                std::this_thread::yield();
+                state = state_.load(std::memory_order_relaxed);
+            }
+            else if (state_.compare_exchange_weak(state, state | kClosed, std::memory_order_acq_rel, std::memory_order_relaxed))
+                return state;
+        }
+    }
+
+private:
+    std::atomic<uint64_t> state_{ kClosed };
+    std::atomic<uint64_t> words_[kWordCount];
+};
+
+}} //namespace
+#endif
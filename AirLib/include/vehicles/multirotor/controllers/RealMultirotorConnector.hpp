@@ -77,6 +77,15 @@ public:
         unused(severity);
     }
 
+    virtual void addToWorldSnapshot(WorldSnapshotSource* source) override
+    {
+        unused(source);
+    }
+    virtual WorldSnapshotSource* getWorldSnapshotSource() override
+    {
+        return nullptr;
+    }
+
 private:
     VehicleControllerBase* controller_;
 };
@@ -81,6 +81,22 @@ public:
         return output_;
     }
 
+    virtual bool getErrorIntegral(GoalModeType mode, TReal& integral) const override
+    {
+        if (mode != GoalModeType::AngleLevel)
+            return rate_controller_->getErrorIntegral(mode, integral);
+        integral = pid_->getErrorIntegral();
+        return true;
+    }
+
+    virtual void setErrorIntegral(GoalModeType mode, TReal integral) override
+    {
+        if (mode != GoalModeType::AngleLevel)
+            rate_controller_->setErrorIntegral(mode, integral);
+        else
+            pid_->setErrorIntegral(integral);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
@@ -58,6 +58,20 @@ public:
         return output_;
     }
 
+    virtual bool getErrorIntegral(GoalModeType mode, TReal& integral) const override
+    {
+        if (mode != GoalModeType::AngleRate)
+            return false;
+        integral = pid_->getErrorIntegral();
+        return true;
+    }
+
+    virtual void setErrorIntegral(GoalModeType mode, TReal integral) override
+    {
+        if (mode == GoalModeType::AngleRate)
+            pid_->setErrorIntegral(integral);
+    }
+
 private:
     unsigned int axis_;
     const IGoal* goal_;
@@ -28,6 +28,21 @@ public:
     {
         goal_ = goal;
         state_estimator_ = state_estimator;
+
+        //all controllers an axis can switch to are created here, so a goal mode change in flight
+        //only picks another one instead of allocating and initializing new PIDs
+        for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
+            active_controllers_[axis] = nullptr;
+            for (int mode = 0; mode < kGoalModeTypeCount; ++mode) {
+                try {
+                    axis_controllers_[axis][mode] = createAxisController(axis, static_cast<GoalModeType>(mode));
+                }
+                catch (const std::invalid_argument&) {
+                    //controller doesn't support this axis, switching to it throws the same error later
+                    axis_controllers_[axis][mode].reset();
+                }
+            }
+        }
     }
 
     virtual void reset() override
@@ -38,8 +53,8 @@ public:
         output_ = Axis4r();
 
         for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
-            if (axis_controllers_[axis] != nullptr)
-                axis_controllers_[axis]->reset();
+            if (active_controllers_[axis] != nullptr)
+                active_controllers_[axis]->reset();
         }
 
     }
@@ -62,47 +77,24 @@ public:
         }
 
         for (unsigned int axis = 0; axis < Axis4r::AxisCount(); ++axis) {
-            //re-create axis controllers if goal mode was changed since last time
+            //switch axis controller if goal mode was changed since last time
             if (goal_mode[axis] != last_goal_mode_[axis]) {
-                switch (goal_mode[axis]) {
-                case GoalModeType::AngleRate:
-                    axis_controllers_[axis].reset(new AngleRateController(params_, clock_));
-                    break;
-                case GoalModeType::AngleLevel:
-                    axis_controllers_[axis].reset(new AngleLevelController(params_, clock_));
-                    break;
-                case GoalModeType::VelocityWorld:
-                    axis_controllers_[axis].reset(new VelocityController(params_, clock_));
-                    break;
-                case GoalModeType::PositionWorld:
-                    axis_controllers_[axis].reset(new PositionController(params_, clock_));
-                    break;
-                case GoalModeType::Passthrough:
-                    axis_controllers_[axis].reset(new PassthroughController());
-                    break;
-                case GoalModeType::Unknown:
-                    axis_controllers_[axis].reset(nullptr);
-                    break;
-                case GoalModeType::ConstantOutput:
-                    axis_controllers_[axis].reset(new ConstantOutputController());
-                    break;
-                default:
-                    throw std::invalid_argument("Axis controller type is not yet implemented for axis " 
-                        + std::to_string(axis));
+                IAxisController* previous = active_controllers_[axis];
+                IAxisController* controller = getAxisController(axis, goal_mode[axis]);
+                if (controller != nullptr) {
+                    controller->reset();
+                    if (previous != nullptr && params_->bumpless_mode_switch)
+                        transferErrorIntegrals(*previous, *controller);
                 }
+                active_controllers_[axis] = controller;
                 last_goal_mode_[axis] = goal_mode[axis];
-
-                //initialize axis controller
-                if (axis_controllers_[axis] != nullptr) {
-                    axis_controllers_[axis]->initialize(axis, goal_, state_estimator_);
-                    axis_controllers_[axis]->reset();
-                }
             }
 
             //update axis controller
-            if (axis_controllers_[axis] != nullptr) {
-                axis_controllers_[axis]->update();
-                output_[axis] = axis_controllers_[axis]->getOutput();
+            IAxisController* controller = active_controllers_[axis];
+            if (controller != nullptr) {
+                controller->update();
+                output_[axis] = controller->getOutput();
             }
             else
                 comm_link_->log(std::string("Axis controller type is not set for axis ").append(std::to_string(axis)), ICommLink::kLogLevelInfo);
@@ -114,6 +106,74 @@ public:
         return output_;
     }
 
+    //error integral of the PID stage for mode in the controller now driving axis, false if there is none
+    bool getErrorIntegral(unsigned int axis, GoalModeType mode, TReal& integral) const
+    {
+        return active_controllers_[axis] != nullptr && active_controllers_[axis]->getErrorIntegral(mode, integral);
+    }
+
+
+private:
+    static constexpr int kGoalModeTypeCount = static_cast<int>(GoalModeType::ConstantOutput) + 1;
+
+    std::unique_ptr<IAxisController> createAxisController(unsigned int axis, GoalModeType mode) const
+    {
+        std::unique_ptr<IAxisController> controller;
+        switch (mode) {
+        case GoalModeType::AngleRate:
+            controller.reset(new AngleRateController(params_, clock_));
+            break;
+        case GoalModeType::AngleLevel:
+            controller.reset(new AngleLevelController(params_, clock_));
+            break;
+        case GoalModeType::VelocityWorld:
+            controller.reset(new VelocityController(params_, clock_));
+            break;
+        case GoalModeType::PositionWorld:
+            controller.reset(new PositionController(params_, clock_));
+            break;
+        case GoalModeType::Passthrough:
+            controller.reset(new PassthroughController());
+            break;
+        case GoalModeType::Unknown:
+            break;
+        case GoalModeType::ConstantOutput:
+            controller.reset(new ConstantOutputController());
+            break;
+        default:
+            throw std::invalid_argument("Axis controller type is not yet implemented for axis " 
+                + std::to_string(axis));
+        }
+
+        if (controller != nullptr)
+            controller->initialize(axis, goal_, state_estimator_);
+        return controller;
+    }
+
+    IAxisController* getAxisController(unsigned int axis, GoalModeType mode)
+    {
+        int index = static_cast<int>(mode);
+        if (index < 0 || index >= kGoalModeTypeCount)
+            throw std::invalid_argument("Axis controller type is not yet implemented for axis " 
+                + std::to_string(axis));
+
+        //not created up front because axis isn't supported, this throws
+        if (axis_controllers_[axis][index] == nullptr && mode != GoalModeType::Unknown)
+            axis_controllers_[axis][index] = createAxisController(axis, mode);
+
+        return axis_controllers_[axis][index].get();
+    }
+
+    //so that e.g. the velocity PID keeps its integral when going from velocity to position goal
+    //and the output doesn't jump
+    static void transferErrorIntegrals(const IAxisController& from, IAxisController& to)
+    {
+        for (int mode = 0; mode < kGoalModeTypeCount; ++mode) {
+            TReal integral;
+            if (from.getErrorIntegral(static_cast<GoalModeType>(mode), integral))
+                to.setErrorIntegral(static_cast<GoalModeType>(mode), integral);
+        }
+    }
 
 private:
     const Params* params_;
@@ -128,7 +188,9 @@ private:
     GoalMode last_goal_mode_;
     Axis4r last_goal_val_;
 
-    std::unique_ptr<IAxisController> axis_controllers_[Axis4r::AxisCount()];
+    //controllers for each goal mode of each axis and the ones in use
+    std::unique_ptr<IAxisController> axis_controllers_[Axis4r::AxisCount()][kGoalModeTypeCount];
+    IAxisController* active_controllers_[Axis4r::AxisCount()] = {};
 };
 
 }
\ No newline at end of file
@@ -14,10 +14,12 @@ public:
     {
     }
 
-    void getMotorOutput(const Axis4r& controls, std::vector<float>& motor_outputs) const
+    //motor_outputs is std::vector or std::array sized for params motor count
+    template<typename TMotorOutputs>
+    void getMotorOutput(const Axis4r& controls, TMotorOutputs& motor_outputs) const
     {
         if (controls.throttle() < params_->motor.min_angling_throttle) {
-            motor_outputs.assign(params_->motor.motor_count, controls.throttle());
+            std::fill(motor_outputs.begin(), motor_outputs.end(), controls.throttle());
             return;
         }
         
@@ -49,9 +51,9 @@ public:
                 std::min(motor_outputs[motor_index], params_->motor.max_motor_output));
     }
 
-private:
-    const int kMotorCount = 4;
+    static constexpr int kMotorCount = 4;
 
+private:
     const Params* params_;
 
     // Custom mixer data per motor
@@ -98,6 +98,9 @@ public:
     } takeoff;
 
     GoalMode default_goal_mode = GoalMode::getStandardAngleMode();
+    //when the goal mode of an axis changes, the new controller starts with the error integrals of the
+    //PID stages it shares with the old one (e.g. velocity PID when going from velocity to position goal)
+    bool bumpless_mode_switch = true;
     VehicleStateType default_vehicle_state = VehicleStateType::Inactive;
     uint64_t api_goal_timeout = 60; //milliseconds
 };
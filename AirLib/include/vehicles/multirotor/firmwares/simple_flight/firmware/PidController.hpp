@@ -80,6 +80,17 @@ public:
         iterm_int_ = T();
     }
 
+    //error integral as accumulated by update, can be carried over to another PID for bumpless transfer
+    T getErrorIntegral() const
+    {
+        return iterm_int_;
+    }
+    void setErrorIntegral(const T& iterm)
+    {
+        iterm_int_ = iterm;
+        clipIterm();
+    }
+
     virtual void reset() override
     {
         IUpdatable::reset();
@@ -101,8 +112,10 @@ public:
 
         const T error = goal_ - measured_;
 
+        //clock is read once per update, it is a virtual call into the board
+        const uint64_t time = clock_ == nullptr ? 0 : clock_->millis();
         float dt = clock_ == nullptr ? 1 :
-            (static_cast<float>(clock_->millis()) - last_time_)
+            (static_cast<float>(time) - last_time_)
             * config_.time_scale;
 
         float pterm = error * config_.kp;
@@ -127,7 +140,7 @@ public:
         //limit final output
         output_ = clip(output_, config_.min_output, config_.max_output);
 
-        last_time_ = clock_->millis();
+        last_time_ = time;
     }
 
 private:
@@ -25,7 +25,7 @@ public:
 
     virtual void initialize(unsigned int axis, const IGoal* goal, const IStateEstimator* state_estimator) override
     {
-        if (axis_ == 2)
+        if (axis == 2)
             throw std::invalid_argument("PositionController does not support yaw axis i.e. " + std::to_string(axis));
 
         axis_ = axis;
@@ -79,6 +79,22 @@ public:
         return output_;
     }
 
+    virtual bool getErrorIntegral(GoalModeType mode, TReal& integral) const override
+    {
+        if (mode != GoalModeType::PositionWorld)
+            return velocity_controller_->getErrorIntegral(mode, integral);
+        integral = pid_->getErrorIntegral();
+        return true;
+    }
+
+    virtual void setErrorIntegral(GoalModeType mode, TReal integral) override
+    {
+        if (mode != GoalModeType::PositionWorld)
+            velocity_controller_->setErrorIntegral(mode, integral);
+        else
+            pid_->setErrorIntegral(integral);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
@@ -119,6 +119,22 @@ public:
         return output_;
     }
 
+    virtual bool getErrorIntegral(GoalModeType mode, TReal& integral) const override
+    {
+        if (mode != GoalModeType::VelocityWorld)
+            return child_controller_->getErrorIntegral(mode, integral);
+        integral = pid_->getErrorIntegral();
+        return true;
+    }
+
+    virtual void setErrorIntegral(GoalModeType mode, TReal integral) override
+    {
+        if (mode != GoalModeType::VelocityWorld)
+            child_controller_->setErrorIntegral(mode, integral);
+        else
+            pid_->setErrorIntegral(integral);
+    }
+
     /********************  IGoal ********************/
     virtual const Axis4r& getGoalValue() const override
     {
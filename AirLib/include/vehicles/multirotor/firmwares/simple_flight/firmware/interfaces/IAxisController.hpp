@@ -20,6 +20,16 @@ public:
         clearResetUpdateAsserts();
         IUpdatable::reset();
     }
+
+    //error integral of the PID stage that runs in goal mode, in this controller or its child
+    //controllers, so it can be carried over when the goal mode of the axis changes
+    virtual bool getErrorIntegral(GoalModeType /*mode*/, TReal& /*integral*/) const
+    {
+        return false;
+    }
+    virtual void setErrorIntegral(GoalModeType /*mode*/, TReal /*integral*/)
+    {
+    }
 };
 
 } //namespace
\ No newline at end of file
@@ -0,0 +1,81 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "api/RawImageClient.hpp"
+#include "api/RawImageSocket.hpp"
+
+
+namespace msr { namespace airlib {
+
+struct RawImageClient::impl {
+    //bounds the allocation for a response so a corrupt header can't exhaust memory
+    static constexpr uint64_t kMaxBodySize = 1ull << 34;
+
+    RawImageSocket::Handle sock = RawImageSocket::kInvalid;
+    vector<uint8_t> request_data;
+};
+
+RawImageClient::RawImageClient(const string& ip_address, uint16_t port)
+    : pimpl_(new impl())
+{
+    pimpl_->sock = RawImageSocket::connect(ip_address, port);
+}
+
+RawImageClient::~RawImageClient()
+{
+    close();
+}
+
+void RawImageClient::close()
+{
+    RawImageSocket::close(pimpl_->sock);
+    pimpl_->sock = RawImageSocket::kInvalid;
+}
+
+RawImageBatch RawImageClient::getImages(const vector<VehicleCameraBase::ImageRequest>& request)
+{
+    if (pimpl_->sock == RawImageSocket::kInvalid)
+        throw std::runtime_error("Raw image client is not connected");
+
+    RawImageFrame::encodeRequest(request, pimpl_->request_data);
+    vector<RawImageFrame::Segment> segments(1, RawImageFrame::Segment{ pimpl_->request_data.data(), pimpl_->request_data.size() });
+    if (!RawImageSocket::send(pimpl_->sock, segments)) {
+        close();
+        throw std::runtime_error("Raw image request could not be sent");
+    }
+
+    uint8_t header[RawImageFrame::kResponseHeaderSize];
+    uint count, error_length;
+    uint64_t body_size;
+    if (!RawImageSocket::receive(pimpl_->sock, header, sizeof(header))
+        || !RawImageFrame::decodeResponseHeader(header, count, error_length, body_size)
+        || body_size > impl::kMaxBodySize) {
+        close();
+        throw std::runtime_error("Raw image server sent an invalid response header");
+    }
+
+    //the body is read once into the buffer the returned views point into
+    auto body = std::make_shared<vector<uint8_t>>(static_cast<size_t>(body_size));
+    if (!RawImageSocket::receive(pimpl_->sock, body->data(), body->size())) {
+        close();
+        throw std::runtime_error("Raw image connection closed while receiving images");
+    }
+
+    RawImageBatch batch;
+    std::string error;
+    if (!RawImageFrame::decodeResponseBody(body, count, error_length, batch, error)) {
+        close();
+        throw std::runtime_error("Raw image server sent a malformed response");
+    }
+    if (error != "")
+        throw std::runtime_error(error);
+
+    return batch;
+}
+
+}} //namespace
+
+#endif
@@ -0,0 +1,171 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "api/RawImageServer.hpp"
+#include "api/RawImageFrame.hpp"
+#include "api/RawImageSocket.hpp"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <list>
+
+
+namespace msr { namespace airlib {
+
+struct RawImageServer::impl {
+    //how often blocked threads look at running
+    static constexpr int kPollMs = 100;
+
+    struct Connection {
+        RawImageSocket::Handle sock = RawImageSocket::kInvalid;
+        std::thread thread;
+        std::atomic<bool> done{ false };
+    };
+
+    impl(VehicleApiBase* vehicle_val, string server_address_val, uint16_t port_val)
+        : vehicle(vehicle_val), server_address(server_address_val), port(port_val)
+    {}
+
+    void acceptLoop()
+    {
+        while (running) {
+            RawImageSocket::Handle sock = RawImageSocket::accept(listener, kPollMs);
+            reapConnections();
+            if (sock == RawImageSocket::kInvalid)
+                continue;
+
+            std::lock_guard<std::mutex> guard(connections_mutex);
+            connections.emplace_back(new Connection());
+            Connection* connection = connections.back().get();
+            connection->sock = sock;
+            connection->thread = std::thread(&impl::serve, this, connection);
+        }
+    }
+
+    void serve(Connection* connection)
+    {
+        //buffers are kept across requests so a client polling images doesn't allocate per frame
+        vector<uint8_t> request_data(RawImageFrame::kRequestHeaderSize);
+        vector<VehicleCameraBase::ImageRequest> request;
+        vector<uint8_t> head;
+        vector<RawImageFrame::Segment> segments;
+
+        RawImageSocket::Handle sock = connection->sock;
+        while (running) {
+            if (!RawImageSocket::waitReadable(sock, kPollMs))
+                continue;
+            if (!RawImageSocket::receive(sock, request_data.data(), RawImageFrame::kRequestHeaderSize))
+                break;
+            int count = RawImageFrame::decodeRequestHeader(request_data.data());
+            if (count < 0)
+                break;
+            request_data.resize(RawImageFrame::kRequestHeaderSize + count * RawImageFrame::kRequestItemSize);
+            if (!RawImageSocket::receive(sock, request_data.data() + RawImageFrame::kRequestHeaderSize,
+                count * RawImageFrame::kRequestItemSize))
+                break;
+            RawImageFrame::decodeRequestItems(request_data.data() + RawImageFrame::kRequestHeaderSize, count, request);
+            request_data.resize(RawImageFrame::kRequestHeaderSize);
+
+            //response owns the pixel buffers the segments point at until the send completes
+            vector<VehicleCameraBase::ImageResponse> response;
+            try {
+                response = vehicle->simGetImages(request);
+                RawImageFrame::encodeResponse(response, head, segments);
+            }
+            catch (const std::exception& ex) {
+                RawImageFrame::encodeError(ex.what(), head);
+                segments.assign(1, RawImageFrame::Segment{ head.data(), head.size() });
+            }
+
+            if (!RawImageSocket::send(sock, segments))
+                break;
+        }
+        connection->done = true;
+    }
+
+    void reapConnections()
+    {
+        std::lock_guard<std::mutex> guard(connections_mutex);
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->done) {
+                (*it)->thread.join();
+                RawImageSocket::close((*it)->sock);
+                it = connections.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    void closeConnections()
+    {
+        std::lock_guard<std::mutex> guard(connections_mutex);
+        for (auto& connection : connections)
+            RawImageSocket::shutdown(connection->sock);
+        for (auto& connection : connections) {
+            if (connection->thread.joinable())
+                connection->thread.join();
+            RawImageSocket::close(connection->sock);
+        }
+        connections.clear();
+    }
+
+    VehicleApiBase* vehicle;
+    string server_address;
+    uint16_t port;
+
+    std::atomic<bool> running{ false };
+    RawImageSocket::Handle listener = RawImageSocket::kInvalid;
+    std::thread accept_thread;
+    std::mutex connections_mutex;
+    std::list<std::unique_ptr<Connection>> connections;
+};
+
+RawImageServer::RawImageServer(VehicleApiBase* vehicle, string server_address, uint16_t port)
+    : pimpl_(new impl(vehicle, server_address, port))
+{
+}
+
+//required for pimpl
+RawImageServer::~RawImageServer()
+{
+    stop();
+}
+
+void RawImageServer::start(bool block)
+{
+    if (pimpl_->running)
+        return;
+
+    pimpl_->listener = RawImageSocket::listen(pimpl_->server_address, pimpl_->port);
+    pimpl_->running = true;
+    if (block)
+        pimpl_->acceptLoop();
+    else
+        pimpl_->accept_thread = std::thread(&impl::acceptLoop, pimpl_.get());
+}
+
+void RawImageServer::stop()
+{
+    if (!pimpl_->running)
+        return;
+
+    pimpl_->running = false;
+    if (pimpl_->accept_thread.joinable())
+        pimpl_->accept_thread.join();
+    pimpl_->closeConnections();
+    RawImageSocket::close(pimpl_->listener);
+    pimpl_->listener = RawImageSocket::kInvalid;
+}
+
+uint16_t RawImageServer::getPort() const
+{
+    return pimpl_->port;
+}
+
+}} //namespace
+
+#endif
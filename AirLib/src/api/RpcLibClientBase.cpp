@@ -21,6 +21,7 @@ STRICT_MODE_OFF
 #undef check
 #include "rpc/client.h"
 #include "api/RpcLibAdapatorsBase.hpp"
+#include "api/RpcLibAsyncCall.hpp"
 STRICT_MODE_ON
 #ifdef _MSC_VER
 __pragma(warning( disable : 4239))
@@ -31,16 +32,34 @@ namespace msr { namespace airlib {
 
 struct RpcLibClientBase::impl {
     impl(const string&  ip_address, uint16_t port, uint timeout_ms)
-        : client(ip_address, port)
+        : client(ip_address, port), timeout_ms(timeout_ms)
     {
         // some long flight path commands can take a while, so we give it up to 1 hour max.
         client.set_timeout(timeout_ms);
     }
 
     rpc::client client;
+    uint timeout_ms;
 };
 
 typedef msr::airlib_rpclib::RpcLibAdapatorsBase RpcLibAdapatorsBase;
+typedef msr::airlib_rpclib::RpcLibAsyncCall RpcLibAsyncCall;
+
+//rpclib has a bug with serializing empty vectors, so server sends 1 byte vector instead
+static vector<uint8_t> toImageBytes(vector<uint8_t>&& result)
+{
+    if (result.size() == 1)
+        result.clear();
+    return std::move(result);
+}
+
+static WorldSnapshot toWorldSnapshot(const vector<uint8_t>& data)
+{
+    WorldSnapshot snapshot;
+    if (!WorldSnapshotCodec::decode(data.data(), data.size(), snapshot))
+        throw std::runtime_error("World snapshot from server could not be decoded");
+    return snapshot;
+}
 
 RpcLibClientBase::RpcLibClientBase(const string&  ip_address, uint16_t port, uint timeout_ms)
 {
@@ -101,12 +120,7 @@ vector<VehicleCameraBase::ImageResponse> RpcLibClientBase::simGetImages(vector<V
 }
 vector<uint8_t> RpcLibClientBase::simGetImage(int camera_id, VehicleCameraBase::ImageType type)
 {
-    vector<uint8_t> result = pimpl_->client.call("simGetImage", camera_id, type).as<vector<uint8_t>>();
-    if (result.size() == 1) {
-        // rpclib has a bug with serializing empty vectors, so we return a 1 byte vector instead.
-        result.clear();
-    }
-    return result;
+    return toImageBytes(pimpl_->client.call("simGetImage", camera_id, type).as<vector<uint8_t>>());
 }
 
 void RpcLibClientBase::simPrintLogMessage(const std::string& message, std::string message_param, unsigned char  severity)
@@ -155,6 +169,83 @@ CollisionInfo RpcLibClientBase::getCollisionInfo()
     return pimpl_->client.call("getCollisionInfo").as<RpcLibAdapatorsBase::CollisionInfo>().to();
 }
 
+WorldSnapshot RpcLibClientBase::simGetWorldSnapshot(uint fields)
+{
+    return toWorldSnapshot(pimpl_->client.call("simGetWorldSnapshot", fields).as<vector<uint8_t>>());
+}
+
+uint RpcLibClientBase::getTimeoutMs() const
+{
+    return pimpl_->timeout_ms;
+}
+
+//async calls
+std::future<bool> RpcLibClientBase::pingAsync()
+{
+    return RpcLibAsyncCall::callAs<bool>(&pimpl_->client, pimpl_->timeout_ms, "ping");
+}
+std::future<vector<VehicleCameraBase::ImageResponse>> RpcLibClientBase::simGetImagesAsync(vector<VehicleCameraBase::ImageRequest> request)
+{
+    return RpcLibAsyncCall::call<vector<VehicleCameraBase::ImageResponse>>(&pimpl_->client, pimpl_->timeout_ms,
+        [](const RPCLIB_MSGPACK::object_handle& result) {
+            return RpcLibAdapatorsBase::ImageResponse::to(result.as<vector<RpcLibAdapatorsBase::ImageResponse>>());
+        }, "simGetImages", RpcLibAdapatorsBase::ImageRequest::from(request));
+}
+std::future<vector<uint8_t>> RpcLibClientBase::simGetImageAsync(int camera_id, VehicleCameraBase::ImageType type)
+{
+    return RpcLibAsyncCall::call<vector<uint8_t>>(&pimpl_->client, pimpl_->timeout_ms,
+        [](const RPCLIB_MSGPACK::object_handle& result) {
+            return toImageBytes(result.as<vector<uint8_t>>());
+        }, "simGetImage", camera_id, type);
+}
+std::future<msr::airlib::GeoPoint> RpcLibClientBase::getHomeGeoPointAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<RpcLibAdapatorsBase::GeoPoint>(&pimpl_->client, pimpl_->timeout_ms, "getHomeGeoPoint");
+}
+std::future<void> RpcLibClientBase::simSetPoseAsync(const Pose& pose, bool ignore_collision)
+{
+    return RpcLibAsyncCall::callVoid(&pimpl_->client, pimpl_->timeout_ms, "simSetPose", RpcLibAdapatorsBase::Pose(pose), ignore_collision);
+}
+std::future<Pose> RpcLibClientBase::simGetPoseAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<RpcLibAdapatorsBase::Pose>(&pimpl_->client, pimpl_->timeout_ms, "simGetPose");
+}
+std::future<bool> RpcLibClientBase::isApiControlEnabledAsync()
+{
+    return RpcLibAsyncCall::callAs<bool>(&pimpl_->client, pimpl_->timeout_ms, "isApiControlEnabled");
+}
+std::future<void> RpcLibClientBase::enableApiControlAsync(bool is_enabled)
+{
+    return RpcLibAsyncCall::callVoid(&pimpl_->client, pimpl_->timeout_ms, "enableApiControl", is_enabled);
+}
+std::future<void> RpcLibClientBase::resetAsync()
+{
+    return RpcLibAsyncCall::callVoid(&pimpl_->client, pimpl_->timeout_ms, "reset");
+}
+std::future<CollisionInfo> RpcLibClientBase::getCollisionInfoAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<RpcLibAdapatorsBase::CollisionInfo>(&pimpl_->client, pimpl_->timeout_ms, "getCollisionInfo");
+}
+std::future<WorldSnapshot> RpcLibClientBase::simGetWorldSnapshotAsync(uint fields)
+{
+    return RpcLibAsyncCall::call<WorldSnapshot>(&pimpl_->client, pimpl_->timeout_ms,
+        [](const RPCLIB_MSGPACK::object_handle& result) {
+            return toWorldSnapshot(result.as<vector<uint8_t>>());
+        }, "simGetWorldSnapshot", fields);
+}
+std::future<bool> RpcLibClientBase::simSetSegmentationObjectIDAsync(const std::string& mesh_name, int object_id, bool is_name_regex)
+{
+    return RpcLibAsyncCall::callAs<bool>(&pimpl_->client, pimpl_->timeout_ms, "simSetSegmentationObjectID", mesh_name, object_id, is_name_regex);
+}
+std::future<int> RpcLibClientBase::simGetSegmentationObjectIDAsync(const std::string& mesh_name)
+{
+    return RpcLibAsyncCall::callAs<int>(&pimpl_->client, pimpl_->timeout_ms, "simGetSegmentationObjectID", mesh_name);
+}
+std::future<void> RpcLibClientBase::simPrintLogMessageAsync(const std::string& message, std::string message_param, unsigned char severity)
+{
+    return RpcLibAsyncCall::callVoid(&pimpl_->client, pimpl_->timeout_ms, "simPrintLogMessage", message, message_param, severity);
+}
+
 
 }} //namespace
 
@@ -8,6 +8,8 @@
 //if using Unreal Build system then include precompiled header file first
 
 #include "api/RpcLibServerBase.hpp"
+#include "api/RawImageServer.hpp"
+#include "api/RawImageFrame.hpp"
 
 
 #include "common/Common.hpp"
@@ -29,18 +31,21 @@ STRICT_MODE_ON
 namespace msr { namespace airlib {
 
 struct RpcLibServerBase::impl {
-    impl(string server_address, uint16_t port)
-        : server(server_address, port)
+    impl(VehicleApiBase* vehicle, string server_address, uint16_t port)
+        : server(server_address, port),
+        image_server(vehicle, server_address, port + RawImageFrame::kPortOffset)
     {}
 
-    impl(uint16_t port)
-        : server(port)
+    impl(VehicleApiBase* vehicle, uint16_t port)
+        : server(port),
+        image_server(vehicle, "", port + RawImageFrame::kPortOffset)
     {}
 
     ~impl() {
     }
 
     rpc::server server;
+    RawImageServer image_server;
 };
 
 typedef msr::airlib_rpclib::RpcLibAdapatorsBase RpcLibAdapatorsBase;
@@ -49,9 +54,9 @@ RpcLibServerBase::RpcLibServerBase(VehicleApiBase* vehicle, string server_addres
     : vehicle_(vehicle)
 {
     if (server_address == "")
-        pimpl_.reset(new impl(port));
+        pimpl_.reset(new impl(vehicle, port));
     else
-        pimpl_.reset(new impl(server_address, port));
+        pimpl_.reset(new impl(vehicle, server_address, port));
     pimpl_->server.bind("ping", [&]() -> bool { return true; });
 
 
@@ -104,6 +109,13 @@ RpcLibServerBase::RpcLibServerBase(VehicleApiBase* vehicle, string server_addres
 
     pimpl_->server.bind("getCollisionInfo", [&]() -> RpcLibAdapatorsBase::CollisionInfo { return vehicle_->getCollisionInfo(); });
 
+    //columnar bytes instead of msgpack structs so large swarms stay cheap to send, never empty as header is always there
+    pimpl_->server.bind("simGetWorldSnapshot", [&](uint fields) -> vector<uint8_t> {
+        vector<uint8_t> result;
+        WorldSnapshotCodec::encode(vehicle_->simGetWorldSnapshot(fields), result);
+        return result;
+    });
+
     pimpl_->server.suppress_exceptions(true);
 }
 
@@ -116,6 +128,14 @@ RpcLibServerBase::~RpcLibServerBase()
 
 void RpcLibServerBase::start(bool block)
 {
+    //images are optional, RPC still works if the raw image port can't be opened
+    try {
+        pimpl_->image_server.start(false);
+    }
+    catch (const std::exception& ex) {
+        Utils::log(ex.what(), Utils::kLogLevelWarn);
+    }
+
     if (block)
         pimpl_->server.run();
     else
@@ -125,6 +145,7 @@ void RpcLibServerBase::start(bool block)
 void RpcLibServerBase::stop()
 {
     pimpl_->server.stop();
+    pimpl_->image_server.stop();
 }
 
 void* RpcLibServerBase::getServer()
@@ -4,19 +4,80 @@
 //in header only mode, control library is not available
 #ifndef AIRLIB_HEADER_ONLY
 
-#include <thread>
+#include <algorithm>
 #include "safety/ObstacleMap.hpp"
 #include "common/common_utils/Utils.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AIRLIB_OBSTACLEMAP_SSE2
+#endif
+
 namespace msr { namespace airlib {
 
+//smallest of count distances and min_distance, NaN distances are ignored like in a < comparison
+static float minDistance(const float* distances, size_t count, float min_distance)
+{
+    size_t i = 0;
+#ifdef AIRLIB_OBSTACLEMAP_SSE2
+    //two accumulators so consecutive minps don't wait on each other
+    __m128 acc0 = _mm_set1_ps(min_distance);
+    __m128 acc1 = acc0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = _mm_min_ps(_mm_loadu_ps(distances + i), acc0);
+        acc1 = _mm_min_ps(_mm_loadu_ps(distances + i + 4), acc1);
+    }
+    if (i + 4 <= count) {
+        acc0 = _mm_min_ps(_mm_loadu_ps(distances + i), acc0);
+        i += 4;
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, _mm_min_ps(acc0, acc1));
+    for (float lane : lanes)
+        if (lane < min_distance)
+            min_distance = lane;
+#endif
+    for (; i < count; ++i)
+        if (distances[i] < min_distance)
+            min_distance = distances[i];
+    return min_distance;
+}
+
+//index of first of count distances equal to distance, or -1
+static int findDistance(const float* distances, size_t count, float distance)
+{
+    size_t i = 0;
+#ifdef AIRLIB_OBSTACLEMAP_SSE2
+    const __m128 target = _mm_set1_ps(distance);
+    for (; i + 4 <= count; i += 4) {
+        int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(distances + i), target));
+        if (mask != 0) {
+            for (int lane = 0; ; ++lane)
+                if (mask & (1 << lane))
+                    return static_cast<int>(i) + lane;
+        }
+    }
+#endif
+    for (; i < count; ++i)
+        if (distances[i] == distance)
+            return static_cast<int>(i);
+    return -1;
+}
 
 ObstacleMap::ObstacleMap(int ticks, bool odd_blindspots)
-    : distances_(ticks, Utils::max<float>()/2), confidences_(ticks, 1),
-      ticks_(ticks), blindspots_(ticks_, false)   //init with all distances at max/2 (setting it to max can cause overflow later)
-{ 
+    : published_(0), pending_(false), latest_buffer_(-1), version_(0), log_start_(0), log_ticks_(0), ticks_(ticks), blindspots_(ticks_, false)
+{
+    //init with all distances at max/2 (setting it to max can cause overflow later)
+    latest_.distances.assign(ticks, Utils::max<float>()/2);
+    latest_.confidences.assign(ticks, 1);
+    latest_.version = 0;
+    for (int i = 0; i < kBufferCount; ++i) {
+        buffers_[i] = latest_;
+        readers_[i] = 0;
+    }
+
     if (odd_blindspots)
-        for(uint i = 1; i < distances_.size(); i+=2)
+        for(uint i = 1; i < blindspots_.size(); i+=2)
             blindspots_.at(i) = true;
 }
 
@@ -30,24 +91,142 @@ int ObstacleMap::wrap(int tick) const
     return iw;
 }
 
+int ObstacleMap::acquireRead()
+{
+    //the buffer may get unpublished between reading published_ and counting ourselves as its reader,
+    //the update writing it next could have missed our count so we try again
+    for (;;) {
+        int index = published_.load();
+        readers_[index].fetch_add(1);
+        if (published_.load() == index)
+            return index;
+        readers_[index].fetch_sub(1);
+    }
+}
+
+void ObstacleMap::releaseRead(int index)
+{
+    //publish sets pending_ before looking for a free buffer and we check it after freeing ours,
+    //so either publish sees our buffer free or we see the update pending
+    if (readers_[index].fetch_sub(1) == 1 && pending_.load()) {
+        std::lock_guard<std::mutex> lock(update_mutex_);
+        if (pending_.load())
+            publish();
+    }
+}
+
+int ObstacleMap::beginWrite()
+{
+    //only updates change published_ and they hold update_mutex_
+    int published = published_.load(std::memory_order_relaxed);
+    for (int i = 0; i < kBufferCount; ++i) {
+        if (i != published && readers_[i].load() == 0)
+            return i;
+    }
+
+    //all other buffers are still read by queries that started before the last two updates
+    return -1;
+}
+
+void ObstacleMap::endWrite(int index)
+{
+    published_.store(index);
+}
+
+void ObstacleMap::publish()
+{
+    int index = beginWrite();
+    if (index < 0) {
+        pending_.store(true);
+        //the last reader may have left before seeing pending_
+        index = beginWrite();
+        if (index < 0)
+            return;
+    }
+    pending_.store(false);
+
+    Buffer& buffer = buffers_[index];
+    if (buffer.version < log_start_) {
+        //no query reads this buffer, so it can take the vectors of latest_
+        buffer.distances.swap(latest_.distances);
+        buffer.confidences.swap(latest_.confidences);
+        latest_buffer_ = index;
+    }
+    else {
+        for (auto i = log_.begin() + static_cast<ptrdiff_t>(buffer.version - log_start_); i != log_.end(); ++i)
+            applyWindow(buffer, *i);
+    }
+    buffer.version = version_;
+    endWrite(index);
+
+    //drop the windows every buffer has
+    uint64_t oldest = version_;
+    for (const Buffer& other : buffers_)
+        oldest = std::min(oldest, other.version);
+    if (oldest > log_start_) {
+        auto applied = log_.begin() + static_cast<ptrdiff_t>(oldest - log_start_);
+        for (auto i = log_.begin(); i != applied; ++i)
+            log_ticks_ -= std::min(2 * i->window + 1, ticks_);
+        log_.erase(log_.begin(), applied);
+        log_start_ = oldest;
+    }
+}
+
+void ObstacleMap::applyWindow(Buffer& buffer, const WindowUpdate& window_update) const
+{
+    for(int i = window_update.tick - window_update.window; i <= window_update.tick + window_update.window; ++i) {
+        int iw = wrap(i);
+        buffer.distances[iw] = window_update.distance;
+        buffer.confidences[iw] = window_update.confidence;
+    }
+}
+
 void ObstacleMap::update(float distance, int tick, int window, float confidence)
 {
-    std::lock_guard<std::mutex> lock(mutex_);   //lock the map before update
+    std::lock_guard<std::mutex> lock(update_mutex_);
 
     //update the specified window on the map
-    for(int i = tick-window; i <= tick+window; ++i) {
-        int iw = wrap(i);
-        distances_[iw] = distance;
-        confidences_[iw] = confidence;
+    WindowUpdate window_update;
+    window_update.distance = distance;
+    window_update.tick = tick;
+    window_update.window = window;
+    window_update.confidence = confidence;
+    if (latest_buffer_ >= 0) {
+        const Buffer& lent = buffers_[latest_buffer_];
+        std::copy(lent.distances.begin(), lent.distances.end(), latest_.distances.begin());
+        std::copy(lent.confidences.begin(), lent.confidences.end(), latest_.confidences.begin());
+        latest_buffer_ = -1;
     }
+    applyWindow(latest_, window_update);
+    ++version_;
+
+    //buffers further behind than the log get all of latest_
+    log_ticks_ += std::min(2 * window + 1, ticks_);
+    if (log_ticks_ >= ticks_) {
+        log_.clear();
+        log_start_ = version_;
+        log_ticks_ = 0;
+    }
+    else
+        log_.push_back(window_update);
+
+    publish();
 }
 
 void ObstacleMap::update(float distances[], float confidences[])
 {
-    std::lock_guard<std::mutex> lock(mutex_);   //lock the map before update
+    std::lock_guard<std::mutex> lock(update_mutex_);
 
-    std::copy(distances, distances + ticks_, std::begin(distances_));
-    std::copy(confidences, confidences + ticks_, std::begin(confidences_));
+    std::copy(distances, distances + ticks_, latest_.distances.begin());
+    std::copy(confidences, confidences + ticks_, latest_.confidences.begin());
+    latest_buffer_ = -1;
+    ++version_;
+
+    log_.clear();
+    log_start_ = version_;
+    log_ticks_ = 0;
+
+    publish();
 }
 
 void ObstacleMap::setBlindspot(int tick, bool blindspot)
@@ -55,56 +234,156 @@ void ObstacleMap::setBlindspot(int tick, bool blindspot)
     blindspots_.at(tick) = blindspot;
 }
 
-ObstacleMap::ObstacleInfo ObstacleMap::hasObstacle_(int from_tick, int to_tick) const
+//first closest obstacle in count ticks from start_tick going around the circle
+ObstacleMap::ObstacleInfo ObstacleMap::findClosest(const Buffer& buffer, int start_tick, int count) const
+{
+    //the window is one span up to the end of the vector and maybe a second one from tick 0
+    const float* distances = buffer.distances.data();
+    int first_count = std::min(count, ticks_ - start_tick);
+    int second_count = count - first_count;
+
+    float min_distance = minDistance(distances + start_tick, first_count, Utils::max<float>());
+    min_distance = minDistance(distances, second_count, min_distance);
+
+    ObstacleMap::ObstacleInfo obs;
+    obs.tick = start_tick;
+    obs.distance = Utils::max<float>();
+    obs.confidence = 0;
+    if (!(min_distance < Utils::max<float>()))
+        return obs;
+
+    int tick = findDistance(distances + start_tick, first_count, min_distance);
+    if (tick >= 0)
+        tick += start_tick;
+    else
+        tick = findDistance(distances, second_count, min_distance);
+
+    obs.tick = tick;
+    obs.distance = min_distance;
+    obs.confidence = buffer.confidences[tick];
+    return obs;
+}
+
+ObstacleMap::ObstacleInfo ObstacleMap::findInWindow(const Buffer& buffer, int from_tick, int to_tick) const
 {
     //make dure from <= to
     if (from_tick > to_tick) {
         //normalize the ticks so bothe are valid indices
         from_tick = wrap(from_tick);
         to_tick = wrap(to_tick);
-        
+
         //if from is still larger then
         //to ticks is then added one full circle to make it larger than from_tick
         if (from_tick > to_tick)
             to_tick += ticks_;
     }
 
-    //find closest obstacle in given window
-    ObstacleMap::ObstacleInfo obs;
-    obs.distance = Utils::max<float>();
-    obs.confidence = 0;
-    for(int i = from_tick; i <= to_tick; ++i) {
-        int iw = wrap(i);
-        if (obs.distance > distances_[iw]) {
-            obs.tick = iw;
-            obs.distance = distances_[iw];
-            obs.confidence = confidences_[iw];
-        }
-    }
-    
-    return obs;
+    //ticks beyond one full circle were seen already
+    int count = std::min(to_tick - from_tick + 1, ticks_);
+
+    return findClosest(buffer, wrap(from_tick), count);
 }
 
-ObstacleMap::ObstacleInfo ObstacleMap::hasObstacle(int from_tick, int to_tick) 
+ObstacleMap::ObstacleInfo ObstacleMap::hasObstacle_(int from_tick, int to_tick)
 {
-    std::lock_guard<std::mutex> lock(mutex_);   //lock the map before query
+    int index = acquireRead();
+    ObstacleMap::ObstacleInfo obs = findInWindow(buffers_[index], from_tick, to_tick);
+    releaseRead(index);
+
+    return obs;
+}
 
+void ObstacleMap::extendForBlindspots(int& from_tick, int& to_tick) const
+{
     if (blindspots_.at(wrap(from_tick)))
         from_tick--;
     if (blindspots_.at(wrap(to_tick)))
         to_tick++;
+}
 
+ObstacleMap::ObstacleInfo ObstacleMap::hasObstacle(int from_tick, int to_tick)
+{
+    extendForBlindspots(from_tick, to_tick);
     return hasObstacle_(from_tick, to_tick);
 }
 
 //search whole map to find closest obstacle
 ObstacleMap::ObstacleInfo ObstacleMap::getClosestObstacle()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-
     return hasObstacle_(0, ticks_ - 1);
 }
 
+void ObstacleMap::getWindowObstacles(int window, vector<ObstacleInfo>& obstacles)
+{
+    obstacles.resize(ticks_);
+
+    int index = acquireRead();
+    const Buffer& buffer = buffers_[index];
+
+    //with blind spots a window is up to 2 * window + 3 ticks, once that covers the circle there is nothing to slide
+    if (2 * window >= ticks_ - 2) {
+        for (int tick = 0; tick < ticks_; ++tick) {
+            int from_tick = tick - window, to_tick = tick + window;
+            extendForBlindspots(from_tick, to_tick);
+            obstacles[tick] = findInWindow(buffer, from_tick, to_tick);
+        }
+        releaseRead(index);
+        return;
+    }
+
+    //positions run from -window to ticks_ - 1 + window, so at most one circle away from valid ticks
+    const float* distances = buffer.distances.data();
+    auto wrap_near = [this](int position) {
+        return position < 0 ? position + ticks_ : (position >= ticks_ ? position - ticks_ : position);
+    };
+
+    //positions in the window with increasing distances, a position is dropped once a closer one comes after it,
+    //equal distances are kept so the head is the first closest tick like findClosest returns
+    vector<int> queue(ticks_ + 2 * window);
+    int head = 0, tail = 0, next = -window;
+    for (int tick = 0; tick < ticks_; ++tick) {
+        for (; next <= tick + window; ++next) {
+            float distance = distances[wrap_near(next)];
+            //like findClosest, distances that aren't below max (or NaN) are never reported
+            if (!(distance < Utils::max<float>()))
+                continue;
+            while (tail > head && distances[wrap_near(queue[tail - 1])] > distance)
+                --tail;
+            queue[tail++] = next;
+        }
+        while (tail > head && queue[head] < tick - window)
+            ++head;
+
+        //blind spots at either end of the window extend it by a tick like in hasObstacle, the one
+        //before wins ties as it comes first and the one after only wins if it is closer
+        int first_tick = wrap_near(tick - window), last_tick = wrap_near(tick + window);
+        int before_tick = first_tick == 0 ? ticks_ - 1 : first_tick - 1;
+        int after_tick = last_tick == ticks_ - 1 ? 0 : last_tick + 1;
+        bool extend_before = blindspots_[first_tick], extend_after = blindspots_[last_tick];
+
+        ObstacleInfo obs;
+        obs.tick = extend_before ? before_tick : first_tick;
+        obs.distance = Utils::max<float>();
+        obs.confidence = 0;
+        auto consider = [&](int candidate_tick) {
+            if (distances[candidate_tick] < obs.distance) {
+                obs.tick = candidate_tick;
+                obs.distance = distances[candidate_tick];
+                obs.confidence = buffer.confidences[candidate_tick];
+            }
+        };
+        if (extend_before)
+            consider(before_tick);
+        if (tail > head)
+            consider(wrap_near(queue[head]));
+        if (extend_after)
+            consider(after_tick);
+        obstacles[tick] = obs;
+    }
+
+    releaseRead(index);
+}
+
 int ObstacleMap::getTicks() const
 {
     return ticks_;
@@ -130,7 +409,7 @@ float ObstacleMap::tickToAngleMid(int tick) const
 {
     return 2 * M_PIf * tick / ticks_;
 }
-    
+
 }} //namespace
 
 #endif
@@ -14,6 +14,17 @@ namespace msr { namespace airlib {
 //TODO: something defines max macro which interfears with code here
 #undef max
 
+//3.2 comes from inverse CDF for epsilone = 0.05 (i.e. 95% confidence), author: akapoor
+static constexpr float kPrStlClearanceFactor = 3.2f;
+//horizontal directions considered for suggestions when obstacles come from VoxelMap
+static constexpr int kVoxelSuggestionDirections = 16;
+
+static int wrapTick(int tick, int ticks)
+{
+    int iw = tick % ticks;
+    return iw < 0 ? ticks + iw : iw;
+}
+
 SafetyEval::SafetyEval(VehicleParams vehicle_params, shared_ptr<IGeoFence> fence_ptr, shared_ptr<ObstacleMap> obs_xy_ptr)
     : vehicle_params_(vehicle_params), fence_ptr_(fence_ptr), obs_xy_ptr_(obs_xy_ptr)
 { 
@@ -42,15 +53,35 @@ SafetyEval::EvalResult SafetyEval::isSafeDestination(const Vector3r& dest_pos, c
 {
     SafetyEval::EvalResult result;
 
-    isSafeDestination(dest_pos, cur_pos, quaternion, result);
+    isSafeDestination(dest_pos, cur_pos, quaternion, nullptr, result);
     return result;
 }
 
+vector<SafetyEval::EvalResult> SafetyEval::isSafeDestinations(const vector<Vector3r>& dest_positions, const Vector3r& cur_pos,
+    const Quaternionr& quaternion)
+{
+    //closest obstacle and obstacles in every direction are looked up once for all destinations
+    ObstacleSnapshot snapshot;
+    if (enable_reasons_ & SafetyViolationType_::Obstacle) {
+        if (obs_voxels_ptr_ != nullptr)
+            snapshot.cur_obs = toObstacleInfo(obs_voxels_ptr_->getClosestObstacle(cur_pos, getMaxClearance()));
+        else {
+            snapshot.cur_obs = obs_xy_ptr_->getClosestObstacle();
+            obs_xy_ptr_->getWindowObstacles(vehicle_params_.obs_window, snapshot.window_obs);
+        }
+    }
+
+    vector<SafetyEval::EvalResult> results(dest_positions.size());
+    for (size_t i = 0; i < dest_positions.size(); ++i)
+        isSafeDestination(dest_positions[i], cur_pos, quaternion, &snapshot, results[i]);
+    return results;
+}
+
 SafetyEval::EvalResult SafetyEval::isSafePosition(const Vector3r& cur_pos, const Quaternionr& quaternion)
 {
     SafetyEval::EvalResult result;
 
-    isSafeDestination(cur_pos, cur_pos, quaternion, result);
+    isSafeDestination(cur_pos, cur_pos, quaternion, nullptr, result);
     return result;
 }
 
@@ -64,10 +95,15 @@ bool SafetyEval::isThisRiskDistLess(float this_risk_dist, float other_risk_dist)
     return other_risk_dist - this_risk_dist <= vehicle_params_.distance_accuracy;
 }
 
-void SafetyEval::isCurrentSafer(SafetyEval::EvalResult& result)
+void SafetyEval::isCurrentSafer(const ObstacleSnapshot* snapshot, SafetyEval::EvalResult& result)
 {
     //are we doing better than closest obstacle?
-    result.cur_obs = obs_xy_ptr_->getClosestObstacle();
+    if (snapshot != nullptr)
+        result.cur_obs = snapshot->cur_obs;
+    else if (obs_voxels_ptr_ != nullptr)
+        result.cur_obs = toObstacleInfo(obs_voxels_ptr_->getClosestObstacle(result.cur_pos, getMaxClearance()));
+    else
+        result.cur_obs = obs_xy_ptr_->getClosestObstacle();
 
     //if we stay where we are, what is the risk distance?
     result.cur_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, result.cur_obs.confidence) - result.cur_obs.distance;
@@ -82,7 +118,8 @@ void SafetyEval::isCurrentSafer(SafetyEval::EvalResult& result)
 }
 
 
-void SafetyEval::isSafeDestination(const Vector3r& dest_pos, const Vector3r& cur_pos, const Quaternionr& quaternion, SafetyEval::EvalResult& result)
+void SafetyEval::isSafeDestination(const Vector3r& dest_pos, const Vector3r& cur_pos, const Quaternionr& quaternion,
+    const ObstacleSnapshot* snapshot, SafetyEval::EvalResult& result)
 {
     //this function should work even when dest_pos == cur_pos
     result.dest_pos = dest_pos;
@@ -102,7 +139,17 @@ void SafetyEval::isSafeDestination(const Vector3r& dest_pos, const Vector3r& cur
     if (cur_dest_norm < vehicle_params_.distance_accuracy) {
         //we are hovering
         result.dest_risk_dist = Utils::nan<float>();
-        isCurrentSafer(result);
+        isCurrentSafer(snapshot, result);
+    }
+    else if (obs_voxels_ptr_ != nullptr) {
+        //voxels are in world frame, so check all around the path to dest including above and below it
+        result.dest_obs = toObstacleInfo(obs_voxels_ptr_->getSegmentObstacle(cur_pos, dest_pos, getMaxClearance()));
+
+        //less risk distance is better, this is never lower than at cur_pos so moving closer to an obstacle is caught
+        result.dest_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, result.dest_obs.confidence) - result.dest_obs.distance;
+        if (result.dest_risk_dist >= 0) { //potential collision
+            isCurrentSafer(snapshot, result);
+        }
     }
     else { //see if we have obstacle in direction 
         result.cur_dest_body = VectorMath::transformToBodyFrame(cur_dest, quaternion, true);
@@ -114,19 +161,22 @@ void SafetyEval::isSafeDestination(const Vector3r& dest_pos, const Vector3r& cur
         int point_tick = obs_xy_ptr_->angleToTick(point_angle);
 
         //get obstacles in the window at the tick direction around the window
-        result.dest_obs = obs_xy_ptr_->hasObstacle(point_tick - vehicle_params_.obs_window, point_tick + vehicle_params_.obs_window);
+        if (snapshot != nullptr)
+            result.dest_obs = snapshot->window_obs[wrapTick(point_tick, static_cast<int>(snapshot->window_obs.size()))];
+        else
+            result.dest_obs = obs_xy_ptr_->hasObstacle(point_tick - vehicle_params_.obs_window, point_tick + vehicle_params_.obs_window);
 
         //less risk distance is better
         result.dest_risk_dist = cur_dest_norm + adjustClearanceForPrStl(vehicle_params_.obs_clearance, result.dest_obs.confidence) - result.dest_obs.distance;
         if (result.dest_risk_dist >= 0) { //potential collision
             //check obstacles around current position and see if it has lower risk
-            isCurrentSafer(result);
+            isCurrentSafer(snapshot, result);
         }
         //else obstacle is too far
     }
 
     //if we detected unsafe condition due to obstacle, find direction to move away to
-    if (!result.is_safe && result.reason & SafetyViolationType_::Obstacle) {
+    if (snapshot == nullptr && !result.is_safe && result.reason & SafetyViolationType_::Obstacle) {
         //look for each surrounding tick to see if we have obstacle free angle
         setSuggestedVelocity(result, quaternion);
 
@@ -138,8 +188,7 @@ void SafetyEval::isSafeDestination(const Vector3r& dest_pos, const Vector3r& cur
 
 float SafetyEval::adjustClearanceForPrStl(float base_clearance, float obs_confidence)
 {
-    //3.2 comes from inverse CDF for epsilone = 0.05 (i.e. 95% confidence), author: akapoor
-    float additional_clearance = (1 - obs_confidence) * 3.2f;   
+    float additional_clearance = (1 - obs_confidence) * kPrStlClearanceFactor;
     if (additional_clearance != 0)
         Utils::log(Utils::stringf("additional_clearance=%f", additional_clearance));
 
@@ -152,6 +201,11 @@ void SafetyEval::setSuggestedVelocity(SafetyEval::EvalResult& result, const Quat
     if (obs_strategy_ == ObsAvoidanceStrategy::RaiseException)
         return;
 
+    if (obs_voxels_ptr_ != nullptr) {
+        setSuggestedVelocityFromVoxels(result);
+        return;
+    }
+
     int ref_tick; 
     int ticks = obs_xy_ptr_->getTicks();
     if (obs_strategy_ == ObsAvoidanceStrategy::ClosestMove)
@@ -161,10 +215,14 @@ void SafetyEval::setSuggestedVelocity(SafetyEval::EvalResult& result, const Quat
     else
         ref_tick = 0; //default doesn't matter as we will raise exception
 
+    //obstacles at every tick from one pass over the map, same as hasObstacle(tick, tick)
+    vector<ObstacleMap::ObstacleInfo> tick_obs;
+    obs_xy_ptr_->getWindowObstacles(0, tick_obs);
+
     for (int i = 0; i <= ticks/2; ++i) {
         //evaluate right and left side of circle
-        ObstacleMap::ObstacleInfo right_obs = obs_xy_ptr_->hasObstacle(ref_tick + i, ref_tick + i);
-        ObstacleMap::ObstacleInfo left_obs = obs_xy_ptr_->hasObstacle(ref_tick - i, ref_tick - i);
+        const ObstacleMap::ObstacleInfo& right_obs = tick_obs[wrapTick(ref_tick + i, ticks)];
+        const ObstacleMap::ObstacleInfo& left_obs = tick_obs[wrapTick(ref_tick - i, ticks)];
 
         //find right and left risk distances
         float right_risk_dist =  adjustClearanceForPrStl(vehicle_params_.obs_clearance, right_obs.confidence) - right_obs.distance;
@@ -187,6 +245,63 @@ void SafetyEval::setSuggestedVelocity(SafetyEval::EvalResult& result, const Quat
     }
 }
 
+void SafetyEval::setSuggestedVelocityFromVoxels(SafetyEval::EvalResult& result)
+{
+    //ClosestMove looks for directions closest to desired direction, OppositeMove closest to its opposite
+    //when hovering, desired direction is towards closest obstacle
+    Vector3r ref_vec(result.dest_pos.x() - result.cur_pos.x(), result.dest_pos.y() - result.cur_pos.y(), 0);
+    if (ref_vec.norm() < vehicle_params_.distance_accuracy) {
+        const VoxelMap::Obstacle closest = obs_voxels_ptr_->getClosestObstacle(result.cur_pos, getMaxClearance());
+        ref_vec = closest.position.hasNaN() ? Vector3r::UnitX()
+            : Vector3r(closest.position.x() - result.cur_pos.x(), closest.position.y() - result.cur_pos.y(), 0);
+    }
+    float ref_angle = std::atan2(ref_vec.y(), ref_vec.x());
+    if (obs_strategy_ == ObsAvoidanceStrategy::OppositeMove)
+        ref_angle += M_PIf;
+
+    const float step_angle = 2 * M_PIf / kVoxelSuggestionDirections;
+    for (int i = 0; i <= kVoxelSuggestionDirections / 2; ++i) {
+        //evaluate right and left side of circle by where we would stop if we moved that way
+        float right_angle = ref_angle + i * step_angle, left_angle = ref_angle - i * step_angle;
+        const Vector3r right_vec(std::cos(right_angle), std::sin(right_angle), 0);
+        const Vector3r left_vec(std::cos(left_angle), std::sin(left_angle), 0);
+        const VoxelMap::Obstacle right_obs = obs_voxels_ptr_->getClosestObstacle(
+            result.cur_pos + right_vec * vehicle_params_.min_breaking_dist, getMaxClearance());
+        const VoxelMap::Obstacle left_obs = obs_voxels_ptr_->getClosestObstacle(
+            result.cur_pos + left_vec * vehicle_params_.min_breaking_dist, getMaxClearance());
+
+        float right_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, right_obs.confidence) - right_obs.distance;
+        float left_risk_dist = adjustClearanceForPrStl(vehicle_params_.obs_clearance, left_obs.confidence) - left_obs.distance;
+
+        if (right_risk_dist <= 0 || left_risk_dist <= 0) {
+            bool is_right = right_risk_dist < left_risk_dist;
+            result.suggested_obs = toObstacleInfo(is_right ? right_obs : left_obs);
+            //voxels are in world frame already
+            result.suggested_vec = is_right ? right_vec : left_vec;
+
+            Utils::log(Utils::stringf("right_risk_dist=%f, left_risk_dist=%f, suggested_angle=%f", right_risk_dist, left_risk_dist,
+                is_right ? right_angle : left_angle));
+
+            break; //if none found then suggested_vec is left as zero vec, meaning enter hover mode
+        }
+    }
+}
+
+float SafetyEval::getMaxClearance() const
+{
+    //obstacles farther than clearance at lowest confidence can't make anything unsafe
+    return vehicle_params_.obs_clearance + kPrStlClearanceFactor;
+}
+
+ObstacleMap::ObstacleInfo SafetyEval::toObstacleInfo(const VoxelMap::Obstacle& obs)
+{
+    ObstacleMap::ObstacleInfo info;
+    info.tick = -1;
+    info.distance = obs.distance;
+    info.confidence = obs.confidence;
+    return info;
+}
+
 SafetyEval::EvalResult SafetyEval::isSafeVelocityZ(const Vector3r& cur_pos, float vx, float vy, float z, const Quaternionr& quaternion)
 {
     SafetyEval::EvalResult result;
@@ -195,7 +310,7 @@ SafetyEval::EvalResult SafetyEval::isSafeVelocityZ(const Vector3r& cur_pos, floa
     dest_pos.z() = z;
 
     //check if dest_pos is safe
-    isSafeDestination(dest_pos, cur_pos, quaternion, result);
+    isSafeDestination(dest_pos, cur_pos, quaternion, nullptr, result);
  
     return result;
 }
@@ -219,7 +334,7 @@ SafetyEval::EvalResult SafetyEval::isSafeVelocity(const Vector3r& cur_pos, const
     const Vector3r dest_pos = getDestination(cur_pos, velocity);
 
     //check if dest_pos is safe
-    isSafeDestination(dest_pos, cur_pos, quaternion, result);
+    isSafeDestination(dest_pos, cur_pos, quaternion, nullptr, result);
  
     return result;
 }
@@ -248,6 +363,11 @@ SafetyEval::ObsAvoidanceStrategy SafetyEval::getObsAvoidanceStrategy()
 {
     return obs_strategy_;
 }
+void SafetyEval::setVoxelMap(shared_ptr<VoxelMap> obs_voxels)
+{
+    obs_voxels_ptr_ = obs_voxels;
+    Utils::log(Utils::stringf("obstacles from %s", obs_voxels == nullptr ? "obs_xy" : "voxel map"));
+}
 
 
 }} //namespace
@@ -0,0 +1,357 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "safety/VoxelMap.hpp"
+#include "common/common_utils/Utils.hpp"
+#include <cmath>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace msr { namespace airlib {
+
+//squared distance from point to closest point on segment from-to
+static float segmentDistanceSquared(const Vector3r& point, const Vector3r& from, const Vector3r& to)
+{
+    const Vector3r segment = to - from;
+    float length_squared = segment.squaredNorm();
+    float t = length_squared > 0 ? Utils::clip((point - from).dot(segment) / length_squared, 0.0f, 1.0f) : 0;
+    return (from + segment * t - point).squaredNorm();
+}
+
+//narrows t_low..t_high to where a + (b - a) * t is within reach of center, false if nothing is left
+static bool clipToSlab(float a, float b, float center, float reach, float& t_low, float& t_high)
+{
+    const float d = b - a;
+    if (d == 0)
+        return std::abs(a - center) <= reach;
+    float t0 = (center - reach - a) / d, t1 = (center + reach - a) / d;
+    if (t0 > t1)
+        std::swap(t0, t1);
+    t_low = std::max(t_low, t0);
+    t_high = std::min(t_high, t1);
+    return t_low <= t_high;
+}
+
+//index of lowest set bit, word must not be 0
+static int lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+VoxelMap::VoxelMap(float voxel_size, float max_range)
+    : voxel_size_(voxel_size), max_range_(max_range)
+{
+}
+
+VoxelMap::VoxelIndex VoxelMap::toVoxel(const Vector3r& point) const
+{
+    return VoxelIndex { Utils::floorToInt(point.x() / voxel_size_), Utils::floorToInt(point.y() / voxel_size_),
+        Utils::floorToInt(point.z() / voxel_size_) };
+}
+
+Vector3r VoxelMap::toPosition(const VoxelIndex& voxel) const
+{
+    return Vector3r(voxel.x + 0.5f, voxel.y + 0.5f, voxel.z + 0.5f) * voxel_size_;
+}
+
+//21 bits per axis is +/-1M blocks, far more than any map we would keep
+uint64_t VoxelMap::blockKey(int block_x, int block_y, int block_z)
+{
+    const uint64_t mask = (1 << 21) - 1;
+    return (static_cast<uint64_t>(block_x) & mask) | ((static_cast<uint64_t>(block_y) & mask) << 21)
+        | ((static_cast<uint64_t>(block_z) & mask) << 42);
+}
+
+int VoxelMap::voxelOffset(const VoxelIndex& voxel)
+{
+    const int mask = kBlockSize - 1;
+    return (voxel.x & mask) | ((voxel.y & mask) << kBlockBits) | ((voxel.z & mask) << (2 * kBlockBits));
+}
+
+VoxelMap::VoxelIndex VoxelMap::blockVoxel(const Block& block, int offset)
+{
+    const int mask = kBlockSize - 1;
+    return VoxelIndex { block.origin.x + (offset & mask), block.origin.y + ((offset >> kBlockBits) & mask),
+        block.origin.z + (offset >> (2 * kBlockBits)) };
+}
+
+size_t VoxelMap::filterIndex(uint64_t key)
+{
+    //Fibonacci hashing, top bits of the product depend on all bits of the key
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 48) & (kOccupiedFilterBits - 1);
+}
+
+float VoxelMap::toConfidence(float log_odds)
+{
+    return 1 - 1 / (1 + std::exp(log_odds));
+}
+
+void VoxelMap::updateVoxel(const VoxelIndex& voxel, float log_odds, bool create, BlockCache& cache)
+{
+    //blocks are found by arithmetic shift so negative voxel indices map to negative blocks
+    int block_x = voxel.x >> kBlockBits, block_y = voxel.y >> kBlockBits, block_z = voxel.z >> kBlockBits;
+    uint64_t key = blockKey(block_x, block_y, block_z);
+    if (key != cache.key) {
+        auto found = blocks_.find(key);
+        cache.key = key;
+        cache.block = found == blocks_.end() ? nullptr : &found->second;
+    }
+    if (cache.block == nullptr) {
+        if (!create)
+            return;
+
+        //value initialized, all voxels unknown
+        Block& block = blocks_[key];
+        block.origin = VoxelIndex { block_x * kBlockSize, block_y * kBlockSize, block_z * kBlockSize };
+        cache.block = &block;
+    }
+
+    int offset = voxelOffset(voxel);
+    float& voxel_log_odds = cache.block->log_odds[offset];
+    bool was_occupied = voxel_log_odds > 0;
+    voxel_log_odds = Utils::clip(voxel_log_odds + log_odds, kMinLogOdds, kMaxLogOdds);
+    bool is_occupied = voxel_log_odds > 0;
+    if (is_occupied != was_occupied) {
+        cache.block->occupied[offset / 64] ^= 1ull << (offset % 64);
+        cache.block->occupied_count += is_occupied ? 1 : -1;
+        if (is_occupied)
+            occupied_filter_.set(filterIndex(key));
+    }
+}
+
+void VoxelMap::insertRay(const Vector3r& origin, const Vector3r& point, BlockCache& cache)
+{
+    const Vector3r ray = point - origin;
+    float length = ray.norm();
+    //points beyond max_range are too uncertain to mark but still tell us the ray up to there is free
+    bool hit = length <= max_range_;
+    const Vector3r end = hit ? point : origin + ray * (max_range_ / length);
+
+    const VoxelIndex start_voxel = toVoxel(origin), end_voxel = toVoxel(end);
+    int index[3] = { start_voxel.x, start_voxel.y, start_voxel.z };
+    const int end_index[3] = { end_voxel.x, end_voxel.y, end_voxel.z };
+
+    //walk the voxels the ray passes through (Amanatides & Woo), t goes from 0 at origin to 1 at point
+    //and t_max is where the ray crosses the next voxel boundary on each axis
+    int step[3], steps = 0;
+    float t_max[3], t_delta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        steps += std::abs(end_index[axis] - index[axis]);
+        if (ray[axis] > 0) {
+            step[axis] = 1;
+            t_max[axis] = ((index[axis] + 1) * voxel_size_ - origin[axis]) / ray[axis];
+            t_delta[axis] = voxel_size_ / ray[axis];
+        }
+        else if (ray[axis] < 0) {
+            step[axis] = -1;
+            t_max[axis] = (index[axis] * voxel_size_ - origin[axis]) / ray[axis];
+            t_delta[axis] = -voxel_size_ / ray[axis];
+        }
+        else {
+            step[axis] = 0;
+            t_max[axis] = t_delta[axis] = Utils::max<float>();
+        }
+    }
+
+    for (int i = 0; i < steps; ++i) {
+        updateVoxel(VoxelIndex { index[0], index[1], index[2] }, kMissLogOdds, false, cache);
+
+        int axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0 : 2) : (t_max[1] < t_max[2] ? 1 : 2);
+        index[axis] += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+
+    if (hit)
+        updateVoxel(end_voxel, kHitLogOdds, true, cache);
+}
+
+void VoxelMap::insertPoint(const Vector3r& point)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    BlockCache cache { Utils::max<uint64_t>(), nullptr };
+    updateVoxel(toVoxel(point), kHitLogOdds, true, cache);
+}
+
+void VoxelMap::insertPointCloud(const Vector3r& origin, const vector<Vector3r>& points)
+{
+    for (size_t start = 0; start < points.size(); start += kInsertChunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        //max is not a valid key as keys only use 63 bits
+        BlockCache cache { Utils::max<uint64_t>(), nullptr };
+        size_t end = points.size() - start > kInsertChunk ? start + kInsertChunk : points.size();
+        for (size_t i = start; i < end; ++i)
+            insertRay(origin, points[i], cache);
+    }
+}
+
+void VoxelMap::insertPointCloud(const Vector3r& origin, const float* points, size_t count)
+{
+    for (size_t start = 0; start < count; start += kInsertChunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        BlockCache cache { Utils::max<uint64_t>(), nullptr };
+        size_t end = count - start > kInsertChunk ? start + kInsertChunk : count;
+        for (size_t i = start; i < end; ++i)
+            insertRay(origin, Vector3r(points[3 * i], points[3 * i + 1], points[3 * i + 2]), cache);
+    }
+}
+
+void VoxelMap::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks_.clear();
+    occupied_filter_.reset();
+}
+
+bool VoxelMap::isOccupied(const Vector3r& point) const
+{
+    const VoxelIndex voxel = toVoxel(point);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = blocks_.find(blockKey(voxel.x >> kBlockBits, voxel.y >> kBlockBits, voxel.z >> kBlockBits));
+    return found != blocks_.end() && found->second.log_odds[voxelOffset(voxel)] > 0;
+}
+
+VoxelMap::Obstacle VoxelMap::findClosest(const Vector3r& from, const Vector3r& to, float max_distance) const
+{
+    Obstacle obs;
+    //max/2 like ObstacleMap, max can overflow when clearance is subtracted from it
+    obs.distance = Utils::max<float>() / 2;
+    obs.confidence = 1;
+    obs.position = Vector3r::Constant(Utils::nan<float>());
+
+    const float block_length = voxel_size_ * kBlockSize;
+    //distances are to voxel centers, which are at most this far from block center
+    const float block_radius = (kBlockSize - 1) * voxel_size_ * std::sqrt(3.0f) / 2;
+
+    //only blocks with center within max_distance + block_radius of the segment can hold anything close enough.
+    //In block units with centers on integers, each z layer keeps the part of the segment within reach of it,
+    //which bounds the y rows, and each row narrows that part further to bound its x run. Bounds are a little
+    //loose so rounding can't drop a block, the distance test below decides.
+    const float reach = (max_distance + block_radius) / block_length + 1E-3f;
+    const Vector3r start = from / block_length - Vector3r::Constant(0.5f);
+    const Vector3r end = to / block_length - Vector3r::Constant(0.5f);
+    const int low_z = Utils::floorToInt(std::min(start.z(), end.z()) - reach);
+    const int high_z = Utils::floorToInt(std::max(start.z(), end.z()) + reach);
+
+    //blocks with occupied voxels and the least distance anything in them can have, skipping blocks too far
+    //or never occupied before looking them up. Closest blocks are visited first so the rest can be skipped
+    //once something closer than them is found.
+    vector<std::pair<float, const Block*>> candidates;
+    for (int block_z = low_z; block_z <= high_z; ++block_z) {
+        float z_low = 0, z_high = 1;
+        if (!clipToSlab(start.z(), end.z(), static_cast<float>(block_z), reach, z_low, z_high))
+            continue;
+        const float y0 = start.y() + (end.y() - start.y()) * z_low, y1 = start.y() + (end.y() - start.y()) * z_high;
+        const int low_y = Utils::floorToInt(std::min(y0, y1) - reach), high_y = Utils::floorToInt(std::max(y0, y1) + reach);
+
+        for (int block_y = low_y; block_y <= high_y; ++block_y) {
+            float t_low = z_low, t_high = z_high;
+            if (!clipToSlab(start.y(), end.y(), static_cast<float>(block_y), reach, t_low, t_high))
+                continue;
+            const float x0 = start.x() + (end.x() - start.x()) * t_low, x1 = start.x() + (end.x() - start.x()) * t_high;
+            const int low_x = Utils::floorToInt(std::min(x0, x1) - reach), high_x = Utils::floorToInt(std::max(x0, x1) + reach);
+
+            for (int block_x = low_x; block_x <= high_x; ++block_x) {
+                uint64_t key = blockKey(block_x, block_y, block_z);
+                if (!occupied_filter_.test(filterIndex(key)))
+                    continue;
+
+                const Vector3r center = Vector3r(block_x + 0.5f, block_y + 0.5f, block_z + 0.5f) * block_length;
+                float min_distance = std::sqrt(segmentDistanceSquared(center, from, to)) - block_radius;
+                if (min_distance > max_distance)
+                    continue;
+
+                auto found = blocks_.find(key);
+                if (found != blocks_.end() && found->second.occupied_count > 0)
+                    candidates.push_back(std::make_pair(min_distance, &found->second));
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<float, const Block*>& a, const std::pair<float, const Block*>& b) { return a.first < b.first; });
+
+    float best_distance = max_distance;
+    float best_distance_squared = max_distance * max_distance;
+    for (const auto& candidate : candidates) {
+        if (candidate.first > best_distance)
+            break;
+
+        const Block& block = *candidate.second;
+        for (int word_index = 0; word_index < kBlockVoxels / 64; ++word_index) {
+            for (uint64_t word = block.occupied[word_index]; word != 0; word &= word - 1) {
+                int offset = word_index * 64 + lowestBit(word);
+                const Vector3r position = toPosition(blockVoxel(block, offset));
+                float distance_squared = segmentDistanceSquared(position, from, to);
+                if (distance_squared < best_distance_squared) {
+                    best_distance_squared = distance_squared;
+                    best_distance = std::sqrt(distance_squared);
+                    obs.distance = best_distance;
+                    obs.confidence = toConfidence(block.log_odds[offset]);
+                    obs.position = position;
+                }
+            }
+        }
+    }
+
+    return obs;
+}
+
+VoxelMap::Obstacle VoxelMap::getClosestObstacle(const Vector3r& position, float max_distance) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return findClosest(position, position, max_distance);
+}
+
+VoxelMap::Obstacle VoxelMap::getSegmentObstacle(const Vector3r& from, const Vector3r& to, float max_distance) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return findClosest(from, to, max_distance);
+}
+
+vector<Vector3r> VoxelMap::getOccupiedVoxels() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    vector<Vector3r> voxels;
+    for (const auto& item : blocks_) {
+        const Block& block = item.second;
+        if (block.occupied_count == 0)
+            continue;
+
+        for (int word_index = 0; word_index < kBlockVoxels / 64; ++word_index) {
+            for (uint64_t word = block.occupied[word_index]; word != 0; word &= word - 1)
+                voxels.push_back(toPosition(blockVoxel(block, word_index * 64 + lowestBit(word))));
+        }
+    }
+    return voxels;
+}
+
+float VoxelMap::getVoxelSize() const
+{
+    return voxel_size_;
+}
+
+size_t VoxelMap::getBlockCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.size();
+}
+
+}} //namespace
+
+#endif
@@ -0,0 +1,457 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//in header only mode, control library is not available
+#ifndef AIRLIB_HEADER_ONLY
+
+#include "safety/ZoneGeoFence.hpp"
+#include "common/common_utils/Utils.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace msr { namespace airlib {
+
+//z of the cross product of 2D vectors
+static float cross(const Vector2r& a, const Vector2r& b)
+{
+    return a.x() * b.y() - a.y() * b.x();
+}
+
+//clips the part of a line from origin with start <= t <= end to low <= origin + direction * t <= high
+static bool clipSlab(float origin, float direction, float low, float high, float& start, float& end)
+{
+    if (direction == 0)
+        return origin >= low && origin <= high;
+
+    float t_low = (low - origin) / direction;
+    float t_high = (high - origin) / direction;
+    if (t_low > t_high)
+        std::swap(t_low, t_high);
+    start = std::max(start, t_low);
+    end = std::min(end, t_high);
+    return start <= end;
+}
+
+ZoneGeoFence::ZoneGeoFence(float distance_accuracy, float cell_size)
+    : distance_accuracy_(distance_accuracy), cell_size_(cell_size), grid_cell_size_(cell_size)
+{
+}
+
+void ZoneGeoFence::addZone(const Zone& zone)
+{
+    if (zone.polygon.size() < 3)
+        throw std::invalid_argument(Utils::stringf("zone polygon needs at least 3 corners but has %d", static_cast<int>(zone.polygon.size())));
+    if (!(zone.min_z <= zone.max_z))
+        throw std::invalid_argument(Utils::stringf("zone min_z %f must not be above max_z %f", zone.min_z, zone.max_z));
+
+    IndexedZone indexed;
+    indexed.zone = zone;
+    indexed.box_min = indexed.box_max = zone.polygon[0];
+    for (const Vector2r& corner : zone.polygon) {
+        indexed.box_min = indexed.box_min.cwiseMin(corner);
+        indexed.box_max = indexed.box_max.cwiseMax(corner);
+    }
+    indexed.center = (indexed.box_min + indexed.box_max) / 2;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    zones_.push_back(indexed);
+    if (zone.type == ZoneType::Allowed)
+        ++allowed_count_;
+    grid_dirty_ = true;
+}
+
+void ZoneGeoFence::addZones(const vector<Zone>& zones)
+{
+    for (const Zone& zone : zones)
+        addZone(zone);
+}
+
+void ZoneGeoFence::clearZones()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    zones_.clear();
+    allowed_count_ = 0;
+    grid_dirty_ = true;
+}
+
+size_t ZoneGeoFence::getZoneCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return zones_.size();
+}
+
+void ZoneGeoFence::buildGrid() const
+{
+    if (!grid_dirty_)
+        return;
+    grid_dirty_ = false;
+
+    zone_stamps_.assign(zones_.size(), 0);
+    stamp_ = 0;
+    allowed_zones_.clear();
+    for (uint index = 0; index < zones_.size(); ++index)
+        if (zones_[index].zone.type == ZoneType::Allowed)
+            allowed_zones_.push_back(index);
+    if (zones_.size() == 0) {
+        grid_width_ = grid_height_ = 0;
+        cell_starts_.assign(1, 0);
+        cell_zones_.clear();
+        return;
+    }
+
+    Vector2r box_min = zones_[0].box_min, box_max = zones_[0].box_max;
+    for (const IndexedZone& zone : zones_) {
+        box_min = box_min.cwiseMin(zone.box_min);
+        box_max = box_max.cwiseMax(zone.box_max);
+    }
+
+    //coarser cells if the requested ones would be too many
+    grid_cell_size_ = cell_size_;
+    for (;;) {
+        double width = std::floor((box_max.x() - box_min.x()) / grid_cell_size_) + 1;
+        double height = std::floor((box_max.y() - box_min.y()) / grid_cell_size_) + 1;
+        if (width * height <= kMaxCells) {
+            grid_width_ = static_cast<int>(width);
+            grid_height_ = static_cast<int>(height);
+            break;
+        }
+        grid_cell_size_ *= 2;
+    }
+    grid_min_ = box_min;
+
+    //count zones per cell first so the lists can be packed in one vector
+    size_t cell_count = static_cast<size_t>(grid_width_) * grid_height_;
+    vector<uint> counts(cell_count, 0);
+    auto forCells = [this](const IndexedZone& zone, auto visit) {
+        int min_x, min_y, max_x, max_y;
+        cellOf(zone.box_min, min_x, min_y);
+        cellOf(zone.box_max, max_x, max_y);
+        for (int y = min_y; y <= max_y; ++y)
+            for (int x = min_x; x <= max_x; ++x)
+                visit(static_cast<size_t>(y) * grid_width_ + x);
+    };
+    for (const IndexedZone& zone : zones_)
+        forCells(zone, [&counts](size_t cell) { ++counts[cell]; });
+
+    cell_starts_.assign(cell_count + 1, 0);
+    for (size_t cell = 0; cell < cell_count; ++cell)
+        cell_starts_[cell + 1] = cell_starts_[cell] + counts[cell];
+
+    cell_zones_.resize(cell_starts_[cell_count]);
+    std::copy(cell_starts_.begin(), cell_starts_.end() - 1, counts.begin());
+    for (uint index = 0; index < zones_.size(); ++index)
+        forCells(zones_[index], [&](size_t cell) { cell_zones_[counts[cell]++] = index; });
+}
+
+//cell containing point, clamped to the grid, false if point is not on the grid
+bool ZoneGeoFence::cellOf(const Vector2r& point, int& cell_x, int& cell_y) const
+{
+    int x = Utils::floorToInt((point.x() - grid_min_.x()) / grid_cell_size_);
+    int y = Utils::floorToInt((point.y() - grid_min_.y()) / grid_cell_size_);
+    cell_x = Utils::clip(x, 0, grid_width_ - 1);
+    cell_y = Utils::clip(y, 0, grid_height_ - 1);
+    return x == cell_x && y == cell_y;
+}
+
+template<typename TVisit>
+bool ZoneGeoFence::visitZones(const Vector3r& from, const Vector3r& to, TVisit visit) const
+{
+    if (grid_width_ == 0)
+        return true;
+
+    if (++stamp_ == 0) {
+        std::fill(zone_stamps_.begin(), zone_stamps_.end(), 0);
+        stamp_ = 1;
+    }
+
+    //part of the segment over the grid
+    const Vector2r start(from.x(), from.y());
+    const Vector2r direction = Vector2r(to.x(), to.y()) - start;
+    const Vector2r grid_max = grid_min_ + Vector2r(static_cast<float>(grid_width_), static_cast<float>(grid_height_)) * grid_cell_size_;
+    float t_start = 0, t_end = 1;
+    for (int axis = 0; axis < 2; ++axis) {
+        if (!clipSlab(start[axis], direction[axis], grid_min_[axis], grid_max[axis], t_start, t_end))
+            return true;
+    }
+
+    int cell_x, cell_y, end_x, end_y;
+    cellOf(start + direction * t_start, cell_x, cell_y);
+    cellOf(start + direction * t_end, end_x, end_y);
+
+    //2D version of the voxel walk in VoxelMap::insertRay, counting steps as rounding could make
+    //t_max pick an axis that is already at its end
+    const int step_x = direction.x() > 0 ? 1 : -1;
+    const int step_y = direction.y() > 0 ? 1 : -1;
+    const float inf = Utils::max<float>();
+    float t_max_x = direction.x() != 0 ? (grid_min_.x() + (cell_x + (step_x > 0)) * grid_cell_size_ - start.x()) / direction.x() : inf;
+    float t_max_y = direction.y() != 0 ? (grid_min_.y() + (cell_y + (step_y > 0)) * grid_cell_size_ - start.y()) / direction.y() : inf;
+    const float t_delta_x = direction.x() != 0 ? grid_cell_size_ / std::abs(direction.x()) : inf;
+    const float t_delta_y = direction.y() != 0 ? grid_cell_size_ / std::abs(direction.y()) : inf;
+
+    int steps = std::abs(end_x - cell_x) + std::abs(end_y - cell_y);
+    for (int i = 0; ; ++i) {
+        size_t cell = static_cast<size_t>(cell_y) * grid_width_ + cell_x;
+        for (uint j = cell_starts_[cell]; j < cell_starts_[cell + 1]; ++j) {
+            uint index = cell_zones_[j];
+            if (zone_stamps_[index] == stamp_)
+                continue;
+            zone_stamps_[index] = stamp_;
+            if (!visit(index))
+                return false;
+        }
+
+        if (i == steps)
+            break;
+        if (cell_y == end_y || (cell_x != end_x && t_max_x < t_max_y)) {
+            cell_x += step_x;
+            t_max_x += t_delta_x;
+        }
+        else {
+            cell_y += step_y;
+            t_max_y += t_delta_y;
+        }
+    }
+    return true;
+}
+
+bool ZoneGeoFence::isInPolygon(const vector<Vector2r>& polygon, const Vector2r& point)
+{
+    //crossing number, edges count for points below their upper end
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const Vector2r& a = polygon[i];
+        const Vector2r& b = polygon[j];
+        if ((a.y() > point.y()) != (b.y() > point.y()) &&
+            point.x() < (b.x() - a.x()) * (point.y() - a.y()) / (b.y() - a.y()) + a.x())
+            inside = !inside;
+    }
+    return inside;
+}
+
+bool ZoneGeoFence::isInZone(const IndexedZone& zone, const Vector3r& point)
+{
+    return point.z() >= zone.zone.min_z && point.z() <= zone.zone.max_z &&
+        point.x() >= zone.box_min.x() && point.x() <= zone.box_max.x() &&
+        point.y() >= zone.box_min.y() && point.y() <= zone.box_max.y() &&
+        isInPolygon(zone.zone.polygon, Vector2r(point.x(), point.y()));
+}
+
+void ZoneGeoFence::clipToZone(const IndexedZone& zone, const Vector3r& from, const Vector3r& to, vector<Interval>& intervals) const
+{
+    const Vector3r direction = to - from;
+    float start = 0, end = 1;
+    if (!clipSlab(from.z(), direction.z(), zone.zone.min_z, zone.zone.max_z, start, end) ||
+        !clipSlab(from.x(), direction.x(), zone.box_min.x(), zone.box_max.x(), start, end) ||
+        !clipSlab(from.y(), direction.y(), zone.box_min.y(), zone.box_max.y(), start, end))
+        return;
+
+    const Vector2r start_xy(from.x(), from.y());
+    const Vector2r direction_xy(direction.x(), direction.y());
+
+    //where the segment crosses polygon edges it goes in or out, parts between crossings are all in or all out
+    crossings_.clear();
+    crossings_.push_back(start);
+    const vector<Vector2r>& polygon = zone.zone.polygon;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const Vector2r edge = polygon[i] - polygon[j];
+        float denominator = cross(direction_xy, edge);
+        if (denominator == 0)
+            continue;
+        const Vector2r offset = polygon[j] - start_xy;
+        float t = cross(offset, edge) / denominator;
+        float s = cross(offset, direction_xy) / denominator;
+        if (s >= 0 && s <= 1 && t > start && t < end)
+            crossings_.push_back(t);
+    }
+    crossings_.push_back(end);
+    std::sort(crossings_.begin() + 1, crossings_.end() - 1);
+
+    if (start == end) {
+        if (isInPolygon(polygon, start_xy + direction_xy * start))
+            intervals.push_back(Interval{ start, end });
+        return;
+    }
+
+    //a part is in if its middle is, consecutive parts that are in are merged
+    bool last_in = false;
+    for (size_t i = 0; i + 1 < crossings_.size(); ++i) {
+        float part_start = crossings_[i], part_end = crossings_[i + 1];
+        if (part_end <= part_start)
+            continue;
+        bool in = isInPolygon(polygon, start_xy + direction_xy * ((part_start + part_end) / 2));
+        if (in && last_in)
+            intervals.back().end = part_end;
+        else if (in)
+            intervals.push_back(Interval{ part_start, part_end });
+        last_in = in;
+    }
+}
+
+bool ZoneGeoFence::isInFence_(const Vector3r& point) const
+{
+    bool in_allowed = allowed_count_ == 0;
+    int cell_x, cell_y;
+    if (grid_width_ == 0 || !cellOf(Vector2r(point.x(), point.y()), cell_x, cell_y))
+        return in_allowed;
+
+    size_t cell = static_cast<size_t>(cell_y) * grid_width_ + cell_x;
+    for (uint j = cell_starts_[cell]; j < cell_starts_[cell + 1]; ++j) {
+        const IndexedZone& zone = zones_[cell_zones_[j]];
+        if (isInZone(zone, point)) {
+            if (zone.zone.type == ZoneType::NoFly)
+                return false;
+            in_allowed = true;
+        }
+    }
+    return in_allowed;
+}
+
+bool ZoneGeoFence::isSegmentInFence_(const Vector3r& from, const Vector3r& to) const
+{
+    if (from == to)
+        return isInFence_(from);
+
+    //collect the parts in allowed zones and stop at the first no-fly zone the segment goes in to
+    intervals_.clear();
+    bool clear = visitZones(from, to, [&](uint index) {
+        const IndexedZone& zone = zones_[index];
+        if (zone.zone.type == ZoneType::Allowed) {
+            clipToZone(zone, from, to, intervals_);
+            return true;
+        }
+        size_t count = intervals_.size();
+        clipToZone(zone, from, to, intervals_);
+        bool crossed = intervals_.size() > count;
+        intervals_.resize(count);
+        return !crossed;
+    });
+    if (!clear)
+        return false;
+    if (allowed_count_ == 0)
+        return true;
+
+    //allowed parts must cover the whole segment, zones that share a side may leave a rounding sized gap
+    const float kGap = 1E-5f;
+    std::sort(intervals_.begin(), intervals_.end(), [](const Interval& a, const Interval& b) {
+        return a.start < b.start;
+    });
+    float covered = 0;
+    for (const Interval& interval : intervals_) {
+        if (interval.start > covered + kGap)
+            return false;
+        covered = std::max(covered, interval.end);
+    }
+    return covered >= 1 - kGap;
+}
+
+ZoneGeoFence::FenceCheck ZoneGeoFence::checkFence_(const Vector3r& cur_loc, const Vector3r& dest_loc) const
+{
+    FenceCheck check;
+    check.in_fence = isSegmentInFence_(cur_loc, dest_loc);
+    check.allow = true;
+    if (check.in_fence)
+        return check;
+
+    //leaving the fence or cutting through a no-fly zone on the way is never allowed, getting back in always is
+    bool cur_in_fence = isInFence_(cur_loc);
+    if (cur_in_fence || isInFence_(dest_loc)) {
+        check.allow = !cur_in_fence;
+        return check;
+    }
+
+    //we are out, dest must take us away from the center of the no-fly zone we are in
+    const Vector2r cur_xy(cur_loc.x(), cur_loc.y()), dest_xy(dest_loc.x(), dest_loc.y());
+    int cell_x, cell_y;
+    if (grid_width_ > 0 && cellOf(cur_xy, cell_x, cell_y)) {
+        size_t cell = static_cast<size_t>(cell_y) * grid_width_ + cell_x;
+        for (uint j = cell_starts_[cell]; j < cell_starts_[cell + 1]; ++j) {
+            const IndexedZone& zone = zones_[cell_zones_[j]];
+            if (zone.zone.type == ZoneType::NoFly && isInZone(zone, cur_loc)) {
+                check.allow = (dest_xy - zone.center).norm() - (cur_xy - zone.center).norm() >= -distance_accuracy_;
+                return check;
+            }
+        }
+    }
+
+    //or closer to the center of the nearest allowed zone
+    const IndexedZone* nearest = nullptr;
+    float nearest_dist = Utils::max<float>();
+    for (uint index : allowed_zones_) {
+        const IndexedZone& zone = zones_[index];
+        float dist = (cur_xy - zone.center).norm();
+        if (dist < nearest_dist) {
+            nearest = &zone;
+            nearest_dist = dist;
+        }
+    }
+    if (nearest != nullptr) {
+        const Vector3r center(nearest->center.x(), nearest->center.y(),
+            Utils::clip(cur_loc.z(), nearest->zone.min_z, nearest->zone.max_z));
+        check.allow = (cur_loc - center).norm() - (dest_loc - center).norm() >= -distance_accuracy_;
+    }
+    return check;
+}
+
+bool ZoneGeoFence::isInFence(const Vector3r& point) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    buildGrid();
+    return isInFence_(point);
+}
+
+bool ZoneGeoFence::isSegmentInFence(const Vector3r& from, const Vector3r& to) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    buildGrid();
+    return isSegmentInFence_(from, to);
+}
+
+vector<ZoneGeoFence::FenceCheck> ZoneGeoFence::checkFences(const vector<Vector3r>& cur_locs, const vector<Vector3r>& dest_locs) const
+{
+    if (cur_locs.size() != dest_locs.size())
+        throw std::invalid_argument(Utils::stringf("checkFences got %d current and %d destination locations",
+            static_cast<int>(cur_locs.size()), static_cast<int>(dest_locs.size())));
+
+    vector<FenceCheck> checks(cur_locs.size());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    buildGrid();
+    for (size_t i = 0; i < cur_locs.size(); ++i)
+        checks[i] = checkFence_(cur_locs[i], dest_locs[i]);
+    return checks;
+}
+
+void ZoneGeoFence::setBoundry(const Vector3r& origin, float xy_length, float max_z, float min_z)
+{
+    //like CubeGeoFence, z limits are not relative to origin and max_z is the top which is the smaller z in NED
+    vector<Vector2r> square {
+        Vector2r(origin.x() - xy_length, origin.y() - xy_length), Vector2r(origin.x() + xy_length, origin.y() - xy_length),
+        Vector2r(origin.x() + xy_length, origin.y() + xy_length), Vector2r(origin.x() - xy_length, origin.y() + xy_length)
+    };
+
+    clearZones();
+    addZone(Zone(square, std::min(max_z, min_z), std::max(max_z, min_z), ZoneType::Allowed));
+    Utils::log(Utils::stringf("ZoneGeoFence: %s", toString().c_str()));
+}
+
+void ZoneGeoFence::checkFence(const Vector3r& cur_loc, const Vector3r& dest_loc,
+    bool& in_fence, bool& allow)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    buildGrid();
+    FenceCheck check = checkFence_(cur_loc, dest_loc);
+    in_fence = check.in_fence;
+    allow = check.allow;
+}
+
+string ZoneGeoFence::toString() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    buildGrid();
+    return Utils::stringf("zones=%d, allowed=%d, no_fly=%d, grid=%dx%d cells of %f",
+        static_cast<int>(zones_.size()), allowed_count_, static_cast<int>(zones_.size() - allowed_count_), grid_width_, grid_height_, grid_cell_size_);
+}
+
+}} //namespace
+
+#endif
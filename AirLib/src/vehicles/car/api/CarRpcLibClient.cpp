@@ -19,6 +19,7 @@ STRICT_MODE_OFF
 #undef check
 #include "rpc/client.h"
 #include "vehicles/car/api/CarRpcLibAdapators.hpp"
+#include "api/RpcLibAsyncCall.hpp"
 STRICT_MODE_ON
 #ifdef _MSC_VER
 __pragma(warning( disable : 4239))
@@ -30,6 +31,7 @@ namespace msr { namespace airlib {
 
 
 typedef msr::airlib_rpclib::CarRpcLibAdapators CarRpcLibAdapators;
+typedef msr::airlib_rpclib::RpcLibAsyncCall RpcLibAsyncCall;
 
 CarRpcLibClient::CarRpcLibClient(const string&  ip_address, uint16_t port, uint timeout_ms)
     : RpcLibClientBase(ip_address, port, timeout_ms)
@@ -51,6 +53,17 @@ CarApiBase::CarState CarRpcLibClient::getCarState()
         call("getCarState").as<CarRpcLibAdapators::CarState>().to();
 }
 
+std::future<void> CarRpcLibClient::setCarControlsAsync(const CarApiBase::CarControls& controls)
+{
+    return RpcLibAsyncCall::callVoid(static_cast<rpc::client*>(getClient()), getTimeoutMs(),
+        "setCarControls", CarRpcLibAdapators::CarControls(controls));
+}
+
+std::future<CarApiBase::CarState> CarRpcLibClient::getCarStateAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<CarRpcLibAdapators::CarState>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getCarState");
+}
+
 
 }} //namespace
 
@@ -18,6 +18,7 @@ STRICT_MODE_OFF
 #undef check
 #include "rpc/client.h"
 #include "vehicles/multirotor/api/MultirotorRpcLibAdapators.hpp"
+#include "api/RpcLibAsyncCall.hpp"
 STRICT_MODE_ON
 #ifdef _MSC_VER
 __pragma(warning( disable : 4239))
@@ -28,6 +29,15 @@ namespace msr { namespace airlib {
 
 
 typedef msr::airlib_rpclib::MultirotorRpcLibAdapators MultirotorRpcLibAdapators;
+typedef msr::airlib_rpclib::RpcLibAsyncCall RpcLibAsyncCall;
+
+static uint decodeTelemetryFrames(const vector<uint8_t>& data, vector<DroneTelemetryFrame>& frames)
+{
+    uint32_t dropped = 0;
+    if (!DroneTelemetryCodec::decode(data.data(), data.size(), frames, dropped))
+        throw std::runtime_error("Telemetry frames from server could not be decoded");
+    return dropped;
+}
 
 MultirotorRpcLibClient::MultirotorRpcLibClient(const string&  ip_address, uint16_t port, uint timeout_ms)
     : RpcLibClientBase(ip_address, port, timeout_ms)
@@ -80,6 +90,13 @@ bool MultirotorRpcLibClient::moveOnPath(const vector<Vector3r>& path, float velo
     return static_cast<rpc::client*>(getClient())->call("moveOnPath", conv_path, velocity, max_wait_seconds, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode), lookahead, adaptive_lookahead).as<bool>();
 }
 
+bool MultirotorRpcLibClient::appendToPath(const vector<Vector3r>& path)
+{
+    vector<MultirotorRpcLibAdapators::Vector3r> conv_path;
+    MultirotorRpcLibAdapators::from(path, conv_path);
+    return static_cast<rpc::client*>(getClient())->call("appendToPath", conv_path).as<bool>();
+}
+
 bool MultirotorRpcLibClient::moveToPosition(float x, float y, float z, float velocity, float max_wait_seconds, DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
 {
     return static_cast<rpc::client*>(getClient())->call("moveToPosition", x, y, z, velocity, max_wait_seconds, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode), lookahead, adaptive_lookahead).as<bool>();
@@ -162,6 +179,164 @@ std::string MultirotorRpcLibClient::getDebugInfo()
     return static_cast<rpc::client*>(getClient())->call("getServerDebugInfo").as<std::string>();
 }
 
+vector<ApiCallStats::Entry> MultirotorRpcLibClient::getApiCallStats(bool reset)
+{
+    vector<ApiCallStats::Entry> stats;
+    MultirotorRpcLibAdapators::to(static_cast<rpc::client*>(getClient())->call("getApiCallStats", reset)
+        .as<vector<MultirotorRpcLibAdapators::ApiCallStats>>(), stats);
+    return stats;
+}
+
+//telemetry streaming
+int MultirotorRpcLibClient::subscribeTelemetry(uint fields, uint every_n_steps, uint queue_size)
+{
+    return static_cast<rpc::client*>(getClient())->call("subscribeTelemetry", fields, every_n_steps, queue_size).as<int>();
+}
+
+bool MultirotorRpcLibClient::unsubscribeTelemetry(int subscription_id)
+{
+    return static_cast<rpc::client*>(getClient())->call("unsubscribeTelemetry", subscription_id).as<bool>();
+}
+
+uint MultirotorRpcLibClient::getTelemetryFrames(int subscription_id, vector<DroneTelemetryFrame>& frames, uint max_wait_ms)
+{
+    return decodeTelemetryFrames(static_cast<rpc::client*>(getClient())->call("getTelemetryFrames", subscription_id, max_wait_ms).as<vector<uint8_t>>(), frames);
+}
+
+//async calls
+std::future<bool> MultirotorRpcLibClient::armDisarmAsync(bool arm)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "armDisarm", arm);
+}
+std::future<void> MultirotorRpcLibClient::setSimulationModeAsync(bool is_set)
+{
+    return RpcLibAsyncCall::callVoid(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "setSimulationMode", is_set);
+}
+std::future<bool> MultirotorRpcLibClient::takeoffAsync(float max_wait_seconds)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "takeoff", max_wait_seconds);
+}
+std::future<bool> MultirotorRpcLibClient::landAsync(float max_wait_seconds)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "land", max_wait_seconds);
+}
+std::future<bool> MultirotorRpcLibClient::goHomeAsync()
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "goHome");
+}
+std::future<bool> MultirotorRpcLibClient::moveByAngleAsync(float pitch, float roll, float z, float yaw, float duration)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveByAngle", pitch, roll, z, yaw, duration);
+}
+std::future<bool> MultirotorRpcLibClient::moveByVelocityAsync(float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveByVelocity",
+        vx, vy, vz, duration, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode));
+}
+std::future<bool> MultirotorRpcLibClient::moveByVelocityZAsync(float vx, float vy, float z, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveByVelocityZ",
+        vx, vy, z, duration, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode));
+}
+std::future<bool> MultirotorRpcLibClient::moveOnPathAsync(const vector<Vector3r>& path, float velocity, float max_wait_seconds, DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
+{
+    vector<MultirotorRpcLibAdapators::Vector3r> conv_path;
+    MultirotorRpcLibAdapators::from(path, conv_path);
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveOnPath",
+        conv_path, velocity, max_wait_seconds, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode), lookahead, adaptive_lookahead);
+}
+std::future<bool> MultirotorRpcLibClient::moveToPositionAsync(float x, float y, float z, float velocity, float max_wait_seconds, DrivetrainType drivetrain, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveToPosition",
+        x, y, z, velocity, max_wait_seconds, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode), lookahead, adaptive_lookahead);
+}
+std::future<bool> MultirotorRpcLibClient::moveToZAsync(float z, float velocity, float max_wait_seconds, const YawMode& yaw_mode, float lookahead, float adaptive_lookahead)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveToZ",
+        z, velocity, max_wait_seconds, MultirotorRpcLibAdapators::YawMode(yaw_mode), lookahead, adaptive_lookahead);
+}
+std::future<bool> MultirotorRpcLibClient::moveByManualAsync(float vx_max, float vy_max, float z_min, float duration, DrivetrainType drivetrain, const YawMode& yaw_mode)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "moveByManual",
+        vx_max, vy_max, z_min, duration, drivetrain, MultirotorRpcLibAdapators::YawMode(yaw_mode));
+}
+std::future<bool> MultirotorRpcLibClient::rotateToYawAsync(float yaw, float max_wait_seconds, float margin)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "rotateToYaw", yaw, max_wait_seconds, margin);
+}
+std::future<bool> MultirotorRpcLibClient::rotateByYawRateAsync(float yaw_rate, float duration)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "rotateByYawRate", yaw_rate, duration);
+}
+std::future<bool> MultirotorRpcLibClient::hoverAsync()
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "hover");
+}
+
+std::future<Vector3r> MultirotorRpcLibClient::getPositionAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<MultirotorRpcLibAdapators::Vector3r>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getPosition");
+}
+std::future<Vector3r> MultirotorRpcLibClient::getVelocityAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<MultirotorRpcLibAdapators::Vector3r>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getVelocity");
+}
+std::future<Quaternionr> MultirotorRpcLibClient::getOrientationAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<MultirotorRpcLibAdapators::Quaternionr>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getOrientation");
+}
+std::future<RCData> MultirotorRpcLibClient::getRCDataAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<MultirotorRpcLibAdapators::RCData>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getRCData");
+}
+std::future<GeoPoint> MultirotorRpcLibClient::getGpsLocationAsync()
+{
+    return RpcLibAsyncCall::callAdaptor<MultirotorRpcLibAdapators::GeoPoint>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getGpsLocation");
+}
+std::future<bool> MultirotorRpcLibClient::isSimulationModeAsync()
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "isSimulationMode");
+}
+std::future<std::string> MultirotorRpcLibClient::getDebugInfoAsync()
+{
+    return RpcLibAsyncCall::callAs<std::string>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "getServerDebugInfo");
+}
+std::future<DroneControllerBase::LandedState> MultirotorRpcLibClient::getLandedStateAsync()
+{
+    return RpcLibAsyncCall::call<DroneControllerBase::LandedState>(static_cast<rpc::client*>(getClient()), getTimeoutMs(),
+        [](const RPCLIB_MSGPACK::object_handle& result) {
+            return static_cast<DroneControllerBase::LandedState>(result.as<int>());
+        }, "getLandedState");
+}
+std::future<TTimePoint> MultirotorRpcLibClient::timestampNowAsync()
+{
+    return RpcLibAsyncCall::callAs<TTimePoint>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "timestampNow");
+}
+
+std::future<int> MultirotorRpcLibClient::subscribeTelemetryAsync(uint fields, uint every_n_steps, uint queue_size)
+{
+    return RpcLibAsyncCall::callAs<int>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "subscribeTelemetry", fields, every_n_steps, queue_size);
+}
+std::future<bool> MultirotorRpcLibClient::unsubscribeTelemetryAsync(int subscription_id)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "unsubscribeTelemetry", subscription_id);
+}
+std::future<uint> MultirotorRpcLibClient::getTelemetryFramesAsync(int subscription_id, vector<DroneTelemetryFrame>& frames, uint max_wait_ms)
+{
+    vector<DroneTelemetryFrame>* frames_ptr = &frames;
+    return RpcLibAsyncCall::call<uint>(static_cast<rpc::client*>(getClient()), getTimeoutMs(),
+        [frames_ptr](const RPCLIB_MSGPACK::object_handle& result) {
+            return decodeTelemetryFrames(result.as<vector<uint8_t>>(), *frames_ptr);
+        }, "getTelemetryFrames", subscription_id, max_wait_ms);
+}
+
+std::future<bool> MultirotorRpcLibClient::setSafetyAsync(SafetyEval::SafetyViolationType enable_reasons, float obs_clearance, SafetyEval::ObsAvoidanceStrategy obs_startegy,
+    float obs_avoidance_vel, const Vector3r& origin, float xy_length, float max_z, float min_z)
+{
+    return RpcLibAsyncCall::callAs<bool>(static_cast<rpc::client*>(getClient()), getTimeoutMs(), "setSafety", static_cast<uint>(enable_reasons), obs_clearance, obs_startegy,
+        obs_avoidance_vel, MultirotorRpcLibAdapators::Vector3r(origin), xy_length, max_z, min_z);
+}
+
 
 }} //namespace
 
@@ -30,8 +30,13 @@ namespace msr { namespace airlib {
 
 typedef msr::airlib_rpclib::MultirotorRpcLibAdapators MultirotorRpcLibAdapators;
 
+//rpclib can't reply later, so a telemetry long poll holds one of the 4 server threads while it waits:
+//keep the wait short compared to client timeouts and leave at least half the threads for other calls
+static constexpr uint kMaxTelemetryWaitMs = 1000;
+static constexpr uint kMaxTelemetryLongPolls = 2;
+
 MultirotorRpcLibServer::MultirotorRpcLibServer(DroneApi* drone, string server_address, uint16_t port)
-        : RpcLibServerBase(drone, server_address, port)
+        : RpcLibServerBase(drone, server_address, port), telemetry_long_polls_(0)
 {
     (static_cast<rpc::server*>(getServer()))->
         bind("armDisarm", [&](bool arm) -> bool { return getDroneApi()->armDisarm(arm); });
@@ -62,6 +67,12 @@ MultirotorRpcLibServer::MultirotorRpcLibServer(DroneApi* drone, string server_ad
             MultirotorRpcLibAdapators::to(path, conv_path);
             return getDroneApi()->moveOnPath(conv_path, velocity, max_wait_seconds, drivetrain, yaw_mode.to(), lookahead, adaptive_lookahead);
         });
+    (static_cast<rpc::server*>(getServer()))->
+        bind("appendToPath", [&](const vector<MultirotorRpcLibAdapators::Vector3r>& path) -> bool {
+            vector<Vector3r> conv_path;
+            MultirotorRpcLibAdapators::to(path, conv_path);
+            return getDroneApi()->appendToPath(conv_path);
+        });
     (static_cast<rpc::server*>(getServer()))->
         bind("moveToPosition", [&](float x, float y, float z, float velocity, float max_wait_seconds, DrivetrainType drivetrain,
         const MultirotorRpcLibAdapators::YawMode& yaw_mode, float lookahead, float adaptive_lookahead) -> 
@@ -107,6 +118,38 @@ MultirotorRpcLibServer::MultirotorRpcLibServer(DroneApi* drone, string server_ad
         bind("isSimulationMode", [&]() -> bool { return getDroneApi()->isSimulationMode(); });
     (static_cast<rpc::server*>(getServer()))->
         bind("getServerDebugInfo", [&]() -> std::string { return getDroneApi()->getServerDebugInfo(); });
+    (static_cast<rpc::server*>(getServer()))->
+        bind("getApiCallStats", [&](bool reset) -> vector<MultirotorRpcLibAdapators::ApiCallStats> {
+            vector<MultirotorRpcLibAdapators::ApiCallStats> stats;
+            MultirotorRpcLibAdapators::from(getDroneApi()->getApiCallStats(reset), stats);
+            return stats;
+        });
+
+    //telemetry streaming
+    (static_cast<rpc::server*>(getServer()))->
+        bind("subscribeTelemetry", [&](uint fields, uint every_n_steps, uint queue_size) -> int {
+            return getDroneApi()->subscribeTelemetry(fields, every_n_steps, queue_size); });
+    (static_cast<rpc::server*>(getServer()))->
+        bind("unsubscribeTelemetry", [&](int subscription_id) -> bool { return getDroneApi()->unsubscribeTelemetry(subscription_id); });
+    (static_cast<rpc::server*>(getServer()))->
+        bind("getTelemetryFrames", [&](int subscription_id, uint max_wait_ms) -> vector<uint8_t> {
+            //long poll, once kMaxTelemetryLongPolls are waiting the others return what is queued right away
+            uint wait_ms = 0;
+            if (max_wait_ms > 0) {
+                if (telemetry_long_polls_.fetch_add(1) < kMaxTelemetryLongPolls)
+                    wait_ms = std::min(max_wait_ms, kMaxTelemetryWaitMs);
+                else
+                    telemetry_long_polls_.fetch_sub(1);
+            }
+            vector<uint8_t> frames;
+            bool found = getDroneApi()->getTelemetryFrames(subscription_id, wait_ms, frames);
+            if (wait_ms > 0)
+                telemetry_long_polls_.fetch_sub(1);
+            //server suppresses exceptions so this reaches the client as an RPC error
+            if (!found)
+                throw std::invalid_argument("unknown telemetry subscription");
+            return frames;
+        });
 
 }
 
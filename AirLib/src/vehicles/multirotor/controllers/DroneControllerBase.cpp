@@ -95,6 +95,30 @@ bool DroneControllerBase::moveOnPath(const vector<Vector3r>& path, float velocit
         return true;
     }
 
+    ArcLengthPath arc_path;
+    arc_path.append(path);
+
+    return moveOnPath(arc_path, velocity, drivetrain, yaw_mode, lookahead, adaptive_lookahead, cancelable_action);
+}
+
+bool DroneControllerBase::moveOnPath(ArcLengthPath& path, float velocity, DrivetrainType drivetrain, const YawMode& yaw_mode,
+    float lookahead, float adaptive_lookahead, CancelableBase& cancelable_action)
+{
+    //whichever way we leave, nobody should append to this path anymore
+    struct PathCloser {
+        ArcLengthPath& path;
+        ~PathCloser() { path.close(); }
+    } path_closer{ path };
+
+    //validate path size
+    if (path.getVertexCount() == 0) {
+        Utils::log("moveOnPath terminated because path has no points", Utils::kLogLevelWarn);
+        return true;
+    }
+
+    //add current position as starting point now rather than when the command was queued, the drone may have moved since
+    path.prepend(getPosition());
+
     //validate yaw mode
     if (drivetrain == DrivetrainType::ForwardOnly && yaw_mode.is_rate)
         throw std::invalid_argument("Yaw cannot be specified as rate if drivetrain is ForwardOnly");
@@ -115,25 +139,6 @@ bool DroneControllerBase::moveOnPath(const vector<Vector3r>& path, float velocit
         Utils::log(Utils::stringf("lookahead = %f, adaptive_lookahead = %f", lookahead, adaptive_lookahead));        
     }
 
-    //add current position as starting point
-    vector<Vector3r> path3d;
-    vector<PathSegment> path_segs;
-    path3d.push_back(getPosition());
-
-    Vector3r point;
-    float path_length = 0;
-    //append the input path and compute segments
-    for(uint i = 0; i < path.size(); ++i) {
-        point = path.at(i);
-        PathSegment path_seg(path3d.at(i), point, velocity, path_length);
-        path_length += path_seg.seg_length;
-        path_segs.push_back(path_seg);
-        path3d.push_back(point);
-    }
-    //add last segment as zero length segment so we have equal number of segments and points. 
-    //path_segs[i] refers to segment that starts at point i
-    path_segs.push_back(PathSegment(point, point, velocity, path_length));
-
     //when path ends, we want to slow down
     float breaking_dist = 0;
     if (velocity > getVehicleParams().breaking_vel) {
@@ -142,27 +147,21 @@ bool DroneControllerBase::moveOnPath(const vector<Vector3r>& path, float velocit
     }
     //else no need to change velocities for last segments
 
-    //setup current position on path to 0 offset
-    PathPosition cur_path_loc, next_path_loc;
-    cur_path_loc.seg_index = 0;
-    cur_path_loc.offset = 0;
-    cur_path_loc.position = path3d[0];
+    //setup current position on path to 0 offset, positions on path are looked up by their distance from the start
+    ArcLengthPath::Location cur_path_loc = path.locate(0);
 
     float lookahead_error_increasing = 0;
     float lookahead_error = 0;
     Waiter waiter(getCommandPeriod());
 
     //initialize next path position
-    setNextPathPosition(path3d, path_segs, cur_path_loc, lookahead + lookahead_error, next_path_loc);
-    float overshoot = 0;
+    ArcLengthPath::Location next_path_loc = path.locate(lookahead + lookahead_error);
     float goal_dist = 0;
 
-    //until we are at the end of the path (last seg is always zero size)
-    while (next_path_loc.seg_index < path_segs.size()-1 || goal_dist > 0
-        ) { //current position is approximately at the last end point
-
-        float seg_velocity = path_segs.at(next_path_loc.seg_index).seg_velocity;
-        float path_length_remaining = path_length - path_segs.at(cur_path_loc.seg_index).seg_path_length - cur_path_loc.offset;
+    //until we are at the end of the path, which may have grown meanwhile
+    while (goal_dist > 0 || !path.closeIfEnd(next_path_loc.distance)) { //current position is approximately at the last end point
+        float seg_velocity = velocity;
+        float path_length_remaining = path.getLength() - cur_path_loc.distance;
         if (seg_velocity > getVehicleParams().min_vel_for_breaking && path_length_remaining <= breaking_dist) {
             seg_velocity = getVehicleParams().breaking_vel;
             //Utils::logMessage("path_length_remaining = %f, Switched to breaking vel %f", path_length_remaining, seg_velocity);
@@ -170,7 +169,7 @@ bool DroneControllerBase::moveOnPath(const vector<Vector3r>& path, float velocit
 
         //send drone command to get to next lookahead
         moveToPathPosition(next_path_loc.position, seg_velocity, drivetrain, 
-            yaw_mode, path_segs.at(cur_path_loc.seg_index).start_z);
+            yaw_mode, path.getVertex(cur_path_loc.segment).z());
 
         //sleep for rest of the cycle
         if (!waiter.sleep(cancelable_action))
@@ -248,16 +247,24 @@ bool DroneControllerBase::moveOnPath(const vector<Vector3r>& path, float velocit
         //if drone moved backward, we don't want goal to move backward as well
         //so only climb forward on the path, never back. Also note >= which means
         //we climb path even if distance was 0 to take care of duplicated points on path
+        float cur_dist = cur_path_loc.distance;
+        uint prev_segment = cur_path_loc.segment;
         if (goal_dist >= 0) {
-            overshoot = setNextPathPosition(path3d, path_segs, cur_path_loc, goal_dist, cur_path_loc);
-            if (overshoot)
+            cur_dist += goal_dist;
+            float overshoot = cur_dist - path.getLength();
+            if (overshoot > 0)
                 Utils::log(Utils::stringf("overshoot=%f", overshoot));
         }
         //else
         //    Utils::logMessage("goal_dist was negative: %f", goal_dist);
 
+        //looked up even if we didn't move as appended points may have redrawn a smoothed path under us
+        cur_path_loc = path.locate(cur_dist, cur_path_loc);
+        if (cur_path_loc.segment > prev_segment)
+            Utils::log(Utils::stringf("segments %d to %d done", prev_segment, cur_path_loc.segment - 1));
+
         //compute next target on path
-        overshoot = setNextPathPosition(path3d, path_segs, cur_path_loc, lookahead + lookahead_error, next_path_loc);
+        next_path_loc = path.locate(cur_path_loc.distance + lookahead + lookahead_error, cur_path_loc);
     }
 
     return true;
@@ -312,6 +319,58 @@ bool DroneControllerBase::rotateByYawRate(float yaw_rate, float duration, Cancel
     return waiter.is_timeout();
 }
 
+bool DroneControllerBase::followSetpoints(const OffboardSetpoint& first, OffboardSetpointMailbox& mailbox, uint64_t session, uint64_t version,
+    CancelableBase& cancelable_action)
+{
+    OffboardSetpoint setpoint = first;
+    YawMode adj_yaw_mode;
+    Vector3r hold_position = Vector3r::Zero();
+    bool holding = false;
+
+    //same setup the single commands do when they start
+    auto prepare = [&]() {
+        adj_yaw_mode = YawMode(setpoint.yaw_mode.is_rate, setpoint.yaw_mode.yaw_or_rate);
+        if (setpoint.type == OffboardSetpoint::Type::Velocity || setpoint.type == OffboardSetpoint::Type::VelocityZ)
+            adjustYaw(setpoint.x, setpoint.y, setpoint.drivetrain, adj_yaw_mode);
+
+        //consecutive yaw rate setpoints keep holding the position of the first one
+        if (setpoint.type != OffboardSetpoint::Type::YawRate)
+            holding = false;
+        else if (!holding) {
+            hold_position = getPosition();
+            holding = true;
+        }
+    };
+
+    try {
+        prepare();
+        Waiter waiter(getCommandPeriod());
+        TTimePoint start = clock()->nowNanos();
+        for (;;) {
+            if (mailbox.take(session, version, setpoint)) {
+                prepare();
+                start = clock()->nowNanos();
+            }
+
+            if (clock()->elapsedSince(start) >= setpoint.duration) {
+                //a setpoint posted just now keeps the loop going, otherwise new ones have to start a new loop
+                if (mailbox.closeIfIdle(session, version))
+                    return true;
+                continue;
+            }
+
+            if (!moveBySetpoint(setpoint, adj_yaw_mode, hold_position) || !waiter.sleep(cancelable_action)) {
+                mailbox.close(session);
+                return false;
+            }
+        }
+    }
+    catch (...) {
+        mailbox.close(session);
+        throw;
+    }
+}
+
 bool DroneControllerBase::takeoff(float max_wait_seconds, CancelableBase& cancelable_action)
 {
     unused(max_wait_seconds);
@@ -350,6 +409,22 @@ bool DroneControllerBase::hover(CancelableBase& cancelable_action)
     return moveToZ(getZ(), 0.5f, YawMode{ true,0 }, 1.0f, false, cancelable_action);
 }
 
+bool DroneControllerBase::moveBySetpoint(const OffboardSetpoint& setpoint, const YawMode& yaw_mode, const Vector3r& hold_position)
+{
+    switch (setpoint.type) {
+    case OffboardSetpoint::Type::RollPitchZ:
+        return moveByRollPitchZ(setpoint.x, setpoint.y, setpoint.z, setpoint.yaw);
+    case OffboardSetpoint::Type::Velocity:
+        return moveByVelocity(setpoint.x, setpoint.y, setpoint.z, yaw_mode);
+    case OffboardSetpoint::Type::VelocityZ:
+        return moveByVelocityZ(setpoint.x, setpoint.y, setpoint.z, yaw_mode);
+    case OffboardSetpoint::Type::YawRate:
+        return moveToPosition(hold_position, yaw_mode);
+    default:
+        throw std::invalid_argument("Unknown offboard setpoint type");
+    }
+}
+
 bool DroneControllerBase::moveByVelocity(float vx, float vy, float vz, const YawMode& yaw_mode)
 {
     if (safetyCheckVelocity(Vector3r(vx, vy, vz)))
@@ -572,40 +647,6 @@ void DroneControllerBase::logHomePoint()
         Utils::log(homepoint.to_string().c_str());
 }
 
-float DroneControllerBase::setNextPathPosition(const vector<Vector3r>& path, const vector<PathSegment>& path_segs,
-    const PathPosition& cur_path_loc, float next_dist, PathPosition& next_path_loc)
-{
-    //note: cur_path_loc and next_path_loc may both point to same object
-    uint i = cur_path_loc.seg_index;
-    float offset = cur_path_loc.offset;
-    while (i < path.size() - 1) {
-        const PathSegment& seg = path_segs.at(i);
-        if (seg.seg_length > 0 && //protect against duplicate points in path, normalized seg will have NaN
-            seg.seg_length >= next_dist + offset) {
-
-            next_path_loc.seg_index = i;
-            next_path_loc.offset = next_dist + offset;  //how much total distance we will travel on this segment
-            next_path_loc.position = path.at(i) + seg.seg_normalized * next_path_loc.offset;
-            return 0;
-        }
-        //otherwise use up this segment, move on to next one
-        next_dist -= seg.seg_length - offset;
-        offset = 0;
-
-        if (&cur_path_loc == &next_path_loc)
-            Utils::log(Utils::stringf("segment %d done: x=%f, y=%f, z=%f", i, path.at(i).x(), path.at(i).z(), path.at(i).z()));
-
-        ++i;
-    }
-
-    //if we are here then we ran out of segments
-    //consider last segment as zero length segment
-    next_path_loc.seg_index = i;
-    next_path_loc.offset = 0;
-    next_path_loc.position = path.at(i);
-    return next_dist;
-}
-
 void DroneControllerBase::adjustYaw(const Vector3r& heading, DrivetrainType drivetrain, YawMode& yaw_mode)
 {
     //adjust yaw for the direction of travel in foward-only mode
@@ -686,5 +727,30 @@ void DroneControllerBase::setCollisionInfo(const CollisionInfo& collision_info)
     collision_info_ = collision_info;
 }
 
+DroneTelemetryPublisher& DroneControllerBase::getTelemetryPublisher()
+{
+    return telemetry_publisher_;
+}
+
+void DroneControllerBase::publishTelemetry()
+{
+    telemetry_publisher_.publish([this](DroneTelemetryFrame& frame) {
+        frame.timestamp = clock()->nowNanos();
+        if (frame.has(DroneTelemetryFields::Kinematics)) {
+            frame.position = getPosition();
+            frame.velocity = getVelocity();
+            frame.orientation = getOrientation();
+        }
+        if (frame.has(DroneTelemetryFields::Gps))
+            frame.gps_location = getGpsLocation();
+        if (frame.has(DroneTelemetryFields::RCData))
+            frame.rc_data = getRCData();
+        if (frame.has(DroneTelemetryFields::Collision))
+            frame.collision_info = getCollisionInfo();
+        if (frame.has(DroneTelemetryFields::LandedState))
+            frame.landed_state = static_cast<uint>(getLandedState());
+    });
+}
+
 }} //namespace
 #endif
@@ -0,0 +1,162 @@
+#ifndef msr_AirLibUnitTests_ArcLengthPathTest_hpp
+#define msr_AirLibUnitTests_ArcLengthPathTest_hpp
+
+#include "TestBase.hpp"
+#include "vehicles/multirotor/controllers/ArcLengthPath.hpp"
+#include <random>
+
+namespace msr { namespace airlib {
+
+class ArcLengthPathTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testLookups();
+        testSmoothing();
+        testAppendWhileFollowing(0);
+        testAppendWhileFollowing(1);
+        testPrepend(0);
+        testPrepend(0.5f);
+    }
+
+private:
+    //lawnmower pattern, 100m legs 5m apart with a waypoint every 2m and some noise like from a planner
+    static vector<Vector3r> survey(int count)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+        vector<Vector3r> points;
+        for (int i = 0; i < count; ++i) {
+            int leg = i / 50, step = i % 50;
+            float x = leg % 2 ? 100 - 2.0f * step : 2.0f * step;
+            points.push_back(Vector3r(x + noise(random), 5.0f * leg + noise(random), -10 + noise(random)));
+        }
+        return points;
+    }
+
+    //lookups over a 20km path against a search in double precision, and from the previous location
+    //against from the start, including distances past the end
+    void testLookups()
+    {
+        const vector<Vector3r> waypoints = survey(10000);
+        ArcLengthPath path;
+        path.append(waypoints);
+        vector<double> lengths(1, 0);
+        for (size_t i = 1; i < waypoints.size(); ++i)
+            lengths.push_back(lengths.back() + (waypoints[i] - waypoints[i - 1]).cast<double>().norm());
+
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> distance(0, path.getLength() * 1.01f);
+        ArcLengthPath::Location previous = path.locate(0);
+        for (int i = 0; i < 20000; ++i) {
+            float s = distance(random);
+            size_t segment = std::upper_bound(lengths.begin(), lengths.end(), s) - lengths.begin() - 1;
+            Vector3r expected = waypoints.back();
+            if (segment + 1 < waypoints.size()) {
+                double offset = (s - lengths[segment]) / (lengths[segment + 1] - lengths[segment]);
+                expected = (waypoints[segment].cast<double>() + (waypoints[segment + 1] - waypoints[segment]).cast<double>() * offset).cast<float>();
+            }
+
+            //lengths are stored in float which is a few mm off at 20km
+            ArcLengthPath::Location location = path.locate(s), location_from = path.locate(s, previous);
+            testAssert((location.position - expected).norm() <= 0.01f,
+                Utils::stringf("lookup at %f is %f m off", s, (location.position - expected).norm()));
+            testAssert(location_from.segment == location.segment,
+                Utils::stringf("lookup at %f from %f found segment %d instead of %d", s, previous.distance,
+                    static_cast<int>(location_from.segment), static_cast<int>(location.segment)));
+            previous = location;
+        }
+    }
+
+    //a smoothed path goes through every waypoint and its corners bulge out a little past the sharp ones, but never far
+    void testSmoothing()
+    {
+        const vector<Vector3r> corners{ Vector3r(0, 0, -5), Vector3r(10, 0, -5), Vector3r(10, 10, -5), Vector3r(30, 10, -8), Vector3r(30, 11, -8) };
+        ArcLengthPath sharp, smooth(0.5f);
+        sharp.append(corners);
+        smooth.append(corners);
+        testAssert(smooth.getVertexCount() > sharp.getVertexCount(), "smoothing added no vertices");
+
+        for (const Vector3r& corner : corners) {
+            float miss = Utils::max<float>();
+            for (uint i = 0; i < smooth.getVertexCount(); ++i)
+                miss = std::min(miss, (smooth.getVertex(i) - corner).norm());
+            testAssert(miss <= 1E-4f, Utils::stringf("smoothed path misses a waypoint by %f m", miss));
+        }
+
+        //around the corner at (10, 0)
+        for (uint i = 0; i < smooth.getVertexCount(); ++i) {
+            const Vector3r& vertex = smooth.getVertex(i);
+            if (vertex.y() < 5)
+                testAssert(vertex.x() - 10 < 1 && -vertex.y() < 1,
+                    Utils::stringf("smoothed corner bulges out to (%f, %f)", vertex.x(), vertex.y()));
+        }
+    }
+
+    //a point put in front of a path gives the same path as appending it first, also when it equals the first waypoint
+    void testPrepend(float smoothing_step)
+    {
+        const vector<Vector3r> waypoints = survey(120);
+        const Vector3r start(-3, 4, -2);
+        vector<Vector3r> with_start(1, start);
+        with_start.insert(with_start.end(), waypoints.begin(), waypoints.end());
+
+        ArcLengthPath path(smoothing_step), expected(smoothing_step), same_start(smoothing_step), plain(smoothing_step), single(smoothing_step);
+        path.append(waypoints);
+        testAssert(path.prepend(start), "prepend to open path failed");
+        expected.append(with_start);
+        same_start.append(waypoints);
+        same_start.prepend(waypoints.front());
+        plain.append(waypoints);
+        single.prepend(start);
+
+        testAssert(path.getVertexCount() == expected.getVertexCount() && path.getLength() == expected.getLength(),
+            Utils::stringf("prepended path has %d vertices and %f m instead of %d and %f m with smoothing_step %f",
+                static_cast<int>(path.getVertexCount()), path.getLength(), static_cast<int>(expected.getVertexCount()), expected.getLength(), smoothing_step));
+        for (uint i = 0; i < path.getVertexCount(); ++i)
+            testAssert(path.getVertex(i) == expected.getVertex(i), Utils::stringf("vertex %d of prepended path differs", i));
+        testAssert(same_start.getVertexCount() == plain.getVertexCount() && same_start.getLength() == plain.getLength(),
+            "prepending the first waypoint changed the path");
+        testAssert(single.getVertexCount() == 1 && single.getVertex(0) == start, "prepend to empty path didn't start it");
+
+        path.close();
+        testAssert(!path.prepend(start), "prepend succeeded after the path was closed");
+    }
+
+    //a follower walks the path like moveOnPath and the rest of the survey is appended in chunks whenever it gets
+    //close to the end. With smoothing the follower is on the spline that gets redrawn by each append.
+    void testAppendWhileFollowing(float smoothing_step)
+    {
+        const vector<Vector3r> waypoints = survey(2000);
+        const size_t chunk = 200;
+        const float step = 0.25f;
+        ArcLengthPath path(smoothing_step), whole_path(smoothing_step);
+        path.append(vector<Vector3r>(waypoints.begin(), waypoints.begin() + chunk));
+        whole_path.append(waypoints);
+
+        size_t appended = chunk;
+        ArcLengthPath::Location location = path.locate(0);
+        for (;;) {
+            if (appended < waypoints.size() && path.getLength() - location.distance < 1) {
+                vector<Vector3r> points(waypoints.begin() + appended, waypoints.begin() + std::min(appended + chunk, waypoints.size()));
+                testAssert(path.append(points), "append failed while the path was being followed");
+                appended += points.size();
+            }
+
+            const Vector3r last = location.position;
+            location = path.locate(location.distance + step, location);
+            float jump = (location.position - last).norm();
+            testAssert(jump <= 2 * step, Utils::stringf("follower jumped %f m at %f m with smoothing_step %f", jump, location.distance, smoothing_step));
+            if (path.closeIfEnd(location.distance))
+                break;
+        }
+
+        testAssert(appended == waypoints.size(), "path was closed before everything was appended");
+        testAssert(std::abs(location.distance - whole_path.getLength()) <= 0.01f,
+            Utils::stringf("followed %f m of %f m with smoothing_step %f", location.distance, whole_path.getLength(), smoothing_step));
+        testAssert(!path.append(waypoints.back() + Vector3r(1, 0, 0)), "append succeeded after the path was closed");
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,155 @@
+#ifndef msr_AirLibUnitTests_CascadeControllerTest_hpp
+#define msr_AirLibUnitTests_CascadeControllerTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "vehicles/multirotor/firmwares/simple_flight/firmware/CascadeController.hpp"
+
+namespace msr { namespace airlib {
+
+class CascadeControllerTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testModeSwitch(true);
+        testModeSwitch(false);
+    }
+
+private:
+    typedef simple_flight::Axis3r Axis3r;
+    typedef simple_flight::Axis4r Axis4r;
+    typedef simple_flight::GoalMode GoalMode;
+    typedef simple_flight::GoalModeType GoalModeType;
+    typedef simple_flight::GeoPoint GeoPoint;
+
+    static constexpr unsigned int kThrottleAxis = 3;
+
+    class Clock : public simple_flight::IBoardClock {
+    public:
+        void step(uint64_t step_micros)
+        {
+            micros_ += step_micros;
+        }
+        virtual uint64_t micros() const override
+        {
+            return micros_;
+        }
+        virtual uint64_t millis() const override
+        {
+            return micros_ / 1000;
+        }
+
+    private:
+        uint64_t micros_ = 0;
+    };
+
+    //only the throttle axis has a goal, the others have no controller
+    class Goal : public simple_flight::IGoal {
+    public:
+        Goal()
+            : mode_(GoalMode::getUnknown())
+        {
+        }
+        void set(GoalModeType mode, float value)
+        {
+            mode_[kThrottleAxis] = mode;
+            value_[kThrottleAxis] = value;
+        }
+        virtual const Axis4r& getGoalValue() const override
+        {
+            return value_;
+        }
+        virtual const GoalMode& getGoalMode() const override
+        {
+            return mode_;
+        }
+
+    private:
+        GoalMode mode_;
+        Axis4r value_;
+    };
+
+    //level vehicle standing still at the origin
+    class StateEstimator : public simple_flight::IStateEstimator {
+    public:
+        virtual Axis3r getAngles() const override { return Axis3r(); }
+        virtual Axis3r getAngulerVelocity() const override { return Axis3r(); }
+        virtual Axis3r getPosition() const override { return Axis3r(); }
+        virtual Axis3r getLinearVelocity() const override { return Axis3r(); }
+        virtual Axis4r getOrientation() const override { return Axis4r(1, 0, 0, 0); }
+        virtual GeoPoint getGeoPoint() const override { return GeoPoint(); }
+        virtual void setHomeGeoPoint(const GeoPoint& geo_point) override { unused(geo_point); }
+        virtual GeoPoint getHomeGeoPoint() const override { return GeoPoint(); }
+        virtual Axis3r transformToBodyFrame(const Axis3r& world_frame_val) const override { return world_frame_val; }
+    };
+
+    //axes without a controller are logged on every update
+    class CommLink : public simple_flight::ICommLink {
+    public:
+        virtual void log(const std::string& message, int32_t log_level) override
+        {
+            unused(message);
+            unused(log_level);
+        }
+    };
+
+    //throttle axis goes from velocity to position goal and back, the velocity PID has to keep its integral across
+    //both switches with bumpless_mode_switch and start from zero without
+    void testModeSwitch(bool bumpless)
+    {
+        simple_flight::Params params;
+        params.bumpless_mode_switch = bumpless;
+        Clock clock;
+        Goal goal;
+        StateEstimator state_estimator;
+        CommLink comm_link;
+
+        simple_flight::CascadeController controller(&params, &clock, &comm_link);
+        controller.initialize(&goal, &state_estimator);
+        controller.reset();
+
+        //climbing at 1 m/s is asked for but the vehicle doesn't move, so the integral builds up
+        goal.set(GoalModeType::VelocityWorld, -1);
+        for (int i = 0; i < 100; ++i)
+            update(controller, clock);
+        float climbing = integral(controller, GoalModeType::VelocityWorld);
+        testAssert(climbing != 0, "velocity PID integral did not build up");
+
+        //holding the current position and then its velocity, the PID error is zero so the integral only decays
+        goal.set(GoalModeType::PositionWorld, 0);
+        update(controller, clock);
+        float holding = integral(controller, GoalModeType::VelocityWorld);
+        goal.set(GoalModeType::VelocityWorld, 0);
+        update(controller, clock);
+        float back = integral(controller, GoalModeType::VelocityWorld);
+
+        const string name = bumpless ? "with bumpless_mode_switch" : "without bumpless_mode_switch";
+        if (bumpless) {
+            testAssert(std::abs(holding - climbing) <= 0.01f * std::abs(climbing),
+                Utils::stringf("velocity PID integral went from %f to %f switching to position goal %s", climbing, holding, name.c_str()));
+            testAssert(std::abs(back - climbing) <= 0.01f * std::abs(climbing),
+                Utils::stringf("velocity PID integral went from %f to %f switching back to velocity goal %s", climbing, back, name.c_str()));
+        }
+        else {
+            testAssert(holding == 0, Utils::stringf("velocity PID integral is %f after switching to position goal %s", holding, name.c_str()));
+            testAssert(back == 0, Utils::stringf("velocity PID integral is %f after switching back to velocity goal %s", back, name.c_str()));
+        }
+    }
+
+    //one update every 3 ms like the firmware loop
+    static void update(simple_flight::CascadeController& controller, Clock& clock)
+    {
+        clock.step(3000);
+        controller.update();
+    }
+
+    float integral(const simple_flight::CascadeController& controller, GoalModeType mode)
+    {
+        float value = Utils::nan<float>();
+        testAssert(controller.getErrorIntegral(kThrottleAxis, mode, value), "throttle axis has no velocity PID");
+        return value;
+    }
+};
+
+}}
+#endif
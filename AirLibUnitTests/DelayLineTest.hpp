@@ -0,0 +1,55 @@
+#ifndef msr_AirLibUnitTests_DelayLineTest_hpp
+#define msr_AirLibUnitTests_DelayLineTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/SteppableClock.hpp"
+#include "common/DelayLine.hpp"
+
+namespace msr { namespace airlib {
+
+class DelayLineTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testLatency();
+    }
+
+private:
+    //a value pushed every tick comes out exactly delay later, while the ring wraps around many times at
+    //its initial capacity and after it had to grow with the oldest value in the middle of the ring
+    void testLatency()
+    {
+        const TTimeDelta tick = 1E-3;
+        SteppableClock clock(tick);
+        ClockFactory::ThreadClockScope clock_scope(&clock);
+
+        DelayLine<int> line(10 * tick);
+        line.reset();
+
+        int pushed = 0;
+        for (int delay_ticks : { 10, 50, 5 }) {
+            line.setDelay(delay_ticks * tick);
+            for (int i = 0; i < 300; ++i, ++pushed) {
+                clock.step();
+                line.push_back(pushed);
+                line.update();
+
+                //after a longer delay is set nothing comes out until values are old enough, and after a
+                //shorter one everything that became due comes out at once
+                if (i < delay_ticks)
+                    continue;
+                testAssert(line.getOutput() == pushed - delay_ticks, Utils::stringf("with delay of %d ticks output is %d when %d was pushed",
+                    delay_ticks, line.getOutput(), pushed));
+                testAssert(line.getOutputTime() == static_cast<double>(clock.nowNanos() - static_cast<TTimePoint>(delay_ticks) * 1000000),
+                    Utils::stringf("output time with delay of %d ticks is off", delay_ticks));
+                testAssert(line.size() == static_cast<uint>(delay_ticks), Utils::stringf("%d values in flight with delay of %d ticks",
+                    static_cast<int>(line.size()), delay_ticks));
+            }
+        }
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,81 @@
+#ifndef msr_AirLibUnitTests_DroneTelemetryTest_hpp
+#define msr_AirLibUnitTests_DroneTelemetryTest_hpp
+
+#include "TestBase.hpp"
+#include "vehicles/multirotor/controllers/DroneTelemetry.hpp"
+#include <thread>
+#include <chrono>
+
+namespace msr { namespace airlib {
+
+class DroneTelemetryTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testFrames();
+        testIdleExpiry();
+    }
+
+private:
+    static void sample(DroneTelemetryFrame& frame)
+    {
+        frame.position = Vector3r(1, 2, -3);
+        frame.landed_state = 1;
+    }
+
+    void testFrames()
+    {
+        DroneTelemetryPublisher publisher;
+        int id = publisher.subscribe(static_cast<uint>(DroneTelemetryFields::Kinematics), 2, 3);
+        for (int step = 0; step < 10; ++step)
+            publisher.publish(sample);
+
+        //5 frames were due but only the last 3 fit in the queue
+        vector<uint8_t> batch;
+        vector<DroneTelemetryFrame> frames;
+        uint32_t dropped;
+        testAssert(publisher.fetch(id, 0, batch), "fetch failed for a new subscription");
+        testAssert(DroneTelemetryCodec::decode(batch.data(), batch.size(), frames, dropped), "telemetry batch did not decode");
+        testAssert(frames.size() == 3 && dropped == 2, "telemetry queue did not keep the latest frames");
+        testAssert(frames[2].step == 8 && frames[2].sequence == 4, "telemetry frames are out of order");
+        testAssert(frames[2].position == Vector3r(1, 2, -3) && !frames[2].has(DroneTelemetryFields::LandedState),
+            "telemetry frame has the wrong fields");
+
+        testAssert(publisher.unsubscribe(id) && !publisher.fetch(id, 0, batch), "unsubscribe did not remove the subscription");
+    }
+
+    void testIdleExpiry()
+    {
+        const uint timeout_ms = 100;
+        DroneTelemetryPublisher publisher(timeout_ms);
+        const uint fields = static_cast<uint>(DroneTelemetryFields::All);
+        int polled = publisher.subscribe(fields, 1, 10);
+        int forgotten = publisher.subscribe(fields, 1, 10);
+        //a client blocked in fetch for longer than the timeout is still polling, step 0 is past so no frame is due for it
+        publisher.publish(sample);
+        int waiting = publisher.subscribe(fields, 1000000, 10);
+
+        vector<uint8_t> waiting_batch;
+        bool waiting_fetched = false;
+        std::thread waiter([&]() {
+            waiting_fetched = publisher.fetch(waiting, 4 * timeout_ms, waiting_batch);
+        });
+
+        vector<uint8_t> batch;
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(3 * timeout_ms)) {
+            publisher.publish(sample);
+            testAssert(publisher.fetch(polled, 0, batch), "subscription that is polled expired");
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        waiter.join();
+
+        testAssert(waiting_fetched, "subscription expired while a fetch was waiting on it");
+        testAssert(!publisher.fetch(forgotten, 0, batch), "subscription that was never polled did not expire");
+        testAssert(!publisher.unsubscribe(forgotten), "expired subscription can still be unsubscribed");
+        testAssert(publisher.unsubscribe(polled), "polled subscription is gone");
+    }
+};
+
+}}
+#endif
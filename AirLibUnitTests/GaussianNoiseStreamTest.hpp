@@ -0,0 +1,130 @@
+#ifndef msr_AirLibUnitTests_GaussianNoiseStreamTest_hpp
+#define msr_AirLibUnitTests_GaussianNoiseStreamTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "common/common_utils/GaussianNoiseStream.hpp"
+#include <cmath>
+
+namespace msr { namespace airlib {
+
+class GaussianNoiseStreamTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testPhiloxKnownAnswers();
+        testPhiloxLanes();
+        testMoments<float>();
+        testMoments<double>();
+        testRepeatable();
+        testGenerator();
+    }
+
+private:
+    typedef common_utils::Philox4x32 Philox4x32;
+
+    //Philox4x32-10 known answer vectors (kat_vectors) from the Random123 reference implementation
+    void testPhiloxKnownAnswers()
+    {
+        struct KnownAnswer {
+            uint32_t counter[4];
+            uint32_t key[2];
+            uint32_t expected[4];
+        };
+        const KnownAnswer answers[] = {
+            { { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 },
+              { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+            { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff },
+              { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+            { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 },
+              { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } }
+        };
+
+        for (const KnownAnswer& answer : answers) {
+            uint64_t counter = answer.counter[0] | (static_cast<uint64_t>(answer.counter[1]) << 32);
+            uint64_t counter_high = answer.counter[2] | (static_cast<uint64_t>(answer.counter[3]) << 32);
+            uint64_t key = answer.key[0] | (static_cast<uint64_t>(answer.key[1]) << 32);
+            uint32_t out[4];
+            Philox4x32::fill(key, counter, out, 1, counter_high);
+            for (int i = 0; i < 4; ++i)
+                testAssert(out[i] == answer.expected[i], Utils::stringf("Philox word %d for counter %08x is %08x instead of %08x",
+                    i, answer.counter[0], out[i], answer.expected[i]));
+        }
+    }
+
+    //a block over several lane groups gives the same words as one counter at a time
+    void testPhiloxLanes()
+    {
+        const uint64_t key = 0x0123456789abcdefULL, counter = 0xfffffffffULL;
+        const size_t count = 2 * Philox4x32::kLanes + 3;
+        vector<uint32_t> block(4 * count);
+        Philox4x32::fill(key, counter, block.data(), count);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t out[4];
+            Philox4x32::fill(key, counter + i, out, 1);
+            for (int word = 0; word < 4; ++word)
+                testAssert(block[4 * i + word] == out[word], Utils::stringf("word %d of counter %d differs in a block", word, static_cast<int>(i)));
+        }
+    }
+
+    //mean 0 and variance 1 within 5 standard errors, samples are never NaN or infinite
+    template <typename RealT>
+    void testMoments()
+    {
+        const int count = 1000000;
+        common_utils::GaussianNoiseStream<RealT> stream(7);
+        double sum = 0, sum_squares = 0;
+        bool finite = true;
+        for (int i = 0; i < count; ++i) {
+            double sample = static_cast<double>(stream.next());
+            finite = finite && std::isfinite(sample);
+            sum += sample;
+            sum_squares += sample * sample;
+        }
+        double mean = sum / count;
+        double variance = sum_squares / count - mean * mean;
+        testAssert(finite, "stream gave a sample that is not finite");
+        testAssert(std::abs(mean) < 5 / std::sqrt(count), Utils::stringf("mean is %f", mean));
+        testAssert(std::abs(variance - 1) < 5 * std::sqrt(2.0 / count), Utils::stringf("variance is %f", variance));
+    }
+
+    //reset and reseeding replay the same samples, block reads match single reads
+    void testRepeatable()
+    {
+        const size_t count = 3 * common_utils::GaussianNoiseStream<float>::kBlockSize + 5;
+        common_utils::GaussianNoiseStream<float> stream(11);
+        vector<float> first(count), second(count);
+        for (size_t i = 0; i < count; ++i)
+            first[i] = stream.next();
+
+        stream.reset();
+        stream.next(second.data(), 7);
+        stream.next(second.data() + 7, count - 7);
+        testAssert(first == second, "reset stream read in blocks doesn't repeat the samples");
+
+        stream.seed(12);
+        testAssert(stream.next() != first[0], "different seed gives the same first sample");
+        stream.seed(11);
+        testAssert(stream.next() == first[0], "seeding again doesn't repeat the samples");
+    }
+
+    //generator scales the stream to its mean and stddev
+    void testGenerator()
+    {
+        const int count = 100000;
+        common_utils::RandomGeneratorGaussianD generator(3, 0.5);
+        double sum = 0, sum_squares = 0;
+        for (int i = 0; i < count; ++i) {
+            double sample = generator.next();
+            sum += sample;
+            sum_squares += sample * sample;
+        }
+        double mean = sum / count;
+        double stddev = std::sqrt(sum_squares / count - mean * mean);
+        testAssert(std::abs(mean - 3) < 5 * 0.5 / std::sqrt(count), Utils::stringf("generator mean is %f", mean));
+        testAssert(std::abs(stddev - 0.5) < 0.01, Utils::stringf("generator stddev is %f", stddev));
+    }
+};
+
+}}
+#endif
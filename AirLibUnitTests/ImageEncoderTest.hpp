@@ -0,0 +1,381 @@
+#ifndef msr_AirLibUnitTests_ImageEncoderTest_hpp
+#define msr_AirLibUnitTests_ImageEncoderTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "controllers/ImageEncoder.hpp"
+#include "Lz4Codec.hpp"
+#include <random>
+#include <cmath>
+
+namespace msr { namespace airlib {
+
+class ImageEncoderTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testLz4RoundTrips();
+        testLz4RejectsBadInput();
+        testPng(1, 8);
+        testPng(2, 8);
+        testPng(3, 8);
+        testPng(4, 8);
+        testPng(1, 16);
+        testEncodings();
+    }
+
+private:
+    typedef mavlinkcom::Lz4Codec Lz4Codec;
+    typedef ImageEncoder::ImageResponse ImageResponse;
+    typedef ImageEncoder::ImageEncoding ImageEncoding;
+
+    //random bytes don't compress, zeros and short runs with some noise are like rendered images
+    static vector<uint8_t> makeData(size_t size, int kind, std::mt19937& random)
+    {
+        vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            switch (kind) {
+            case 0: data[i] = static_cast<uint8_t>(random()); break;
+            case 1: data[i] = 0; break;
+            case 2: data[i] = static_cast<uint8_t>(i / 100); break;
+            default: data[i] = static_cast<uint8_t>(i % 37 < 30 ? i % 37 : random() % 4); break;
+            }
+        }
+        return data;
+    }
+
+    static void putSize(vector<uint8_t>& block, uint32_t size)
+    {
+        for (int i = 0; i < 4; ++i)
+            block[i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+
+    //literal and match lengths past their nibble, offsets up to the 64K window and blocks too short for a match
+    void testLz4RoundTrips()
+    {
+        std::mt19937 random(5);
+        for (size_t size : vector<size_t>{ 0, 1, 4, 12, 13, 17, 255, 1000, 70000, 300000 }) {
+            for (int kind = 0; kind < 4; ++kind) {
+                vector<uint8_t> data = makeData(size, kind, random), compressed, decompressed;
+                Lz4Codec::compress(data.data(), data.size(), compressed);
+                testAssert(compressed.size() <= 4 + Lz4Codec::maxBlockSize(size),
+                    Utils::stringf("%d bytes of kind %d compressed to more than the bound", static_cast<int>(size), kind));
+                testAssert(Lz4Codec::decompress(compressed.data(), compressed.size(), decompressed) && decompressed == data,
+                    Utils::stringf("%d bytes of kind %d didn't round trip", static_cast<int>(size), kind));
+                if ((kind == 1 || kind == 2) && size >= 1000)
+                    testAssert(compressed.size() < size / 10,
+                        Utils::stringf("%d bytes of kind %d only compressed to %d", static_cast<int>(size), kind, static_cast<int>(compressed.size())));
+            }
+        }
+    }
+
+    void testLz4RejectsBadInput()
+    {
+        std::mt19937 random(7);
+        vector<uint8_t> data = makeData(5000, 3, random), compressed, decompressed;
+        Lz4Codec::compress(data.data(), data.size(), compressed);
+
+        for (size_t size = 0; size < compressed.size(); ++size)
+            testAssert(!Lz4Codec::decompress(compressed.data(), size, decompressed),
+                Utils::stringf("block truncated to %d bytes was accepted", static_cast<int>(size)));
+
+        //the block must decode to exactly the size it claims, and a size it can't expand to is rejected before allocating
+        for (uint32_t size : vector<uint32_t>{ 4999, 5001, 0, 0xFFFFFFFF }) {
+            vector<uint8_t> wrong = compressed;
+            putSize(wrong, size);
+            testAssert(!Lz4Codec::decompress(wrong.data(), wrong.size(), decompressed),
+                Utils::stringf("block of 5000 bytes was accepted as %u", size));
+        }
+
+        //one literal then a match of 4: back reference 0, before the start of the output, or past its end
+        vector<uint8_t> bad_offset = { 5, 0, 0, 0, 0x10, 'a', 2, 0, 0x00 };
+        testAssert(!Lz4Codec::decompress(bad_offset.data(), bad_offset.size(), decompressed), "offset before the output was accepted");
+        vector<uint8_t> zero_offset = { 5, 0, 0, 0, 0x10, 'a', 0, 0, 0x00 };
+        testAssert(!Lz4Codec::decompress(zero_offset.data(), zero_offset.size(), decompressed), "offset 0 was accepted");
+        vector<uint8_t> good = { 5, 0, 0, 0, 0x10, 'a', 1, 0, 0x00 };
+        testAssert(Lz4Codec::decompress(good.data(), good.size(), decompressed) && decompressed == vector<uint8_t>(5, 'a'),
+            "overlapping match didn't repeat the literal");
+        vector<uint8_t> long_match = { 4, 0, 0, 0, 0x10, 'a', 1, 0, 0x00 };
+        testAssert(!Lz4Codec::decompress(long_match.data(), long_match.size(), decompressed), "match past the output was accepted");
+        vector<uint8_t> long_literals = { 1, 0, 0, 0, 0x20, 'a', 'b' };
+        testAssert(!Lz4Codec::decompress(long_literals.data(), long_literals.size(), decompressed), "literals past the output were accepted");
+
+        //flipped bits may still decode when they only hit literals, but never to another size
+        for (int i = 0; i < 2000; ++i) {
+            vector<uint8_t> corrupt = compressed;
+            corrupt[4 + random() % (corrupt.size() - 4)] ^= static_cast<uint8_t>(1 << (random() % 8));
+            if (Lz4Codec::decompress(corrupt.data(), corrupt.size(), decompressed))
+                testAssert(decompressed.size() == data.size(), "corrupt block decoded to a different size");
+        }
+    }
+
+    //bit by bit versions so nothing is shared with the encoder
+    static uint32_t crc32(const uint8_t* data, size_t size)
+    {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i) {
+            crc ^= data[i];
+            for (int k = 0; k < 8; ++k)
+                crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        return ~crc;
+    }
+
+    static uint32_t adler32(const vector<uint8_t>& data)
+    {
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : data) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    static uint32_t getUInt32BE(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    //inflates the single fixed Huffman block PngEncoder writes
+    static bool inflateFixed(const uint8_t* data, size_t size, vector<uint8_t>& out, size_t& used)
+    {
+        static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        size_t bit = 0;
+        bool overrun = false;
+        //values are least significant bit first, Huffman codes most significant bit first
+        auto bits = [&](uint32_t count) {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; ++i, ++bit) {
+                if (bit / 8 >= size) {
+                    overrun = true;
+                    return 0u;
+                }
+                value |= ((data[bit / 8] >> (bit % 8)) & 1u) << i;
+            }
+            return value;
+        };
+        auto code = [&](uint32_t count, uint32_t value) {
+            for (uint32_t i = 0; i < count; ++i)
+                value = (value << 1) | bits(1);
+            return value;
+        };
+
+        out.clear();
+        if (bits(3) != 3)   //last block, fixed Huffman
+            return false;
+        for (;;) {
+            uint32_t symbol = code(7, 0);
+            if (symbol <= 0x17)
+                symbol += 256;
+            else {
+                symbol = code(1, symbol);
+                if (symbol >= 0x30 && symbol <= 0xBF)
+                    symbol -= 0x30;
+                else if (symbol >= 0xC0 && symbol <= 0xC7)
+                    symbol = symbol - 0xC0 + 280;
+                else
+                    symbol = code(1, symbol) - 0x190 + 144;
+            }
+            if (overrun || symbol > 285)
+                return false;
+
+            if (symbol < 256)
+                out.push_back(static_cast<uint8_t>(symbol));
+            else if (symbol == 256)
+                break;
+            else {
+                uint32_t length = length_base[symbol - 257] + bits(length_extra[symbol - 257]);
+                uint32_t distance_code = code(5, 0);
+                if (distance_code >= 30)
+                    return false;
+                size_t distance = distance_base[distance_code] + bits(distance_extra[distance_code]);
+                if (overrun || distance > out.size())
+                    return false;
+                for (uint32_t i = 0; i < length; ++i)
+                    out.push_back(out[out.size() - distance]);
+            }
+        }
+        used = (bit + 7) / 8;
+        return true;
+    }
+
+    //checks the chunk CRCs, zlib header and Adler-32 and returns the filtered scanlines
+    bool readPng(const vector<uint8_t>& png, uint32_t& width, uint32_t& height, int& bit_depth, int& color_type, vector<uint8_t>& filtered)
+    {
+        static const uint8_t signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+        if (png.size() < 8 || !std::equal(signature, signature + 8, png.begin()))
+            return false;
+
+        vector<uint8_t> zlib;
+        bool has_header = false;
+        size_t pos = 8;
+        for (;;) {
+            if (png.size() - pos < 12)
+                return false;
+            uint32_t length = getUInt32BE(&png[pos]);
+            if (png.size() - pos - 12 < length)
+                return false;
+            const uint8_t* type = &png[pos + 4];
+            const uint8_t* content = type + 4;
+            testAssert(getUInt32BE(content + length) == crc32(type, length + 4), "PNG chunk CRC doesn't match");
+            string name(type, type + 4);
+            pos += 12 + length;
+
+            if (name == "IHDR" && length == 13) {
+                width = getUInt32BE(content);
+                height = getUInt32BE(content + 4);
+                bit_depth = content[8];
+                color_type = content[9];
+                testAssert(content[10] == 0 && content[11] == 0 && content[12] == 0, "PNG has unexpected compression, filter or interlace method");
+                has_header = true;
+            }
+            else if (name == "IDAT")
+                zlib.insert(zlib.end(), content, content + length);
+            else if (name == "IEND")
+                break;
+        }
+        testAssert(pos == png.size(), "PNG has data after IEND");
+
+        if (!has_header || zlib.size() < 6 || (zlib[0] & 0x0F) != 8 || (zlib[0] * 256 + zlib[1]) % 31 != 0)
+            return false;
+        size_t used;
+        if (!inflateFixed(zlib.data() + 2, zlib.size() - 2, filtered, used) || used + 6 != zlib.size())
+            return false;
+        return getUInt32BE(&zlib[2 + used]) == adler32(filtered);
+    }
+
+    void testPng(int channels, int bit_depth)
+    {
+        const int width = 67, height = 41;
+        const int sample_bytes = bit_depth / 8;
+        const size_t row_bytes = static_cast<size_t>(width * channels * sample_bytes);
+
+        //gradient and flat areas for the matches, noise for the literals
+        std::mt19937 random(channels * bit_depth);
+        vector<uint8_t> pixels(row_bytes * height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width * channels; ++x) {
+                uint16_t sample = static_cast<uint16_t>(y < 10 ? 1000 : (y < 30 ? x * 251 + y : random()));
+                uint8_t* p = &pixels[y * row_bytes + x * sample_bytes];
+                if (sample_bytes == 2)
+                    std::memcpy(p, &sample, 2);
+                else
+                    *p = static_cast<uint8_t>(sample);
+            }
+        }
+
+        vector<uint8_t> png, filtered;
+        common_utils::PngEncoder::encode(pixels.data(), width, height, channels, bit_depth, png);
+        uint32_t png_width, png_height;
+        int png_depth, color_type;
+        string image = Utils::stringf("%d channel %d bit PNG", channels, bit_depth);
+        testAssert(readPng(png, png_width, png_height, png_depth, color_type, filtered), image + " can't be read");
+        static const int color_types[5] = { 0, 0, 4, 2, 6 };
+        testAssert(png_width == width && png_height == height && png_depth == bit_depth && color_type == color_types[channels],
+            image + " has the wrong header");
+        testAssert(filtered.size() == height * (row_bytes + 1), image + " has the wrong amount of pixel data");
+
+        //undo the Up filter, samples are big endian in the PNG
+        vector<uint8_t> above(row_bytes, 0), row(row_bytes);
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* line = &filtered[y * (row_bytes + 1)];
+            testAssert(line[0] == 2, image + " row doesn't use the Up filter");
+            for (size_t i = 0; i < row_bytes; ++i)
+                row[i] = static_cast<uint8_t>(line[i + 1] + above[i]);
+            for (size_t i = 0; i < row_bytes; i += sample_bytes) {
+                uint16_t expected = pixels[y * row_bytes + i];
+                uint16_t actual = row[i];
+                if (sample_bytes == 2) {
+                    std::memcpy(&expected, &pixels[y * row_bytes + i], 2);
+                    actual = static_cast<uint16_t>(row[i] << 8 | row[i + 1]);
+                }
+                testAssert(actual == expected, Utils::stringf("%s differs at row %d byte %d", image.c_str(), y, static_cast<int>(i)));
+            }
+            above.swap(row);
+        }
+    }
+
+    void testEncodings()
+    {
+        //depth quantizes to millimeters with NaN and negative as 0 and anything past 65.535 m as 0xFFFF
+        vector<float> depth = { 0, 1.25f, 0.0004f, 0.0006f, 65.534f, 70.0f, std::nanf(""), -1.0f };
+        vector<uint16_t> millimeters = { 0, 1250, 0, 1, 65534, 0xFFFF, 0, 0 };
+        ImageResponse response;
+        response.width = 4;
+        response.height = 2;
+        response.pixels_as_float = true;
+        response.compress = false;
+        response.image_data_float = depth;
+        ImageEncoder::encode(ImageEncoding::DepthU16, response);
+        testAssert(response.encoding == ImageEncoding::DepthU16 && !response.pixels_as_float && response.image_data_float.empty()
+            && response.image_data_uint8.size() == depth.size() * 2, "DepthU16 response is not uint16 pixels");
+        for (size_t i = 0; i < depth.size(); ++i) {
+            uint16_t value = static_cast<uint16_t>(response.image_data_uint8[2 * i] | response.image_data_uint8[2 * i + 1] << 8);
+            testAssert(value == millimeters[i], Utils::stringf("depth %f became %d mm", depth[i], value));
+        }
+
+        //16 bit PNG of the same millimeters
+        response = ImageResponse();
+        response.width = 4;
+        response.height = 2;
+        response.pixels_as_float = true;
+        response.compress = false;
+        response.image_data_float = depth;
+        ImageEncoder::encode(ImageEncoding::PngFast, response);
+        vector<uint8_t> filtered;
+        uint32_t png_width, png_height;
+        int png_depth, color_type;
+        testAssert(response.encoding == ImageEncoding::PngFast && response.compress && !response.pixels_as_float
+            && readPng(response.image_data_uint8, png_width, png_height, png_depth, color_type, filtered)
+            && png_depth == 16 && color_type == 0 && filtered.size() == 2 * (1 + 4 * 2), "float PngFast is not a 16 bit gray PNG");
+        for (size_t i = 0; i < depth.size(); ++i) {
+            size_t y = i / 4, x = i % 4;
+            const uint8_t* sample = &filtered[y * 9 + 1 + 2 * x];
+            uint8_t high = sample[0], low = sample[1];
+            if (y == 1) {
+                high = static_cast<uint8_t>(high + sample[-9]);
+                low = static_cast<uint8_t>(low + sample[-8]);
+            }
+            uint16_t value = static_cast<uint16_t>(high << 8 | low);
+            testAssert(value == millimeters[i], Utils::stringf("depth %f became %d mm in the PNG", depth[i], value));
+        }
+
+        //floats compressed as bytes, pixels_as_float still says how to read them
+        response = ImageResponse();
+        response.width = 4;
+        response.height = 2;
+        response.pixels_as_float = true;
+        response.compress = false;
+        response.image_data_float = depth;
+        ImageEncoder::encode(ImageEncoding::Lz4, response);
+        vector<uint8_t> decompressed;
+        testAssert(response.encoding == ImageEncoding::Lz4 && response.compress && response.pixels_as_float && response.image_data_float.empty()
+            && Lz4Codec::decompress(response.image_data_uint8.data(), response.image_data_uint8.size(), decompressed)
+            && decompressed.size() == depth.size() * sizeof(float)
+            && std::memcmp(decompressed.data(), depth.data(), decompressed.size()) == 0, "float Lz4 response doesn't decompress to the floats");
+
+        //PngFast needs 1 to 4 channels and unknown encodings go out as Raw
+        vector<uint8_t> pixels(4 * 2 * 5, 7);
+        response = ImageResponse();
+        response.width = 4;
+        response.height = 2;
+        response.compress = false;
+        response.image_data_uint8 = pixels;
+        ImageEncoder::encode(ImageEncoding::PngFast, response);
+        testAssert(!response.message.empty() && response.image_data_uint8 == pixels, "PngFast encoded 5 channels");
+        response.message.clear();
+        ImageEncoder::encode(static_cast<ImageEncoding>(99), response);
+        testAssert(response.encoding == ImageEncoding::Raw && response.image_data_uint8 == pixels, "unknown encoding was not sent as Raw");
+    }
+};
+
+}}
+#endif
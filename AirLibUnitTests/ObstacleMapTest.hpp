@@ -0,0 +1,225 @@
+#ifndef msr_AirLibUnitTests_ObstacleMapTest_hpp
+#define msr_AirLibUnitTests_ObstacleMapTest_hpp
+
+#include "TestBase.hpp"
+#include "safety/ObstacleMap.hpp"
+#include <random>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+namespace msr { namespace airlib {
+
+class ObstacleMapTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testUpdates();
+        testConcurrentUpdates();
+        testPendingUpdate();
+        testWindowObstacles(false);
+        testWindowObstacles(true);
+    }
+
+private:
+    static constexpr int kTicks = 64;
+
+    //the map as a plain array, updated and scanned tick by tick
+    struct Reference {
+        vector<float> distances, confidences;
+
+        Reference()
+            : distances(kTicks, Utils::max<float>() / 2), confidences(kTicks, 1)
+        {
+        }
+
+        static int wrap(int tick)
+        {
+            int iw = tick % kTicks;
+            return iw < 0 ? kTicks + iw : iw;
+        }
+
+        void update(float distance, int tick, int window, float confidence)
+        {
+            for (int i = tick - window; i <= tick + window; ++i) {
+                distances[wrap(i)] = distance;
+                confidences[wrap(i)] = confidence;
+            }
+        }
+
+        ObstacleMap::ObstacleInfo hasObstacle(int from_tick, int to_tick) const
+        {
+            if (from_tick > to_tick) {
+                from_tick = wrap(from_tick);
+                to_tick = wrap(to_tick);
+                if (from_tick > to_tick)
+                    to_tick += kTicks;
+            }
+
+            ObstacleMap::ObstacleInfo obs;
+            obs.tick = wrap(from_tick);
+            obs.distance = Utils::max<float>();
+            obs.confidence = 0;
+            for (int i = from_tick; i <= to_tick; ++i) {
+                int iw = wrap(i);
+                if (obs.distance > distances[iw]) {
+                    obs.tick = iw;
+                    obs.distance = distances[iw];
+                    obs.confidence = confidences[iw];
+                }
+            }
+            return obs;
+        }
+    };
+
+    static bool same(const ObstacleMap::ObstacleInfo& obs, const ObstacleMap::ObstacleInfo& expected)
+    {
+        return obs.tick == expected.tick && obs.distance == expected.distance && obs.confidence == expected.confidence;
+    }
+
+    //beams of a few ticks with a wide window or a full scan now and then, so buffers are brought up to date
+    //from the window log, after it overflowed and after full updates, checked against scanning tick by tick
+    void testUpdates()
+    {
+        std::mt19937 random(3);
+        std::uniform_int_distribution<int> tick(-kTicks, 2 * kTicks);
+        std::uniform_int_distribution<int> window(0, 3);
+        std::uniform_real_distribution<float> distance(1, 50);
+        std::uniform_int_distribution<int> pick(0, 49);
+
+        ObstacleMap map(kTicks);
+        Reference reference;
+        vector<float> distances(kTicks), confidences(kTicks);
+        vector<ObstacleMap::ObstacleInfo> obstacles;
+        for (int update = 0; update < 2000; ++update) {
+            int kind = pick(random);
+            if (kind == 0) {
+                for (int i = 0; i < kTicks; ++i) {
+                    distances[i] = distance(random);
+                    confidences[i] = distance(random);
+                }
+                map.update(distances.data(), confidences.data());
+                reference.distances = distances;
+                reference.confidences = confidences;
+            }
+            else {
+                int beam_tick = tick(random);
+                int beam_window = kind == 1 ? kTicks / 2 + window(random) : window(random);
+                float beam_distance = distance(random), confidence = distance(random);
+                map.update(beam_distance, beam_tick, beam_window, confidence);
+                reference.update(beam_distance, beam_tick, beam_window, confidence);
+            }
+
+            map.getWindowObstacles(0, obstacles);
+            for (int i = 0; i < kTicks; ++i)
+                testAssert(same(obstacles[i], reference.hasObstacle(i, i)),
+                    Utils::stringf("tick %d differs from reference after update %d", i, update));
+            //small windows, and any two ticks so windows can be reversed or more than a circle
+            int from = tick(random);
+            int to = update % 2 ? from + 10 : tick(random);
+            testAssert(same(map.hasObstacle(from, to), reference.hasObstacle(from, to)),
+                Utils::stringf("window %d to %d differs from reference after update %d", from, to, update));
+        }
+    }
+
+    //getWindowObstacles gives the same obstacle as hasObstacle for the window around every tick, including the tick
+    //picked on ties, blind spots extending the window and windows that cover the whole circle
+    void testWindowObstacles(bool odd_blindspots)
+    {
+        std::mt19937 random(13);
+        std::uniform_int_distribution<int> pick(0, 99);
+        std::uniform_real_distribution<float> far(20, 100);
+        vector<float> distances(kTicks), confidences(kTicks);
+        vector<ObstacleMap::ObstacleInfo> obstacles;
+
+        ObstacleMap map(kTicks, odd_blindspots);
+        for (int scan = 0; scan < 20; ++scan) {
+            for (int i = 0; i < kTicks; ++i) {
+                int kind = pick(random);
+                distances[i] = kind < 3 ? 1.0f + kind : (kind < 6 ? 10.0f : far(random));
+                confidences[i] = 0.5f + 0.005f * kind;
+            }
+            //some ticks see nothing, distances at max must never be reported
+            distances[scan % kTicks] = Utils::max<float>();
+            map.update(distances.data(), confidences.data());
+
+            for (int window : { 0, 1, 5, kTicks / 2 - 2, kTicks / 2, kTicks }) {
+                map.getWindowObstacles(window, obstacles);
+                for (int tick = 0; tick < kTicks; ++tick)
+                    testAssert(same(obstacles[tick], map.hasObstacle(tick - window, tick + window)),
+                        Utils::stringf("window +/-%d around tick %d differs from hasObstacle", window, tick));
+            }
+        }
+    }
+
+    //with queries pinning buffers updates may be left pending but never lost or torn, the query finishing
+    //last publishes them so once queries stop the map has every update without another one
+    void testConcurrentUpdates()
+    {
+        ObstacleMap map(kTicks);
+        Reference reference;
+        std::atomic<bool> stop(false);
+        std::atomic<int> inconsistent(0);
+        vector<std::thread> readers;
+        for (int reader = 0; reader < 2; ++reader) {
+            readers.emplace_back([&]() {
+                vector<ObstacleMap::ObstacleInfo> obstacles;
+                while (!stop) {
+                    //every beam writes its whole sweep number into distance and confidence
+                    map.getWindowObstacles(0, obstacles);
+                    for (const auto& obs : obstacles)
+                        if (obs.distance != obs.confidence && obs.distance < Utils::max<float>() / 2)
+                            ++inconsistent;
+                }
+            });
+        }
+
+        for (int update = 0; update < 200000; ++update) {
+            float sweep = static_cast<float>(update / kTicks + 1);
+            map.update(sweep, update % kTicks, 1, sweep);
+            reference.update(sweep, update % kTicks, 1, sweep);
+        }
+        stop = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        vector<ObstacleMap::ObstacleInfo> obstacles;
+        map.getWindowObstacles(0, obstacles);
+        bool matches = true;
+        for (int i = 0; i < kTicks; ++i)
+            matches = matches && same(obstacles[i], reference.hasObstacle(i, i));
+        testAssert(inconsistent == 0, Utils::stringf("%d ticks were read while they were written", static_cast<int>(inconsistent)));
+        testAssert(matches, "updates were lost while queries were running");
+    }
+
+    //queries over a large map keep the other buffers pinned most of the time, so updates are mostly left
+    //pending and the last one must be published by the query finishing last
+    void testPendingUpdate()
+    {
+        ObstacleMap map(1 << 20);
+        std::atomic<bool> stop(false);
+        vector<std::thread> readers;
+        for (int reader = 0; reader < 2; ++reader) {
+            readers.emplace_back([&]() {
+                vector<ObstacleMap::ObstacleInfo> obstacles;
+                while (!stop)
+                    map.getWindowObstacles(0, obstacles);
+            });
+        }
+
+        const int updates = 100;
+        for (int update = 1; update <= updates; ++update) {
+            map.update(static_cast<float>(update), 0, 0, 1);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        stop = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        float distance = map.hasObstacle(0, 0).distance;
+        testAssert(distance == updates, Utils::stringf("map has distance %f after the last update set %d", distance, updates));
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,189 @@
+#ifndef msr_AirLibUnitTests_OffboardSetpointTest_hpp
+#define msr_AirLibUnitTests_OffboardSetpointTest_hpp
+
+#include "TestBase.hpp"
+#include "vehicles/multirotor/controllers/DroneControllerBase.hpp"
+#include "vehicles/multirotor/controllers/OffboardSetpoint.hpp"
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+namespace msr { namespace airlib {
+
+class OffboardSetpointTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testNoTornReads();
+        testSessions();
+        testFollowSetpoints();
+    }
+
+private:
+    //every field of setpoint i is i, so a setpoint with different values was read while it was written
+    static OffboardSetpoint numbered(uint i)
+    {
+        float value = static_cast<float>(i);
+        OffboardSetpoint setpoint = OffboardSetpoint::velocity(value, value, value, value, DrivetrainType::MaxDegreeOfFreedom,
+            YawMode(true, value));
+        setpoint.yaw = value;
+        return setpoint;
+    }
+
+    static bool isNumbered(const OffboardSetpoint& setpoint)
+    {
+        float value = setpoint.x;
+        return setpoint.type == OffboardSetpoint::Type::Velocity && setpoint.y == value && setpoint.z == value
+            && setpoint.yaw == value && setpoint.duration == value && setpoint.yaw_mode.yaw_or_rate == value;
+    }
+
+    //runs long enough that on a single core the writer gets preempted in the middle of a post many times
+    void testNoTornReads()
+    {
+        OffboardSetpointMailbox mailbox;
+        uint64_t version;
+        uint64_t session = mailbox.open(version);
+
+        std::atomic<bool> stop(false);
+        std::atomic<uint> posted(0);
+        std::thread writer([&]() {
+            //numbers stay exact in float
+            for (uint i = 1; !stop && i < (1u << 24); ++i) {
+                mailbox.post(numbered(i));
+                posted = i;
+            }
+        });
+
+        uint taken = 0, torn = 0;
+        float last = 0;
+        bool ordered = true;
+        OffboardSetpoint setpoint;
+        auto take = [&]() {
+            if (mailbox.take(session, version, setpoint)) {
+                ++taken;
+                if (!isNumbered(setpoint))
+                    ++torn;
+                ordered = ordered && setpoint.x > last;
+                last = setpoint.x;
+            }
+        };
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::seconds(1))
+            take();
+        stop = true;
+        writer.join();
+        take();
+
+        testAssert(torn == 0, Utils::stringf("%d of %d setpoints taken were torn", torn, taken));
+        testAssert(last == posted, "last setpoint posted was not taken");
+        testAssert(ordered, "mailbox handed out an older setpoint after a newer one");
+        testAssert(!mailbox.take(session, version, setpoint), "mailbox handed out the same setpoint twice");
+    }
+
+    void testSessions()
+    {
+        OffboardSetpointMailbox mailbox;
+        testAssert(!mailbox.post(numbered(1)), "post succeeded before the mailbox was opened");
+
+        uint64_t version;
+        uint64_t old_session = mailbox.open(version);
+        uint64_t old_version = version;
+        uint64_t session = mailbox.open(version);
+        testAssert(mailbox.post(numbered(2)), "post failed on an open mailbox");
+
+        //a loop on its way out must not take or close what was posted for the next one
+        OffboardSetpoint setpoint;
+        testAssert(!mailbox.take(old_session, old_version, setpoint), "old session took a setpoint of the new one");
+        testAssert(mailbox.closeIfIdle(old_session, old_version) && mailbox.post(numbered(3)), "old session closed the new one");
+
+        testAssert(!mailbox.closeIfIdle(session, version), "mailbox closed with a setpoint not taken yet");
+        testAssert(mailbox.take(session, version, setpoint) && setpoint.x == 3, "latest setpoint was not taken");
+        testAssert(mailbox.closeIfIdle(session, version) && !mailbox.post(numbered(4)), "idle mailbox did not close");
+    }
+
+    //followSetpoints has to switch to each setpoint posted while it runs and return once the last one is done
+    void testFollowSetpoints()
+    {
+        FakeController controller;
+        OffboardSetpointMailbox mailbox;
+        uint64_t version;
+        uint64_t session = mailbox.open(version);
+        Action action;
+
+        bool result = false;
+        std::thread loop([&]() {
+            result = controller.followSetpoints(velocity(1, 5), mailbox, session, version, action);
+        });
+
+        testAssert(controller.waitForVx(1), "first setpoint was not commanded");
+        testAssert(mailbox.post(velocity(2, 5)), "post failed while the loop was running");
+        testAssert(controller.waitForVx(2), "loop did not pick up the posted setpoint");
+        testAssert(mailbox.post(velocity(3, 0.05f)), "post failed while the loop was running");
+        loop.join();
+
+        testAssert(result, "followSetpoints failed");
+        testAssert(controller.vx == 3, "loop did not end on the latest setpoint");
+        testAssert(!mailbox.post(velocity(4, 1)), "mailbox still open after the loop ended");
+    }
+
+    static OffboardSetpoint velocity(float vx, float duration)
+    {
+        return OffboardSetpoint::velocity(vx, 0, 0, duration, DrivetrainType::MaxDegreeOfFreedom, YawMode());
+    }
+
+    class Action : public CancelableBase {
+    public:
+        virtual void execute() override
+        {
+        }
+    };
+
+    //only commandVelocity does anything, it remembers the last vx
+    class FakeController : public DroneControllerBase {
+    public:
+        std::atomic<float> vx{ 0 };
+
+        bool waitForVx(float expected)
+        {
+            for (int i = 0; i < 1000 && vx != expected; ++i)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            return vx == expected;
+        }
+
+        virtual void commandVelocity(float vx_val, float vy, float vz, const YawMode& yaw_mode) override
+        {
+            unused(vy); unused(vz); unused(yaw_mode);
+            vx = vx_val;
+        }
+        virtual float getCommandPeriod() override { return 1E-3f; }
+
+        virtual void enableApiControl(bool is_enabled) override { unused(is_enabled); }
+        virtual void setSimulationMode(bool is_set) override { unused(is_set); }
+        virtual bool isApiControlEnabled() override { return true; }
+        virtual bool isSimulationMode() override { return true; }
+        virtual bool isAvailable(std::string& message) override { unused(message); return true; }
+        virtual real_T getVertexControlSignal(unsigned int rotor_index) override { unused(rotor_index); return 0; }
+        virtual size_t getVertexCount() override { return 0; }
+        virtual bool armDisarm(bool arm, CancelableBase& cancelable_action) override { unused(arm); unused(cancelable_action); return true; }
+        virtual Vector3r getPosition() override { return Vector3r::Zero(); }
+        virtual Vector3r getVelocity() override { return Vector3r::Zero(); }
+        virtual Quaternionr getOrientation() override { return Quaternionr::Identity(); }
+        virtual LandedState getLandedState() override { return LandedState::Flying; }
+        virtual RCData getRCData() override { return RCData(); }
+        virtual void setRCData(const RCData& rcData) override { unused(rcData); }
+        virtual GeoPoint getHomeGeoPoint() override { return GeoPoint(); }
+        virtual GeoPoint getGpsLocation() override { return GeoPoint(); }
+        virtual const VehicleParams& getVehicleParams() override { return params_; }
+        virtual void commandRollPitchZ(float pitch, float roll, float z, float yaw) override { unused(pitch); unused(roll); unused(z); unused(yaw); }
+        virtual void commandVelocityZ(float vx_val, float vy, float z, const YawMode& yaw_mode) override { unused(vx_val); unused(vy); unused(z); unused(yaw_mode); }
+        virtual void commandPosition(float x, float y, float z, const YawMode& yaw_mode) override { unused(x); unused(y); unused(z); unused(yaw_mode); }
+        virtual float getTakeoffZ() override { return -3; }
+        virtual float getDistanceAccuracy() override { return 0.5f; }
+
+    private:
+        VehicleParams params_;
+    };
+};
+
+}}
+#endif
@@ -0,0 +1,114 @@
+#ifndef msr_AirLibUnitTests_SafetyEvalTest_hpp
+#define msr_AirLibUnitTests_SafetyEvalTest_hpp
+
+#include "TestBase.hpp"
+#include "safety/SafetyEval.hpp"
+#include <random>
+
+namespace msr { namespace airlib {
+
+class SafetyEvalTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        //unsafe destinations log every evaluation
+        int min_log_level = Utils::getSetMinLogLevel();
+        Utils::getSetMinLogLevel(true, Utils::kLogLevelInfo + 1);
+
+        testBatchWithObstacleMap(false);
+        testBatchWithObstacleMap(true);
+        testBatchWithVoxelMap();
+
+        Utils::getSetMinLogLevel(true, min_log_level);
+    }
+
+private:
+    static void setObstacleSafety(SafetyEval& safety_eval)
+    {
+        //only obstacles are checked so no fence is needed
+        safety_eval.setSafety(SafetyEval::SafetyViolationType_::Obstacle, Utils::nan<float>(), SafetyEval::ObsAvoidanceStrategy::RaiseException,
+            Vector3r::Constant(Utils::nan<float>()), Utils::nan<float>(), Utils::nan<float>(), Utils::nan<float>());
+    }
+
+    //destinations on circles around position, including one at position itself
+    static vector<Vector3r> circleDestinations(const Vector3r& position)
+    {
+        vector<Vector3r> destinations = { position };
+        for (float radius : { 1.0f, 3.0f, 6.0f }) {
+            for (int i = 0; i < 64; ++i) {
+                float angle = 2 * M_PIf * i / 64;
+                destinations.push_back(position + Vector3r(radius * std::cos(angle), radius * std::sin(angle), i % 3 - 1.0f));
+            }
+        }
+        return destinations;
+    }
+
+    static bool sameFloat(float a, float b)
+    {
+        return a == b || (std::isnan(a) && std::isnan(b));
+    }
+
+    //isSafeDestinations scores every destination like isSafeDestination does on its own, only without suggestions
+    void checkBatch(SafetyEval& safety_eval, const Vector3r& position, const Quaternionr& orientation, const string& name)
+    {
+        const vector<Vector3r> destinations = circleDestinations(position);
+        vector<SafetyEval::EvalResult> batch = safety_eval.isSafeDestinations(destinations, position, orientation);
+        testAssert(batch.size() == destinations.size(), name + ": isSafeDestinations returned the wrong number of results");
+
+        uint safe_count = 0;
+        for (size_t i = 0; i < destinations.size(); ++i) {
+            SafetyEval::EvalResult single = safety_eval.isSafeDestination(destinations[i], position, orientation);
+            //there is no obstacle towards a destination at position
+            bool same = batch[i].is_safe == single.is_safe && batch[i].reason == single.reason
+                && sameFloat(batch[i].dest_risk_dist, single.dest_risk_dist) && sameFloat(batch[i].cur_risk_dist, single.cur_risk_dist)
+                && (std::isnan(single.dest_risk_dist) || sameFloat(batch[i].dest_obs.distance, single.dest_obs.distance));
+            testAssert(same, Utils::stringf("%s: destination %d differs, batch %s, single %s", name.c_str(), static_cast<int>(i),
+                batch[i].toString().c_str(), single.toString().c_str()));
+            safe_count += single.is_safe ? 1 : 0;
+        }
+        testAssert(safe_count > 0 && safe_count < destinations.size(), name + ": destinations should be partly safe");
+    }
+
+    void testBatchWithObstacleMap(bool odd_blindspots)
+    {
+        const int ticks = 256;
+        std::mt19937 random(19);
+        std::uniform_real_distribution<float> far(2, 10), confidence(0.5f, 1);
+        std::uniform_int_distribution<int> pick(0, 99);
+        vector<float> distances(ticks), confidences(ticks);
+        for (int i = 0; i < ticks; ++i) {
+            //mostly far away with a few close obstacles and repeated distances to exercise ties
+            int kind = pick(random);
+            distances[i] = kind < 3 ? 0.5f + kind : (kind < 6 ? 4.0f : far(random));
+            confidences[i] = kind < 6 ? 1 : confidence(random);
+        }
+        auto map = std::make_shared<ObstacleMap>(ticks, odd_blindspots);
+        map->update(distances.data(), confidences.data());
+
+        VehicleParams params;
+        params.obs_window = 5;
+        SafetyEval safety_eval(params, nullptr, map);
+        setObstacleSafety(safety_eval);
+
+        const Quaternionr yawed = VectorMath::toQuaternion(0, 0, 0.7f);
+        checkBatch(safety_eval, Vector3r(1, -2, 0), yawed, odd_blindspots ? "ObstacleMap with blind spots" : "ObstacleMap");
+    }
+
+    void testBatchWithVoxelMap()
+    {
+        std::mt19937 random(23);
+        std::uniform_real_distribution<float> coordinate(-8, 8);
+        auto voxels = std::make_shared<VoxelMap>(0.2f, 30.0f);
+        for (int i = 0; i < 300; ++i)
+            voxels->insertPoint(Vector3r(coordinate(random), coordinate(random), coordinate(random) / 4));
+
+        SafetyEval safety_eval(VehicleParams(), nullptr, nullptr);
+        safety_eval.setVoxelMap(voxels);
+        setObstacleSafety(safety_eval);
+
+        checkBatch(safety_eval, Vector3r(0.5f, 0.5f, 0), Quaternionr::Identity(), "VoxelMap");
+    }
+};
+
+}}
+#endif
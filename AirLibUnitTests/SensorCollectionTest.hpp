@@ -0,0 +1,100 @@
+#ifndef msr_AirLibUnitTests_SensorCollectionTest_hpp
+#define msr_AirLibUnitTests_SensorCollectionTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/SteppableClock.hpp"
+#include "sensors/SensorCollection.hpp"
+
+namespace msr { namespace airlib {
+
+class SensorCollectionTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testSchedule();
+    }
+
+private:
+    //records when it was updated and asks for the next update one period later, period 0 is every tick
+    class PeriodicSensor : public SensorBase {
+    public:
+        PeriodicSensor(TTimeDelta period)
+            : period_(period)
+        {
+        }
+
+        virtual void reset() override
+        {
+            SensorBase::reset();
+            updates.clear();
+            next_update_ = 0;
+        }
+
+        virtual void update() override
+        {
+            SensorBase::update();
+            TTimePoint now = clock()->nowNanos();
+            updates.push_back(now);
+            next_update_ = period_ > 0 ? clock()->addTo(now, period_) : 0;
+        }
+
+        virtual TTimePoint getNextUpdateTime() override
+        {
+            return next_update_;
+        }
+
+        TTimeDelta getPeriod() const
+        {
+            return period_;
+        }
+
+        vector<TTimePoint> updates;
+
+    private:
+        TTimeDelta period_;
+        TTimePoint next_update_ = 0;
+    };
+
+    //sensors at different rates, some not multiples of the tick, are each updated on the first tick at or
+    //after their due time and not on any other, before and after a reset
+    void testSchedule()
+    {
+        SteppableClock clock(1E-3);
+        ClockFactory::ThreadClockScope clock_scope(&clock);
+
+        vector<unique_ptr<PeriodicSensor>> sensors;
+        for (TTimeDelta period : { 0.0, 1E-3, 2.5E-3, 10E-3, 7E-3, 1.0 })
+            sensors.push_back(unique_ptr<PeriodicSensor>(new PeriodicSensor(period)));
+        SensorCollection collection;
+        SensorCollection::SensorType types[] = { SensorCollection::SensorType::Imu, SensorCollection::SensorType::Barometer,
+            SensorCollection::SensorType::Gps, SensorCollection::SensorType::Magnetometer };
+        for (size_t i = 0; i < sensors.size(); ++i)
+            collection.insert(sensors[i].get(), types[i % 4]);
+
+        for (int run = 0; run < 2; ++run) {
+            collection.reset();
+
+            vector<TTimePoint> ticks;
+            for (int tick = 0; tick < 200; ++tick) {
+                ticks.push_back(clock.nowNanos());
+                collection.update();
+                clock.step();
+            }
+
+            for (const auto& sensor : sensors) {
+                vector<TTimePoint> expected;
+                for (TTimePoint now : ticks) {
+                    if (expected.empty() || sensor->getPeriod() == 0 || now >= clock.addTo(expected.back(), sensor->getPeriod()))
+                        expected.push_back(now);
+                }
+                testAssert(sensor->updates == expected, Utils::stringf("sensor with period %f was updated %d times instead of %d in run %d",
+                    sensor->getPeriod(), static_cast<int>(sensor->updates.size()), static_cast<int>(expected.size()), run));
+            }
+        }
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,143 @@
+#ifndef msr_AirLibUnitTests_VoxelMapTest_hpp
+#define msr_AirLibUnitTests_VoxelMapTest_hpp
+
+#include "TestBase.hpp"
+#include "safety/VoxelMap.hpp"
+#include "safety/ObstacleMap.hpp"
+#include "safety/SafetyEval.hpp"
+#include <random>
+
+namespace msr { namespace airlib {
+
+class VoxelMapTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testQueries();
+        testClearing();
+        testAgainstObstacleMap();
+    }
+
+private:
+    static float segmentDistance(const Vector3r& point, const Vector3r& from, const Vector3r& to)
+    {
+        const Vector3r segment = to - from;
+        float length_squared = segment.squaredNorm();
+        float t = length_squared > 0 ? Utils::clip((point - from).dot(segment) / length_squared, 0.0f, 1.0f) : 0;
+        return (from + segment * t - point).norm();
+    }
+
+    //closest and segment queries against a search over all occupied voxels, with segments short and long
+    //enough to cross the map diagonally. In the sparse map the closest voxel is often blocks away.
+    void testQueries()
+    {
+        testQueries(2000);
+        testQueries(40);
+    }
+
+    void testQueries(int points)
+    {
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> coordinate(-10, 10);
+        std::normal_distribution<float> normal;
+
+        VoxelMap map(0.2f, 30.0f);
+        for (int i = 0; i < points; ++i)
+            map.insertPoint(Vector3r(coordinate(random), coordinate(random), coordinate(random) / 4));
+        const vector<Vector3r> voxels = map.getOccupiedVoxels();
+
+        const float max_distance = 5.2f;
+        for (int i = 0; i < 200; ++i) {
+            const Vector3r from(coordinate(random), coordinate(random), coordinate(random) / 4);
+            const float length = i % 4 == 1 ? 3.0f : 20.0f;
+            const Vector3r to = i % 2 ? from + Vector3r(normal(random), normal(random), normal(random)).normalized() * length : from;
+
+            float expected = Utils::max<float>() / 2;
+            for (const Vector3r& voxel : voxels) {
+                float distance = segmentDistance(voxel, from, to);
+                if (distance < max_distance && distance < expected)
+                    expected = distance;
+            }
+            float distance = i % 2 ? map.getSegmentObstacle(from, to, max_distance).distance : map.getClosestObstacle(from, max_distance).distance;
+            testAssert(std::abs(distance - expected) <= 1E-4f,
+                Utils::stringf("query %d with %d points found obstacle at %f instead of %f", i, points, distance, expected));
+        }
+    }
+
+    //an obstacle that is gone is cleared by rays passing through where it was
+    void testClearing()
+    {
+        VoxelMap map(0.2f, 30.0f);
+        const Vector3r origin(0, 0, 0), pillar(6.05f, 0.1f, 0.1f);
+        map.insertPoint(pillar);
+        testAssert(map.isOccupied(pillar), "inserted point is not occupied");
+
+        const vector<Vector3r> behind_pillar = { Vector3r(12, 0.2f, 0.2f), Vector3r(12, 0.1f, 0.3f), Vector3r(12, 0.3f, 0.1f) };
+        for (int scan = 0; scan < 3; ++scan)
+            map.insertPointCloud(origin, behind_pillar);
+        testAssert(!map.isOccupied(pillar), "obstacle was not cleared by rays through it");
+        testAssert(map.isOccupied(behind_pillar[0]), "points behind the obstacle are not occupied");
+    }
+
+    //level moves inside a round wall are judged the same with VoxelMap as with ObstacleMap, and a climb in to a
+    //ceiling ObstacleMap can't see is only caught with VoxelMap
+    void testAgainstObstacleMap()
+    {
+        const float radius = 8;
+        auto voxels = std::make_shared<VoxelMap>(0.2f, 30.0f);
+        for (int i = 0; i < 1000; ++i) {
+            float angle = 2 * M_PIf * i / 1000;
+            //repeated hits saturate the voxels so their confidence is as high as it gets
+            for (int hit = 0; hit < 5; ++hit)
+                voxels->insertPoint(Vector3r(radius * std::cos(angle), radius * std::sin(angle), 0));
+        }
+        for (float x = -2; x <= 2; x += 0.1f)
+            for (float y = -2; y <= 2; y += 0.1f)
+                for (int hit = 0; hit < 5; ++hit)
+                    voxels->insertPoint(Vector3r(x, y, -3));
+        float confidence = voxels->getClosestObstacle(Vector3r(radius, 0, 0), 1).confidence;
+
+        const int ticks = 64;
+        auto ticks_map = std::make_shared<ObstacleMap>(ticks);
+        vector<float> distances(ticks, radius), confidences(ticks, confidence);
+        ticks_map->update(distances.data(), confidences.data());
+
+        SafetyEval voxel_eval(VehicleParams(), nullptr, nullptr);
+        voxel_eval.setVoxelMap(voxels);
+        SafetyEval ticks_eval(VehicleParams(), nullptr, ticks_map);
+        for (SafetyEval* eval : { &voxel_eval, &ticks_eval })
+            eval->setSafety(SafetyEval::SafetyViolationType_::Obstacle, Utils::nan<float>(), SafetyEval::ObsAvoidanceStrategy::RaiseException,
+                Vector3r::Constant(Utils::nan<float>()), Utils::nan<float>(), Utils::nan<float>(), Utils::nan<float>());
+
+        //unsafe destinations log every evaluation
+        int min_log_level = Utils::getSetMinLogLevel();
+        Utils::getSetMinLogLevel(true, Utils::kLogLevelInfo + 1);
+
+        //moves stay well clear of the boundary at radius - clearance where voxel size could decide
+        const Vector3r position = Vector3r::Zero();
+        bool agree = true, climb_caught = false;
+        string message;
+        for (int direction = 0; direction < 16; ++direction) {
+            float angle = 2 * M_PIf * direction / 16;
+            for (float move : { 0.0f, 1.0f, 3.0f, 5.0f, 7.0f, 7.5f }) {
+                const Vector3r destination(move * std::cos(angle), move * std::sin(angle), 0);
+                bool voxel_safe = voxel_eval.isSafeDestination(destination, position, Quaternionr::Identity()).is_safe;
+                bool ticks_safe = ticks_eval.isSafeDestination(destination, position, Quaternionr::Identity()).is_safe;
+                if (voxel_safe != ticks_safe && agree) {
+                    agree = false;
+                    message = Utils::stringf("move of %f at %f rad is %s with VoxelMap but not with ObstacleMap",
+                        move, angle, voxel_safe ? "safe" : "unsafe");
+                }
+            }
+        }
+        climb_caught = !voxel_eval.isSafeDestination(Vector3r(0, 0, -2), position, Quaternionr::Identity()).is_safe;
+
+        Utils::getSetMinLogLevel(true, min_log_level);
+
+        testAssert(agree, message);
+        testAssert(climb_caught, "climb in to the ceiling was not caught with VoxelMap");
+    }
+};
+
+}}
+#endif
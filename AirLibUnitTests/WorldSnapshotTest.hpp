@@ -0,0 +1,187 @@
+#ifndef msr_AirLibUnitTests_WorldSnapshotTest_hpp
+#define msr_AirLibUnitTests_WorldSnapshotTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "physics/WorldSnapshot.hpp"
+#include "physics/WorldSnapshotSource.hpp"
+#include <random>
+
+namespace msr { namespace airlib {
+
+class WorldSnapshotTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        const uint kinematics = static_cast<uint>(WorldSnapshotFields::Kinematics), collision = static_cast<uint>(WorldSnapshotFields::Collision),
+            imu = static_cast<uint>(WorldSnapshotFields::Imu), gps = static_cast<uint>(WorldSnapshotFields::Gps),
+            barometer = static_cast<uint>(WorldSnapshotFields::Barometer), magnetometer = static_cast<uint>(WorldSnapshotFields::Magnetometer);
+        for (uint fields : { kinematics | gps | magnetometer, collision | imu | barometer, static_cast<uint>(WorldSnapshotFields::All), 0u })
+            testRoundTrip(fields);
+        testRejectsBadInput();
+        testMissingSensors();
+    }
+
+private:
+    //sensor whose output the test sets directly
+    template<typename SensorBaseT>
+    class FixedSensor : public SensorBaseT {
+    public:
+        void set(const typename SensorBaseT::Output& output)
+        {
+            this->setOutput(output);
+        }
+    };
+
+    //bytes of every column in wire order, columns not in the snapshot are empty
+    static vector<vector<uint8_t>> columnBytes(const WorldSnapshot& snapshot)
+    {
+        vector<vector<uint8_t>> columns;
+        WorldSnapshot::forEachColumn(snapshot, [&columns](WorldSnapshotFields group, const auto& column, uint components) {
+            unused(group);
+            unused(components);
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(column.data());
+            columns.push_back(vector<uint8_t>(p, p + column.size() * sizeof(column[0])));
+        });
+        return columns;
+    }
+
+    static WorldSnapshot roundTrip(const WorldSnapshot& snapshot, bool& ok)
+    {
+        vector<uint8_t> data;
+        WorldSnapshotCodec::encode(snapshot, data);
+
+        //decoding in to a snapshot that had other groups must leave only the encoded ones
+        WorldSnapshot decoded;
+        decoded.resize(5, static_cast<uint>(WorldSnapshotFields::All));
+        ok = WorldSnapshotCodec::decode(data.data(), data.size(), decoded);
+        return decoded;
+    }
+
+    //random contents in only the columns of fields survive encoding and decoding unchanged
+    void testRoundTrip(uint fields)
+    {
+        std::mt19937 random(fields);
+        WorldSnapshot snapshot;
+        snapshot.resize(3, fields);
+        snapshot.step = 123456789012ULL;
+        snapshot.timestamp = 987654321098ULL;
+        snapshot.vehicle_names = { "drone1", "", "\xc3\xa9quipe 2" };
+        WorldSnapshot::forEachColumn(snapshot, [&random](WorldSnapshotFields group, auto& column, uint components) {
+            unused(group);
+            unused(components);
+            uint8_t* p = reinterpret_cast<uint8_t*>(column.data());
+            for (size_t i = 0; i < column.size() * sizeof(column[0]); ++i)
+                p[i] = static_cast<uint8_t>(random());
+        });
+
+        vector<uint8_t> data;
+        WorldSnapshotCodec::encode(snapshot, data);
+        size_t expected_size = WorldSnapshotCodec::kHeaderSize;
+        for (const string& name : snapshot.vehicle_names)
+            expected_size += 2 + name.size();
+        for (const auto& column : columnBytes(snapshot))
+            expected_size += column.size();
+        testAssert(data.size() == expected_size, Utils::stringf("snapshot with fields %u encoded to %d bytes instead of %d",
+            fields, static_cast<int>(data.size()), static_cast<int>(expected_size)));
+
+        bool ok;
+        WorldSnapshot decoded = roundTrip(snapshot, ok);
+        testAssert(ok, Utils::stringf("snapshot with fields %u did not decode", fields));
+        testAssert(decoded.fields == fields && decoded.step == snapshot.step && decoded.timestamp == snapshot.timestamp,
+            Utils::stringf("header of snapshot with fields %u changed", fields));
+        testAssert(decoded.vehicle_names == snapshot.vehicle_names, Utils::stringf("names of snapshot with fields %u changed", fields));
+        testAssert(columnBytes(decoded) == columnBytes(snapshot), Utils::stringf("columns of snapshot with fields %u changed", fields));
+    }
+
+    //every truncation and an unknown version are rejected
+    void testRejectsBadInput()
+    {
+        WorldSnapshot snapshot;
+        snapshot.resize(2, static_cast<uint>(WorldSnapshotFields::All));
+        snapshot.vehicle_names = { "a", "bc" };
+        vector<uint8_t> data;
+        WorldSnapshotCodec::encode(snapshot, data);
+
+        WorldSnapshot decoded;
+        for (size_t size = 0; size < data.size(); ++size)
+            testAssert(!WorldSnapshotCodec::decode(data.data(), size, decoded), Utils::stringf("snapshot cut to %d bytes was decoded", static_cast<int>(size)));
+        data[0] ^= 0xFF;
+        testAssert(!WorldSnapshotCodec::decode(data.data(), data.size(), decoded), "snapshot with unknown version was decoded");
+    }
+
+    //vehicles without a sensor, or with GPS but no fix, are not valid in that group and have zero or identity
+    //values, vehicles with it have its output, and the *_valid columns survive encoding
+    void testMissingSensors()
+    {
+        FixedSensor<ImuBase> imu;
+        ImuBase::Output imu_output;
+        imu_output.orientation = Quaternionr(0.5f, 0.5f, -0.5f, 0.5f);
+        imu_output.angular_velocity = Vector3r(0.1f, 0.2f, 0.3f);
+        imu_output.linear_acceleration = Vector3r(0, 0, -9.8f);
+        imu.set(imu_output);
+
+        FixedSensor<GpsBase> gps, gps_no_fix;
+        GpsBase::Output gps_output;
+        gps_output.is_valid = true;
+        gps_output.gnss.geo_point = GeoPoint(47.641468, -122.140165, 122);
+        gps_output.gnss.eph = 0.3f;
+        gps_output.gnss.epv = 0.4f;
+        gps_output.gnss.velocity = Vector3r(1, 2, 3);
+        gps_output.gnss.fix_type = GpsBase::GNSS_FIX_3D_FIX;
+        gps.set(gps_output);
+        gps_output.is_valid = false;
+        gps_no_fix.set(gps_output);
+
+        FixedSensor<BarometerBase> barometer;
+        BarometerBase::Output barometer_output = { 122, 99900, 1013.25f };
+        barometer.set(barometer_output);
+
+        FixedSensor<MagnetometerBase> magnetometer;
+        MagnetometerBase::Output magnetometer_output;
+        magnetometer_output.magnetic_field_body = Vector3r(0.2f, 0.01f, 0.4f);
+        magnetometer.set(magnetometer_output);
+
+        //first vehicle has everything but IMU, second only IMU and GPS without fix, third has no sensors
+        SensorCollection first_sensors, second_sensors;
+        first_sensors.insert(&gps, SensorCollection::SensorType::Gps);
+        first_sensors.insert(&barometer, SensorCollection::SensorType::Barometer);
+        first_sensors.insert(&magnetometer, SensorCollection::SensorType::Magnetometer);
+        second_sensors.insert(&imu, SensorCollection::SensorType::Imu);
+        second_sensors.insert(&gps_no_fix, SensorCollection::SensorType::Gps);
+
+        PhysicsWorld world(nullptr, {}, 3000000LL, false, false);
+        WorldSnapshotSource source(&world);
+        source.addVehicle("first", nullptr, &first_sensors);
+        source.addVehicle("second", nullptr, &second_sensors);
+        source.addVehicle("third", nullptr, nullptr);
+
+        const uint sensor_fields = static_cast<uint>(WorldSnapshotFields::Imu) | static_cast<uint>(WorldSnapshotFields::Gps) |
+            static_cast<uint>(WorldSnapshotFields::Barometer) | static_cast<uint>(WorldSnapshotFields::Magnetometer);
+        WorldSnapshot captured;
+        source.capture(sensor_fields, captured);
+
+        bool ok;
+        const WorldSnapshot snapshot = roundTrip(captured, ok);
+        testAssert(ok && columnBytes(snapshot) == columnBytes(captured), "captured snapshot changed in encoding");
+        testAssert(snapshot.position.empty() && snapshot.has_collided.empty(), "groups that were not asked for have columns");
+
+        testAssert(snapshot.imu_valid == vector<uint8_t>({ 0, 1, 0 }), "imu_valid is wrong");
+        testAssert(snapshot.gps_valid == vector<uint8_t>({ 1, 0, 0 }), "gps_valid is wrong");
+        testAssert(snapshot.barometer_valid == vector<uint8_t>({ 1, 0, 0 }), "barometer_valid is wrong");
+        testAssert(snapshot.magnetometer_valid == vector<uint8_t>({ 1, 0, 0 }), "magnetometer_valid is wrong");
+
+        testAssert(snapshot.imu_orientation == vector<float>({ 1, 0, 0, 0, 0.5f, 0.5f, -0.5f, 0.5f, 1, 0, 0, 0 }), "imu_orientation is wrong");
+        testAssert(snapshot.imu_linear_acceleration == vector<float>({ 0, 0, 0, 0, 0, -9.8f, 0, 0, 0 }), "imu_linear_acceleration is wrong");
+        testAssert(snapshot.gps_geo_point[0] == 47.641468 && snapshot.gps_geo_point[1] == -122.140165 && snapshot.gps_geo_point[2] == 122,
+            "gps_geo_point of vehicle with fix is wrong");
+        testAssert(snapshot.gps_fix_type == vector<uint8_t>({ GpsBase::GNSS_FIX_3D_FIX, GpsBase::GNSS_FIX_NO_FIX, GpsBase::GNSS_FIX_NO_FIX }),
+            "gps_fix_type is wrong");
+        testAssert(snapshot.gps_velocity == vector<float>({ 1, 2, 3, 0, 0, 0, 0, 0, 0 }), "gps_velocity is wrong");
+        testAssert(snapshot.barometer_pressure == vector<float>({ 99900, 0, 0 }), "barometer_pressure is wrong");
+        testAssert(snapshot.magnetic_field_body == vector<float>({ 0.2f, 0.01f, 0.4f, 0, 0, 0, 0, 0, 0 }), "magnetic_field_body is wrong");
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,91 @@
+#ifndef msr_AirLibUnitTests_WorldTest_hpp
+#define msr_AirLibUnitTests_WorldTest_hpp
+
+#include "TestBase.hpp"
+#include "common/Common.hpp"
+#include "common/SteppableClock.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "physics/BatchedFastPhysicsEngine.hpp"
+#include "physics/DebugPhysicsBody.hpp"
+#include <cstring>
+
+namespace msr { namespace airlib {
+
+class WorldTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testParallelUpdate<FastPhysicsEngine>("FastPhysicsEngine");
+        testParallelUpdate<BatchedFastPhysicsEngine>("BatchedFastPhysicsEngine");
+    }
+
+private:
+    //DebugPhysicsBody without printing every step
+    class QuietBody : public DebugPhysicsBody {
+    public:
+        virtual void kinematicsUpdated() override
+        {
+        }
+    };
+
+    //kinematics of bodies that start with different velocities after steps of world update on thread_count threads
+    template<typename Engine>
+    static vector<Kinematics::State> simulate(unsigned int thread_count)
+    {
+        SteppableClock clock(3E-3);
+        ClockFactory::ThreadClockScope clock_scope(&clock);
+
+        const int body_count = 16;
+        vector<unique_ptr<Environment>> environments;
+        vector<unique_ptr<QuietBody>> bodies;
+        Engine engine;
+        World world(&engine);
+        world.setParallelUpdate(thread_count);
+        for (int i = 0; i < body_count; ++i) {
+            Kinematics::State state = Kinematics::State::zero();
+            state.pose.position = Vector3r(10.0f * i, 0, -5);
+            state.twist.linear = Vector3r(0.5f * i, 1, -2);
+            state.twist.angular = Vector3r(0.1f * i, 0.2f, -0.3f);
+            environments.push_back(unique_ptr<Environment>(new Environment(Environment::State(state.pose.position, GeoPoint(47.641468, -122.140165, 122)))));
+            bodies.push_back(unique_ptr<QuietBody>(new QuietBody()));
+            bodies.back()->initialize(state, environments.back().get());
+            world.insert(bodies.back().get());
+        }
+
+        world.reset();
+        for (int step = 0; step < 500; ++step)
+            world.update();
+
+        vector<Kinematics::State> states;
+        for (const auto& body : bodies)
+            states.push_back(body->getKinematics());
+        return states;
+    }
+
+    static bool sameBits(const Vector3r& a, const Vector3r& b)
+    {
+        return std::memcmp(a.data(), b.data(), sizeof(real_T) * 3) == 0;
+    }
+
+    //parallel update gives bit for bit the kinematics of serial update
+    template<typename Engine>
+    void testParallelUpdate(const char* engine_name)
+    {
+        const vector<Kinematics::State> serial = simulate<Engine>(1), parallel = simulate<Engine>(4);
+        for (size_t i = 0; i < serial.size(); ++i) {
+            const Kinematics::State& s = serial[i];
+            const Kinematics::State& p = parallel[i];
+            bool same = sameBits(s.pose.position, p.pose.position)
+                && std::memcmp(s.pose.orientation.coeffs().data(), p.pose.orientation.coeffs().data(), sizeof(real_T) * 4) == 0
+                && sameBits(s.twist.linear, p.twist.linear) && sameBits(s.twist.angular, p.twist.angular)
+                && sameBits(s.accelerations.linear, p.accelerations.linear) && sameBits(s.accelerations.angular, p.accelerations.angular);
+            testAssert(same, Utils::stringf("%s body %d has different kinematics with parallel update", engine_name, static_cast<int>(i)));
+        }
+        //bodies must actually have moved for the comparison to mean anything
+        testAssert(!sameBits(serial.back().pose.position, Vector3r(150, 0, -5)), Utils::stringf("%s bodies did not move", engine_name));
+    }
+};
+
+}}
+#endif
@@ -0,0 +1,193 @@
+#ifndef msr_AirLibUnitTests_ZoneGeoFenceTest_hpp
+#define msr_AirLibUnitTests_ZoneGeoFenceTest_hpp
+
+#include "TestBase.hpp"
+#include "safety/ZoneGeoFence.hpp"
+#include <random>
+#include <algorithm>
+
+namespace msr { namespace airlib {
+
+class ZoneGeoFenceTest : public TestBase {
+public:
+    virtual void run() override
+    {
+        testAgainstBruteForce(true, 300);
+        //sparse enough that long moves get through, so zones missed on the way would show
+        testAgainstBruteForce(false, 30);
+    }
+
+private:
+    static vector<Vector2r> box(float min_x, float min_y, float max_x, float max_y)
+    {
+        return { Vector2r(min_x, min_y), Vector2r(max_x, min_y), Vector2r(max_x, max_y), Vector2r(min_x, max_y) };
+    }
+
+    //a 1km operating area of two squares that share a side and an L shaped area sticking out, all up to 120m above
+    //ground, with no-fly zones of 20 to 100m in it, some only reaching up to some height
+    static vector<ZoneGeoFence::Zone> makeZones(bool with_allowed, int no_fly_zones)
+    {
+        vector<ZoneGeoFence::Zone> zones;
+        if (with_allowed) {
+            const float ceiling = -120;
+            zones.push_back(ZoneGeoFence::Zone(box(0, 0, 500, 1000), ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+            zones.push_back(ZoneGeoFence::Zone(box(500, 0, 1000, 1000), ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+            zones.push_back(ZoneGeoFence::Zone({ Vector2r(1000, 0), Vector2r(1200, 0), Vector2r(1200, 400),
+                Vector2r(1100, 400), Vector2r(1100, 100), Vector2r(1000, 100) }, ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+        }
+
+        std::mt19937 random(17);
+        std::uniform_real_distribution<float> xy(0, 1200), radius(20, 100), height(-150, -20), unit(0, 1);
+        for (int i = 0; i < no_fly_zones; ++i) {
+            const Vector2r center(xy(random), xy(random) * 1000 / 1200);
+            int corners = 3 + i % 6;
+            vector<Vector2r> polygon;
+            for (int corner = 0; corner < corners; ++corner) {
+                float angle = 2 * M_PIf * (corner + 0.8f * unit(random)) / corners;
+                polygon.push_back(center + Vector2r(std::cos(angle), std::sin(angle)) * radius(random));
+            }
+            float top = i % 3 ? -Utils::max<float>() : height(random);
+            zones.push_back(ZoneGeoFence::Zone(polygon, top, Utils::max<float>(), ZoneGeoFence::ZoneType::NoFly));
+        }
+        return zones;
+    }
+
+    //moves of about length from random points around the operating area
+    static void randomMoves(int count, float length, vector<Vector3r>& from, vector<Vector3r>& to)
+    {
+        std::mt19937 random(count + static_cast<int>(length));
+        std::uniform_real_distribution<float> x(-50, 1250), y(-50, 1050), z(-140, 5);
+        std::normal_distribution<float> normal;
+        from.clear();
+        to.clear();
+        for (int i = 0; i < count; ++i) {
+            from.push_back(Vector3r(x(random), y(random), z(random)));
+            Vector3r direction(normal(random), normal(random), 0.1f * normal(random));
+            to.push_back(from.back() + direction.normalized() * length);
+        }
+    }
+
+    static bool isInPolygon(const vector<Vector2r>& polygon, float x, float y)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            if ((polygon[i].y() > y) != (polygon[j].y() > y) &&
+                x < (polygon[j].x() - polygon[i].x()) * (y - polygon[i].y()) / (polygon[j].y() - polygon[i].y()) + polygon[i].x())
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    static bool isInZone(const ZoneGeoFence::Zone& zone, const Vector3r& point)
+    {
+        return point.z() >= zone.min_z && point.z() <= zone.max_z && isInPolygon(zone.polygon, point.x(), point.y());
+    }
+
+    //every zone is tested, without allowed zones the operating area is everywhere
+    static bool isInFence(const vector<ZoneGeoFence::Zone>& zones, const Vector3r& point)
+    {
+        bool in_allowed = true;
+        for (const ZoneGeoFence::Zone& zone : zones) {
+            if (zone.type == ZoneGeoFence::ZoneType::Allowed) {
+                in_allowed = false;
+                break;
+            }
+        }
+        for (const ZoneGeoFence::Zone& zone : zones) {
+            if (isInZone(zone, point)) {
+                if (zone.type == ZoneGeoFence::ZoneType::NoFly)
+                    return false;
+                in_allowed = true;
+            }
+        }
+        return in_allowed;
+    }
+
+    //the segment is in or out of every zone between two points where it crosses a zone boundary, so it
+    //is in the fence if the ends and the middle points between all crossings are
+    static bool isSegmentInFence(const vector<ZoneGeoFence::Zone>& zones, const Vector3r& from, const Vector3r& to)
+    {
+        const Vector3r direction = to - from;
+        vector<float> crossings { 0, 1 };
+        auto cross = [&crossings](float t) {
+            if (t > 0 && t < 1)
+                crossings.push_back(t);
+        };
+        for (const ZoneGeoFence::Zone& zone : zones) {
+            for (float z : { zone.min_z, zone.max_z }) {
+                if (direction.z() != 0)
+                    cross((z - from.z()) / direction.z());
+            }
+            for (size_t i = 0, j = zone.polygon.size() - 1; i < zone.polygon.size(); j = i++) {
+                const Vector2r edge = zone.polygon[i] - zone.polygon[j];
+                const Vector2r offset = zone.polygon[j] - Vector2r(from.x(), from.y());
+                float denominator = direction.x() * edge.y() - direction.y() * edge.x();
+                if (denominator == 0)
+                    continue;
+                float t = (offset.x() * edge.y() - offset.y() * edge.x()) / denominator;
+                float s = (offset.x() * direction.y() - offset.y() * direction.x()) / denominator;
+                if (s >= 0 && s <= 1)
+                    cross(t);
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        if (!isInFence(zones, from) || !isInFence(zones, to))
+            return false;
+        for (size_t i = 0; i + 1 < crossings.size(); ++i) {
+            float t = (crossings[i] + crossings[i + 1]) / 2;
+            if (crossings[i + 1] - crossings[i] > 1E-5f && !isInFence(zones, from + direction * t))
+                return false;
+        }
+        return true;
+    }
+
+    //points, moves of a control step or two, moves across many cells and the batch checkFences against checkFence
+    void testAgainstBruteForce(bool with_allowed, int no_fly_zones)
+    {
+        const vector<ZoneGeoFence::Zone> zones = makeZones(with_allowed, no_fly_zones);
+        ZoneGeoFence fence(0.1f);
+        fence.addZones(zones);
+        testAssert(fence.getZoneCount() == zones.size(), "fence lost zones");
+        const string name = with_allowed ? "allowed and no-fly zones" : "no-fly zones only";
+
+        vector<Vector3r> from, to;
+        uint in_fence_count = 0;
+        randomMoves(500, 30, from, to);
+        for (size_t i = 0; i < from.size(); ++i) {
+            bool expected = isInFence(zones, from[i]);
+            testAssert(fence.isInFence(from[i]) == expected, Utils::stringf("%s: point %d is %s the fence but should not be",
+                name.c_str(), static_cast<int>(i), expected ? "out of" : "in"));
+            in_fence_count += expected ? 1 : 0;
+        }
+        testAssert(in_fence_count > 0 && in_fence_count < from.size(), name + ": points should be partly in the fence");
+
+        //in the dense fence every move across many cells hits a no-fly zone, so those are only tried on the sparse one
+        const vector<float> lengths = with_allowed ? vector<float>{ 2, 30 } : vector<float>{ 2, 30, 1000 };
+        for (float length : lengths) {
+            randomMoves(length > 100 ? 50 : 500, length, from, to);
+            in_fence_count = 0;
+            for (size_t i = 0; i < from.size(); ++i) {
+                bool expected = isSegmentInFence(zones, from[i], to[i]);
+                testAssert(fence.isSegmentInFence(from[i], to[i]) == expected, Utils::stringf("%s: %f m move %d is %s the fence but should not be",
+                    name.c_str(), length, static_cast<int>(i), expected ? "out of" : "in"));
+                in_fence_count += expected ? 1 : 0;
+            }
+            testAssert(in_fence_count > 0 && in_fence_count < from.size(),
+                Utils::stringf("%s: %f m moves should be partly in the fence", name.c_str(), length));
+        }
+
+        randomMoves(200, 0.5f, from, to);
+        vector<ZoneGeoFence::FenceCheck> checks = fence.checkFences(from, to);
+        testAssert(checks.size() == from.size(), name + ": checkFences returned the wrong number of results");
+        for (size_t i = 0; i < from.size(); ++i) {
+            bool in_fence, allow;
+            fence.checkFence(from[i], to[i], in_fence, allow);
+            testAssert(checks[i].in_fence == in_fence && checks[i].allow == allow,
+                Utils::stringf("%s: checkFences differs from checkFence for vehicle %d", name.c_str(), static_cast<int>(i)));
+        }
+    }
+};
+
+}}
+#endif
@@ -5,6 +5,20 @@
 #include "SimpleFlightTest.hpp"
 #include "WorkerThreadTest.hpp"
 #include "QuaternionTest.hpp"
+#include "DroneTelemetryTest.hpp"
+#include "OffboardSetpointTest.hpp"
+#include "ObstacleMapTest.hpp"
+#include "VoxelMapTest.hpp"
+#include "SafetyEvalTest.hpp"
+#include "ArcLengthPathTest.hpp"
+#include "ZoneGeoFenceTest.hpp"
+#include "CascadeControllerTest.hpp"
+#include "ImageEncoderTest.hpp"
+#include "GaussianNoiseStreamTest.hpp"
+#include "SensorCollectionTest.hpp"
+#include "DelayLineTest.hpp"
+#include "WorldSnapshotTest.hpp"
+#include "WorldTest.hpp"
 
 int main()
 {
@@ -12,6 +26,21 @@ int main()
 
     std::unique_ptr<TestBase> tests[] = {
         std::unique_ptr<TestBase>(new SettingsTest()),
+        std::unique_ptr<TestBase>(new DroneTelemetryTest()),
+        std::unique_ptr<TestBase>(new OffboardSetpointTest()),
+        std::unique_ptr<TestBase>(new ObstacleMapTest()),
+        std::unique_ptr<TestBase>(new VoxelMapTest()),
+        std::unique_ptr<TestBase>(new SafetyEvalTest()),
+        std::unique_ptr<TestBase>(new ArcLengthPathTest()),
+        std::unique_ptr<TestBase>(new ZoneGeoFenceTest()),
+        std::unique_ptr<TestBase>(new CascadeControllerTest()),
+        std::unique_ptr<TestBase>(new ImageEncoderTest()),
+        std::unique_ptr<TestBase>(new GaussianNoiseStreamTest()),
+        std::unique_ptr<TestBase>(new SensorCollectionTest()),
+        std::unique_ptr<TestBase>(new DelayLineTest()),
+        std::unique_ptr<TestBase>(new WorldSnapshotTest()),
+        std::unique_ptr<TestBase>(new WorldTest()),
+        //keeps flying until the process is stopped, so it goes last
         std::unique_ptr<TestBase>(new SimpleFlightTest())
         //,
         //std::unique_ptr<TestBase>(new PixhawkTest()),
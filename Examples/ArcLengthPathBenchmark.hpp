@@ -0,0 +1,162 @@
+#pragma once
+
+#include "vehicles/multirotor/controllers/ArcLengthPath.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+namespace msr { namespace airlib {
+
+//Follows a survey pattern with thousands of waypoints like moveOnPath does, once with ArcLengthPath and once
+//with a copy of the segment walk moveOnPath had before, and compares the time. ArcLengthPathTest checks the lookups.
+class ArcLengthPathBenchmark {
+public:
+    ArcLengthPathBenchmark(int waypoints = 10000)
+        : waypoints_(survey(waypoints))
+    {
+    }
+
+    void run(int lookups = 100000)
+    {
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << waypoints_.size() << " waypoints" << std::endl;
+        timeFollow();
+        timeLookups(lookups);
+    }
+
+private:
+    //lawnmower pattern, 100m legs 5m apart with a waypoint every 2m and some noise like from a planner
+    static vector<Vector3r> survey(int count)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+        vector<Vector3r> points;
+        for (int i = 0; i < count; ++i) {
+            int leg = i / 50, step = i % 50;
+            float x = leg % 2 ? 100 - 2.0f * step : 2.0f * step;
+            points.push_back(Vector3r(x + noise(random), 5.0f * leg + noise(random), -10 + noise(random)));
+        }
+        return points;
+    }
+
+    //what moveOnPath used before, segments are walked from the current one
+    struct Segment {
+        Vector3r normalized;
+        float length;
+    };
+    struct SegmentPosition {
+        uint index;
+        float offset;
+        Vector3r position;
+    };
+
+    static vector<Segment> makeSegments(const vector<Vector3r>& path)
+    {
+        vector<Segment> segments;
+        for (uint i = 0; i + 1 < path.size(); ++i) {
+            const Vector3r segment = path[i + 1] - path[i];
+            segments.push_back(Segment{ segment.normalized(), segment.norm() });
+        }
+        segments.push_back(Segment{ Vector3r::Zero(), 0 });
+        return segments;
+    }
+
+    static void walk(const vector<Vector3r>& path, const vector<Segment>& segments, const SegmentPosition& cur, float next_dist, SegmentPosition& next)
+    {
+        uint i = cur.index;
+        float offset = cur.offset;
+        while (i < path.size() - 1) {
+            const Segment& segment = segments[i];
+            if (segment.length > 0 && segment.length >= next_dist + offset) {
+                next.index = i;
+                next.offset = next_dist + offset;
+                next.position = path[i] + segment.normalized * next.offset;
+                return;
+            }
+            next_dist -= segment.length - offset;
+            offset = 0;
+            ++i;
+        }
+        next.index = i;
+        next.offset = 0;
+        next.position = path[i];
+    }
+
+    //moveOnPath steps: current position moves 0.25m and the goal is looked up 4m ahead of it
+    void timeFollow() const
+    {
+        const float step = 0.25f, lookahead = 4;
+        float sum = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        vector<Vector3r> path3d(waypoints_);
+        const vector<Segment> segments = makeSegments(path3d);
+        SegmentPosition cur{ 0, 0, path3d[0] }, next;
+        walk(path3d, segments, cur, lookahead, next);
+        int steps = 0;
+        while (next.index < path3d.size() - 1) {
+            walk(path3d, segments, cur, step, cur);
+            walk(path3d, segments, cur, lookahead, next);
+            sum += next.position.x();
+            ++steps;
+        }
+        double walk_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ArcLengthPath path;
+        path.append(waypoints_);
+        ArcLengthPath::Location cur_loc = path.locate(0), next_loc = path.locate(lookahead);
+        while (next_loc.distance < path.getLength()) {
+            cur_loc = path.locate(cur_loc.distance + step, cur_loc);
+            next_loc = path.locate(cur_loc.distance + lookahead, cur_loc);
+            sum += next_loc.position.x();
+        }
+        double arc_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink_ = sink_ + sum;
+
+        std::cout << "following " << steps << " steps: segment walk " << walk_elapsed * 1E9 / steps << " ns/step, ArcLengthPath "
+            << arc_elapsed * 1E9 / steps << " ns/step" << std::endl;
+    }
+
+    //lookups anywhere on the path, like after an append redrew it or a goal far ahead
+    void timeLookups(int lookups) const
+    {
+        ArcLengthPath path;
+        path.append(waypoints_);
+        const vector<Segment> segments = makeSegments(waypoints_);
+        const SegmentPosition start{ 0, 0, waypoints_[0] };
+
+        std::mt19937 random(13);
+        std::uniform_real_distribution<float> distance(0, path.getLength());
+        vector<float> distances;
+        for (int i = 0; i < lookups; ++i)
+            distances.push_back(distance(random));
+
+        float sum = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (float s : distances)
+            sum += path.locate(s).position.x();
+        double arc_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        //the walk is so slow that a hundredth of the lookups is plenty
+        int walks = std::max(1, lookups / 100);
+        begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < walks; ++i) {
+            SegmentPosition position;
+            walk(waypoints_, segments, start, distances[i], position);
+            sum += position.position.x();
+        }
+        double walk_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        sink_ = sink_ + sum;
+
+        std::cout << "random lookups: segment walk " << walk_elapsed * 1E9 / walks << " ns, ArcLengthPath "
+            << arc_elapsed * 1E9 / lookups << " ns" << std::endl;
+    }
+
+    vector<Vector3r> waypoints_;
+    //results end up here so the compiler can't drop the lookups
+    mutable volatile float sink_ = 0;
+};
+
+}}
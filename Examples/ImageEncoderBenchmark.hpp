@@ -0,0 +1,148 @@
+#pragma once
+
+#include "controllers/ImageEncoder.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+namespace msr { namespace airlib {
+
+//Runs the simGetImages encoder stage without the simulator. Synthetic cameras return scene and depth
+//images that look roughly like a rendered frame (gradients, edges and a bit of noise), every encoding
+//is timed with encoding on the calling thread and on the encoder pool.
+class ImageEncoderBenchmark {
+public:
+    ImageEncoderBenchmark(unsigned int camera_count = 10, int width = 640, int height = 480)
+    {
+        for (unsigned int i = 0; i < camera_count; ++i)
+            cameras_.emplace_back(width, height, i);
+    }
+
+    void run(unsigned int frames = 20)
+    {
+        ImageEncoder serial(0);
+        ImageEncoder parallel;
+        std::cout << cameras_.size() << " cameras, " << parallel.getThreadCount() << " encoder threads" << std::endl;
+
+        const struct {
+            const char* name;
+            ImageEncoding encoding;
+            bool compress;
+        } cases[] = {
+            { "raw", ImageEncoding::Raw, false },
+            { "camera png", ImageEncoding::Default, true },
+            { "png fast", ImageEncoding::PngFast, false },
+            { "lz4", ImageEncoding::Lz4, false },
+            { "depth u16", ImageEncoding::DepthU16, false }
+        };
+        for (const auto& item : cases) {
+            vector<ImageRequest> request;
+            for (unsigned int i = 0; i < cameras_.size(); ++i) {
+                bool depth = item.encoding == ImageEncoding::DepthU16 || i % 2 == 1;
+                request.push_back(ImageRequest(static_cast<uint8_t>(i),
+                    depth ? ImageType::DepthPlanner : ImageType::Scene, depth, item.compress, item.encoding));
+            }
+
+            Result serial_result = measure(serial, request, frames);
+            Result parallel_result = measure(parallel, request, frames);
+            std::cout << std::setw(10) << item.name << ": " << std::fixed << std::setprecision(2)
+                << serial_result.frame_ms << " ms serial, " << parallel_result.frame_ms << " ms parallel, "
+                << serial_result.frame_ms / parallel_result.frame_ms << "x, size "
+                << std::setprecision(3) << parallel_result.size_ratio << " of raw" << std::endl;
+        }
+    }
+
+private:
+    typedef VehicleCameraBase::ImageRequest ImageRequest;
+    typedef VehicleCameraBase::ImageResponse ImageResponse;
+    typedef VehicleCameraBase::ImageType ImageType;
+    typedef VehicleCameraBase::ImageEncoding ImageEncoding;
+
+    class SyntheticCamera : public VehicleCameraBase {
+    public:
+        SyntheticCamera(int width, int height, unsigned int seed)
+            : width_(width), height_(height)
+        {
+            //the frames are made once so the benchmark measures encoding, not image generation
+            scene_.resize(width * height * 4);
+            depth_.resize(width * height);
+            unsigned int noise = seed * 2654435761u + 1;
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    noise = noise * 1664525u + 1013904223u;
+                    int pixel = y * width + x;
+                    bool sky = y < height / 3 + static_cast<int>(20 * std::sin(x * 0.02f + seed));
+                    bool box = (x / 80 + y / 60 + static_cast<int>(seed)) % 5 == 0;
+                    uint8_t jitter = static_cast<uint8_t>((noise >> 24) & 7);
+
+                    scene_[pixel * 4 + 0] = sky ? 120 : static_cast<uint8_t>(box ? 200 : 60 + (x >> 3) + jitter);
+                    scene_[pixel * 4 + 1] = sky ? 170 : static_cast<uint8_t>(box ? 40 : 90 + (y >> 3) + jitter);
+                    scene_[pixel * 4 + 2] = sky ? static_cast<uint8_t>(230 - y / 8) : static_cast<uint8_t>(50 + jitter);
+                    scene_[pixel * 4 + 3] = 255;
+
+                    //ground plane getting farther towards the horizon, boxes in front of it, sky at max range
+                    float ground = 2.0f + 400.0f / std::max(1.0f, 1.0f + y - height / 3.0f);
+                    depth_[pixel] = sky ? 1000.0f : (box ? 5.0f + 0.01f * x : ground);
+                }
+            }
+        }
+
+        virtual ImageResponse getImage(ImageType image_type, bool pixels_as_float, bool compress) override
+        {
+            ImageResponse response;
+            response.image_type = image_type;
+            response.pixels_as_float = pixels_as_float;
+            response.compress = compress;
+            response.width = width_;
+            response.height = height_;
+            if (pixels_as_float)
+                response.image_data_float = depth_;
+            else if (compress)
+                common_utils::PngEncoder::encode(scene_.data(), width_, height_, 4, 8, response.image_data_uint8);
+            else
+                response.image_data_uint8 = scene_;
+            return response;
+        }
+
+    private:
+        int width_, height_;
+        vector<uint8_t> scene_;
+        vector<float> depth_;
+    };
+
+    struct Result {
+        double frame_ms;
+        double size_ratio;
+    };
+
+    Result measure(ImageEncoder& encoder, const vector<ImageRequest>& request, unsigned int frames)
+    {
+        auto get_camera = [this](uint8_t camera_id) -> VehicleCameraBase* { return &cameras_.at(camera_id); };
+
+        //warm up the pool and the allocator
+        encoder.getImages(request, get_camera);
+
+        size_t raw_size = 0, encoded_size = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int frame = 0; frame < frames; ++frame) {
+            vector<ImageResponse> response = encoder.getImages(request, get_camera);
+            for (const auto& image : response) {
+                //RGBA and float depth are both 4 bytes per pixel uncompressed
+                raw_size += static_cast<size_t>(image.width) * image.height * 4;
+                encoded_size += image.image_data_uint8.size() + image.image_data_float.size() * sizeof(float);
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Result result;
+        result.frame_ms = elapsed * 1000 / frames;
+        result.size_ratio = raw_size == 0 ? 0 : static_cast<double>(encoded_size) / raw_size;
+        return result;
+    }
+
+private:
+    vector<SyntheticCamera> cameras_;
+};
+
+}}
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "safety/ObstacleMap.hpp"
+#include "safety/SafetyEval.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+namespace msr { namespace airlib {
+
+//Compares ObstacleMap with the earlier implementation that locked one mutex for every update and query
+//and scanned windows tick by tick. A writer thread feeds full scans like a many beam rangefinder, or one
+//beam at a time like a spinning one, while reader threads query like SafetyEval.
+//Also times windows around every tick from getWindowObstacles and destinations scored by
+//SafetyEval::isSafeDestinations against the same done one call at a time. ObstacleMapTest and
+//SafetyEvalTest in AirLibUnitTests check that all of these agree.
+class ObstacleMapBenchmark {
+public:
+    ObstacleMapBenchmark(int ticks = 1024)
+        : ticks_(ticks)
+    {
+    }
+
+    void run(float seconds = 1, unsigned int reader_count = 2)
+    {
+        ObstacleMap map(ticks_);
+        ReferenceMap reference(ticks_);
+        std::cout << std::fixed << std::setprecision(1) << ticks_ << " ticks" << std::endl
+            << "getClosestObstacle: " << timeQueries(map, 0) << " ns, reference " << timeQueries(reference, 0) << " ns" << std::endl
+            << "hasObstacle(61 ticks): " << timeQueries(map, 30) << " ns, reference " << timeQueries(reference, 30) << " ns" << std::endl;
+
+        for (bool per_beam : { false, true }) {
+            Concurrent result = runConcurrent(map, seconds, reader_count, per_beam);
+            Concurrent reference_result = runConcurrent(reference, seconds, reader_count, per_beam);
+            std::cout << (per_beam ? "per beam updates" : "full scan updates") << " with " << reader_count << " readers: "
+                << result.updates_per_sec << " updates/s (p99 " << result.p99_update_ns << " ns, max " << result.max_update_us << " us), "
+                << result.queries_per_sec << " queries/s" << std::endl
+                << "reference: " << reference_result.updates_per_sec << " updates/s (p99 " << reference_result.p99_update_ns
+                << " ns, max " << reference_result.max_update_us << " us), " << reference_result.queries_per_sec << " queries/s" << std::endl;
+        }
+
+        for (int window : { 0, 5, 50 }) {
+            WindowTimes times = timeWindows(window);
+            std::cout << "window +/-" << window << " around all ticks: " << times.sliding_us << " us, hasObstacle per tick "
+                << times.per_tick_us << " us" << std::endl;
+        }
+        timeSafetyEval(256);
+    }
+
+private:
+    //earlier implementation, kept as baseline
+    class ReferenceMap {
+    public:
+        ReferenceMap(int ticks)
+            : distances_(ticks, Utils::max<float>() / 2), confidences_(ticks, 1), ticks_(ticks)
+        {
+        }
+
+        void update(float distances[], float confidences[])
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::copy(distances, distances + ticks_, distances_.begin());
+            std::copy(confidences, confidences + ticks_, confidences_.begin());
+        }
+
+        void update(float distance, int tick, int window, float confidence)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int i = tick - window; i <= tick + window; ++i) {
+                distances_[wrap(i)] = distance;
+                confidences_[wrap(i)] = confidence;
+            }
+        }
+
+        ObstacleMap::ObstacleInfo hasObstacle(int from_tick, int to_tick)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (from_tick > to_tick) {
+                from_tick = wrap(from_tick);
+                to_tick = wrap(to_tick);
+                if (from_tick > to_tick)
+                    to_tick += ticks_;
+            }
+
+            ObstacleMap::ObstacleInfo obs;
+            obs.tick = wrap(from_tick);
+            obs.distance = Utils::max<float>();
+            obs.confidence = 0;
+            for (int i = from_tick; i <= to_tick; ++i) {
+                int iw = wrap(i);
+                if (obs.distance > distances_[iw]) {
+                    obs.tick = iw;
+                    obs.distance = distances_[iw];
+                    obs.confidence = confidences_[iw];
+                }
+            }
+            return obs;
+        }
+
+        ObstacleMap::ObstacleInfo getClosestObstacle()
+        {
+            return hasObstacle(0, ticks_ - 1);
+        }
+
+    private:
+        int wrap(int tick) const
+        {
+            int iw = tick % ticks_;
+            return iw < 0 ? ticks_ + iw : iw;
+        }
+
+        vector<float> distances_, confidences_;
+        int ticks_;
+        std::mutex mutex_;
+    };
+
+    struct Concurrent {
+        double updates_per_sec;
+        double queries_per_sec;
+        double max_update_us;
+        //on a busy machine the max is mostly the writer losing its time slice
+        double p99_update_ns;
+    };
+
+    void makeScan(std::mt19937& random, vector<float>& distances, vector<float>& confidences) const
+    {
+        //mostly far away with a few close obstacles and repeated distances to exercise ties
+        std::uniform_real_distribution<float> far(20, 100);
+        std::uniform_int_distribution<int> pick(0, 99);
+        for (int i = 0; i < ticks_; ++i) {
+            int kind = pick(random);
+            distances[i] = kind < 3 ? 1.0f + kind : (kind < 6 ? 10.0f : far(random));
+            confidences[i] = 0.5f + 0.005f * kind;
+        }
+    }
+
+    struct WindowTimes {
+        double sliding_us;
+        double per_tick_us;
+    };
+
+    WindowTimes timeWindows(int window) const
+    {
+        std::mt19937 random(17);
+        vector<float> distances(ticks_), confidences(ticks_);
+        makeScan(random, distances, confidences);
+        ObstacleMap map(ticks_);
+        map.update(distances.data(), confidences.data());
+
+        const int repeats = 200;
+        vector<ObstacleMap::ObstacleInfo> obstacles;
+        float sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            map.getWindowObstacles(window, obstacles);
+            sum += obstacles[i % ticks_].distance;
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            for (int tick = 0; tick < ticks_; ++tick)
+                obstacles[tick] = map.hasObstacle(tick - window, tick + window);
+            sum += obstacles[i % ticks_].distance;
+        }
+        auto end = std::chrono::steady_clock::now();
+        sink_ = sink_ + sum;
+
+        WindowTimes times;
+        times.sliding_us = std::chrono::duration<double, std::micro>(middle - start).count() / repeats;
+        times.per_tick_us = std::chrono::duration<double, std::micro>(end - middle).count() / repeats;
+        return times;
+    }
+
+    //scores destinations on a circle around the vehicle with and without batching
+    void timeSafetyEval(int destination_count) const
+    {
+        std::mt19937 random(19);
+        vector<float> distances(ticks_), confidences(ticks_, 1);
+        vector<float> unused_confidences(ticks_);
+        makeScan(random, distances, unused_confidences);
+        for (float& distance : distances)
+            distance /= 10;
+        auto map = std::make_shared<ObstacleMap>(ticks_);
+        map->update(distances.data(), confidences.data());
+
+        VehicleParams params;
+        params.obs_window = 5;
+        //only obstacles are checked so no fence is needed
+        SafetyEval safety_eval(params, nullptr, map);
+        safety_eval.setSafety(SafetyEval::SafetyViolationType_::Obstacle, Utils::nan<float>(), SafetyEval::ObsAvoidanceStrategy::RaiseException,
+            Vector3r::Constant(Utils::nan<float>()), Utils::nan<float>(), Utils::nan<float>(), Utils::nan<float>());
+
+        vector<Vector3r> destinations;
+        for (int i = 0; i < destination_count; ++i) {
+            float angle = 2 * M_PIf * i / destination_count;
+            destinations.push_back(Vector3r(3 * std::cos(angle), 3 * std::sin(angle), 0));
+        }
+        const Vector3r position = Vector3r::Zero();
+        const Quaternionr orientation = Quaternionr::Identity();
+
+        //unsafe destinations log every evaluation
+        int min_log_level = Utils::getSetMinLogLevel();
+        Utils::getSetMinLogLevel(true, Utils::kLogLevelInfo + 1);
+
+        auto start = std::chrono::steady_clock::now();
+        vector<SafetyEval::EvalResult> batch = safety_eval.isSafeDestinations(destinations, position, orientation);
+        auto middle = std::chrono::steady_clock::now();
+        vector<SafetyEval::EvalResult> single;
+        for (const Vector3r& destination : destinations)
+            single.push_back(safety_eval.isSafeDestination(destination, position, orientation));
+        auto end = std::chrono::steady_clock::now();
+
+        Utils::getSetMinLogLevel(true, min_log_level);
+
+        unsigned int safe_count = 0;
+        for (size_t i = 0; i < destinations.size(); ++i)
+            safe_count += batch[i].is_safe && single[i].is_safe ? 1 : 0;
+        std::cout << destination_count << " destinations (" << safe_count << " safe): isSafeDestinations "
+            << std::chrono::duration<double, std::micro>(middle - start).count() << " us, isSafeDestination each "
+            << std::chrono::duration<double, std::micro>(end - middle).count() << " us" << std::endl;
+    }
+
+    template<typename TMap>
+    double timeQueries(TMap& map, int window) const
+    {
+        std::mt19937 random(7);
+        vector<float> distances(ticks_), confidences(ticks_);
+        makeScan(random, distances, confidences);
+        map.update(distances.data(), confidences.data());
+
+        const int queries = 20000;
+        float sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i) {
+            //windows walk around the circle so some of them wrap
+            int tick = (i * 37) % ticks_;
+            sum += window == 0 ? map.getClosestObstacle().distance : map.hasObstacle(tick - window, tick + window).distance;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink_ = sink_ + sum;
+        return elapsed * 1E9 / queries;
+    }
+
+    template<typename TMap>
+    Concurrent runConcurrent(TMap& map, float seconds, unsigned int reader_count, bool per_beam) const
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> queries(0);
+        vector<std::thread> readers;
+        for (unsigned int reader = 0; reader < reader_count; ++reader) {
+            readers.emplace_back([&map, &stop, &queries, reader, this]() {
+                uint64_t count = 0;
+                float sum = 0;
+                for (int i = 0; !stop; ++i, ++count) {
+                    int tick = (i * 37 + static_cast<int>(reader) * 101) % ticks_;
+                    if (i % 4 == 0)
+                        sum += map.getClosestObstacle().distance;
+                    else
+                        sum += map.hasObstacle(tick - 30, tick + 30).distance;
+                }
+                queries += count;
+                sink_ = sink_ + sum;
+            });
+        }
+
+        std::mt19937 random(11);
+        vector<float> distances(ticks_), confidences(ticks_);
+        makeScan(random, distances, confidences);
+        uint64_t updates = 0;
+        double max_update_us = 0;
+        vector<float> update_ns;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < seconds) {
+            //a beam covers a few ticks and sweeps the circle
+            auto update_start = std::chrono::steady_clock::now();
+            if (per_beam) {
+                int tick = static_cast<int>(updates % ticks_);
+                map.update(distances[tick], tick, 2, confidences[tick]);
+            }
+            else
+                map.update(distances.data(), confidences.data());
+            auto update_end = std::chrono::steady_clock::now();
+
+            double duration_us = std::chrono::duration<double, std::micro>(update_end - update_start).count();
+            max_update_us = std::max(max_update_us, duration_us);
+            update_ns.push_back(static_cast<float>(duration_us * 1000));
+            elapsed = std::chrono::duration<double>(update_end - start).count();
+            ++updates;
+        }
+        stop = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        Concurrent result;
+        result.updates_per_sec = updates / elapsed;
+        result.queries_per_sec = queries / elapsed;
+        result.max_update_us = max_update_us;
+        auto p99 = update_ns.begin() + update_ns.size() * 99 / 100;
+        std::nth_element(update_ns.begin(), p99, update_ns.end());
+        result.p99_update_ns = *p99;
+        return result;
+    }
+
+private:
+    int ticks_;
+    //query results end up here so the compiler can't drop the queries
+    mutable volatile float sink_ = 0;
+};
+
+}}
@@ -44,5 +44,5 @@ public:
         orientation = VectorMath::toQuaternion(pitch, roll, yaw);
     }
 private:
-    RandomGeneratorGaussianF rand_xy_, rand_z_, rand_pitch_, rand_yaw_, rand_roll_;
+    RandomGeneratorGaussianF rand_xy_, rand_z_, rand_pitch_, rand_roll_, rand_yaw_;
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "vehicles/multirotor/api/MultirotorRpcLibClient.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+namespace msr { namespace airlib {
+
+//Compares blocking RPC calls with pipelined *Async calls against a running simulator.
+//Each round reads position, velocity, orientation and pose and sets the pose back, like a mission runner
+//does every frame. Blocking mode pays a round trip per call, pipelined mode sends the whole round and waits once.
+class RpcPipelineBenchmark {
+public:
+    RpcPipelineBenchmark(const std::string& ip_address = "localhost", uint16_t port = 41451)
+        : client_(ip_address, port)
+    {
+    }
+
+    void run(unsigned int rounds = 1000)
+    {
+        client_.confirmConnection();
+        pose_ = client_.simGetPose();
+
+        //warm up connection and server threads
+        runBlocking(10);
+
+        Result blocking = runBlocking(rounds);
+        Result pipelined = runPipelined(rounds);
+
+        report("blocking", blocking);
+        report("pipelined", pipelined);
+        std::cout << "round latency gain: " << blocking.round_ms / pipelined.round_ms << "x, "
+            << "throughput gain: " << pipelined.calls_per_sec / blocking.calls_per_sec << "x" << std::endl;
+    }
+
+private:
+    static constexpr unsigned int kCallsPerRound = 5;
+
+    struct Result {
+        double round_ms;
+        double calls_per_sec;
+    };
+
+    Result runBlocking(unsigned int rounds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < rounds; ++i) {
+            client_.getPosition();
+            client_.getVelocity();
+            client_.getOrientation();
+            client_.simGetPose();
+            client_.simSetPose(pose_, false);
+        }
+        return toResult(start, rounds);
+    }
+
+    Result runPipelined(unsigned int rounds)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < rounds; ++i) {
+            RpcLibCallBatch batch;
+            batch.add(client_.getPositionAsync());
+            batch.add(client_.getVelocityAsync());
+            batch.add(client_.getOrientationAsync());
+            batch.add(client_.simGetPoseAsync());
+            batch.add(client_.simSetPoseAsync(pose_, false));
+            batch.wait();
+        }
+        return toResult(start, rounds);
+    }
+
+    static Result toResult(std::chrono::steady_clock::time_point start, unsigned int rounds)
+    {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Result result;
+        result.round_ms = elapsed * 1000 / rounds;
+        result.calls_per_sec = rounds * kCallsPerRound / elapsed;
+        return result;
+    }
+
+    static void report(const char* name, const Result& result)
+    {
+        std::cout << std::setw(10) << name << ": " << std::fixed << std::setprecision(3)
+            << result.round_ms << " ms per round of " << kCallsPerRound << " calls, "
+            << std::setprecision(0) << result.calls_per_sec << " calls/sec" << std::endl;
+    }
+
+private:
+    MultirotorRpcLibClient client_;
+    Pose pose_;
+};
+
+}}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "vehicles/multirotor/firmwares/simple_flight/firmware/Firmware.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+namespace msr { namespace airlib {
+
+//Runs simple_flight's firmware loop against a minimal board and a vertical point mass, without physics
+//engine or simulator. Measures update throughput of Firmware with a steady velocity goal and with a client
+//that keeps switching between velocity and position goals, and how far altitude drifts at those switches
+//with and without bumpless transfer of the PID integrals.
+class SimpleFlightBenchmark {
+public:
+    void run(unsigned int updates = 200000)
+    {
+        simple_flight::Params params;
+        params.rc.allow_api_always = true;
+
+        const struct {
+            const char* name;
+            unsigned int switch_every;
+        } cases[] = {
+            { "steady velocity goal", 0 },
+            { "switch every 50 updates", 50 },
+            { "switch every update", 1 }
+        };
+        std::cout << std::fixed << std::setprecision(3);
+        for (const auto& item : cases) {
+            Result result = measureBest(params, updates, item.switch_every);
+            std::cout << std::setw(24) << item.name << ": " << result.update_us << " us/update" << std::endl;
+        }
+
+        Result switching = measure(params, updates, 50);
+        params.bumpless_mode_switch = false;
+        Result switching_bump = measure(params, updates, 50);
+        std::cout << "altitude drift with switches every 50 updates: "
+            << switching.max_z_error << " m bumpless, " << switching_bump.max_z_error << " m without" << std::endl;
+    }
+
+private:
+    typedef simple_flight::Axis3r Axis3r;
+    typedef simple_flight::Axis4r Axis4r;
+    typedef simple_flight::GoalMode GoalMode;
+    typedef simple_flight::GeoPoint GeoPoint;
+
+    //the clock advances one physics step per update so PIDs see the same dt as in the simulator
+    class Board : public simple_flight::IBoard {
+    public:
+        void step(uint64_t step_micros)
+        {
+            micros_ += step_micros;
+        }
+        float getOutput(uint16_t index) const
+        {
+            return outputs_[index];
+        }
+
+        virtual uint64_t micros() const override
+        {
+            return micros_;
+        }
+        virtual uint64_t millis() const override
+        {
+            return micros_ / 1000;
+        }
+        virtual float readChannel(uint16_t index) const override
+        {
+            unused(index);
+            return 0;
+        }
+        virtual bool isRcConnected() const override
+        {
+            return false;
+        }
+        virtual void writeOutput(uint16_t index, float val) override
+        {
+            outputs_[index % 8] = val;
+        }
+        virtual void setLed(uint8_t index, int32_t color) override
+        {
+            unused(index);
+            unused(color);
+        }
+        virtual void readAccel(float accel[3]) const override
+        {
+            accel[0] = accel[1] = 0;
+            accel[2] = -9.81f;
+        }
+        virtual void readGyro(float gyro[3]) const override
+        {
+            gyro[0] = gyro[1] = gyro[2] = 0;
+        }
+
+    private:
+        uint64_t micros_ = 0;
+        float outputs_[8] = {};
+    };
+
+    class CommLink : public simple_flight::ICommLink {
+    public:
+        virtual void log(const std::string& message, int32_t log_level) override
+        {
+            unused(message);
+            unused(log_level);
+        }
+    };
+
+    //level vehicle that only moves vertically, hovers at kHoverThrottle
+    class StateEstimator : public simple_flight::IStateEstimator {
+    public:
+        static constexpr float kHoverThrottle = 0.6f;
+
+        void step(float throttle, float dt)
+        {
+            float accel = 9.81f * (1 - throttle / kHoverThrottle); //NED, +z is down
+            velocity_z_ += accel * dt;
+            z_ += velocity_z_ * dt;
+        }
+        float getZ() const
+        {
+            return z_;
+        }
+
+        virtual Axis3r getAngles() const override
+        {
+            return Axis3r();
+        }
+        virtual Axis3r getAngulerVelocity() const override
+        {
+            return Axis3r();
+        }
+        virtual Axis3r getPosition() const override
+        {
+            return Axis3r(0, 0, z_);
+        }
+        virtual Axis3r getLinearVelocity() const override
+        {
+            return Axis3r(0, 0, velocity_z_);
+        }
+        virtual Axis4r getOrientation() const override
+        {
+            return Axis4r(1, 0, 0, 0);
+        }
+        virtual GeoPoint getGeoPoint() const override
+        {
+            //arming needs a valid home point
+            GeoPoint geo_point;
+            geo_point.latitude = 47.641468;
+            geo_point.longitude = -122.140165;
+            geo_point.altiude = 122 - z_;
+            return geo_point;
+        }
+        virtual void setHomeGeoPoint(const GeoPoint& geo_point) override
+        {
+            home_ = geo_point;
+        }
+        virtual GeoPoint getHomeGeoPoint() const override
+        {
+            return home_;
+        }
+        virtual Axis3r transformToBodyFrame(const Axis3r& world_frame_val) const override
+        {
+            return world_frame_val;
+        }
+
+    private:
+        float z_ = -10, velocity_z_ = 0;
+        GeoPoint home_;
+    };
+
+    struct Result {
+        double update_us;
+        float max_z_error;
+    };
+
+    //timings on a busy machine are noisy, so the fastest of a few runs is reported
+    Result measureBest(const simple_flight::Params& params, unsigned int updates, unsigned int switch_every)
+    {
+        Result best = measure(params, updates, switch_every);
+        for (int run = 1; run < 3; ++run) {
+            Result result = measure(params, updates, switch_every);
+            if (result.update_us < best.update_us)
+                best = result;
+        }
+        return best;
+    }
+
+    //holds altitude, alternating between velocity and position goal every switch_every updates (0 = never)
+    Result measure(const simple_flight::Params& params, unsigned int updates, unsigned int switch_every)
+    {
+        static constexpr uint64_t kStepMicros = 3000;
+
+        Board board;
+        CommLink comm_link;
+        StateEstimator state_estimator;
+        simple_flight::Firmware firmware(&params, &board, &comm_link, &state_estimator);
+        firmware.reset();
+
+        std::string message;
+        firmware.offboardApi().requestApiControl(message);
+        firmware.offboardApi().arm(message);
+
+        const Axis4r velocity_goal(0, 0, 0, 0);
+        Axis4r position_goal;
+        float start_z = 0, max_z_error = 0;
+
+        //let the velocity PID settle at hover throttle before timing
+        const unsigned int settle_updates = 5000;
+        std::chrono::steady_clock::time_point start;
+        for (unsigned int i = 0; i < settle_updates + updates; ++i) {
+            if (i == settle_updates) {
+                start_z = state_estimator.getZ();
+                position_goal = Axis4r(0, 0, 0, start_z);
+                start = std::chrono::steady_clock::now();
+            }
+
+            bool position = switch_every > 0 && i >= settle_updates && ((i - settle_updates) / switch_every) % 2 == 1;
+            firmware.offboardApi().setGoalAndMode(position ? &position_goal : &velocity_goal,
+                position ? &GoalMode::getPositionMode() : &GoalMode::getVelocityMode(), message);
+            firmware.update();
+
+            board.step(kStepMicros);
+            state_estimator.step(board.getOutput(0), kStepMicros * 1E-6f);
+            if (i >= settle_updates)
+                max_z_error = std::max(max_z_error, std::abs(state_estimator.getZ() - start_z));
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Result result;
+        result.update_us = elapsed * 1E6 / updates;
+        result.max_z_error = max_z_error;
+        return result;
+    }
+};
+
+}}
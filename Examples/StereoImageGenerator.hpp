@@ -192,7 +192,7 @@ private:
     static void saveImageToFile(const std::vector<uint8_t>& image_data, const std::string& file_name)
     {
         std::ofstream file(file_name , std::ios::binary);
-        file.write((char*) image_data.data(), image_data.size());
+        file.write(reinterpret_cast<const char*>(image_data.data()), image_data.size());
         file.close();
     }
 
@@ -214,14 +214,14 @@ private:
 
     static void convertToDisparity(std::vector<float>& image_data, int width, int height, float f = 320, float baseline_meters = 1)
     {
-        for (int i = 0; i < image_data.size(); ++i) {
+        for (size_t i = 0; i < image_data.size(); ++i) {
             image_data[i] = f * baseline_meters * (1.0f / image_data[i]);
         }
     }
 
     static void denormalizeDisparity(std::vector<float>& image_data, int width)
     {
-        for (int i = 0; i < image_data.size(); ++i) {
+        for (size_t i = 0; i < image_data.size(); ++i) {
             image_data[i] = image_data[i] * width;
         }
     }
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "safety/VoxelMap.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+namespace msr { namespace airlib {
+
+//Feeds VoxelMap with simulated lidar scans of a room and measures insertion rate and query latency.
+//VoxelMapTest in AirLibUnitTests checks the query results.
+class VoxelMapBenchmark {
+public:
+    VoxelMapBenchmark(int rings = 32, int points_per_ring = 2048)
+        : rings_(rings), points_per_ring_(points_per_ring)
+    {
+    }
+
+    void run(int scans = 10, int queries = 2000)
+    {
+        std::shared_ptr<VoxelMap> map = std::make_shared<VoxelMap>(0.2f, 30.0f);
+
+        vector<Vector3r> points;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < scans; ++i) {
+            const Vector3r origin(0.3f * i, -0.2f * i, 0);
+            points = scan(origin);
+            map->insertPointCloud(origin, points);
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(2)
+            << scans << " scans of " << points.size() << " points: " << scans * points.size() / elapsed / 1E6 << "M points/s, "
+            << map->getBlockCount() << " blocks, " << map->getOccupiedVoxels().size() << " occupied voxels" << std::endl;
+
+        std::cout << std::setprecision(0) << "getSegmentObstacle(3m): " << timeQueries(*map, queries, 3) << " ns, "
+            << "getClosestObstacle: " << timeQueries(*map, queries, 0) << " ns" << std::endl;
+    }
+
+private:
+    //room from -20 to 20 in x and y, floor at z = -2 and ceiling at 4
+    Vector3r castInRoom(const Vector3r& origin, const Vector3r& direction) const
+    {
+        const Vector3r low(-20, -20, -2), high(20, 20, 4);
+        float t = Utils::max<float>();
+        for (int axis = 0; axis < 3; ++axis) {
+            if (direction[axis] > 0)
+                t = std::min(t, (high[axis] - origin[axis]) / direction[axis]);
+            else if (direction[axis] < 0)
+                t = std::min(t, (low[axis] - origin[axis]) / direction[axis]);
+        }
+        return origin + direction * t;
+    }
+
+    vector<Vector3r> scan(const Vector3r& origin) const
+    {
+        vector<Vector3r> points;
+        points.reserve(rings_ * points_per_ring_);
+        for (int ring = 0; ring < rings_; ++ring) {
+            //-15 to +15 degrees of elevation like common spinning lidars
+            float elevation = (-15 + 30.0f * ring / (rings_ - 1)) * M_PIf / 180;
+            for (int i = 0; i < points_per_ring_; ++i) {
+                float azimuth = 2 * M_PIf * i / points_per_ring_;
+                const Vector3r direction(std::cos(elevation) * std::cos(azimuth), std::cos(elevation) * std::sin(azimuth), std::sin(elevation));
+                points.push_back(castInRoom(origin, direction));
+            }
+        }
+        return points;
+    }
+
+    Vector3r randomSegmentEnd(std::mt19937& random, const Vector3r& from, float length) const
+    {
+        std::normal_distribution<float> normal;
+        Vector3r direction(normal(random), normal(random), normal(random));
+        return from + direction.normalized() * length;
+    }
+
+    double timeQueries(const VoxelMap& map, int queries, float length) const
+    {
+        std::mt19937 random(5);
+        std::uniform_real_distribution<float> xy(-18, 18), z(-1, 3);
+        vector<std::pair<Vector3r, Vector3r>> segments;
+        for (int i = 0; i < queries; ++i) {
+            const Vector3r from(xy(random), xy(random), z(random));
+            segments.push_back(std::make_pair(from, randomSegmentEnd(random, from, length)));
+        }
+
+        float sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& segment : segments)
+            sum += length > 0 ? map.getSegmentObstacle(segment.first, segment.second, 5.2f).distance
+                : map.getClosestObstacle(segment.first, 5.2f).distance;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink_ = sink_ + sum;
+        return elapsed * 1E9 / queries;
+    }
+
+    int rings_, points_per_ring_;
+    //query results end up here so the compiler can't drop the queries
+    mutable volatile float sink_ = 0;
+};
+
+}}
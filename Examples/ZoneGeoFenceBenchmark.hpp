@@ -0,0 +1,209 @@
+#pragma once
+
+#include "safety/ZoneGeoFence.hpp"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+namespace msr { namespace airlib {
+
+//Loads a 10km operating area made of a few allowed zones with thousands of small no-fly zones in it in to
+//ZoneGeoFence and measures query time against a brute force search over all zones, and single queries against
+//batches for many vehicles. ZoneGeoFenceTest checks the queries against the brute force search.
+class ZoneGeoFenceBenchmark {
+public:
+    ZoneGeoFenceBenchmark(int no_fly_zones = 5000)
+        : fence_(0.1f)
+    {
+        std::mt19937 random(17);
+
+        //two squares that share a side and an L shaped area sticking out, all up to 120m above ground
+        const float ceiling = -120;
+        zones_.push_back(ZoneGeoFence::Zone(box(0, 0, 5000, 10000), ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+        zones_.push_back(ZoneGeoFence::Zone(box(5000, 0, 10000, 10000), ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+        zones_.push_back(ZoneGeoFence::Zone({ Vector2r(10000, 0), Vector2r(12000, 0), Vector2r(12000, 4000),
+            Vector2r(11000, 4000), Vector2r(11000, 1000), Vector2r(10000, 1000) }, ceiling, 0, ZoneGeoFence::ZoneType::Allowed));
+
+        //no-fly zones are random polygons of 20 to 100m around their center, some only reach up to some height
+        std::uniform_real_distribution<float> xy(0, 12000), radius(20, 100), height(-150, -20), unit(0, 1);
+        for (int i = 0; i < no_fly_zones; ++i) {
+            const Vector2r center(xy(random), xy(random) * 10000 / 12000);
+            int corners = 3 + i % 6;
+            vector<Vector2r> polygon;
+            for (int corner = 0; corner < corners; ++corner) {
+                float angle = 2 * M_PIf * (corner + 0.8f * unit(random)) / corners;
+                polygon.push_back(center + Vector2r(std::cos(angle), std::sin(angle)) * radius(random));
+            }
+            float top = i % 3 ? -Utils::max<float>() : height(random);
+            zones_.push_back(ZoneGeoFence::Zone(polygon, top, Utils::max<float>(), ZoneGeoFence::ZoneType::NoFly));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        fence_.addZones(zones_);
+        fence_.isInFence(Vector3r::Zero());
+        load_seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void run(int queries = 20000, int vehicles = 1000)
+    {
+        std::cout << std::fixed << std::setprecision(2) << fence_.toString() << ", loaded and indexed in "
+            << load_seconds_ * 1E3 << " ms" << std::endl;
+
+        vector<Vector3r> from, to;
+        randomMoves(queries, 30, from, to);
+        timeQueries(from, to);
+        timeBatch(vehicles);
+    }
+
+private:
+    static vector<Vector2r> box(float min_x, float min_y, float max_x, float max_y)
+    {
+        return { Vector2r(min_x, min_y), Vector2r(max_x, min_y), Vector2r(max_x, max_y), Vector2r(min_x, max_y) };
+    }
+
+    //moves of about length from random points around the operating area
+    void randomMoves(int count, float length, vector<Vector3r>& from, vector<Vector3r>& to) const
+    {
+        std::mt19937 random(count + static_cast<int>(length));
+        std::uniform_real_distribution<float> x(-200, 12200), y(-200, 10200), z(-140, 5);
+        std::normal_distribution<float> normal;
+        from.clear();
+        to.clear();
+        for (int i = 0; i < count; ++i) {
+            from.push_back(Vector3r(x(random), y(random), z(random)));
+            Vector3r direction(normal(random), normal(random), 0.1f * normal(random));
+            to.push_back(from.back() + direction.normalized() * length);
+        }
+    }
+
+    static bool isInPolygon(const vector<Vector2r>& polygon, float x, float y)
+    {
+        bool inside = false;
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+            if ((polygon[i].y() > y) != (polygon[j].y() > y) &&
+                x < (polygon[j].x() - polygon[i].x()) * (y - polygon[i].y()) / (polygon[j].y() - polygon[i].y()) + polygon[i].x())
+                inside = !inside;
+        }
+        return inside;
+    }
+
+    static bool isInZone(const ZoneGeoFence::Zone& zone, const Vector3r& point)
+    {
+        return point.z() >= zone.min_z && point.z() <= zone.max_z && isInPolygon(zone.polygon, point.x(), point.y());
+    }
+
+    bool isInFence(const Vector3r& point) const
+    {
+        bool in_allowed = false;
+        for (const ZoneGeoFence::Zone& zone : zones_) {
+            if (isInZone(zone, point)) {
+                if (zone.type == ZoneGeoFence::ZoneType::NoFly)
+                    return false;
+                in_allowed = true;
+            }
+        }
+        return in_allowed;
+    }
+
+    //the segment is in or out of every zone between two points where it crosses a zone boundary, so it
+    //is in the fence if the ends and the middle points between all crossings are
+    bool isSegmentInFence(const Vector3r& from, const Vector3r& to) const
+    {
+        const Vector3r direction = to - from;
+        vector<float> crossings { 0, 1 };
+        for (const ZoneGeoFence::Zone& zone : zones_) {
+            for (float z : { zone.min_z, zone.max_z }) {
+                if (direction.z() != 0)
+                    crossings.push_back((z - from.z()) / direction.z());
+            }
+            for (size_t i = 0, j = zone.polygon.size() - 1; i < zone.polygon.size(); j = i++) {
+                const Vector2r edge = zone.polygon[i] - zone.polygon[j];
+                const Vector2r offset = zone.polygon[j] - Vector2r(from.x(), from.y());
+                float denominator = direction.x() * edge.y() - direction.y() * edge.x();
+                if (denominator == 0)
+                    continue;
+                float t = (offset.x() * edge.y() - offset.y() * edge.x()) / denominator;
+                float s = (offset.x() * direction.y() - offset.y() * direction.x()) / denominator;
+                if (s >= 0 && s <= 1)
+                    crossings.push_back(t);
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        if (!isInFence(from) || !isInFence(to))
+            return false;
+        for (size_t i = 0; i + 1 < crossings.size(); ++i) {
+            float t = (crossings[i] + crossings[i + 1]) / 2;
+            if (t > 0 && t < 1 && crossings[i + 1] - crossings[i] > 1E-5f && !isInFence(from + direction * t))
+                return false;
+        }
+        return true;
+    }
+
+    void timeQueries(const vector<Vector3r>& from, const vector<Vector3r>& to)
+    {
+        int in_fence_count = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Vector3r& point : from)
+            in_fence_count += fence_.isInFence(point);
+        double point_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < from.size(); ++i) {
+            bool in_fence, allow;
+            fence_.checkFence(from[i], to[i], in_fence, allow);
+            in_fence_count += in_fence;
+        }
+        double check_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        //brute force is slow, a few hundred are enough
+        size_t brute_count = std::min<size_t>(from.size(), 200);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < brute_count; ++i)
+            in_fence_count += isSegmentInFence(from[i], to[i]);
+        double brute_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink_ = sink_ + in_fence_count;
+
+        std::cout << "isInFence: " << point_elapsed * 1E6 / from.size() << " us, checkFence(30m move): "
+            << check_elapsed * 1E6 / from.size() << " us, brute force segment: " << brute_elapsed * 1E6 / brute_count << " us" << std::endl;
+    }
+
+    //one checkFences call for all vehicles against one checkFence call per vehicle, moves of one control period
+    void timeBatch(int vehicles)
+    {
+        vector<Vector3r> cur_locs, dest_locs;
+        randomMoves(vehicles, 0.5f, cur_locs, dest_locs);
+        const int rounds = 20;
+        int allowed = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < cur_locs.size(); ++i) {
+                bool in_fence, allow;
+                fence_.checkFence(cur_locs[i], dest_locs[i], in_fence, allow);
+                allowed += allow;
+            }
+        }
+        double single_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (const ZoneGeoFence::FenceCheck& check : fence_.checkFences(cur_locs, dest_locs))
+                allowed += check.allow;
+        }
+        double batch_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink_ = sink_ + allowed;
+
+        std::cout << vehicles << " vehicles: checkFence each " << single_elapsed * 1E3 / rounds << " ms, checkFences "
+            << batch_elapsed * 1E3 / rounds << " ms" << std::endl;
+    }
+
+    ZoneGeoFence fence_;
+    vector<ZoneGeoFence::Zone> zones_;
+    double load_seconds_;
+    //query results end up here so the compiler can't drop the queries
+    mutable volatile int sink_ = 0;
+};
+
+}}
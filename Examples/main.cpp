@@ -2,6 +2,13 @@
 #include "StandAlonePhysics.hpp"
 #include "StereoImageGenerator.hpp"
 #include "GaussianMarkovTest.hpp"
+#include "RpcPipelineBenchmark.hpp"
+#include "ImageEncoderBenchmark.hpp"
+#include "SimpleFlightBenchmark.hpp"
+#include "ObstacleMapBenchmark.hpp"
+#include "VoxelMapBenchmark.hpp"
+#include "ArcLengthPathBenchmark.hpp"
+#include "ZoneGeoFenceBenchmark.hpp"
 #include <iostream>
 #include <string>
 
@@ -68,10 +75,94 @@ void runSteroImageGenerator(int argc, const char *argv[])
         : std::string(argv[2]));
 }
 
+void runRpcPipelineBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::RpcPipelineBenchmark benchmark(argc < 2 ? "localhost" : argv[1]);
+    benchmark.run(argc < 3 ? 1000 : std::stoi(argv[2]));
+}
+
+void runImageEncoderBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::ImageEncoderBenchmark benchmark(argc < 2 ? 10 : std::stoi(argv[1]));
+    benchmark.run(argc < 3 ? 20 : std::stoi(argv[2]));
+}
+
+void runSimpleFlightBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::SimpleFlightBenchmark benchmark;
+    benchmark.run(argc < 2 ? 200000 : std::stoi(argv[1]));
+}
+
+void runObstacleMapBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::ObstacleMapBenchmark benchmark(argc < 2 ? 1024 : std::stoi(argv[1]));
+    benchmark.run(argc < 3 ? 1 : std::stof(argv[2]), argc < 4 ? 2 : std::stoi(argv[3]));
+}
+
+void runVoxelMapBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::VoxelMapBenchmark benchmark;
+    benchmark.run(argc < 2 ? 10 : std::stoi(argv[1]));
+}
+
+void runArcLengthPathBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::ArcLengthPathBenchmark benchmark(argc < 2 ? 10000 : std::stoi(argv[1]));
+    benchmark.run();
+}
+
+void runZoneGeoFenceBenchmark(int argc, const char *argv[])
+{
+    msr::airlib::ZoneGeoFenceBenchmark benchmark(argc < 2 ? 5000 : std::stoi(argv[1]));
+    benchmark.run();
+}
+
+//benchmarks that run without a simulator, by name as given on the command line
+typedef void (*RunBenchmark)(int argc, const char *argv[]);
+static const struct {
+    const char* name;
+    RunBenchmark run;
+} benchmarks[] = {
+    { "ImageEncoderBenchmark", runImageEncoderBenchmark },
+    { "SimpleFlightBenchmark", runSimpleFlightBenchmark },
+    { "ObstacleMapBenchmark", runObstacleMapBenchmark },
+    { "VoxelMapBenchmark", runVoxelMapBenchmark },
+    { "ArcLengthPathBenchmark", runArcLengthPathBenchmark },
+    { "ZoneGeoFenceBenchmark", runZoneGeoFenceBenchmark }
+};
+
+//Examples <benchmark> [args] runs one benchmark with the rest of the arguments, Examples benchmarks runs all
+//of them with their defaults and Examples RpcPipelineBenchmark [ip] [rounds] needs a running simulator
 int main(int argc, const char *argv[])
 {
     using namespace msr::airlib;
 
+    if (argc >= 2) {
+        std::string name = argv[1];
+        if (name == "RpcPipelineBenchmark") {
+            runRpcPipelineBenchmark(argc - 1, argv + 1);
+            return 0;
+        }
+        for (const auto& benchmark : benchmarks) {
+            if (name == "benchmarks") {
+                std::cout << "--- " << benchmark.name << std::endl;
+                benchmark.run(1, argv + 1);
+            }
+            else if (name == benchmark.name) {
+                benchmark.run(argc - 1, argv + 1);
+                return 0;
+            }
+        }
+        if (name == "benchmarks")
+            return 0;
+
+        std::cout << "Unknown benchmark " << name << ", available are benchmarks (all of them), RpcPipelineBenchmark";
+        for (const auto& benchmark : benchmarks)
+            std::cout << ", " << benchmark.name;
+        std::cout << std::endl;
+        return 1;
+    }
+
     GaussianMarkovTest test;
     test.run();
 }
@@ -12,6 +12,8 @@
 #include "MavLinkVideoStream.hpp"
 #include "MavLinkTcpServer.hpp"
 #include "MavLinkFtpClient.hpp"
+#include "MavLinkIndexedLog.hpp"
+#include "MavLinkAsyncLog.hpp"
 #include "Semaphore.hpp"
 
 STRICT_MODE_OFF
@@ -19,6 +21,8 @@ STRICT_MODE_OFF
 STRICT_MODE_ON
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
 
 using namespace mavlink_utils;
 using namespace mavlinkcom;
@@ -35,6 +39,12 @@ void UnitTests::RunAll(std::string comPort, int boardRate)
 
 	RunTest("UdpPingTest", [=] { UdpPingTest(); });
 	RunTest("TcpPingTest", [=] { TcpPingTest(); });
+	RunTest("UdpFramingTest", [=] { UdpFramingTest(); });
+	RunTest("IndexedLogTest", [=] { IndexedLogTest(); });
+	RunTest("IndexedLogCorruptTest", [=] { IndexedLogCorruptTest(); });
+	RunTest("AsyncLogTest", [=] { AsyncLogTest(); });
+	RunTest("SubscriptionTest", [=] { SubscriptionTest(); });
+	RunTest("SubscriberQueueTest", [=] { SubscriberQueueTest(); });
 	RunTest("SendImageTest", [=] { SendImageTest(); });
 	RunTest("SerialPx4Test", [=] { SerialPx4Test(); });
 	RunTest("FtpTest", [=] { FtpTest(); });
@@ -125,6 +135,400 @@ void UnitTests::TcpPingTest() {
 	client->close();
 }
 
+void UnitTests::UdpFramingTest() {
+
+	// send a burst of messages each way and make sure every field survives the serialize/decode fast paths.
+	const int count = 500;
+	auto localConnection = MavLinkConnection::connectLocalUdp("local", "127.0.0.1", 14589);
+	auto remoteConnection = MavLinkConnection::connectRemoteUdp("remote", "127.0.0.1", "127.0.0.1", 14589);
+
+	std::vector<int> localReceived, remoteReceived;
+	std::string error;
+	std::mutex error_mutex;
+	Semaphore done;
+	auto checker = [&](std::vector<int>& received) {
+		return [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+			if (msg.msgid != MavLinkHilSensor::kMessageId) {
+				return;
+			}
+			MavLinkHilSensor sensor;
+			sensor.decode(msg);
+			int i = static_cast<int>(sensor.time_usec);
+			if (sensor.xacc != i * 0.5f || sensor.zmag != -i || sensor.fields_updated != static_cast<uint32_t>(i % 2)) {
+				std::lock_guard<std::mutex> guard(error_mutex);
+				error = Utils::stringf("message %d has wrong contents", i);
+			}
+			received.push_back(i);
+			if (received.size() == count) {
+				done.post();
+			}
+		};
+	};
+	localConnection->subscribe(checker(localReceived));
+	remoteConnection->subscribe(checker(remoteReceived));
+
+	for (int i = 0; i < count; i++) {
+		MavLinkHilSensor sensor;
+		sensor.sysid = 166;
+		sensor.compid = 1;
+		sensor.time_usec = i;
+		sensor.xacc = i * 0.5f;
+		sensor.zmag = static_cast<float>(-i);
+		sensor.fields_updated = i % 2; // zero tail exercises mavlink 2 payload trimming.
+		remoteConnection->sendMessage(sensor);
+		if (i > 0) {
+			// local connection only knows where to reply once it has heard from remote.
+			localConnection->sendMessage(sensor);
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	MavLinkHilSensor last;
+	last.time_usec = 0;
+	localConnection->sendMessage(last);
+
+	bool ok = done.timed_wait(2000) && done.timed_wait(2000);
+	MavLinkTelemetry telemetry;
+	localConnection->getTelemetry(telemetry);
+	localConnection->close();
+	remoteConnection->close();
+
+	if (!ok) {
+		throw std::runtime_error(Utils::stringf("only received %d and %d of %d messages", static_cast<int>(localReceived.size()), static_cast<int>(remoteReceived.size()), count));
+	}
+	std::lock_guard<std::mutex> guard(error_mutex);
+	if (error.size() > 0) {
+		throw std::runtime_error(error);
+	}
+	if (telemetry.crcErrors != 0) {
+		throw std::runtime_error(Utils::stringf("%d crc errors", static_cast<int>(telemetry.crcErrors)));
+	}
+}
+
+void UnitTests::IndexedLogTest()
+{
+	// one message every millisecond, a heartbeat every 10th, in small chunks so seek and filter have to use the index.
+	const int count = 20000;
+	auto tempPath = FileSystem::combine(FileSystem::getTempFolder(), "test.mavidx");
+	MavLinkIndexedLog log;
+	log.openForWriting(tempPath, true, 16 * 1024);
+	for (int i = 0; i < count; i++) {
+		MavLinkMessage msg;
+		if (i % 10 == 0) {
+			MavLinkHeartbeat hb;
+			hb.custom_mode = i;
+			hb.type = 1;
+			hb.encode(msg);
+		}
+		else {
+			MavLinkHilSensor sensor;
+			sensor.time_usec = i;
+			sensor.xacc = i * 0.5f;
+			sensor.encode(msg);
+		}
+		msg.sysid = 166;
+		msg.compid = 1;
+		log.write(msg, 1000000 + i * 1000);
+	}
+	log.close();
+
+	log.openForReading(tempPath);
+	if (log.getMessageCount() != count || log.getChunks().size() < 10) {
+		throw std::runtime_error(Utils::stringf("index has %d messages in %d chunks", static_cast<int>(log.getMessageCount()), static_cast<int>(log.getChunks().size())));
+	}
+	for (const MavLinkLogChunkInfo& chunk : log.getChunks()) {
+		if (chunk.storedSize >= chunk.rawSize) {
+			throw std::runtime_error("chunk was not compressed");
+		}
+	}
+
+	MavLinkMessage msg;
+	uint64_t timestamp;
+	int read = 0;
+	while (log.read(msg, timestamp)) {
+		if (timestamp != 1000000 + static_cast<uint64_t>(read) * 1000 || msg.sysid != 166) {
+			throw std::runtime_error(Utils::stringf("message %d has wrong header", read));
+		}
+		if (msg.msgid == MavLinkHilSensor::kMessageId) {
+			MavLinkHilSensor sensor;
+			sensor.decode(msg);
+			if (sensor.time_usec != static_cast<uint64_t>(read) || sensor.xacc != read * 0.5f) {
+				throw std::runtime_error(Utils::stringf("message %d has wrong contents", read));
+			}
+		}
+		read++;
+	}
+	if (read != count) {
+		throw std::runtime_error(Utils::stringf("only read %d of %d messages", read, count));
+	}
+
+	// seek into the middle of a chunk.
+	if (!log.seek(1000000 + 12345 * 1000) || !log.read(msg, timestamp) || timestamp != 1000000 + 12345 * 1000) {
+		throw std::runtime_error("seek did not find message 12345");
+	}
+
+	// heartbeats only, starting near the end, replayed at 10x into a udp connection.
+	log.setMessageFilter({ MavLinkHeartbeat::kMessageId });
+	const int start = count - 1000;
+	if (!log.seek(1000000 + start * 1000) || !log.read(msg, timestamp) || msg.msgid != MavLinkHeartbeat::kMessageId) {
+		throw std::runtime_error("filtered seek did not find a heartbeat");
+	}
+	log.seek(1000000 + start * 1000);
+
+	auto localConnection = MavLinkConnection::connectLocalUdp("local", "127.0.0.1", 14590);
+	auto remoteConnection = MavLinkConnection::connectRemoteUdp("remote", "127.0.0.1", "127.0.0.1", 14590);
+	std::atomic<int> received(0);
+	localConnection->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+		if (message.msgid == MavLinkHeartbeat::kMessageId) {
+			received++;
+		}
+	});
+
+	auto startTime = std::chrono::steady_clock::now();
+	size_t sent = log.replay(remoteConnection, 10);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	localConnection->close();
+	remoteConnection->close();
+	log.close();
+
+	if (sent != 100 || received != 100) {
+		throw std::runtime_error(Utils::stringf("replay sent %d and received %d of 100 heartbeats", static_cast<int>(sent), static_cast<int>(received)));
+	}
+	// the 100 heartbeats span 0.99 seconds of log time.
+	if (elapsed < 95) {
+		throw std::runtime_error(Utils::stringf("replay at 10x took only %d ms", static_cast<int>(elapsed)));
+	}
+}
+
+void UnitTests::IndexedLogCorruptTest()
+{
+	// uncompressed chunks are read straight out of the mapping, so sizes in a broken index or chunk header
+	// must make the reader drop the index or stop at that chunk instead of reading past the end of the file.
+	const int count = 2000;
+	auto tempPath = FileSystem::combine(FileSystem::getTempFolder(), "testcorrupt.mavidx");
+	MavLinkIndexedLog log;
+	log.openForWriting(tempPath, false, 4 * 1024);
+	for (int i = 0; i < count; i++) {
+		MavLinkHeartbeat hb;
+		hb.custom_mode = i;
+		MavLinkMessage msg;
+		hb.encode(msg);
+		log.write(msg, 1 + i);
+	}
+	log.close();
+	log.openForReading(tempPath);
+	std::vector<MavLinkLogChunkInfo> chunks = log.getChunks();
+	log.close();
+	if (chunks.size() < 4) {
+		throw std::runtime_error(Utils::stringf("log only has %d chunks", static_cast<int>(chunks.size())));
+	}
+
+	std::vector<char> original;
+	{
+		std::ifstream in(tempPath, std::ios::binary);
+		original.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+	auto putU32 = [](std::vector<char>& bytes, size_t pos, uint32_t value) {
+		for (int i = 0; i < 4; i++) {
+			bytes[pos + i] = static_cast<char>(value >> (8 * i));
+		}
+	};
+	auto readAll = [&](const std::vector<char>& bytes) {
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), bytes.size());
+		}
+		log.openForReading(tempPath);
+		MavLinkMessage msg;
+		uint64_t timestamp;
+		int read = 0;
+		while (log.read(msg, timestamp)) {
+			read++;
+		}
+		log.close();
+		return read;
+	};
+
+	// first index entry claims the chunk runs far past the index, the chunk headers in the file are still good.
+	std::vector<char> bytes = original;
+	uint64_t indexOffset = 0;
+	for (int i = 0; i < 8; i++) {
+		indexOffset |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[bytes.size() - 16 + i])) << (8 * i);
+	}
+	size_t entry = static_cast<size_t>(indexOffset) + 8 + 8;
+	putU32(bytes, entry + 8, chunks[0].rawSize + 1000000);
+	putU32(bytes, entry + 12, chunks[0].storedSize + 1000000);
+	int read = readAll(bytes);
+	if (read != count) {
+		throw std::runtime_error(Utils::stringf("log with a bad index read %d of %d messages", read, count));
+	}
+
+	// third chunk header in the file says there is more raw data than is stored.
+	bytes = original;
+	putU32(bytes, static_cast<size_t>(chunks[2].offset) + 8, chunks[2].rawSize + 1000000);
+	read = readAll(bytes);
+	if (read != static_cast<int>(chunks[0].messageCount + chunks[1].messageCount)) {
+		throw std::runtime_error(Utils::stringf("log with a bad chunk header read %d messages, expected the %d in front of it",
+			read, static_cast<int>(chunks[0].messageCount + chunks[1].messageCount)));
+	}
+}
+
+void UnitTests::AsyncLogTest()
+{
+	// two threads share one queue, like the send and receive side of a connection.
+	const int perThread = 5000;
+	auto tempPath = FileSystem::combine(FileSystem::getTempFolder(), "testasync.mavidx");
+	auto file = std::make_shared<MavLinkIndexedLog>();
+	file->openForWriting(tempPath);
+	auto log = std::make_shared<MavLinkAsyncLog>(file, 2 * perThread, 5, 50);
+
+	auto producer = [&](uint8_t sysid) {
+		for (int i = 0; i < perThread; i++) {
+			MavLinkHeartbeat hb;
+			hb.custom_mode = i;
+			MavLinkMessage msg;
+			hb.encode(msg);
+			msg.sysid = sysid;
+			log->write(msg, 1 + i);
+		}
+	};
+	std::thread sender(producer, 1);
+	std::thread receiver(producer, 2);
+	sender.join();
+	receiver.join();
+	log->flush();
+
+	MavLinkLogStats stats;
+	log->getStats(stats);
+	log->close();
+	file->close();
+	if (stats.messagesWritten != 2 * perThread || stats.messagesDropped != 0 || stats.flushes == 0) {
+		throw std::runtime_error(Utils::stringf("wrote %d, dropped %d, flushed %d times", static_cast<int>(stats.messagesWritten),
+			static_cast<int>(stats.messagesDropped), static_cast<int>(stats.flushes)));
+	}
+
+	// each thread's messages must come out in the order they were written.
+	file->openForReading(tempPath);
+	MavLinkMessage msg;
+	uint64_t timestamp;
+	uint64_t last[3] = { 0, 0, 0 };
+	int read = 0;
+	while (file->read(msg, timestamp)) {
+		if (msg.sysid < 1 || msg.sysid > 2 || timestamp != last[msg.sysid] + 1) {
+			throw std::runtime_error(Utils::stringf("message %d is out of order", read));
+		}
+		last[msg.sysid] = timestamp;
+		read++;
+	}
+	file->close();
+	if (read != 2 * perThread) {
+		throw std::runtime_error(Utils::stringf("only read %d of %d messages", read, 2 * perThread));
+	}
+}
+
+void UnitTests::SubscriptionTest()
+{
+	// a heartbeat only subscriber, a catch all subscriber and a slow subscriber on its own thread.
+	const int count = 200;
+	auto localConnection = MavLinkConnection::connectLocalUdp("local", "127.0.0.1", 14591);
+	auto remoteConnection = MavLinkConnection::connectRemoteUdp("remote", "127.0.0.1", "127.0.0.1", 14591);
+
+	std::atomic<int> heartbeats(0), all(0), slow(0), wrong(0);
+	Semaphore allReceived;
+	localConnection->subscribe({ MavLinkHeartbeat::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+		if (msg.msgid != MavLinkHeartbeat::kMessageId) {
+			wrong++;
+		}
+		heartbeats++;
+	});
+	localConnection->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+		if (++all == count) {
+			allReceived.post();
+		}
+	});
+	int slowId = localConnection->subscribe({ MavLinkHilSensor::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+		slow++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}, true);
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < count; i++) {
+		MavLinkHeartbeat hb;
+		MavLinkHilSensor sensor;
+		if (i % 2 == 0) {
+			remoteConnection->sendMessage(hb);
+		}
+		else {
+			remoteConnection->sendMessage(sensor);
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	bool ok = allReceived.timed_wait(2000);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+	int slowSoFar = slow;
+	localConnection->unsubscribe(slowId);
+	localConnection->close();
+	remoteConnection->close();
+
+	if (!ok || heartbeats != count / 2 || wrong != 0) {
+		throw std::runtime_error(Utils::stringf("received %d messages, %d heartbeats and %d unexpected messages", static_cast<int>(all), static_cast<int>(heartbeats), static_cast<int>(wrong)));
+	}
+	// 100 sensor messages take the slow subscriber 2 seconds, the others must not have waited for it.
+	if (elapsed > 1000 || slowSoFar >= count / 2) {
+		throw std::runtime_error(Utils::stringf("slow subscriber held up the others, took %d ms", static_cast<int>(elapsed)));
+	}
+}
+
+void UnitTests::SubscriberQueueTest()
+{
+	// a subscriber on its own thread that doesn't handle anything until more messages arrived than its queue holds,
+	// with the Block policy it still gets every one of them and with DropNewest the ones that didn't fit are counted.
+	const int count = 1100;
+	for (int drop = 0; drop < 2; drop++) {
+		int port = 14592 + drop;
+		auto localConnection = MavLinkConnection::connectLocalUdp("local", "127.0.0.1", port);
+		auto remoteConnection = MavLinkConnection::connectRemoteUdp("remote", "127.0.0.1", "127.0.0.1", port);
+		if (drop) {
+			localConnection->setQueuePolicy(MavLinkQueuePolicy::DropNewest);
+		}
+
+		std::atomic<bool> open(false);
+		std::atomic<int> received(0);
+		localConnection->subscribe({ MavLinkHeartbeat::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+			while (!open) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			received++;
+		}, true);
+
+		for (int i = 0; i < count; i++) {
+			MavLinkHeartbeat hb;
+			remoteConnection->sendMessage(hb);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		open = true;
+
+		MavLinkQueueStats stats;
+		for (int wait = 0; wait < 200; wait++) {
+			localConnection->getQueueStats(stats);
+			if (received + static_cast<int>(stats.subscriberDrops) == count) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		localConnection->close();
+		remoteConnection->close();
+
+		int drops = static_cast<int>(stats.subscriberDrops);
+		if (received + drops != count || (drop ? drops == 0 : drops != 0)) {
+			throw std::runtime_error(Utils::stringf("%s policy: subscriber got %d of %d messages and %d were dropped",
+				drop ? "DropNewest" : "Block", static_cast<int>(received), count, drops));
+		}
+	}
+}
+
 void UnitTests::SerialPx4Test()
 {
 	auto connection = MavLinkConnection::connectSerial("px4", com_port_, baud_rate_);
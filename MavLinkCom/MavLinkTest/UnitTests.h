@@ -16,6 +16,12 @@ public:
 	void SerialPx4Test();
 	void UdpPingTest();
 	void TcpPingTest();
+	void UdpFramingTest();
+	void IndexedLogTest();
+	void IndexedLogCorruptTest();
+	void AsyncLogTest();
+	void SubscriptionTest();
+	void SubscriberQueueTest();
 	void SendImageTest();
 	void FtpTest();
     void JSonLogTest();
@@ -9,6 +9,7 @@
 #include "MavLinkVehicle.hpp"
 #include "MavLinkMessages.hpp"
 #include "MavLinkLog.hpp"
+#include "MavLinkAsyncLog.hpp"
 #include "Commands.h"
 #include <iostream>
 #include <vector>
@@ -143,9 +144,11 @@ bool convertExisting = false;
 std::vector<int> filterTypes;
 std::shared_ptr<MavLinkFileLog> inLogFile;
 std::shared_ptr<MavLinkFileLog> outLogFile;
+// the files are written on background threads so a slow disk doesn't hold up the drone connection.
+std::shared_ptr<MavLinkAsyncLog> inLog;
+std::shared_ptr<MavLinkAsyncLog> outLog;
 std::thread telemetry_thread;
 bool telemetry = false;
-std::mutex logLock;
 std::stringstream initScript;
 
 std::shared_ptr<MavLinkConnection> droneConnection;
@@ -423,9 +426,20 @@ void OpenLogFiles() {
         outLogFile = std::make_shared<MavLinkFileLog>();
         outLogFile->openForWriting(outfile, jsonLogFormat);
 
+        inLog = std::make_shared<MavLinkAsyncLog>(inLogFile);
+        outLog = std::make_shared<MavLinkAsyncLog>(outLogFile);
     }
 }
 void CloseLogFiles() {
+    // drain the queues before closing the files underneath them.
+    if (inLog != nullptr) {
+        inLog->close();
+        inLog = nullptr;
+    }
+    if (outLog != nullptr) {
+        outLog->close();
+        outLog = nullptr;
+    }
     if (inLogFile != nullptr) {
         inLogFile->close();
         inLogFile = nullptr;
@@ -1154,8 +1168,11 @@ bool connect()
         return false;
     }
 
-    if (outLogFile != nullptr) {
-        droneConnection->startLoggingSendMessage(outLogFile);
+    if (outLog != nullptr) {
+        droneConnection->startLoggingSendMessage(outLog);
+    }
+    if (inLog != nullptr) {
+        droneConnection->startLoggingReceiveMessage(inLog);
     }
     mavLinkVehicle->connect(droneConnection);
 
@@ -1267,13 +1284,10 @@ int console(std::stringstream& script) {
         return 1;
     }
 
-    droneConnection->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    droneConnection->subscribe({ MavLinkHeartbeat::kMessageId, MavLinkAttitudeTarget::kMessageId, MavLinkStatustext::kMessageId },
+        [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
 
         MavLinkStatustext statustext;
-        if (inLogFile != nullptr && inLogFile->isOpen()) {
-            std::lock_guard<std::mutex> lock(logLock);
-            inLogFile->write(message);
-        }
         switch (message.msgid) {
         case MavLinkHeartbeat::kMessageId:
             CheckHeartbeat(message);
@@ -1412,15 +1426,14 @@ int console(std::stringstream& script) {
             else {
                 Command* selected = Command::create(args);
                 //add command text in log
-                if (selected != nullptr && inLogFile != nullptr && inLogFile->isOpen()) {
+                if (selected != nullptr && inLog != nullptr) {
                     auto str = std::string(Command::kCommandLogPrefix) + line;
                     MavLinkStatustext st;
                     strncpy(st.text, str.c_str(), 50);
                     MavLinkMessage m; 
                     st.encode(m);
                     droneConnection->prepareForSending(m);
-                    std::lock_guard<std::mutex> lock(logLock);
-                    inLogFile->write(m);
+                    inLog->write(m);
                 }
 
                 if (currentCommand != nullptr && currentCommand != selected) {
@@ -14,6 +14,7 @@
 #include <direct.h>
 #include <stdlib.h>
 #include <direct.h>
+#include <io.h>
 #else
 #include <unistd.h>
 #include <sys/param.h> // MAXPATHLEN definition
@@ -162,4 +163,14 @@ bool FileSystem::exists(const std::string path)
 	return rc == 0;
 #endif
 }
+
+void FileSystem::flushToDisk(FILE* file)
+{
+	fflush(file);
+#ifdef _WIN32
+	_commit(_fileno(file));
+#else
+	fsync(fileno(file));
+#endif
+}
 #endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <codecvt>
 #include <fstream>
 #include <string>
+#include <cstdio>
 #include "Utils.hpp"
 
 // This defines a default folder name for all the files created by AirLib so they 
@@ -98,6 +99,9 @@ public:
 
     static bool exists(const std::string path);
 
+    // flush the stream and wait for the OS to write it to the disk.
+    static void flushToDisk(FILE* file);
+
     static std::string getTempFolder() {
 #ifdef _WIN32
         std::wstring userProfile = _wgetenv(L"TEMP");
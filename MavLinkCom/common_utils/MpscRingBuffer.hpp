@@ -0,0 +1,133 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_MpscRingBuffer_hpp
+#define common_utils_MpscRingBuffer_hpp
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+namespace mavlink_utils {
+
+/*
+    Bounded multiple producer, single consumer queue with preallocated slots.
+    Producers claim a slot with one compare-and-swap and never wait on each other or on the consumer,
+    tryPush just returns false when the queue is full. Each slot carries a sequence number that tells the
+    consumer when the producer that claimed it has finished filling it (bounded queue by D. Vyukov).
+    Any number of threads may call tryPush, exactly one thread may call the consumer methods.
+    Capacity is rounded up to next power of two.
+*/
+template <typename T>
+class MpscRingBuffer {
+public:
+    explicit MpscRingBuffer(size_t capacity)
+        : slots_(roundUp(capacity))
+    {
+        mask_ = slots_.size() - 1;
+        for (size_t i = 0; i < slots_.size(); ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+        return slots_.size();
+    }
+
+    //approximate when called concurrently with producers or consumer
+    size_t size() const
+    {
+        return head_.value.load(std::memory_order_acquire) - tail_.value.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    //*** producer side ***//
+
+    //returns false if queue is full
+    bool tryPush(const T& item)
+    {
+        size_t pos = head_.value.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (head_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+                //pos was reloaded by failed compare_exchange
+            }
+            else if (diff < 0) {
+                //slot still holds an item from one lap ago
+                return false;
+            }
+            else {
+                pos = head_.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //*** consumer side ***//
+
+    //returns oldest item or nullptr if queue is empty (or the producer that claimed it hasn't finished), item stays valid until pop
+    T* front()
+    {
+        size_t pos = tail_.value.load(std::memory_order_relaxed);
+        Slot& slot = slots_[pos & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            return nullptr;
+        return &slot.item;
+    }
+
+    void pop()
+    {
+        size_t pos = tail_.value.load(std::memory_order_relaxed);
+        slots_[pos & mask_].sequence.store(pos + slots_.size(), std::memory_order_release);
+        tail_.value.store(pos + 1, std::memory_order_release);
+    }
+
+    //don't allow copies
+    MpscRingBuffer(MpscRingBuffer const&) = delete;
+    void operator=(MpscRingBuffer const&) = delete;
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+
+        Slot() : sequence(0) {}
+        //vector needs these to construct the slots, the queue itself never copies a slot
+        Slot(const Slot& other) : sequence(other.sequence.load()), item(other.item) {}
+    };
+
+    //padding instead of alignas so the object doesn't need over-aligned heap allocation.
+    struct Index {
+        char pad_before[kCacheLine];
+        std::atomic<size_t> value {0};
+        char pad_after[kCacheLine];
+    };
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+    Index head_;
+    Index tail_;
+};
+
+} //namespace
+#endif
@@ -0,0 +1,110 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef common_utils_SpscRingBuffer_hpp
+#define common_utils_SpscRingBuffer_hpp
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+namespace mavlink_utils {
+
+/*
+    Bounded single producer, single consumer queue with preallocated slots.
+    The producer fills a slot in place (beginWrite/commitWrite) and the consumer reads it
+    in place (front/pop), so nothing is allocated or copied by the queue itself after construction.
+    Exactly one thread may call the producer methods and exactly one other thread may call
+    the consumer methods. Capacity is rounded up to next power of two.
+*/
+template <typename T>
+class SpscRingBuffer {
+public:
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    size_t capacity() const
+    {
+        return slots_.size();
+    }
+
+    //approximate when called concurrently with producer or consumer
+    size_t size() const
+    {
+        return head_.value.load(std::memory_order_acquire) - tail_.value.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    //*** producer side ***//
+
+    //returns slot to fill or nullptr if queue is full, slot is not visible to consumer until commitWrite
+    T* beginWrite()
+    {
+        size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head - head_.cached_other >= slots_.size()) {
+            head_.cached_other = tail_.value.load(std::memory_order_acquire);
+            if (head - head_.cached_other >= slots_.size())
+                return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    void commitWrite()
+    {
+        head_.value.store(head_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //*** consumer side ***//
+
+    //returns oldest item or nullptr if queue is empty, item stays valid until pop
+    T* front()
+    {
+        size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail == tail_.cached_other) {
+            tail_.cached_other = head_.value.load(std::memory_order_acquire);
+            if (tail == tail_.cached_other)
+                return nullptr;
+        }
+        return &slots_[tail & mask_];
+    }
+
+    void pop()
+    {
+        tail_.value.store(tail_.value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //don't allow copies
+    SpscRingBuffer(SpscRingBuffer const&) = delete;
+    void operator=(SpscRingBuffer const&) = delete;
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    //head is written only by producer and tail only by consumer, each side keeps a
+    //private copy of the other index so it only touches the shared cache line when needed.
+    //padding instead of alignas so the object doesn't need over-aligned heap allocation.
+    struct Index {
+        char pad_before[kCacheLine];
+        std::atomic<size_t> value {0};
+        size_t cached_other = 0;
+        char pad_after[kCacheLine];
+    };
+
+    std::vector<T> slots_;
+    size_t mask_;
+    Index head_;
+    Index tail_;
+};
+
+} //namespace
+#endif
@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MavLinkCom_Lz4Codec_hpp
+#define MavLinkCom_Lz4Codec_hpp
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace mavlinkcom
+{
+    // LZ4 block compression without external dependency, used for MavLinkIndexedLog chunks and by AirLib for images.
+    // Each sequence is a token (literal length in the high nibble, match length - 4 in the low nibble), extra length
+    // bytes for either when the nibble is 15, the literals, then a 16 bit back reference, and the last sequence has
+    // literals only.  Compression is the greedy single probe hash search of the reference fast mode, so it runs at
+    // memory speed on data with big flat areas or repeated records.  Decompression checks every length and offset
+    // against both buffers, so truncated or corrupt input is rejected instead of read or written out of bounds.
+    class Lz4Codec
+    {
+    public:
+        // uncompressed size as little endian uint32 followed by the block, which is what lz4.block.decompress()
+        // in Python and LZ4_decompress_safe() after reading the size expect.
+        static void compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+        {
+            out.resize(4 + maxBlockSize(size));
+            out[0] = static_cast<uint8_t>(size);
+            out[1] = static_cast<uint8_t>(size >> 8);
+            out[2] = static_cast<uint8_t>(size >> 16);
+            out[3] = static_cast<uint8_t>(size >> 24);
+            out.resize(4 + compressBlock(src, size, out.data() + 4));
+        }
+
+        // returns false if data is not a valid size prefixed block.
+        static bool decompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+        {
+            if (size < 4) {
+                return false;
+            }
+            size_t raw_size = static_cast<size_t>(src[0]) | (static_cast<size_t>(src[1]) << 8) |
+                (static_cast<size_t>(src[2]) << 16) | (static_cast<size_t>(src[3]) << 24);
+            // a corrupt size must not make us allocate more than the block could ever expand to.
+            if (raw_size > maxRawSize(size - 4)) {
+                return false;
+            }
+            out.resize(raw_size);
+            return decompressBlock(src + 4, size - 4, out.data(), raw_size);
+        }
+
+        // block only, the caller keeps the uncompressed size.
+        static void compressBlock(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+        {
+            out.resize(maxBlockSize(size));
+            out.resize(compressBlock(src, size, out.data()));
+        }
+
+        // dst must have maxBlockSize(size) bytes, returns the block size.
+        static size_t compressBlock(const uint8_t* src, size_t size, uint8_t* dst)
+        {
+            uint8_t* op = dst;
+            size_t anchor = 0;
+
+            if (size > kMatchSafeDistance) {
+                std::vector<uint32_t> table(static_cast<size_t>(1) << kHashBits, 0);
+                const size_t match_limit = size - kMatchSafeDistance;
+                const size_t end_limit = size - kLastLiterals;
+
+                size_t ip = 1;
+                while (ip < match_limit) {
+                    uint32_t h = hash(src + ip);
+                    size_t candidate = table[h];
+                    table[h] = static_cast<uint32_t>(ip);
+
+                    if (ip - candidate > kMaxOffset || read32(src + candidate) != read32(src + ip)) {
+                        // skip faster through data that doesn't compress.
+                        ip += 1 + ((ip - anchor) >> 6);
+                        continue;
+                    }
+
+                    // extend the match backwards over literals and forwards as far as the format allows.
+                    while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+                        --ip;
+                        --candidate;
+                    }
+                    size_t match_length = kMinMatch;
+                    while (ip + match_length < end_limit && src[ip + match_length] == src[candidate + match_length]) {
+                        ++match_length;
+                    }
+
+                    op = writeSequence(op, src + anchor, ip - anchor, ip - candidate, match_length);
+                    ip += match_length;
+                    anchor = ip;
+                    if (ip < match_limit) {
+                        table[hash(src + ip - 2)] = static_cast<uint32_t>(ip - 2);
+                    }
+                }
+            }
+
+            // last literals.
+            size_t literals = size - anchor;
+            op = writeToken(op, literals, 0);
+            if (literals > 0) {
+                std::memcpy(op, src + anchor, literals);
+            }
+            op += literals;
+            return static_cast<size_t>(op - dst);
+        }
+
+        // returns false unless the block decodes to exactly raw_size bytes.
+        static bool decompressBlock(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size)
+        {
+            size_t ip = 0;
+            size_t op = 0;
+            while (ip < size) {
+                uint8_t token = src[ip++];
+
+                size_t literals = token >> 4;
+                if (!readLength(src, size, ip, literals)) {
+                    return false;
+                }
+                if (literals > size - ip || literals > raw_size - op) {
+                    return false;
+                }
+                if (literals > 0) {
+                    std::memcpy(dst + op, src + ip, literals);
+                }
+                ip += literals;
+                op += literals;
+
+                if (ip == size) {
+                    break; // last sequence has no match.
+                }
+
+                if (size - ip < 2) {
+                    return false;
+                }
+                size_t offset = static_cast<size_t>(src[ip]) | (static_cast<size_t>(src[ip + 1]) << 8);
+                ip += 2;
+                size_t match_length = token & 15;
+                if (!readLength(src, size, ip, match_length)) {
+                    return false;
+                }
+                match_length += kMinMatch;
+                if (offset == 0 || offset > op || match_length > raw_size - op) {
+                    return false;
+                }
+
+                const uint8_t* match = dst + op - offset;
+                if (offset >= match_length) {
+                    std::memcpy(dst + op, match, match_length);
+                }
+                else {
+                    // overlapping copy repeats the last offset bytes.
+                    for (size_t i = 0; i < match_length; ++i) {
+                        dst[op + i] = match[i];
+                    }
+                }
+                op += match_length;
+            }
+            return op == raw_size;
+        }
+
+        static size_t maxBlockSize(size_t size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        // every byte of a block adds at most 255 bytes of output.
+        static size_t maxRawSize(size_t block_size)
+        {
+            return block_size * 255;
+        }
+
+    private:
+        static const int kHashBits = 16;
+        static const size_t kMinMatch = 4;
+        // format rules: last 5 bytes are literals and the last match starts at least 12 bytes before the end.
+        static const size_t kLastLiterals = 5;
+        static const size_t kMatchSafeDistance = 12;
+        static const size_t kMaxOffset = 65535;
+
+        static uint8_t* writeSequence(uint8_t* op, const uint8_t* literals, size_t literal_length, size_t offset, size_t match_length)
+        {
+            size_t match_rest = match_length - kMinMatch;
+            op = writeToken(op, literal_length, match_rest);
+            std::memcpy(op, literals, literal_length);
+            op += literal_length;
+
+            *op++ = static_cast<uint8_t>(offset);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+            if (match_rest >= 15) {
+                op = writeExtraLength(op, match_rest - 15);
+            }
+            return op;
+        }
+
+        // token with both length nibbles, then the extra literal length bytes.
+        static uint8_t* writeToken(uint8_t* op, size_t literal_length, size_t match_rest)
+        {
+            *op++ = static_cast<uint8_t>(((literal_length >= 15 ? 15 : literal_length) << 4) | (match_rest >= 15 ? 15 : match_rest));
+            if (literal_length >= 15) {
+                op = writeExtraLength(op, literal_length - 15);
+            }
+            return op;
+        }
+
+        static uint8_t* writeExtraLength(uint8_t* op, size_t rest)
+        {
+            for (; rest >= 255; rest -= 255) {
+                *op++ = 255;
+            }
+            *op++ = static_cast<uint8_t>(rest);
+            return op;
+        }
+
+        static bool readLength(const uint8_t* src, size_t size, size_t& ip, size_t& length)
+        {
+            if (length != 15) {
+                return true;
+            }
+            uint8_t extra;
+            do {
+                if (ip >= size) {
+                    return false;
+                }
+                extra = src[ip++];
+                length += extra;
+            } while (extra == 255);
+            return true;
+        }
+
+        static uint32_t hash(const uint8_t* p)
+        {
+            return (read32(p) * 2654435761u) >> (32 - kHashBits);
+        }
+
+        static uint32_t read32(const uint8_t* p)
+        {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,80 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MavLinkCom_MavLinkAsyncLog_hpp
+#define MavLinkCom_MavLinkAsyncLog_hpp
+
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "MavLinkMessageBase.hpp"
+#include "MavLinkLog.hpp"
+
+namespace mavlinkcom
+{
+    struct MavLinkLogStats {
+        uint64_t messagesWritten;   // messages handed to the underlying log
+        uint64_t messagesDropped;   // messages discarded because the queue was full
+        uint64_t flushes;           // number of times the underlying log was flushed to disk
+        uint32_t capacity;          // number of preallocated queue slots
+        uint32_t highWaterMark;     // largest number of messages that were waiting at once
+    };
+
+    // This implementation of MavLinkLog writes to another MavLinkLog (for example a MavLinkFileLog) on a background
+    // thread, so a slow disk never holds up the thread that is sending or receiving messages.  write() copies the
+    // message into a preallocated lock free queue and returns, when the queue is full the message is dropped and
+    // counted instead of blocking the caller.  The writer thread wakes up every batchIntervalMs, writes everything
+    // waiting in one batch and flushes the underlying log to disk every flushIntervalMs (0 means only on flush/close).
+    // One instance can be shared by the send and receive side of any number of connections.
+    class MavLinkAsyncLog : public MavLinkLog
+    {
+    public:
+        MavLinkAsyncLog(std::shared_ptr<MavLinkLog> log, size_t capacity = 8192, int batchIntervalMs = 10, int flushIntervalMs = 1000);
+        ~MavLinkAsyncLog();
+
+        // timestamp 0 means now, taken when the message is queued rather than when it reaches the disk.
+        virtual void write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp = 0) override;
+        // waits until everything queued so far has been written and then flushes the underlying log.
+        virtual void flush() override;
+        // writes whatever is still queued, flushes and stops the writer thread, the underlying log is left open.
+        void close();
+
+        void getStats(MavLinkLogStats& stats);
+        std::shared_ptr<MavLinkLog> getLog() { return log_; }
+
+        //don't allow copies
+        MavLinkAsyncLog(MavLinkAsyncLog const&) = delete;
+        void operator=(MavLinkAsyncLog const&) = delete;
+
+    private:
+        class LogQueue;
+
+        void writerLoop();
+        void writeQueued();
+
+        std::shared_ptr<MavLinkLog> log_;
+        std::unique_ptr<LogQueue> queue_;
+        std::chrono::milliseconds batch_interval_;
+        std::chrono::milliseconds flush_interval_;
+        std::thread writer_thread_;
+
+        // only used to wake the writer and for flush(), write() never takes it.
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable flushed_;
+        uint64_t flush_requested_;
+        uint64_t flush_done_;
+        bool stop_;
+
+        std::atomic<uint64_t> messages_written_;
+        std::atomic<uint64_t> messages_dropped_;
+        std::atomic<uint64_t> flushes_;
+        std::atomic<uint32_t> high_water_;
+    };
+}
+
+#endif
@@ -37,6 +37,28 @@ namespace mavlinkcom {
     // This callback is invoked when a new TCP connection is accepted via acceptTcp().
     typedef std::function<void(std::shared_ptr<MavLinkConnection> port)> MavLinkConnectionHandler;
 
+    // What the reader thread does when the queue of received messages waiting to be published is full
+    // because the subscribers are not keeping up, and what the publisher thread does when the queue of a
+    // subscriber with its own thread is full.
+    enum class MavLinkQueuePolicy {
+        // reader waits for the publisher to make room, nothing is lost inside this process but the
+        // OS socket or serial buffers fill up instead.  Connections on the shared I/O thread drop instead.
+        // The publisher likewise waits for a subscriber with its own thread, holding up the other subscribers.
+        Block,
+        // the newly received message is discarded and counted in MavLinkQueueStats::messagesDropped,
+        // or in MavLinkQueueStats::subscriberDrops for just the subscriber with its own thread that is full.
+        DropNewest
+    };
+
+    struct MavLinkQueueStats {
+        uint64_t messagesQueued;    // messages handed to the publisher thread
+        uint64_t messagesDropped;   // messages discarded because the queue was full (DropNewest policy)
+        uint64_t readerStalls;      // number of times the reader had to wait for room in the queue (Block policy)
+        uint32_t capacity;          // number of preallocated queue slots
+        uint32_t highWaterMark;     // largest number of messages that were waiting at once
+        uint64_t subscriberDrops;   // messages not delivered to a subscriber with its own thread because its queue was full (DropNewest policy)
+    };
+
     struct SerialPortInfo {
         std::wstring displayName;
         std::wstring portName;
@@ -94,12 +116,24 @@ namespace mavlinkcom {
 
         // provide a callback function that will be called for every message "received" from the remote mavlink node.
         int subscribe(MessageHandler handler);
+        // same but the handler is only called for messages with one of the given ids (all messages if the list is empty),
+        // the connection looks subscribers up by id so this is much cheaper than filtering inside the handler.  If ownThread
+        // is true the handler runs on a thread of its own so a short burst of slow handling doesn't hold up the other
+        // subscribers.  Messages are queued for it and nothing is lost, once it falls too far behind the other subscribers
+        // wait for it unless the queue policy is DropNewest, then messages are dropped for that subscriber only (see
+        // setQueuePolicy and MavLinkQueueStats::subscriberDrops).  Subscribers forwarding messages with join() work this way.
+        int subscribe(const std::vector<uint32_t>& msgids, MessageHandler handler, bool ownThread = false);
         void unsubscribe(int id);
 
-        // log every message that is "sent" using sendMessage.
+        // log every message that is "sent" using sendMessage.  The log is written on the sending thread, so wrap
+        // file logs in a MavLinkAsyncLog to keep disk writes off the send path.
         void startLoggingSendMessage(std::shared_ptr<MavLinkLog> log);
         void stopLoggingSendMessage();
 
+        // log every message that is "received", this happens on the thread that calls the subscribers.
+        void startLoggingReceiveMessage(std::shared_ptr<MavLinkLog> log);
+        void stopLoggingReceiveMessage();
+
         uint8_t getNextSequence();
 
         // Advanced method that create a bridge between two connections.  For example, if you use connectRemoteUdp to connect to 
@@ -113,11 +147,26 @@ namespace mavlinkcom {
         // Send the given already encoded message, assuming the compid and sysid have been set by the caller.
         void sendMessage(const MavLinkMessage& msg);
 
+        // Send several already encoded messages with as few system calls as possible (one sendmmsg on Linux UDP),
+        // useful when a simulation step produces a burst of messages like HIL_SENSOR and HIL_GPS together.
+        void sendMessages(const std::vector<MavLinkMessage>& messages);
+
+        // Serve the reads of UDP and TCP connections created after this call from one shared I/O thread instead of a
+        // thread per connection.  This is Linux only (epoll), elsewhere connections keep their own read thread.  A full
+        // receive queue on such a connection drops messages instead of blocking, see MavLinkQueuePolicy.
+        static void setSharedIoThread(bool enable);
+
         // get the next telemetry snapshot, then clear the internal counters and start over.  This way each snapshot
         // gives you a picture of what happened in whatever timeslice you decide to call this method.  This is packaged
         // in a mavlink message so you can easily send it to the LogViewer.
         void getTelemetry(MavLinkTelemetry& result);
 
+        // Control what happens when the subscribers can't keep up with the received messages, default is Block.
+        void setQueuePolicy(MavLinkQueuePolicy policy);
+
+        // get the receive queue counters, unlike getTelemetry these accumulate for the lifetime of the connection.
+        void getQueueStats(MavLinkQueueStats& result);
+
         //add the message in to list of ignored messages. These messages will not be sent in the sendMessage() call.
         //this does not effect reception of message, however. This is typically useful in scenario where many connections
         //are bridged and you don't want certain connection to read ceratin messages.
@@ -0,0 +1,120 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MavLinkCom_MavLinkIndexedLog_hpp
+#define MavLinkCom_MavLinkIndexedLog_hpp
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
+#include <cstdint>
+#include "MavLinkMessageBase.hpp"
+#include "MavLinkLog.hpp"
+
+namespace mavlinkcom
+{
+    class MavLinkConnection;
+
+    // Describes one chunk of a MavLinkIndexedLog, the index at the end of the file holds one of these per chunk
+    // so the reader can find a time or a message id without touching the chunk data.
+    struct MavLinkLogChunkInfo {
+        uint64_t offset;                // file offset of the chunk header
+        uint64_t startTime;             // smallest timestamp in the chunk
+        uint64_t endTime;               // largest timestamp in the chunk
+        uint32_t messageCount;
+        uint32_t rawSize;               // size of the message records once decompressed
+        uint32_t storedSize;            // size on disk, same as rawSize if the chunk was stored uncompressed
+        std::vector<uint32_t> msgids;   // sorted list of the distinct message ids in the chunk
+    };
+
+    // This implementation of MavLinkLog writes a chunked binary log meant for very long recordings.
+    // Messages are collected into chunks of about chunkSize bytes, each chunk is compressed on its own with Lz4Codec and
+    // an index of chunk time ranges and message ids is written at the end of the file.  The reader maps the
+    // file into memory and only decompresses the chunks it needs, so seek() and setMessageFilter() don't
+    // have to scan the whole log.  This is not the QGroundControl .mavlink format, use MavLinkFileLog for that.
+    class MavLinkIndexedLog : public MavLinkLog
+    {
+    public:
+        static const uint32_t kDefaultChunkSize = 256 * 1024;
+
+        MavLinkIndexedLog();
+        ~MavLinkIndexedLog();
+
+        bool isOpen();
+        void openForWriting(const std::string& filename, bool compress = true, uint32_t chunkSize = kDefaultChunkSize);
+        void openForReading(const std::string& filename);
+        // finishes the current chunk and writes the index.
+        void close();
+
+        // this method is thread safe so the same log can record both sent and received messages.
+        virtual void write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp = 0) override;
+        // write the current chunk to disk now instead of waiting for it to fill up.
+        virtual void flush() override;
+
+        // read the next message that passes the message filter, returns false at the end of the log.
+        bool read(mavlinkcom::MavLinkMessage& msg, uint64_t& timestamp);
+        // position the reader on the first message with timestamp >= the given time, returns false if there is none.
+        bool seek(uint64_t timestamp);
+        // only return messages with these ids from read(), chunks that contain none of them are skipped entirely.
+        // pass an empty list to read everything again.
+        void setMessageFilter(const std::vector<uint32_t>& msgids);
+
+        const std::vector<MavLinkLogChunkInfo>& getChunks() const { return chunks_; }
+        uint64_t getMessageCount() const;
+        uint64_t getStartTime() const;
+        uint64_t getEndTime() const;
+
+        // send messages from the current read position to the given connection, pacing them by their recorded
+        // timestamps divided by speed (so 2 plays twice as fast), or as fast as possible if speed <= 0.
+        // Blocks until the end of the log or until cancelReplay is called and returns the number of messages sent.
+        size_t replay(std::shared_ptr<MavLinkConnection> connection, double speed = 1.0);
+        void cancelReplay();
+
+        //don't allow copies
+        MavLinkIndexedLog(MavLinkIndexedLog const&) = delete;
+        void operator=(MavLinkIndexedLog const&) = delete;
+
+    private:
+        class MappedFile;
+
+        void writeChunk();
+        void writeIndex();
+        bool readIndex();
+        void scanChunkHeaders();
+        bool chunkMatchesFilter(size_t index) const;
+        void loadChunk(size_t index);
+        bool nextChunk();
+
+        std::string file_name_;
+        bool reading_;
+        bool writing_;
+
+        // writer state
+        std::mutex write_mutex_;
+        FILE* ptr_;
+        bool compress_;
+        uint32_t chunk_size_;
+        uint64_t file_offset_;
+        std::vector<uint8_t> raw_;
+        std::vector<uint8_t> compressed_;
+        MavLinkLogChunkInfo current_;
+
+        // reader state
+        std::unique_ptr<MappedFile> map_;
+        std::vector<MavLinkLogChunkInfo> chunks_;
+        std::vector<uint64_t> max_end_time_;   // running maximum of endTime, so it is sorted even if timestamps jump back
+        std::vector<uint32_t> filter_;
+        std::vector<uint8_t> decompressed_;
+        size_t chunk_index_;
+        const uint8_t* chunk_data_;
+        size_t chunk_length_;
+        size_t chunk_pos_;
+
+        std::atomic<bool> replay_cancelled_;
+    };
+}
+
+#endif
@@ -16,11 +16,14 @@ namespace mavlinkcom
     {
     public:
         virtual void write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp = 0) = 0;
+        // push anything the log is buffering out to the disk.
+        virtual void flush() {}
     };
 
     // This implementation of MavLinkLog reads/writes MavLinkMessages to a local file.
     class MavLinkFileLog : public MavLinkLog
     {
+        static const int kWriteBufferSize = 64 * 1024;
         std::string file_name_;
         FILE* ptr_;
         bool reading_;
@@ -34,6 +37,7 @@ namespace mavlinkcom
         void openForWriting(const std::string& filename, bool json = false);
         void close();
         virtual void write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp = 0) override;
+        virtual void flush() override;
         bool read(mavlinkcom::MavLinkMessage& msg, uint64_t& timestamp);
         static uint64_t getTimeStamp();
     };
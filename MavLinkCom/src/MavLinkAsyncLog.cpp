@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "MavLinkAsyncLog.hpp"
+#include "MpscRingBuffer.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+
+using namespace mavlinkcom;
+using namespace mavlink_utils;
+
+struct QueuedLogMessage {
+    MavLinkMessage msg;
+    uint64_t timestamp;
+};
+
+class MavLinkAsyncLog::LogQueue : public MpscRingBuffer<QueuedLogMessage>
+{
+public:
+    explicit LogQueue(size_t capacity)
+        : MpscRingBuffer<QueuedLogMessage>(capacity)
+    {
+    }
+};
+
+MavLinkAsyncLog::MavLinkAsyncLog(std::shared_ptr<MavLinkLog> log, size_t capacity, int batchIntervalMs, int flushIntervalMs)
+    : log_(log), queue_(new LogQueue(capacity)), batch_interval_(std::max(1, batchIntervalMs)), flush_interval_(std::max(0, flushIntervalMs)),
+    flush_requested_(0), flush_done_(0), stop_(false), messages_written_(0), messages_dropped_(0), flushes_(0), high_water_(0)
+{
+    if (log_ == nullptr) {
+        throw std::invalid_argument("MavLinkAsyncLog needs a log to write to");
+    }
+    writer_thread_ = std::thread(&MavLinkAsyncLog::writerLoop, this);
+}
+
+MavLinkAsyncLog::~MavLinkAsyncLog()
+{
+    close();
+}
+
+void MavLinkAsyncLog::write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp)
+{
+    QueuedLogMessage entry;
+    entry.msg = msg;
+    entry.timestamp = timestamp == 0 ? MavLinkFileLog::getTimeStamp() : timestamp;
+    if (!queue_->tryPush(entry)) {
+        messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // several producers may race here, the mark is a statistic so losing an update now and then is fine.
+    uint32_t queued = static_cast<uint32_t>(queue_->size());
+    if (queued > high_water_.load(std::memory_order_relaxed)) {
+        high_water_.store(queued, std::memory_order_relaxed);
+    }
+}
+
+void MavLinkAsyncLog::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stop_) {
+        return;
+    }
+    uint64_t request = ++flush_requested_;
+    wake_.notify_one();
+    flushed_.wait(lock, [this, request] { return flush_done_ >= request || stop_; });
+}
+
+void MavLinkAsyncLog::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+    flushed_.notify_all();
+}
+
+void MavLinkAsyncLog::getStats(MavLinkLogStats& stats)
+{
+    stats.messagesWritten = messages_written_.load(std::memory_order_relaxed);
+    stats.messagesDropped = messages_dropped_.load(std::memory_order_relaxed);
+    stats.flushes = flushes_.load(std::memory_order_relaxed);
+    stats.capacity = static_cast<uint32_t>(queue_->capacity());
+    stats.highWaterMark = high_water_.load(std::memory_order_relaxed);
+}
+
+void MavLinkAsyncLog::writeQueued()
+{
+    QueuedLogMessage* entry;
+    while ((entry = queue_->front()) != nullptr) {
+        try {
+            log_->write(entry->msg, entry->timestamp);
+        }
+        catch (std::exception& e) {
+            Utils::log(Utils::stringf("MavLinkAsyncLog: error writing message %d, details: %s", entry->msg.msgid, e.what()), Utils::kLogLevelError);
+        }
+        queue_->pop();
+        messages_written_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MavLinkAsyncLog::writerLoop()
+{
+    auto last_flush = std::chrono::steady_clock::now();
+    while (true) {
+        bool stopping;
+        uint64_t request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, batch_interval_, [this] { return stop_ || flush_requested_ != flush_done_; });
+            stopping = stop_;
+            request = flush_requested_;
+        }
+
+        writeQueued();
+
+        auto now = std::chrono::steady_clock::now();
+        bool interval_elapsed = flush_interval_.count() > 0 && now - last_flush >= flush_interval_;
+        if (stopping || request != flush_done_ || interval_elapsed) {
+            try {
+                log_->flush();
+            }
+            catch (std::exception& e) {
+                Utils::log(Utils::stringf("MavLinkAsyncLog: error flushing log, details: %s", e.what()), Utils::kLogLevelError);
+            }
+            flushes_.fetch_add(1, std::memory_order_relaxed);
+            last_flush = now;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush_done_ = request;
+        }
+        flushed_.notify_all();
+
+        if (stopping) {
+            return;
+        }
+    }
+}
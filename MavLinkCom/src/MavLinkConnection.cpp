@@ -49,6 +49,17 @@ void MavLinkConnection::stopLoggingSendMessage()
 	pImpl->stopLoggingSendMessage();
 }
 
+// log every message that is "received".
+void MavLinkConnection::startLoggingReceiveMessage(std::shared_ptr<MavLinkLog> log)
+{
+	pImpl->startLoggingReceiveMessage(log);
+}
+
+void MavLinkConnection::stopLoggingReceiveMessage()
+{
+	pImpl->stopLoggingReceiveMessage();
+}
+
 void MavLinkConnection::close()
 {
 	pImpl->close();
@@ -94,11 +105,26 @@ void MavLinkConnection::sendMessage(const MavLinkMessage& msg)
 	pImpl->sendMessage(msg);
 }
 
+void MavLinkConnection::sendMessages(const std::vector<MavLinkMessage>& messages)
+{
+	pImpl->sendMessages(messages);
+}
+
+void MavLinkConnection::setSharedIoThread(bool enable)
+{
+	MavLinkConnectionImpl::setSharedIoThread(enable);
+}
+
 int MavLinkConnection::subscribe(MessageHandler handler)
 {
 	return pImpl->subscribe(handler);
 }
 
+int MavLinkConnection::subscribe(const std::vector<uint32_t>& msgids, MessageHandler handler, bool ownThread)
+{
+	return pImpl->subscribe(msgids, handler, ownThread);
+}
+
 void MavLinkConnection::unsubscribe(int id) 
 {
 	pImpl->unsubscribe(id);
@@ -120,6 +146,16 @@ void MavLinkConnection::getTelemetry(MavLinkTelemetry& result)
 	pImpl->getTelemetry(result);
 }
 
+void MavLinkConnection::setQueuePolicy(MavLinkQueuePolicy policy)
+{
+	pImpl->setQueuePolicy(policy);
+}
+
+void MavLinkConnection::getQueueStats(MavLinkQueueStats& result)
+{
+	pImpl->getQueueStats(result);
+}
+
 
 
 //MavLinkConnection::MavLinkConnection(MavLinkConnection&&) = default;
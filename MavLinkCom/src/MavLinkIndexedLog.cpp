@@ -0,0 +1,718 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "StrictMode.hpp"
+
+STRICT_MODE_OFF
+#define MAVLINK_PACKED
+#include "../mavlink/common/mavlink.h"
+#include "../mavlink/mavlink_types.h"
+#include "../mavlink/mavlink_helpers.h"
+STRICT_MODE_ON
+
+#include "MavLinkIndexedLog.hpp"
+#include "MavLinkConnection.hpp"
+#include "Lz4Codec.hpp"
+#include "Utils.hpp"
+#include "FileSystem.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace mavlinkcom;
+using namespace mavlink_utils;
+
+/*
+    File layout, all integers are little endian:
+
+    file header:  "MAVLIDX" 0, uint32 version, uint32 reserved
+    chunk:        uint32 kChunkMagic, uint32 flags, uint32 rawSize, uint32 storedSize, uint32 messageCount,
+                  uint32 msgidCount, uint64 startTime, uint64 endTime, uint32 msgids[msgidCount], storedSize bytes of data
+    index:        uint32 kIndexMagic, uint32 chunkCount, then per chunk the same fields as the chunk header plus its uint64 offset
+    trailer:      uint64 index offset, uint32 chunkCount, uint32 kTrailerMagic
+
+    The chunk data is a run of message records: uint64 timestamp, magic, len, incompat_flags, compat_flags, seq,
+    sysid, compid, uint24 msgid, uint16 checksum, then len bytes of payload.  If the writer never got to close the
+    file the reader rebuilds the index by hopping from chunk header to chunk header.
+*/
+
+static const char kFileMagic[8] = { 'M', 'A', 'V', 'L', 'I', 'D', 'X', 0 };
+static const uint32_t kFileVersion = 1;
+static const size_t kFileHeaderSize = 16;
+static const uint32_t kChunkMagic = 0x4b434c4d; // "MLCK"
+static const uint32_t kIndexMagic = 0x58494c4d; // "MLIX"
+static const uint32_t kTrailerMagic = 0x45494c4d; // "MLIE"
+static const size_t kChunkHeaderSize = 40;
+static const size_t kTrailerSize = 16;
+static const size_t kRecordHeaderSize = 20;
+static const uint32_t kChunkCompressed = 1;
+
+static void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+static void putU64(uint8_t* p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+}
+
+static uint16_t getU16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t getU64(const uint8_t* p)
+{
+    return static_cast<uint64_t>(getU32(p)) | (static_cast<uint64_t>(getU32(p + 4)) << 32);
+}
+
+//*** read only memory mapping ***//
+
+class MavLinkIndexedLog::MappedFile
+{
+public:
+    MappedFile(const std::string& filename)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error(Utils::stringf("Could not open the file %s, error=%d", filename.c_str(), static_cast<int>(GetLastError())));
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file_, &size);
+        size_ = static_cast<size_t>(size.QuadPart);
+        if (size_ > 0) {
+            mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping_ != NULL) {
+                data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+            }
+            if (data_ == nullptr) {
+                int hr = static_cast<int>(GetLastError());
+                close();
+                throw std::runtime_error(Utils::stringf("Could not map the file %s, error=%d", filename.c_str(), hr));
+            }
+        }
+#else
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw std::runtime_error(Utils::stringf("Could not open the file %s, error=%d", filename.c_str(), errno));
+        }
+        struct stat info;
+        if (fstat(fd_, &info) != 0) {
+            int hr = errno;
+            close();
+            throw std::runtime_error(Utils::stringf("Could not get size of the file %s, error=%d", filename.c_str(), hr));
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+            if (data == MAP_FAILED) {
+                int hr = errno;
+                close();
+                throw std::runtime_error(Utils::stringf("Could not map the file %s, error=%d", filename.c_str(), hr));
+            }
+            data_ = static_cast<const uint8_t*>(data);
+            // chunks are mostly read front to back.
+            madvise(data, size_, MADV_SEQUENTIAL);
+        }
+#endif
+    }
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void close()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_ != NULL) {
+            CloseHandle(mapping_);
+        }
+        if (file_ != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_);
+        }
+        mapping_ = NULL;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_ != nullptr) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = NULL;
+#else
+    int fd_ = -1;
+#endif
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+//*** MavLinkIndexedLog ***//
+
+MavLinkIndexedLog::MavLinkIndexedLog()
+    : reading_(false), writing_(false), ptr_(nullptr), compress_(true), chunk_size_(kDefaultChunkSize), file_offset_(0),
+    chunk_index_(0), chunk_data_(nullptr), chunk_length_(0), chunk_pos_(0), replay_cancelled_(false)
+{
+}
+
+MavLinkIndexedLog::~MavLinkIndexedLog()
+{
+    close();
+}
+
+bool MavLinkIndexedLog::isOpen()
+{
+    return reading_ || writing_;
+}
+
+void MavLinkIndexedLog::openForWriting(const std::string& filename, bool compress, uint32_t chunkSize)
+{
+    close();
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    file_name_ = filename;
+    compress_ = compress;
+    chunk_size_ = std::max<uint32_t>(chunkSize, 1024);
+    ptr_ = fopen(filename.c_str(), "wb");
+    if (ptr_ == nullptr) {
+        throw std::runtime_error(Utils::stringf("Could not open the file %s, error=%d", filename.c_str(), errno));
+    }
+
+    uint8_t header[kFileHeaderSize];
+    std::memcpy(header, kFileMagic, sizeof(kFileMagic));
+    putU32(header + 8, kFileVersion);
+    putU32(header + 12, 0);
+    fwrite(header, 1, sizeof(header), ptr_);
+    file_offset_ = kFileHeaderSize;
+
+    raw_.clear();
+    raw_.reserve(chunk_size_ + kRecordHeaderSize + 256);
+    current_ = MavLinkLogChunkInfo();
+    chunks_.clear();
+    reading_ = false;
+    writing_ = true;
+}
+
+void MavLinkIndexedLog::openForReading(const std::string& filename)
+{
+    close();
+    file_name_ = filename;
+    map_.reset(new MappedFile(filename));
+    if (map_->size() < kFileHeaderSize || std::memcmp(map_->data(), kFileMagic, sizeof(kFileMagic)) != 0) {
+        map_ = nullptr;
+        throw std::runtime_error(Utils::stringf("The file %s is not an indexed mavlink log", filename.c_str()));
+    }
+    uint32_t version = getU32(map_->data() + 8);
+    if (version > kFileVersion) {
+        map_ = nullptr;
+        throw std::runtime_error(Utils::stringf("The file %s has unsupported log version %d", filename.c_str(), version));
+    }
+
+    chunks_.clear();
+    if (!readIndex()) {
+        // writer didn't close the file, so rebuild the index from the chunk headers.
+        chunks_.clear();
+        scanChunkHeaders();
+    }
+
+    max_end_time_.resize(chunks_.size());
+    uint64_t max_end = 0;
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        max_end = std::max(max_end, chunks_[i].endTime);
+        max_end_time_[i] = max_end;
+    }
+
+    filter_.clear();
+    chunk_index_ = 0;
+    chunk_data_ = nullptr;
+    chunk_length_ = 0;
+    chunk_pos_ = 0;
+    reading_ = true;
+    writing_ = false;
+}
+
+void MavLinkIndexedLog::close()
+{
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    if (ptr_ != nullptr) {
+        writeChunk();
+        writeIndex();
+        fclose(ptr_);
+        ptr_ = nullptr;
+    }
+    map_ = nullptr;
+    chunk_data_ = nullptr;
+    reading_ = false;
+    writing_ = false;
+}
+
+void MavLinkIndexedLog::write(const mavlinkcom::MavLinkMessage& msg, uint64_t timestamp)
+{
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    if (ptr_ == nullptr) {
+        if (reading_) {
+            throw std::runtime_error("Log file was opened for reading");
+        }
+        return;
+    }
+    if (timestamp == 0) {
+        timestamp = MavLinkFileLog::getTimeStamp();
+    }
+
+    size_t pos = raw_.size();
+    raw_.resize(pos + kRecordHeaderSize + msg.len);
+    uint8_t* record = &raw_[pos];
+    putU64(record, timestamp);
+    record[8] = msg.magic;
+    record[9] = msg.len;
+    record[10] = msg.incompat_flags;
+    record[11] = msg.compat_flags;
+    record[12] = msg.seq;
+    record[13] = msg.sysid;
+    record[14] = msg.compid;
+    record[15] = static_cast<uint8_t>(msg.msgid);
+    record[16] = static_cast<uint8_t>(msg.msgid >> 8);
+    record[17] = static_cast<uint8_t>(msg.msgid >> 16);
+    putU16(record + 18, msg.checksum);
+    std::memcpy(record + kRecordHeaderSize, msg.payload64, msg.len);
+
+    if (current_.messageCount == 0) {
+        current_.startTime = current_.endTime = timestamp;
+    }
+    else {
+        current_.startTime = std::min(current_.startTime, timestamp);
+        current_.endTime = std::max(current_.endTime, timestamp);
+    }
+    current_.messageCount++;
+
+    uint32_t msgid = msg.msgid;
+    auto found = std::lower_bound(current_.msgids.begin(), current_.msgids.end(), msgid);
+    if (found == current_.msgids.end() || *found != msgid) {
+        current_.msgids.insert(found, msgid);
+    }
+
+    if (raw_.size() >= chunk_size_) {
+        writeChunk();
+    }
+}
+
+void MavLinkIndexedLog::flush()
+{
+    std::lock_guard<std::mutex> guard(write_mutex_);
+    if (ptr_ != nullptr) {
+        writeChunk();
+        FileSystem::flushToDisk(ptr_);
+    }
+}
+
+// must be called with write_mutex_ held.
+void MavLinkIndexedLog::writeChunk()
+{
+    if (current_.messageCount == 0) {
+        return;
+    }
+
+    const uint8_t* data = raw_.data();
+    size_t stored = raw_.size();
+    uint32_t flags = 0;
+    if (compress_) {
+        Lz4Codec::compressBlock(raw_.data(), raw_.size(), compressed_);
+        if (compressed_.size() < raw_.size()) {
+            data = compressed_.data();
+            stored = compressed_.size();
+            flags |= kChunkCompressed;
+        }
+    }
+
+    current_.offset = file_offset_;
+    current_.rawSize = static_cast<uint32_t>(raw_.size());
+    current_.storedSize = static_cast<uint32_t>(stored);
+
+    std::vector<uint8_t> header(kChunkHeaderSize + current_.msgids.size() * 4);
+    putU32(&header[0], kChunkMagic);
+    putU32(&header[4], flags);
+    putU32(&header[8], current_.rawSize);
+    putU32(&header[12], current_.storedSize);
+    putU32(&header[16], current_.messageCount);
+    putU32(&header[20], static_cast<uint32_t>(current_.msgids.size()));
+    putU64(&header[24], current_.startTime);
+    putU64(&header[32], current_.endTime);
+    for (size_t i = 0; i < current_.msgids.size(); i++) {
+        putU32(&header[kChunkHeaderSize + i * 4], current_.msgids[i]);
+    }
+
+    if (fwrite(header.data(), 1, header.size(), ptr_) != header.size() || fwrite(data, 1, stored, ptr_) != stored) {
+        throw std::runtime_error(Utils::stringf("Error writing to log file %s, error=%d", file_name_.c_str(), errno));
+    }
+    file_offset_ += header.size() + stored;
+
+    chunks_.push_back(current_);
+    current_ = MavLinkLogChunkInfo();
+    raw_.clear();
+}
+
+// must be called with write_mutex_ held.
+void MavLinkIndexedLog::writeIndex()
+{
+    std::vector<uint8_t> index(8);
+    putU32(&index[0], kIndexMagic);
+    putU32(&index[4], static_cast<uint32_t>(chunks_.size()));
+    for (const MavLinkLogChunkInfo& chunk : chunks_) {
+        size_t pos = index.size();
+        index.resize(pos + 8 + kChunkHeaderSize + chunk.msgids.size() * 4);
+        uint8_t* entry = &index[pos];
+        putU64(entry, chunk.offset);
+        putU32(entry + 8, kChunkMagic);
+        putU32(entry + 12, chunk.storedSize < chunk.rawSize ? kChunkCompressed : 0);
+        putU32(entry + 16, chunk.rawSize);
+        putU32(entry + 20, chunk.storedSize);
+        putU32(entry + 24, chunk.messageCount);
+        putU32(entry + 28, static_cast<uint32_t>(chunk.msgids.size()));
+        putU64(entry + 32, chunk.startTime);
+        putU64(entry + 40, chunk.endTime);
+        for (size_t i = 0; i < chunk.msgids.size(); i++) {
+            putU32(entry + 48 + i * 4, chunk.msgids[i]);
+        }
+    }
+
+    uint8_t trailer[kTrailerSize];
+    putU64(trailer, file_offset_);
+    putU32(trailer + 8, static_cast<uint32_t>(chunks_.size()));
+    putU32(trailer + 12, kTrailerMagic);
+    fwrite(index.data(), 1, index.size(), ptr_);
+    fwrite(trailer, 1, sizeof(trailer), ptr_);
+}
+
+// parse a chunk header (as found in the file and in the index), returns the number of bytes it used or 0 if it is invalid.
+static size_t parseChunkHeader(const uint8_t* p, size_t available, MavLinkLogChunkInfo& chunk)
+{
+    if (available < kChunkHeaderSize || getU32(p) != kChunkMagic) {
+        return 0;
+    }
+    uint32_t flags = getU32(p + 4);
+    chunk.rawSize = getU32(p + 8);
+    chunk.storedSize = getU32(p + 12);
+    if ((flags & kChunkCompressed) == 0 && chunk.rawSize != chunk.storedSize) {
+        return 0; // uncompressed chunks are read in place, so the data must be all there is.
+    }
+    chunk.messageCount = getU32(p + 16);
+    uint32_t msgid_count = getU32(p + 20);
+    chunk.startTime = getU64(p + 24);
+    chunk.endTime = getU64(p + 32);
+    if ((available - kChunkHeaderSize) / 4 < msgid_count) {
+        return 0;
+    }
+    chunk.msgids.resize(msgid_count);
+    for (uint32_t i = 0; i < msgid_count; i++) {
+        chunk.msgids[i] = getU32(p + kChunkHeaderSize + i * 4);
+    }
+    return kChunkHeaderSize + msgid_count * 4;
+}
+
+bool MavLinkIndexedLog::readIndex()
+{
+    const uint8_t* data = map_->data();
+    size_t size = map_->size();
+    if (size < kFileHeaderSize + kTrailerSize) {
+        return false;
+    }
+    const uint8_t* trailer = data + size - kTrailerSize;
+    if (getU32(trailer + 12) != kTrailerMagic) {
+        return false;
+    }
+    uint64_t index_offset = getU64(trailer);
+    uint32_t count = getU32(trailer + 8);
+    size_t index_end = size - kTrailerSize;
+    if (index_offset < kFileHeaderSize || index_offset + 8 > index_end || getU32(data + index_offset) != kIndexMagic ||
+        getU32(data + index_offset + 4) != count) {
+        return false;
+    }
+
+    size_t pos = static_cast<size_t>(index_offset) + 8;
+    chunks_.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        MavLinkLogChunkInfo& chunk = chunks_[i];
+        if (index_end - pos < 8) {
+            return false;
+        }
+        chunk.offset = getU64(data + pos);
+        size_t used = parseChunkHeader(data + pos + 8, index_end - pos - 8, chunk);
+        if (used == 0 || chunk.offset < kFileHeaderSize || chunk.offset > index_offset) {
+            return false;
+        }
+        // the whole chunk has to be in front of the index and its header has to be the one the index describes,
+        // otherwise the reader would run off the end of the mapping.
+        uint64_t available = index_offset - chunk.offset;
+        if (available < used || available - used < chunk.storedSize ||
+            std::memcmp(data + chunk.offset, data + pos + 8, used) != 0) {
+            return false;
+        }
+        pos += 8 + used;
+    }
+    return true;
+}
+
+void MavLinkIndexedLog::scanChunkHeaders()
+{
+    const uint8_t* data = map_->data();
+    size_t size = map_->size();
+    size_t pos = kFileHeaderSize;
+    while (pos < size) {
+        MavLinkLogChunkInfo chunk;
+        size_t used = parseChunkHeader(data + pos, size - pos, chunk);
+        if (used == 0 || chunk.storedSize > size - pos - used) {
+            break; // partially written chunk at the end of the file.
+        }
+        chunk.offset = pos;
+        chunks_.push_back(chunk);
+        pos += used + chunk.storedSize;
+    }
+}
+
+uint64_t MavLinkIndexedLog::getMessageCount() const
+{
+    uint64_t count = 0;
+    for (const MavLinkLogChunkInfo& chunk : chunks_) {
+        count += chunk.messageCount;
+    }
+    return count;
+}
+
+uint64_t MavLinkIndexedLog::getStartTime() const
+{
+    uint64_t start = 0;
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        start = i == 0 ? chunks_[i].startTime : std::min(start, chunks_[i].startTime);
+    }
+    return start;
+}
+
+uint64_t MavLinkIndexedLog::getEndTime() const
+{
+    return max_end_time_.size() == 0 ? 0 : max_end_time_.back();
+}
+
+void MavLinkIndexedLog::setMessageFilter(const std::vector<uint32_t>& msgids)
+{
+    filter_ = msgids;
+    std::sort(filter_.begin(), filter_.end());
+}
+
+bool MavLinkIndexedLog::chunkMatchesFilter(size_t index) const
+{
+    if (filter_.size() == 0) {
+        return true;
+    }
+    // both lists are sorted.
+    const std::vector<uint32_t>& msgids = chunks_[index].msgids;
+    auto a = msgids.begin();
+    auto b = filter_.begin();
+    while (a != msgids.end() && b != filter_.end()) {
+        if (*a == *b) {
+            return true;
+        }
+        if (*a < *b) {
+            ++a;
+        }
+        else {
+            ++b;
+        }
+    }
+    return false;
+}
+
+void MavLinkIndexedLog::loadChunk(size_t index)
+{
+    const MavLinkLogChunkInfo& chunk = chunks_[index];
+    const uint8_t* stored = map_->data() + chunk.offset + kChunkHeaderSize + chunk.msgids.size() * 4;
+    uint32_t flags = getU32(map_->data() + chunk.offset + 4);
+    if ((flags & kChunkCompressed) != 0) {
+        decompressed_.resize(chunk.rawSize);
+        if (!Lz4Codec::decompressBlock(stored, chunk.storedSize, decompressed_.data(), chunk.rawSize)) {
+            throw std::runtime_error(Utils::stringf("Log file %s has a corrupt chunk at offset %lld", file_name_.c_str(),
+                static_cast<long long>(chunk.offset)));
+        }
+        chunk_data_ = decompressed_.data();
+    }
+    else {
+        // uncompressed chunks are read straight out of the mapping.
+        chunk_data_ = stored;
+    }
+    chunk_index_ = index;
+    chunk_length_ = chunk.rawSize;
+    chunk_pos_ = 0;
+}
+
+bool MavLinkIndexedLog::nextChunk()
+{
+    size_t index = chunk_data_ == nullptr ? chunk_index_ : chunk_index_ + 1;
+    while (index < chunks_.size() && !chunkMatchesFilter(index)) {
+        index++;
+    }
+    if (index >= chunks_.size()) {
+        chunk_index_ = chunks_.size();
+        chunk_data_ = nullptr;
+        return false;
+    }
+    loadChunk(index);
+    return true;
+}
+
+bool MavLinkIndexedLog::read(mavlinkcom::MavLinkMessage& msg, uint64_t& timestamp)
+{
+    if (map_ == nullptr) {
+        if (writing_) {
+            throw std::runtime_error("Log file was opened for writing");
+        }
+        return false;
+    }
+
+    while (true) {
+        if (chunk_data_ == nullptr || chunk_pos_ >= chunk_length_) {
+            if (!nextChunk()) {
+                return false;
+            }
+        }
+
+        const uint8_t* record = chunk_data_ + chunk_pos_;
+        if (chunk_length_ - chunk_pos_ < kRecordHeaderSize || chunk_length_ - chunk_pos_ - kRecordHeaderSize < record[9]) {
+            throw std::runtime_error(Utils::stringf("Log file %s has a truncated message record", file_name_.c_str()));
+        }
+        uint8_t len = record[9];
+        chunk_pos_ += kRecordHeaderSize + len;
+
+        uint32_t msgid = record[15] | (record[16] << 8) | (record[17] << 16);
+        if (filter_.size() > 0 && !std::binary_search(filter_.begin(), filter_.end(), msgid)) {
+            continue;
+        }
+
+        timestamp = getU64(record);
+        msg.magic = record[8];
+        msg.len = len;
+        msg.incompat_flags = record[10];
+        msg.compat_flags = record[11];
+        msg.seq = record[12];
+        msg.sysid = record[13];
+        msg.compid = record[14];
+        msg.msgid = msgid;
+        msg.checksum = getU16(record + 18);
+        // mavlink2 trims trailing zeros from the payload, so put them back for decode().
+        uint8_t* payload = reinterpret_cast<uint8_t*>(msg.payload64);
+        std::memcpy(payload, record + kRecordHeaderSize, len);
+        std::memset(payload + len, 0, sizeof(msg.payload64) - len);
+        return true;
+    }
+}
+
+bool MavLinkIndexedLog::seek(uint64_t timestamp)
+{
+    if (map_ == nullptr) {
+        return false;
+    }
+    // first chunk that can contain the time, then scan inside it.
+    size_t index = std::lower_bound(max_end_time_.begin(), max_end_time_.end(), timestamp) - max_end_time_.begin();
+    for (; index < chunks_.size(); index++) {
+        if (!chunkMatchesFilter(index)) {
+            continue;
+        }
+        loadChunk(index);
+        while (chunk_pos_ + kRecordHeaderSize <= chunk_length_) {
+            const uint8_t* record = chunk_data_ + chunk_pos_;
+            uint32_t msgid = record[15] | (record[16] << 8) | (record[17] << 16);
+            if (getU64(record) >= timestamp && (filter_.size() == 0 || std::binary_search(filter_.begin(), filter_.end(), msgid))) {
+                return true;
+            }
+            chunk_pos_ += kRecordHeaderSize + record[9];
+        }
+    }
+    chunk_index_ = chunks_.size();
+    chunk_data_ = nullptr;
+    return false;
+}
+
+size_t MavLinkIndexedLog::replay(std::shared_ptr<MavLinkConnection> connection, double speed)
+{
+    replay_cancelled_ = false;
+    MavLinkMessage msg;
+    uint64_t timestamp;
+    uint64_t first_timestamp = 0;
+    size_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    const auto max_wait = std::chrono::milliseconds(100);
+
+    while (!replay_cancelled_ && read(msg, timestamp)) {
+        if (sent == 0) {
+            first_timestamp = timestamp;
+        }
+        if (speed > 0 && timestamp > first_timestamp) {
+            auto due = start + std::chrono::microseconds(static_cast<int64_t>((timestamp - first_timestamp) / speed));
+            // wait in slices so cancelReplay doesn't have to wait out a long gap in the log.
+            while (!replay_cancelled_) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= due) {
+                    break;
+                }
+                std::this_thread::sleep_until(std::min(due, now + max_wait));
+            }
+            if (replay_cancelled_) {
+                break;
+            }
+        }
+
+        // received mavlink2 messages were logged with their trimmed length, the connection wants the full payload.
+        const mavlink_msg_entry_t* entry = mavlink_get_msg_entry(msg.msgid);
+        if (entry != nullptr && msg.len < entry->msg_len) {
+            msg.len = entry->msg_len;
+        }
+        connection->sendMessage(msg);
+        sent++;
+    }
+    return sent;
+}
+
+void MavLinkIndexedLog::cancelReplay()
+{
+    replay_cancelled_ = true;
+}
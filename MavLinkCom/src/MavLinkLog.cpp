@@ -3,6 +3,7 @@
 
 #include "MavLinkLog.hpp"
 #include "Utils.hpp"
+#include "FileSystem.hpp"
 #include <chrono>
 
 using namespace mavlinkcom;
@@ -53,6 +54,8 @@ void MavLinkFileLog::openForWriting(const std::string& filename, bool json)
 	if (ptr_ == nullptr) {
 		throw std::runtime_error(Utils::stringf("Could not open the file %s, error=%d", filename.c_str(), errno));
 	}
+	// messages are only a few dozen bytes each so give the stream a bigger buffer and write in large blocks.
+	setvbuf(ptr_, nullptr, _IOFBF, kWriteBufferSize);
 	if (json) {
 		fprintf(ptr_, "{ \"rows\": [\n");
 	}
@@ -126,6 +129,13 @@ void MavLinkFileLog::write(const mavlinkcom::MavLinkMessage& msg, uint64_t times
 	}
 }
 
+void MavLinkFileLog::flush()
+{
+	if (ptr_ != nullptr && writing_) {
+		FileSystem::flushToDisk(ptr_);
+	}
+}
+
 bool MavLinkFileLog::read(mavlinkcom::MavLinkMessage& msg, uint64_t& timestamp)
 {
 	if (ptr_ != nullptr) {
@@ -8,25 +8,156 @@
 #include "../serial_com/SerialPort.hpp"
 #include "../serial_com/UdpClientPort.hpp"
 #include "../serial_com/TcpClientPort.hpp"
+#include <unordered_map>
+#include <algorithm>
 
 using namespace mavlink_utils;
 using namespace mavlinkcom_impl;
 
+std::atomic<bool> MavLinkConnectionImpl::use_shared_io_thread_(false);
+
+// Runs one subscriber's handler on a thread of its own.  The publisher thread is the only producer of its
+// queue, when the handler falls behind the publisher waits for room or drops the newest messages depending
+// on the connection's MavLinkQueuePolicy, the same as the reader does for the receive queue.
+class MavLinkConnectionImpl::SubscriberWorker
+{
+public:
+    static std::shared_ptr<SubscriberWorker> start(std::shared_ptr<MavLinkConnection> connection, MessageHandler handler, size_t capacity)
+    {
+        std::shared_ptr<SubscriberWorker> worker(new SubscriberWorker(connection, handler, capacity));
+        // the thread keeps the worker alive so it can also be stopped from inside its own handler.
+        worker->thread_ = std::thread(&SubscriberWorker::run, worker.get(), worker);
+        return worker;
+    }
+
+    ~SubscriberWorker()
+    {
+        if (thread_.joinable()) {
+            if (std::this_thread::get_id() == thread_.get_id()) {
+                thread_.detach();
+            }
+            else {
+                thread_.join();
+            }
+        }
+    }
+
+    // called only from the publisher thread.  If the queue is full it waits for room until cancel is set,
+    // or not at all if cancel is null, and returns false if the message could not be queued.
+    bool post(const MavLinkMessage& msg, const std::atomic<bool>* cancel)
+    {
+        MavLinkMessage* slot = queue_.beginWrite();
+        while (slot == nullptr && cancel != nullptr && !*cancel && !stop_) {
+            // the handler is busy so it doesn't need a wake up, poll like beginQueueMessage does.
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            slot = queue_.beginWrite();
+        }
+        if (slot == nullptr) {
+            return false;
+        }
+        ::memcpy(slot, &msg, sizeof(MavLinkMessage));
+        queue_.commitWrite();
+
+        // same handshake as commitQueueMessage/publishPackets.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.exchange(false)) {
+            available_.post();
+        }
+        return true;
+    }
+
+    void stop()
+    {
+        if (stop_.exchange(true)) {
+            return;
+        }
+        available_.post();
+        if (thread_.joinable() && std::this_thread::get_id() != thread_.get_id()) {
+            thread_.join();
+        }
+    }
+
+private:
+    SubscriberWorker(std::shared_ptr<MavLinkConnection> connection, MessageHandler handler, size_t capacity)
+        : connection_(connection), handler_(handler), queue_(capacity), waiting_(false), stop_(false)
+    {
+    }
+
+    void run(std::shared_ptr<SubscriberWorker> self)
+    {
+        while (!stop_) {
+            MavLinkMessage* msg;
+            while (!stop_ && (msg = queue_.front()) != nullptr) {
+                try {
+                    handler_(connection_, *msg);
+                }
+                catch (std::exception& e) {
+                    Utils::log(Utils::stringf("MavLinkConnectionImpl: Error handling message %d on subscriber thread, details: %s",
+                        msg->msgid, e.what()), Utils::kLogLevelError);
+                }
+                queue_.pop();
+            }
+            if (stop_) {
+                break;
+            }
+
+            waiting_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!queue_.empty()) {
+                if (waiting_.exchange(false)) {
+                    continue;
+                }
+            }
+            available_.wait();
+            waiting_.store(false);
+        }
+        // release the connection here rather than whenever the last table referencing us goes away.
+        connection_ = nullptr;
+        handler_ = nullptr;
+        self = nullptr;
+    }
+
+    std::shared_ptr<MavLinkConnection> connection_;
+    MessageHandler handler_;
+    SpscRingBuffer<MavLinkMessage> queue_;
+    Semaphore available_;
+    std::atomic<bool> waiting_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+struct MavLinkConnectionImpl::Subscriber {
+    int id;
+    MessageHandler handler;
+    std::vector<uint32_t> msgids;                   // sorted, empty means every message
+    std::shared_ptr<SubscriberWorker> worker;       // null means the handler runs on the publisher thread
+};
+
+// Immutable once published.  Each msgid that somebody subscribed to maps to its subscribers with the
+// wildcard subscribers merged in, all in subscription order, every other msgid goes to the wildcard list.
+struct MavLinkConnectionImpl::DispatchTable {
+    std::unordered_map<uint32_t, std::vector<Subscriber*>> by_msgid;
+    std::vector<Subscriber*> wildcard;
+    std::vector<std::shared_ptr<Subscriber>> owners; // keeps the subscribers alive while the table is in use
+};
+
 MavLinkConnectionImpl::MavLinkConnectionImpl()
+    : dispatch_table_(std::make_shared<DispatchTable>()), dispatch_version_(1), subscriber_drops_(0),
+    msg_queue_(kMessageQueueCapacity), waiting_for_msg_(false), queue_policy_(MavLinkQueuePolicy::Block),
+    messages_queued_(0), messages_dropped_(0), reader_stalls_(0), queue_high_water_(0),
+    messages_sent_(0), messages_received_(0), messages_handled_(0), crc_errors_(0), handler_microseconds_(0)
 {
-    // add our custom telemetry message length.
-    telemetry_.crcErrors = 0;
-    telemetry_.handlerMicroseconds = 0;
-    telemetry_.messagesHandled = 0;
-    telemetry_.messagesReceived = 0;
-    telemetry_.messagesSent = 0;
-    telemetry_.renderTime = 0;
     closed = true;
     ::memset(&mavlink_intermediate_status_, 0, sizeof(mavlink_status_t));
     ::memset(&mavlink_status_, 0, sizeof(mavlink_status_t));
     // todo: if we support signing then initialize
     // mavlink_intermediate_status_.signing callbacks
 }
+void MavLinkConnectionImpl::setSharedIoThread(bool enable)
+{
+    use_shared_io_thread_ = enable;
+}
+
 std::string MavLinkConnectionImpl::getName() {
     return name;
 }
@@ -108,8 +239,13 @@ void MavLinkConnectionImpl::startListening(std::shared_ptr<MavLinkConnection> pa
     closed = false;
     port = connectedPort;
 
+    mavlink_intermediate_status_.parse_state = MAVLINK_PARSE_STATE_IDLE;
     Utils::cleanupThread(read_thread);
-    read_thread = std::thread{ &MavLinkConnectionImpl::readPackets, this };
+    async_read_ = use_shared_io_thread_ && port->startAsyncRead(
+        std::bind(&MavLinkConnectionImpl::processReceivedBytes, this, std::placeholders::_1, std::placeholders::_2));
+    if (!async_read_) {
+        read_thread = std::thread{ &MavLinkConnectionImpl::readPackets, this };
+    }
     Utils::cleanupThread(publish_thread_);
     publish_thread_ = std::thread{ &MavLinkConnectionImpl::publishPackets, this };
 }
@@ -117,12 +253,23 @@ void MavLinkConnectionImpl::startListening(std::shared_ptr<MavLinkConnection> pa
 // log every message that is "sent" using sendMessage.
 void MavLinkConnectionImpl::startLoggingSendMessage(std::shared_ptr<MavLinkLog> log)
 {
-    sendLog_ = log;
+    std::atomic_store(&sendLog_, log);
 }
 
 void MavLinkConnectionImpl::stopLoggingSendMessage()
 {
-    sendLog_ = nullptr;
+    std::atomic_store(&sendLog_, std::shared_ptr<MavLinkLog>());
+}
+
+// log every message that is received, this is done on the publisher thread just before the subscribers see it.
+void MavLinkConnectionImpl::startLoggingReceiveMessage(std::shared_ptr<MavLinkLog> log)
+{
+    std::atomic_store(&receiveLog_, log);
+}
+
+void MavLinkConnectionImpl::stopLoggingReceiveMessage()
+{
+    std::atomic_store(&receiveLog_, std::shared_ptr<MavLinkLog>());
 }
 
 void MavLinkConnectionImpl::close()
@@ -140,7 +287,9 @@ void MavLinkConnectionImpl::close()
         msg_available_.post();
         publish_thread_.join();
     }
-    sendLog_ = nullptr;
+    stopSubscriberWorkers();
+    stopLoggingSendMessage();
+    stopLoggingReceiveMessage();
 }
 
 bool MavLinkConnectionImpl::isOpen()
@@ -178,30 +327,9 @@ void MavLinkConnectionImpl::sendMessage(const MavLinkMessage& m)
     }
 
     {
-        MavLinkMessage msg;
-        ::memcpy(&msg, &m, sizeof(MavLinkMessage));
-        prepareForSending(msg);
-
-        if (sendLog_ != nullptr)
-        {
-            sendLog_->write(msg);
-        }
-
-        mavlink_message_t message;
-        message.compid = msg.compid;
-        message.sysid = msg.sysid;
-        message.len = msg.len;
-        message.checksum = msg.checksum;
-        message.magic = msg.magic;
-        message.incompat_flags = msg.incompat_flags;
-        message.compat_flags = msg.compat_flags;
-        message.seq = msg.seq;
-        message.msgid = msg.msgid;
-        ::memcpy(message.signature, msg.signature, 13);
-        ::memcpy(message.payload64, msg.payload64, PayloadSize * sizeof(uint64_t));
-        
+        // the frame is serialized straight from the caller's message into our write buffer which is handed to the port.
         std::lock_guard<std::mutex> guard(buffer_mutex);
-        unsigned len = mavlink_msg_to_send_buffer(message_buf, &message);
+        int len = serializeFrame(m, message_buf);
 
         try {
             port->write(message_buf, len);
@@ -209,45 +337,85 @@ void MavLinkConnectionImpl::sendMessage(const MavLinkMessage& m)
         catch (std::exception& e) {
             throw std::runtime_error(Utils::stringf("MavLinkConnectionImpl: Error sending message on connection '%s', details: %s", name.c_str(), e.what()));
         }
-    }
-    {
-        std::lock_guard<std::mutex> guard(telemetry_mutex_);
-        telemetry_.messagesSent++;
-    }
 
+        // log after the frame is on its way so logging never delays the send.
+        logSentFrame(m, message_buf);
+    }
+    messages_sent_.fetch_add(1, std::memory_order_relaxed);
 }
 
-int MavLinkConnectionImpl::prepareForSending(MavLinkMessage& msg)
+void MavLinkConnectionImpl::sendMessages(const std::vector<MavLinkMessage>& messages)
 {
-    // as per  https://github.com/mavlink/mavlink/blob/master/doc/MAVLink2.md
-    int seqno = getNextSequence();
+    if (closed || messages.size() == 0) {
+        return;
+    }
 
-    bool mavlink1 = !supports_mavlink2_;
-    bool signing = !mavlink1 && mavlink_status_.signing && (mavlink_status_.signing->flags & MAVLINK_SIGNING_FLAG_SIGN_OUTGOING);
-    uint8_t signature_len = signing ? MAVLINK_SIGNATURE_BLOCK_LEN : 0;
+    int count = 0;
+    {
+        // serialize every frame into one batch buffer and hand them to the port together (sendmmsg for UDP on Linux).
+        std::lock_guard<std::mutex> guard(buffer_mutex);
+        batch_buf_.resize(messages.size() * MAVLINK_MAX_PACKET_LEN);
+        batch_frames_.resize(messages.size());
+        batch_lengths_.resize(messages.size());
+        batch_sources_.resize(messages.size());
+        for (const MavLinkMessage& m : messages) {
+            if (ignored_messageids.find(m.msgid) != ignored_messageids.end())
+                continue;
+            uint8_t* frame = &batch_buf_[count * MAVLINK_MAX_PACKET_LEN];
+            batch_lengths_[count] = serializeFrame(m, frame);
+            batch_frames_[count] = frame;
+            batch_sources_[count] = &m;
+            count++;
+        }
 
-    uint8_t header_len = MAVLINK_CORE_HEADER_LEN + 1;
-    uint8_t buf[MAVLINK_CORE_HEADER_LEN + 1];
-    if (mavlink1) {
-        msg.magic = MAVLINK_STX_MAVLINK1;
-        header_len = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1;
+        try {
+            port->writeBatch(batch_frames_.data(), batch_lengths_.data(), count);
+        }
+        catch (std::exception& e) {
+            throw std::runtime_error(Utils::stringf("MavLinkConnectionImpl: Error sending messages on connection '%s', details: %s", name.c_str(), e.what()));
+        }
+
+        for (int i = 0; i < count; i++) {
+            logSentFrame(*batch_sources_[i], batch_frames_[i]);
+        }
     }
-    else {
-        msg.magic = MAVLINK_STX;
+    messages_sent_.fetch_add(count, std::memory_order_relaxed);
+}
+
+// must be called with buffer_mutex held.
+void MavLinkConnectionImpl::logSentFrame(const MavLinkMessage& m, const uint8_t* frame)
+{
+    std::shared_ptr<MavLinkLog> log = std::atomic_load(&sendLog_);
+    if (log != nullptr)
+    {
+        MavLinkMessage msg;
+        ::memcpy(&msg, &m, sizeof(MavLinkMessage));
+        frameToMessage(frame, msg);
+        log->write(msg);
     }
+}
 
-    msg.seq = seqno;
-    msg.incompat_flags = 0;
-    if (signing_) {
-        msg.incompat_flags |= MAVLINK_IFLAG_SIGNED;
+int MavLinkConnectionImpl::prepareForSending(MavLinkMessage& msg)
+{
+    uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+    int len;
+    {
+        std::lock_guard<std::mutex> guard(buffer_mutex);
+        len = serializeFrame(msg, frame);
     }
-    msg.compat_flags = 0;
+    frameToMessage(frame, msg);
+    return len;
+}
 
-    // pack the payload buffer.
-    char* payload = reinterpret_cast<char*>(&msg.payload64[0]);
-    int len = msg.len;
+// must be called with buffer_mutex held, writes the wire format of msg to buf which must hold MAVLINK_MAX_PACKET_LEN bytes
+// and returns the frame length.
+int MavLinkConnectionImpl::serializeFrame(const MavLinkMessage& msg, uint8_t* buf)
+{
+    // as per  https://github.com/mavlink/mavlink/blob/master/doc/MAVLink2.md
+    bool mavlink1 = !supports_mavlink2_;
+    bool signing = !mavlink1 && signing_ && mavlink_status_.signing && (mavlink_status_.signing->flags & MAVLINK_SIGNING_FLAG_SIGN_OUTGOING);
+    int header_len = mavlink1 ? MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 : MAVLINK_CORE_HEADER_LEN + 1;
 
-    // calculate checksum
     const mavlink_msg_entry_t* entry = mavlink_get_msg_entry(msg.msgid);
     uint8_t crc_extra = 0;
     int msglen = 0;
@@ -258,50 +426,78 @@ int MavLinkConnectionImpl::prepareForSending(MavLinkMessage& msg)
     if (msg.msgid == MavLinkTelemetry::kMessageId) {
         msglen = 28; // mavlink doesn't know about our custom telemetry message.
     }
-    if (len != msglen) {
-        throw std::runtime_error(Utils::stringf("Message length %d doesn't match expected length%d\n", len, msglen));
+    if (msg.len != msglen) {
+        throw std::runtime_error(Utils::stringf("Message length %d doesn't match expected length%d\n", msg.len, msglen));
     }
-    msg.len = mavlink1 ? msglen : _mav_trim_payload(payload, msglen);
 
-    // form the header as a byte array for the crc
-    buf[0] = msg.magic;
-    buf[1] = msg.len;
+    const char* payload = reinterpret_cast<const char*>(&msg.payload64[0]);
+    uint8_t len = mavlink1 ? static_cast<uint8_t>(msglen) : _mav_trim_payload(payload, static_cast<uint8_t>(msglen));
+
+    uint8_t seqno = next_seq++;
+    buf[1] = len;
     if (mavlink1) {
-        buf[2] = msg.seq;
+        buf[0] = MAVLINK_STX_MAVLINK1;
+        buf[2] = seqno;
         buf[3] = msg.sysid;
         buf[4] = msg.compid;
         buf[5] = msg.msgid & 0xFF;
     }
     else {
-        buf[2] = msg.incompat_flags;
-        buf[3] = msg.compat_flags;
-        buf[4] = msg.seq;
+        buf[0] = MAVLINK_STX;
+        buf[2] = signing ? MAVLINK_IFLAG_SIGNED : 0; // incompat_flags
+        buf[3] = 0; // compat_flags
+        buf[4] = seqno;
         buf[5] = msg.sysid;
         buf[6] = msg.compid;
         buf[7] = msg.msgid & 0xFF;
         buf[8] = (msg.msgid >> 8) & 0xFF;
         buf[9] = (msg.msgid >> 16) & 0xFF;
     }
+    ::memcpy(buf + header_len, payload, len);
+
+    // the crc covers everything after the magic byte, computed over the bytes as they will go on the wire.
+    uint16_t checksum = crc_calculate(buf + 1, static_cast<uint16_t>(header_len - 1 + len));
+    crc_accumulate(crc_extra, &checksum);
+    buf[header_len + len] = static_cast<uint8_t>(checksum & 0xFF);
+    buf[header_len + len + 1] = static_cast<uint8_t>(checksum >> 8);
+
+    if (signing) {
+        mavlink_sign_packet(mavlink_status_.signing, buf + header_len + len + 2,
+            buf, static_cast<uint8_t>(header_len), buf + header_len, len, buf + header_len + len);
+        return header_len + len + 2 + MAVLINK_SIGNATURE_BLOCK_LEN;
+    }
+    return header_len + len + 2;
+}
 
-    msg.checksum = crc_calculate(&buf[1], header_len - 1);
-    crc_accumulate_buffer(&msg.checksum, payload, msg.len);
-    crc_accumulate(crc_extra, &msg.checksum);
+// fill in the header fields of msg from a frame produced by serializeFrame, this is what prepareForSending returns.
+void MavLinkConnectionImpl::frameToMessage(const uint8_t* frame, MavLinkMessage& msg)
+{
+    msg.magic = frame[0];
+    msg.len = frame[1];
+    msg.incompat_flags = 0;
+    msg.compat_flags = 0;
+    int header_len;
+    if (msg.magic == MAVLINK_STX_MAVLINK1) {
+        header_len = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1;
+        msg.seq = frame[2];
+    }
+    else {
+        header_len = MAVLINK_CORE_HEADER_LEN + 1;
+        msg.incompat_flags = frame[2];
+        msg.seq = frame[4];
+    }
+    uint8_t ck_a = frame[header_len + msg.len];
+    uint8_t ck_b = frame[header_len + msg.len + 1];
+    if (msg.incompat_flags & MAVLINK_IFLAG_SIGNED) {
+        ::memcpy(msg.signature, frame + header_len + msg.len + 2, MAVLINK_SIGNATURE_BLOCK_LEN);
+    }
+    msg.checksum = static_cast<uint16_t>(ck_a | (ck_b << 8));
 
     // these macros use old style cast.
     STRICT_MODE_OFF
-    mavlink_ck_a(&msg) = (uint8_t)(msg.checksum & 0xFF);
-    mavlink_ck_b(&msg) = (uint8_t)(msg.checksum >> 8);
+    mavlink_ck_a(&msg) = ck_a;
+    mavlink_ck_b(&msg) = ck_b;
     STRICT_MODE_ON
-
-    if (signing_) {
-        mavlink_sign_packet(mavlink_status_.signing,
-            reinterpret_cast<uint8_t *>(msg.signature),
-            reinterpret_cast<const uint8_t *>(message_buf), header_len,
-            reinterpret_cast<const uint8_t *>(payload), msg.len,
-            reinterpret_cast<const uint8_t *>(payload) + msg.len);
-    }
-
-    return msg.len + header_len + 2 + signature_len;
 }
 
 void MavLinkConnectionImpl::sendMessage(const MavLinkMessageBase& msg)
@@ -313,22 +509,91 @@ void MavLinkConnectionImpl::sendMessage(const MavLinkMessageBase& msg)
 
 int MavLinkConnectionImpl::subscribe(MessageHandler handler)
 {
-    MessageHandlerEntry entry = { static_cast<int>(listeners.size() + 1), handler = handler };
+    return subscribe(std::vector<uint32_t>(), handler, false);
+}
+
+int MavLinkConnectionImpl::subscribe(const std::vector<uint32_t>& msgids, MessageHandler handler, bool ownThread)
+{
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->handler = handler;
+    subscriber->msgids = msgids;
+    std::sort(subscriber->msgids.begin(), subscriber->msgids.end());
+    subscriber->msgids.erase(std::unique(subscriber->msgids.begin(), subscriber->msgids.end()), subscriber->msgids.end());
+    if (ownThread) {
+        subscriber->worker = SubscriberWorker::start(con_, handler, kSubscriberQueueCapacity);
+    }
+
+    // the replaced table is released after the lock, it may be the last owner of handlers that call unsubscribe when destroyed.
+    std::shared_ptr<const DispatchTable> replaced;
     std::lock_guard<std::mutex> guard(listener_mutex);
-    listeners.push_back(entry);
-    snapshot_stale = true;
-    return entry.id;
+    subscriber->id = next_subscriber_id_++;
+    listeners.push_back(subscriber);
+    replaced = publishDispatchTable();
+    return subscriber->id;
 }
+
 void MavLinkConnectionImpl::unsubscribe(int id)
 {
-    std::lock_guard<std::mutex> guard(listener_mutex);
-    for (auto ptr = listeners.begin(), end = listeners.end(); ptr != end; ptr++)
+    std::shared_ptr<Subscriber> removed;
     {
-        if ((*ptr).id == id)
+        std::lock_guard<std::mutex> guard(listener_mutex);
+        for (auto ptr = listeners.begin(), end = listeners.end(); ptr != end; ptr++)
         {
-            listeners.erase(ptr);
-            snapshot_stale = true;
-            break;
+            if ((*ptr)->id == id)
+            {
+                removed = *ptr;
+                listeners.erase(ptr);
+                publishDispatchTable();
+                break;
+            }
+        }
+    }
+    // a worker is joined outside the lock in case its handler is busy subscribing or unsubscribing.
+    if (removed != nullptr && removed->worker != nullptr) {
+        removed->worker->stop();
+    }
+}
+
+// must be called with listener_mutex held, returns the table that was replaced.
+std::shared_ptr<const MavLinkConnectionImpl::DispatchTable> MavLinkConnectionImpl::publishDispatchTable()
+{
+    auto table = std::make_shared<DispatchTable>();
+    table->owners = listeners;
+    for (const auto& subscriber : listeners) {
+        for (uint32_t msgid : subscriber->msgids) {
+            table->by_msgid[msgid];
+        }
+    }
+    for (const auto& subscriber : listeners) {
+        if (subscriber->msgids.size() == 0) {
+            table->wildcard.push_back(subscriber.get());
+            for (auto& entry : table->by_msgid) {
+                entry.second.push_back(subscriber.get());
+            }
+        }
+        else {
+            for (uint32_t msgid : subscriber->msgids) {
+                table->by_msgid[msgid].push_back(subscriber.get());
+            }
+        }
+    }
+
+    std::shared_ptr<const DispatchTable> replaced = std::atomic_load(&dispatch_table_);
+    std::atomic_store(&dispatch_table_, std::shared_ptr<const DispatchTable>(table));
+    dispatch_version_.fetch_add(1, std::memory_order_release);
+    return replaced;
+}
+
+void MavLinkConnectionImpl::stopSubscriberWorkers()
+{
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    {
+        std::lock_guard<std::mutex> guard(listener_mutex);
+        subscribers = listeners;
+    }
+    for (const auto& subscriber : subscribers) {
+        if (subscriber->worker != nullptr) {
+            subscriber->worker->stop();
         }
     }
 }
@@ -349,27 +614,23 @@ void MavLinkConnectionImpl::joinRightSubscriber(std::shared_ptr<MavLinkConnectio
 
 void MavLinkConnectionImpl::join(std::shared_ptr<MavLinkConnection> remote, bool subscribeToLeft, bool subscribeToRight)
 {
+    // forwarding sends on another connection, so give it its own thread rather than holding up our other subscribers.
     if (subscribeToLeft)
-        this->subscribe(std::bind(&MavLinkConnectionImpl::joinLeftSubscriber, this, remote, std::placeholders::_1, std::placeholders::_2));
+        this->subscribe(std::vector<uint32_t>(), std::bind(&MavLinkConnectionImpl::joinLeftSubscriber, this, remote, std::placeholders::_1, std::placeholders::_2), true);
 
     if (subscribeToRight)
-        remote->subscribe(std::bind(&MavLinkConnectionImpl::joinRightSubscriber, this, std::placeholders::_1, std::placeholders::_2));
+        remote->subscribe(std::vector<uint32_t>(), std::bind(&MavLinkConnectionImpl::joinRightSubscriber, this, std::placeholders::_1, std::placeholders::_2), true);
 }
 
 void MavLinkConnectionImpl::readPackets()
 {
     //CurrentThread::setMaximumPriority();
     std::shared_ptr<Port> safePort = this->port;
-    mavlink_message_t msg;
-    mavlink_message_t msgBuffer; // intermediate state.
     const int MAXBUFFER = 512;
     uint8_t* buffer = new uint8_t[MAXBUFFER];
-    mavlink_intermediate_status_.parse_state = MAVLINK_PARSE_STATE_IDLE;
-    int channel = 0;
     int hr = 0;
     while (hr == 0 && con_ != nullptr && !closed)
     {
-        int read = 0;
         if (safePort->isClosed())
         {
             // hmmm, wait till it is opened?
@@ -377,119 +638,264 @@ void MavLinkConnectionImpl::readPackets()
             continue;
         }
 
+        // the port read blocks until data arrives (waking up periodically to check for close) so there is no need to sleep here.
         int count = safePort->read(buffer, MAXBUFFER);
-        if (count <= 0) {
+        if (count < 0) {
             // error? well let's try again, but we should be careful not to spin too fast and kill the CPU
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
-        for (int i = 0; i < count; i++)
-        {
-            uint8_t frame_state = mavlink_frame_char_buffer(&msgBuffer, &mavlink_intermediate_status_, buffer[i], &msg, &mavlink_status_);
+        processReceivedBytes(buffer, count);
+
+    } //while
+
+    delete[]  buffer;
+
+} //readPackets
 
-            if (frame_state == MAVLINK_FRAMING_INCOMPLETE) {
+// called from readPackets or, for connections served by the shared I/O thread, straight from the port.
+void MavLinkConnectionImpl::processReceivedBytes(const uint8_t* buffer, int count)
+{
+    mavlink_message_t& msg = rx_message_;
+    mavlink_message_t& msgBuffer = rx_buffer_; // intermediate state.
+    for (int i = 0; i < count; i++)
+    {
+        if (mavlink_intermediate_status_.parse_state <= MAVLINK_PARSE_STATE_IDLE) {
+            int consumed = decodeFrameInPlace(buffer + i, count - i);
+            if (consumed > 0) {
+                i += consumed - 1;
                 continue;
             }
-            else if (frame_state == MAVLINK_FRAMING_BAD_CRC) {
-                std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                telemetry_.crcErrors++;
-            }
-            else if (frame_state == MAVLINK_FRAMING_OK)
-            {
-                int msgId = msg.msgid;
+        }
 
-                // pick up the sysid/compid of the remote node we are connected to.
-                if (other_system_id == -1) {
-                    other_system_id = msg.sysid;
-                    other_component_id = msg.compid;
-                }
+        uint8_t frame_state = mavlink_frame_char_buffer(&msgBuffer, &mavlink_intermediate_status_, buffer[i], &msg, &mavlink_status_);
 
-                if (mavlink_intermediate_status_.flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1)
-                {
-                    // then this is a mavlink 1 message
-                } else {
-                    // then this mavlink sender supports mavlink 2
-                    supports_mavlink2_ = true;
-                }
+        if (frame_state == MAVLINK_FRAMING_INCOMPLETE) {
+            continue;
+        }
+        else if (frame_state == MAVLINK_FRAMING_BAD_CRC) {
+            crc_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (frame_state == MAVLINK_FRAMING_OK)
+        {
+            // this frame was split across reads (or is signed) so it went through the byte at a time parser.
+            onFrameReceived(msg.sysid, msg.compid, (mavlink_intermediate_status_.flags & MAVLINK_STATUS_FLAG_IN_MAVLINK1) == 0);
 
-                if (con_ != nullptr && !closed)
-                {
-                    {
-                        std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                        telemetry_.messagesReceived++;
-                    }
-                    // queue event for publishing.
-                    {
-                        std::lock_guard<std::mutex> guard(msg_queue_mutex_);
-                        MavLinkMessage message;
-                        message.compid = msg.compid;
-                        message.sysid = msg.sysid;
-                        message.len = msg.len;
-                        message.checksum = msg.checksum;
-                        message.magic = msg.magic;
-                        message.incompat_flags = msg.incompat_flags;
-                        message.compat_flags = msg.compat_flags;
-                        message.seq = msg.seq;
-                        message.msgid = msg.msgid;
-                        ::memcpy(message.signature, msg.signature, 13);
-                        ::memcpy(message.payload64, msg.payload64, PayloadSize * sizeof(uint64_t));
-                        msg_queue_.push(message);
-                    }
-                    if (waiting_for_msg_) {
-                        msg_available_.post();
-                    }
+            if (con_ != nullptr && !closed)
+            {
+                messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+                // queue event for publishing.
+                MavLinkMessage* message = beginQueueMessage();
+                if (message != nullptr) {
+                    message->compid = msg.compid;
+                    message->sysid = msg.sysid;
+                    message->len = msg.len;
+                    message->checksum = msg.checksum;
+                    message->magic = msg.magic;
+                    message->incompat_flags = msg.incompat_flags;
+                    message->compat_flags = msg.compat_flags;
+                    message->seq = msg.seq;
+                    message->msgid = msg.msgid;
+                    ::memcpy(message->signature, msg.signature, 13);
+                    ::memcpy(message->payload64, msg.payload64, PayloadSize * sizeof(uint64_t));
+                    commitQueueMessage();
                 }
             }
-            else {
-                std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                telemetry_.crcErrors++;
+        }
+        else {
+            crc_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MavLinkConnectionImpl::onFrameReceived(uint8_t sysid, uint8_t compid, bool mavlink2)
+{
+    // pick up the sysid/compid of the remote node we are connected to.
+    if (other_system_id == -1) {
+        other_system_id = sysid;
+        other_component_id = compid;
+    }
+
+    if (mavlink2) {
+        // then this mavlink sender supports mavlink 2
+        supports_mavlink2_ = true;
+    }
+}
+
+// Fast path for the common case where a whole frame is sitting in the receive buffer, which is always true for UDP datagrams.
+// The crc is checked on the received bytes in place and the frame is decoded straight into the queue slot, skipping the
+// byte at a time parser and its intermediate mavlink_message_t copies.  Returns the number of bytes consumed, or 0 if these
+// bytes have to go through mavlink_frame_char_buffer instead (not a frame start, partial frame, signed frame).
+int MavLinkConnectionImpl::decodeFrameInPlace(const uint8_t* data, int available)
+{
+    bool mavlink1;
+    int header_len;
+    if (data[0] == MAVLINK_STX) {
+        mavlink1 = false;
+        header_len = MAVLINK_CORE_HEADER_LEN + 1;
+    }
+    else if (data[0] == MAVLINK_STX_MAVLINK1) {
+        mavlink1 = true;
+        header_len = MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1;
+    }
+    else {
+        return 0;
+    }
+    if (available < header_len) {
+        return 0;
+    }
+
+    uint8_t len = data[1];
+    int frame_len = header_len + len + 2;
+    if (available < frame_len || (!mavlink1 && data[2] != 0)) {
+        // incompat_flags means signing (or something we don't know about), let the full parser deal with it.
+        return 0;
+    }
+
+    uint32_t msgid = mavlink1 ? data[5] : (data[7] | (data[8] << 8) | (data[9] << 16));
+    const mavlink_msg_entry_t* entry = mavlink_get_msg_entry(msgid);
+    uint16_t checksum = crc_calculate(data + 1, static_cast<uint16_t>(header_len - 1 + len));
+    crc_accumulate(entry != nullptr ? entry->crc_extra : 0, &checksum);
+    const uint8_t* ck = data + header_len + len;
+    if (ck[0] != (checksum & 0xFF) || ck[1] != (checksum >> 8)) {
+        crc_errors_.fetch_add(1, std::memory_order_relaxed);
+        return frame_len;
+    }
+
+    uint8_t sysid = mavlink1 ? data[3] : data[5];
+    uint8_t compid = mavlink1 ? data[4] : data[6];
+    onFrameReceived(sysid, compid, !mavlink1);
+
+    if (con_ != nullptr && !closed)
+    {
+        messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+        MavLinkMessage* message = beginQueueMessage();
+        if (message != nullptr) {
+            message->checksum = checksum;
+            message->magic = data[0];
+            message->len = len;
+            message->incompat_flags = 0;
+            message->compat_flags = mavlink1 ? 0 : data[3];
+            message->seq = mavlink1 ? data[2] : data[4];
+            message->sysid = sysid;
+            message->compid = compid;
+            message->msgid = msgid;
+            message->ck[0] = ck[0];
+            message->ck[1] = ck[1];
+            char* payload = reinterpret_cast<char*>(message->payload64);
+            ::memcpy(payload, data + header_len, len);
+            // zero-fill the payload to cope with trimmed mavlink 2 payloads, same as mavlink_frame_char_buffer.
+            if (entry != nullptr && len < entry->msg_len) {
+                ::memset(payload + len, 0, entry->msg_len - len);
             }
-        }	
+            commitQueueMessage();
+        }
+    }
+    return frame_len;
+}
 
-    } //while
+// called on the readPackets thread, returns the queue slot to fill or nullptr if the message has to be dropped.
+MavLinkMessage* MavLinkConnectionImpl::beginQueueMessage()
+{
+    MavLinkMessage* slot = msg_queue_.beginWrite();
+    if (slot != nullptr) {
+        return slot;
+    }
 
-    delete[]  buffer;
+    // the shared I/O thread serves other connections too so it never waits on our subscribers.
+    if (queue_policy_.load(std::memory_order_relaxed) == MavLinkQueuePolicy::DropNewest || async_read_) {
+        messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
 
-} //readPackets
+    // backpressure: wait for the publisher to catch up, the port buffers absorb the incoming data meanwhile.
+    reader_stalls_.fetch_add(1, std::memory_order_relaxed);
+    while (!closed) {
+        if (waiting_for_msg_.exchange(false)) {
+            msg_available_.post();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        slot = msg_queue_.beginWrite();
+        if (slot != nullptr) {
+            return slot;
+        }
+    }
+    messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+void MavLinkConnectionImpl::commitQueueMessage()
+{
+    msg_queue_.commitWrite();
+    messages_queued_.fetch_add(1, std::memory_order_relaxed);
+
+    // only this thread writes the high water mark so a relaxed load/store pair is enough.
+    uint32_t queued = static_cast<uint32_t>(msg_queue_.size());
+    if (queued > queue_high_water_.load(std::memory_order_relaxed)) {
+        queue_high_water_.store(queued, std::memory_order_relaxed);
+    }
+
+    // pairs with the fence in publishPackets so that either the publisher sees this message
+    // before it goes to sleep or we see that it is waiting and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_for_msg_.exchange(false)) {
+        msg_available_.post();
+    }
+}
 
 void MavLinkConnectionImpl::drainQueue()
 {
-    MavLinkMessage message;
-    bool hasMsg = true;
-    while (hasMsg) {
-        hasMsg = false;
-        {
-            std::lock_guard<std::mutex> guard(msg_queue_mutex_);
-            if (!msg_queue_.empty()) {
-                message = msg_queue_.front();
-                msg_queue_.pop();
-                hasMsg = true;
-            }
-        }
-        if (!hasMsg)
+    std::shared_ptr<MavLinkLog> log = std::atomic_load(&receiveLog_);
+    while (true) {
+        // handlers get a reference to the queue slot itself, it is only released back to the reader after they return.
+        MavLinkMessage* queued = msg_queue_.front();
+        if (queued == nullptr)
         {
             return;
         }
+        const MavLinkMessage& message = *queued;
         // publish the message from this thread, this is safer than publishing from the readPackets thread
         // as it ensures we don't lose messages if the listener is slow.
-        if (snapshot_stale) {
-            // this is tricky, the clear has to be done outside the lock because it is destructing the handlers
-            // and the handler might try and call unsubscribe, which needs to be able to grab the lock, otherwise
-            // we would get a deadlock.
-            snapshot.clear();
+        uint64_t version = dispatch_version_.load(std::memory_order_acquire);
+        if (version != snapshot_version_) {
+            // dropping our reference to the old table may destroy handlers, which is fine here because we don't hold
+            // listener_mutex so a handler destructor can still call unsubscribe.
+            dispatch_snapshot_ = std::atomic_load(&dispatch_table_);
+            snapshot_version_ = version;
+        }
+        const DispatchTable& table = *dispatch_snapshot_;
+        const std::vector<Subscriber*>* subscribers = &table.wildcard;
+        if (table.by_msgid.size() > 0) {
+            auto found = table.by_msgid.find(message.msgid);
+            if (found != table.by_msgid.end()) {
+                subscribers = &found->second;
+            }
+        }
 
-            std::lock_guard<std::mutex> guard(listener_mutex);
-            snapshot = listeners;
-            snapshot_stale = false;
+        if (log != nullptr) {
+            try {
+                log->write(message);
+            }
+            catch (std::exception& e) {
+                Utils::log(Utils::stringf("MavLinkConnectionImpl: Error logging message %d on connection '%s', details: %s",
+                    message.msgid, name.c_str(), e.what()), Utils::kLogLevelError);
+            }
         }
-        auto end = snapshot.end();
 
-        auto startTime = std::chrono::system_clock::now();
-        std::shared_ptr<MavLinkConnection> sharedPtr = std::shared_ptr<MavLinkConnection>(this->con_);
-        for (auto ptr = snapshot.begin(); ptr != end; ptr++)
+        auto startTime = std::chrono::steady_clock::now();
+        bool drop_newest = queue_policy_.load(std::memory_order_relaxed) == MavLinkQueuePolicy::DropNewest;
+        for (Subscriber* subscriber : *subscribers)
         {
+            if (subscriber->worker != nullptr) {
+                if (!subscriber->worker->post(message, drop_newest ? nullptr : &closed)) {
+                    subscriber_drops_.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
             try {
-                (*ptr).handler(sharedPtr, message);
+                subscriber->handler(con_, message);
             }
             catch (std::exception& e) {
                 Utils::log(Utils::stringf("MavLinkConnectionImpl: Error handling message %d on connection '%s', details: %s",
@@ -497,13 +903,14 @@ void MavLinkConnectionImpl::drainQueue()
             }
         }
 
+        msg_queue_.pop();
+
         {
-            auto endTime = std::chrono::system_clock::now();
+            auto endTime = std::chrono::steady_clock::now();
             auto diff = endTime - startTime;
             long microseconds = static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count());
-            std::lock_guard<std::mutex> guard(telemetry_mutex_);
-            telemetry_.messagesHandled++;
-            telemetry_.handlerMicroseconds += microseconds;
+            messages_handled_.fetch_add(1, std::memory_order_relaxed);
+            handler_microseconds_.fetch_add(static_cast<uint32_t>(microseconds), std::memory_order_relaxed);
         }
     }
 }
@@ -514,25 +921,48 @@ void MavLinkConnectionImpl::publishPackets()
     while (!closed) {
 
         drainQueue();
-        
-        waiting_for_msg_ = true;
+
+        // announce we are going to sleep and then look at the queue once more, a message committed in between
+        // is either seen here or the reader sees the flag and posts the semaphore.
+        waiting_for_msg_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!msg_queue_.empty()) {
+            if (waiting_for_msg_.exchange(false)) {
+                continue;
+            }
+            // reader already cleared the flag and posted, fall through and consume that post.
+        }
         msg_available_.wait();
-        waiting_for_msg_ = false;
+        waiting_for_msg_.store(false);
     }
 }
 
+void MavLinkConnectionImpl::setQueuePolicy(MavLinkQueuePolicy policy)
+{
+    queue_policy_.store(policy, std::memory_order_relaxed);
+}
+
+void MavLinkConnectionImpl::getQueueStats(MavLinkQueueStats& result)
+{
+    result.messagesQueued = messages_queued_.load(std::memory_order_relaxed);
+    result.messagesDropped = messages_dropped_.load(std::memory_order_relaxed);
+    result.readerStalls = reader_stalls_.load(std::memory_order_relaxed);
+    result.capacity = static_cast<uint32_t>(msg_queue_.capacity());
+    result.highWaterMark = queue_high_water_.load(std::memory_order_relaxed);
+    result.subscriberDrops = subscriber_drops_.load(std::memory_order_relaxed);
+}
+
 void MavLinkConnectionImpl::getTelemetry(MavLinkTelemetry& result)
 {
-    std::lock_guard<std::mutex> guard(telemetry_mutex_);
-    result = telemetry_;
-    // reset counters 
-    telemetry_.crcErrors = 0;
-    telemetry_.handlerMicroseconds = 0;
-    telemetry_.messagesHandled = 0;
-    telemetry_.messagesReceived = 0;
-    telemetry_.messagesSent = 0;
-    telemetry_.renderTime = 0;
-    if (telemetry_.wifiInterfaceName != nullptr) {
-        telemetry_.wifiRssi = port->getRssi(telemetry_.wifiInterfaceName);
+    // swap each counter back to zero so nothing counted between the reads is lost.
+    result.crcErrors = crc_errors_.exchange(0);
+    result.handlerMicroseconds = handler_microseconds_.exchange(0);
+    result.messagesHandled = messages_handled_.exchange(0);
+    result.messagesReceived = messages_received_.exchange(0);
+    result.messagesSent = messages_sent_.exchange(0);
+    result.renderTime = 0;
+    result.wifiRssi = 0;
+    if (result.wifiInterfaceName != nullptr && port != nullptr) {
+        result.wifiRssi = port->getRssi(result.wifiInterfaceName);
     }
 }
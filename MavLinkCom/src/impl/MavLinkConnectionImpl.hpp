@@ -6,13 +6,14 @@
 
 #include <memory>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <unordered_set>
 #include "MavLinkConnection.hpp"
 #include "MavLinkMessageBase.hpp"
 #include "Semaphore.hpp"
+#include "SpscRingBuffer.hpp"
 #include "../serial_com/TcpClientPort.hpp"
 #include "StrictMode.hpp"
 #define MAVLINK_PACKED
@@ -44,15 +45,22 @@ namespace mavlinkcom_impl {
 		void startListening(std::shared_ptr<MavLinkConnection> parent, const std::string& nodeName, std::shared_ptr<Port>  connectedPort);
 		void startLoggingSendMessage(std::shared_ptr<MavLinkLog> log);
 		void stopLoggingSendMessage();
+		void startLoggingReceiveMessage(std::shared_ptr<MavLinkLog> log);
+		void stopLoggingReceiveMessage();
 		void close();
         bool isOpen();
 		void sendMessage(const MavLinkMessageBase& msg);
 		void sendMessage(const MavLinkMessage& msg);
+		void sendMessages(const std::vector<MavLinkMessage>& messages);
+		static void setSharedIoThread(bool enable);
 		int subscribe(MessageHandler handler);
+		int subscribe(const std::vector<uint32_t>& msgids, MessageHandler handler, bool ownThread);
 		void unsubscribe(int id);		
 		uint8_t getNextSequence();
 		void join(std::shared_ptr<MavLinkConnection> remote, bool subscribeToLeft = true, bool subscribeToRight = true);
 		void getTelemetry(MavLinkTelemetry& result);
+		void setQueuePolicy(MavLinkQueuePolicy policy);
+		void getQueueStats(MavLinkQueueStats& result);
         void ignoreMessage(uint8_t message_id);
         int prepareForSending(MavLinkMessage& msg);
 	private:
@@ -61,7 +69,20 @@ namespace mavlinkcom_impl {
         void joinRightSubscriber(std::shared_ptr<MavLinkConnection>con, const MavLinkMessage& msg);
 		void publishPackets();
 		void readPackets();
+		void processReceivedBytes(const uint8_t* buffer, int count);
 		void drainQueue();
+		int decodeFrameInPlace(const uint8_t* data, int available);
+		void onFrameReceived(uint8_t sysid, uint8_t compid, bool mavlink2);
+		int serializeFrame(const MavLinkMessage& msg, uint8_t* buf);
+		void frameToMessage(const uint8_t* frame, MavLinkMessage& msg);
+		void logSentFrame(const MavLinkMessage& m, const uint8_t* frame);
+		MavLinkMessage* beginQueueMessage();
+		void commitQueueMessage();
+		struct Subscriber;
+		struct DispatchTable;
+		class SubscriberWorker;
+		std::shared_ptr<const DispatchTable> publishDispatchTable();
+		void stopSubscriberWorkers();
 		std::string name;
 		std::shared_ptr<Port> port;
 		std::shared_ptr<MavLinkConnection> con_;
@@ -71,31 +92,54 @@ namespace mavlinkcom_impl {
 		std::thread read_thread;
 		std::string accept_node_name_;
 		std::shared_ptr<TcpClientPort> server_;
-		std::shared_ptr<MavLinkLog> sendLog_;
+		std::shared_ptr<MavLinkLog> sendLog_; // both logs are swapped with std::atomic_store while messages flow.
+		std::shared_ptr<MavLinkLog> receiveLog_;
 
-		struct MessageHandlerEntry {
-		public:
-			int id;
-			MessageHandler handler;
-		};
-		std::vector<MessageHandlerEntry> listeners;
-		std::vector<MessageHandlerEntry> snapshot;
-		bool snapshot_stale;
+		// subscribe/unsubscribe edit listeners under listener_mutex and publish a new immutable DispatchTable,
+		// the publisher thread only reloads its dispatch_snapshot_ when dispatch_version_ changes so the per message
+		// cost is one atomic load, and an old table is freed by whoever drops the last reference to it.
+		std::vector<std::shared_ptr<Subscriber>> listeners;
+		int next_subscriber_id_ = 1;
 		std::mutex listener_mutex;
-		uint8_t message_buf[300]; // must be bigger than sizeof(mavlink_message_t), which is currently 292.
+		std::shared_ptr<const DispatchTable> dispatch_table_;
+		std::atomic<uint64_t> dispatch_version_;
+		std::shared_ptr<const DispatchTable> dispatch_snapshot_;
+		uint64_t snapshot_version_ = 0;
+		static const size_t kSubscriberQueueCapacity = 1024;
+		std::atomic<uint64_t> subscriber_drops_;
+		uint8_t message_buf[MAVLINK_MAX_PACKET_LEN]; // write buffer that outgoing frames are serialized into.
+		std::vector<uint8_t> batch_buf_; // same for sendMessages, along with where each frame starts and its length.
+		std::vector<const uint8_t*> batch_frames_;
+		std::vector<const MavLinkMessage*> batch_sources_;
+		std::vector<int> batch_lengths_;
 		std::mutex buffer_mutex;
-		bool closed;
+		std::atomic<bool> closed;
 		std::thread publish_thread_;
-		std::queue<MavLinkMessage> msg_queue_;
-		std::mutex msg_queue_mutex_;
+		// readPackets is the only producer and publishPackets the only consumer.
+		static const size_t kMessageQueueCapacity = 1024;
+		mavlink_utils::SpscRingBuffer<MavLinkMessage> msg_queue_;
 		mavlink_utils::Semaphore msg_available_;
-		bool waiting_for_msg_ = false;
+		std::atomic<bool> waiting_for_msg_;
+		std::atomic<MavLinkQueuePolicy> queue_policy_;
+		std::atomic<uint64_t> messages_queued_;
+		std::atomic<uint64_t> messages_dropped_;
+		std::atomic<uint64_t> reader_stalls_;
+		std::atomic<uint32_t> queue_high_water_;
         bool supports_mavlink2_ = false;
         bool signing_ = false;
         mavlink_status_t mavlink_intermediate_status_;
         mavlink_status_t mavlink_status_;
-        std::mutex telemetry_mutex_;
-		MavLinkTelemetry telemetry_;
+        mavlink_message_t rx_message_;
+        mavlink_message_t rx_buffer_;
+        // true when the port delivers data from the shared SocketEventLoop thread instead of our read_thread.
+        bool async_read_ = false;
+        static std::atomic<bool> use_shared_io_thread_;
+        // counters are bumped from the reader, publisher and sender threads, getTelemetry swaps them back to zero.
+        std::atomic<uint32_t> messages_sent_;
+        std::atomic<uint32_t> messages_received_;
+        std::atomic<uint32_t> messages_handled_;
+        std::atomic<uint32_t> crc_errors_;
+        std::atomic<uint32_t> handler_microseconds_;
         std::unordered_set<uint8_t> ignored_messageids;
 	};
 }
@@ -106,7 +106,7 @@ bool MavLinkFtpClientImpl::isSupported()
 void MavLinkFtpClientImpl::subscribe() 
 {
     if (subscription_ == 0) {
-        subscription_ = getConnection()->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        subscription_ = getConnection()->subscribe({ static_cast<uint32_t>(MavLinkMessageIds::MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
             unused(connection);
             handleResponse(msg);
         });
@@ -108,7 +108,7 @@ AsyncResult<MavLinkAutopilotVersion> MavLinkNodeImpl::getCapabilities()
         con->unsubscribe(state);
     });
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
+    int subscription = con->subscribe({ static_cast<uint32_t>(MavLinkMessageIds::MAVLINK_MSG_ID_AUTOPILOT_VERSION) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
         unused(connection);
         if (m.msgid == static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_AUTOPILOT_VERSION))
         {
@@ -140,7 +140,7 @@ AsyncResult<MavLinkHeartbeat>  MavLinkNodeImpl::waitForHeartbeat()
         con->unsubscribe(state);
     });
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
+    int subscription = con->subscribe({ static_cast<uint32_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HEARTBEAT) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
         unused(connection);
         if (m.msgid == static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HEARTBEAT))
         {
@@ -277,7 +277,7 @@ std::vector<MavLinkParameter> MavLinkNodeImpl::getParamList()
     size_t paramCount = 0;
 
     auto con = ensureConnection();
-    int subscription = con->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId)
         {
@@ -403,7 +403,7 @@ AsyncResult<MavLinkParameter> MavLinkNodeImpl::getParameter(const std::string& n
     cmd.target_component = getTargetComponentId();
     cmd.target_system = getTargetSystemId();
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId)
         {
@@ -440,7 +440,7 @@ AsyncResult<MavLinkParameter> MavLinkNodeImpl::getParameterByIndex(int16_t index
     cmd.target_component = getTargetComponentId();
     cmd.target_system = getTargetSystemId();
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId)
         {
@@ -500,7 +500,7 @@ AsyncResult<bool> MavLinkNodeImpl::setParameter(MavLinkParameter  p)
     sendMessage(setparam);
 
     // confirmation of the PARAM_SET is to receive the updated PARAM_VALUE.
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId)
         {
@@ -565,7 +565,7 @@ AsyncResult<bool> MavLinkNodeImpl::sendCommandAndWaitForAck(MavLinkCommand& comm
 
     uint16_t cmd = command.command;
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage&  message) {
+    int subscription = con->subscribe({ MavLinkCommandAck::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage&  message) {
         unused(connection);
         if (message.msgid == MavLinkCommandAck::kMessageId)
         {
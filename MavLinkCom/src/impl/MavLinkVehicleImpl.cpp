@@ -126,7 +126,7 @@ AsyncResult<MavLinkHomePosition> MavLinkVehicleImpl::waitForHomePosition()
 
     this->setMessageInterval(static_cast<int>(MavLinkMessageIds::MAVLINK_MSG_ID_HOME_POSITION), 1);
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
+    int subscription = con->subscribe({ static_cast<uint32_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HOME_POSITION) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
         unused(connection);
         if (m.msgid == static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HOME_POSITION)) {
             MavLinkHomePosition pos;
@@ -495,7 +495,7 @@ AsyncResult<bool> MavLinkVehicleImpl::waitForAltitude(float z, float dz, float d
         con->unsubscribe(subscription);
     });
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
+    int subscription = con->subscribe({ MavLinkLocalPositionNed::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
         unused(connection);
         if (m.msgid == static_cast<uint8_t>(MavLinkLocalPositionNed::kMessageId)) {
             MavLinkLocalPositionNed pos;
@@ -4,6 +4,7 @@
 #ifndef PORT_H
 #define PORT_H
 #include <stdint.h>
+#include <functional>
 
 class Port
 {
@@ -22,5 +23,23 @@ public:
 
     virtual int getRssi(const char* ifaceName) = 0;
 
+	// write several separate packets in one go (one datagram each for UDP), return number of packets written.
+	virtual int writeBatch(const uint8_t* const* buffers, const int* counts, int packets)
+	{
+		for (int i = 0; i < packets; i++) {
+			write(buffers[i], counts[i]);
+		}
+		return packets;
+	}
+
+	// Event driven alternative to calling read() from a dedicated thread: the port delivers each chunk of
+	// received bytes to the handler on the shared SocketEventLoop thread until it is closed.  Returns false
+	// if this port or platform doesn't support it, in which case the caller keeps using read().
+	typedef std::function<void(const uint8_t* buffer, int count)> ReadHandler;
+	virtual bool startAsyncRead(ReadHandler /*handler*/)
+	{
+		return false;
+	}
+
 };
 #endif // !PORT_H
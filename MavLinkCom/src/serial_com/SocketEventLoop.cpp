@@ -0,0 +1,210 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "SocketEventLoop.hpp"
+#include "Utils.hpp"
+#include <stdexcept>
+
+using namespace mavlink_utils;
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+
+class SocketEventLoop::EventLoopImpl
+{
+	static const int kMaxEvents = 64;
+
+	int epoll_fd_ = -1;
+	int wake_fd_ = -1;
+	bool stop_ = false;
+	std::thread thread_;
+
+	// handlers are looked up under the lock but called outside it, remove() waits on dispatch_done_
+	// until the loop thread has finished with the handler being removed.
+	std::mutex mutex_;
+	std::condition_variable dispatch_done_;
+	std::unordered_map<int, std::shared_ptr<ReadyHandler>> handlers_;
+	int dispatching_fd_ = -1;
+
+public:
+	EventLoopImpl()
+	{
+		epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+		wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (epoll_fd_ < 0 || wake_fd_ < 0) {
+			throw std::runtime_error(Utils::stringf("SocketEventLoop could not create epoll instance, error: %d\n", errno));
+		}
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.fd = wake_fd_;
+		epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+		thread_ = std::thread(&EventLoopImpl::run, this);
+	}
+
+	~EventLoopImpl()
+	{
+		{
+			std::lock_guard<std::mutex> guard(mutex_);
+			stop_ = true;
+		}
+		wake();
+		if (thread_.joinable()) {
+			thread_.join();
+		}
+		::close(wake_fd_);
+		::close(epoll_fd_);
+	}
+
+	bool add(int fd, ReadyHandler handler)
+	{
+		std::lock_guard<std::mutex> guard(mutex_);
+		handlers_[fd] = std::make_shared<ReadyHandler>(handler);
+
+		// level triggered so a handler that doesn't drain everything is simply called again.
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLRDHUP;
+		ev.data.fd = fd;
+		if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			handlers_.erase(fd);
+			throw std::runtime_error(Utils::stringf("SocketEventLoop could not watch socket, error: %d\n", errno));
+		}
+		return true;
+	}
+
+	void remove(int fd)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (handlers_.erase(fd) == 0) {
+			return;
+		}
+		epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+		if (std::this_thread::get_id() != thread_.get_id()) {
+			dispatch_done_.wait(lock, [this, fd] { return dispatching_fd_ != fd; });
+		}
+	}
+
+private:
+	void wake()
+	{
+		uint64_t one = 1;
+		ssize_t rc = ::write(wake_fd_, &one, sizeof(one));
+		unused(rc);
+	}
+
+	void run()
+	{
+		epoll_event events[kMaxEvents];
+		while (true) {
+			int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+			if (count < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				Utils::log(Utils::stringf("SocketEventLoop epoll_wait failed with error: %d", errno), Utils::kLogLevelError);
+				return;
+			}
+
+			for (int i = 0; i < count; i++) {
+				int fd = events[i].data.fd;
+				std::shared_ptr<ReadyHandler> handler;
+				{
+					std::lock_guard<std::mutex> guard(mutex_);
+					if (stop_) {
+						return;
+					}
+					if (fd == wake_fd_) {
+						uint64_t value;
+						ssize_t rc = ::read(wake_fd_, &value, sizeof(value));
+						unused(rc);
+						continue;
+					}
+					auto found = handlers_.find(fd);
+					if (found == handlers_.end()) {
+						// removed while we were waiting.
+						continue;
+					}
+					handler = found->second;
+					dispatching_fd_ = fd;
+				}
+
+				try {
+					(*handler)();
+				}
+				catch (std::exception& e) {
+					Utils::log(Utils::stringf("SocketEventLoop handler failed: %s", e.what()), Utils::kLogLevelError);
+				}
+
+				{
+					std::lock_guard<std::mutex> guard(mutex_);
+					dispatching_fd_ = -1;
+				}
+				dispatch_done_.notify_all();
+			}
+		}
+	}
+};
+
+bool SocketEventLoop::isSupported()
+{
+	return true;
+}
+
+#else
+
+class SocketEventLoop::EventLoopImpl
+{
+public:
+	bool add(int fd, ReadyHandler handler)
+	{
+		unused(fd);
+		unused(handler);
+		return false;
+	}
+
+	void remove(int fd)
+	{
+		unused(fd);
+	}
+};
+
+bool SocketEventLoop::isSupported()
+{
+	return false;
+}
+
+#endif
+
+SocketEventLoop& SocketEventLoop::shared()
+{
+	static SocketEventLoop loop;
+	return loop;
+}
+
+SocketEventLoop::SocketEventLoop()
+{
+	impl_.reset(new EventLoopImpl());
+}
+
+SocketEventLoop::~SocketEventLoop()
+{
+	impl_ = nullptr;
+}
+
+bool SocketEventLoop::add(int fd, ReadyHandler handler)
+{
+	return impl_->add(fd, handler);
+}
+
+void SocketEventLoop::remove(int fd)
+{
+	impl_->remove(fd);
+}
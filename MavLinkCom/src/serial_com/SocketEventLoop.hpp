@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef SERIAL_COM_SOCKETEVENTLOOP_HPP
+#define SERIAL_COM_SOCKETEVENTLOOP_HPP
+
+#include <functional>
+#include <memory>
+
+// A single I/O thread that waits on many sockets at once (epoll on Linux) and calls a handler
+// on that thread whenever one of them becomes readable.  This lets one process serve dozens of
+// connections without a blocking read thread per connection.  On other platforms isSupported()
+// returns false and the ports keep using their own blocking read.
+class SocketEventLoop
+{
+public:
+	// called on the event loop thread when the socket has data to read (or has been closed by the peer).
+	typedef std::function<void()> ReadyHandler;
+
+	// the process wide loop, the thread is started on first use.
+	static SocketEventLoop& shared();
+	static bool isSupported();
+
+	SocketEventLoop();
+	~SocketEventLoop();
+
+	// start watching the given socket, returns false if this platform has no event loop.
+	bool add(int fd, ReadyHandler handler);
+
+	// stop watching the given socket.  When this returns the handler is not running and won't be called
+	// again, so the caller can safely close the socket (unless called from the handler itself).
+	void remove(int fd);
+
+	//don't allow copies
+	SocketEventLoop(SocketEventLoop const&) = delete;
+	void operator=(SocketEventLoop const&) = delete;
+
+private:
+	class EventLoopImpl;
+	std::unique_ptr<EventLoopImpl> impl_;
+};
+
+#endif // SERIAL_COM_SOCKETEVENTLOOP_HPP
@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <string.h>
 #include "SocketInit.hpp"
+#include "SocketEventLoop.hpp"
 #include "wifi.h"
+#include <vector>
 
 using namespace mavlink_utils;
 
@@ -35,6 +37,7 @@ static bool socket_initialized_ = false;
 #include <errno.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <poll.h>
 typedef int SOCKET;
 const int INVALID_SOCKET = -1;
 const int ERROR_ACCESS_DENIED = EACCES;
@@ -54,6 +57,30 @@ class TcpClientPort::TcpSocketImpl
 	sockaddr_in localaddr;
 	sockaddr_in remoteaddr;
 	bool closed_ = true;
+
+	// blocking reads wake up this often to notice that the port has been closed.
+	static const int kReadTimeoutMs = 100;
+
+	// state for event driven reads, see startAsyncRead.
+	static const int kAsyncBufferSize = 8192;
+	bool async_ = false;
+	Port::ReadHandler handler_;
+	std::vector<uint8_t> async_buffer_;
+
+	bool waitReadable()
+	{
+#ifdef _WIN32
+		// closesocket already wakes up a blocked recv on windows.
+		return true;
+#else
+		pollfd pfd;
+		pfd.fd = sock;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return ::poll(&pfd, 1, kReadTimeoutMs) > 0;
+#endif
+	}
+
 public:
 
 	bool isClosed() {
@@ -181,6 +208,11 @@ public:
 
 		while (!closed_)
 		{
+			if (!waitReadable())
+			{
+				continue;
+			}
+
 			socklen_t addrlen = sizeof(sockaddr_in);
 			int rc = recv(sock, reinterpret_cast<char*>(result), bytesToRead, 0);
 			if (rc < 0)
@@ -224,16 +256,50 @@ public:
 		return -1;
 	}
 
+	bool startAsyncRead(Port::ReadHandler handler)
+	{
+		if (closed_ || async_ || !SocketEventLoop::isSupported()) {
+			return false;
+		}
+		handler_ = handler;
+		async_buffer_.resize(kAsyncBufferSize);
+		async_ = SocketEventLoop::shared().add(static_cast<int>(sock), [this]() { onReadable(); });
+		return async_;
+	}
+
+	void onReadable()
+	{
+#ifndef _WIN32
+		int rc = recv(sock, reinterpret_cast<char*>(async_buffer_.data()), kAsyncBufferSize, MSG_DONTWAIT);
+		if (rc > 0)
+		{
+			handler_(async_buffer_.data(), rc);
+		}
+		else if (rc == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+		{
+			// remote end has gone away, stop watching it so the loop doesn't keep waking up for it.
+			SocketEventLoop::shared().remove(static_cast<int>(sock));
+		}
+#endif
+	}
 
 	void close()
 	{
 		if (!closed_) {
 			closed_ = true;
 
+			if (async_) {
+				// after this returns the event loop is no longer touching this socket or our buffer.
+				SocketEventLoop::shared().remove(static_cast<int>(sock));
+				async_ = false;
+			}
+
 #ifdef _WIN32
 			closesocket(sock);
 #else
 			int fd = static_cast<int>(sock);
+			// wake up a reader blocked on this socket right away.
+			::shutdown(fd, SHUT_RDWR);
 			::close(fd);
 #endif
 		}
@@ -287,6 +353,11 @@ TcpClientPort::read(uint8_t* buffer, int bytesToRead)
 	return impl_->read(buffer, bytesToRead);
 }
 
+bool TcpClientPort::startAsyncRead(ReadHandler handler)
+{
+	return impl_->startAsyncRead(handler);
+}
+
 bool TcpClientPort::isClosed()
 {
 	return impl_->isClosed();
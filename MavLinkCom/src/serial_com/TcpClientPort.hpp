@@ -26,6 +26,9 @@ public:
 	// read some bytes from the port, return the number of bytes read or -1 if error.
 	int read(uint8_t* buffer, int bytesToRead);
 
+	// deliver received bytes from the shared SocketEventLoop thread instead (Linux only).
+	bool startAsyncRead(ReadHandler handler);
+
 	// close the port.
 	void close();
 
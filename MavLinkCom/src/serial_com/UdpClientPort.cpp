@@ -6,7 +6,10 @@
 #include <stdio.h>
 #include <string.h>
 #include "SocketInit.hpp"
+#include "SocketEventLoop.hpp"
 #include "wifi.h"
+#include <vector>
+#include <algorithm>
 
 using namespace mavlink_utils;
 
@@ -35,6 +38,7 @@ static bool socket_initialized_ = false;
 #include <errno.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <poll.h>
 typedef int SOCKET;
 const int INVALID_SOCKET = -1;
 const int ERROR_ACCESS_DENIED = EACCES;
@@ -55,6 +59,51 @@ class UdpClientPort::UdpSocketImpl
 	sockaddr_in remoteaddr;
 	bool hasRemote = false;
 	bool closed_ = true;
+
+	// blocking reads wake up this often to notice that the port has been closed.
+	static const int kReadTimeoutMs = 100;
+
+	// state for event driven reads, see startAsyncRead.
+	bool async_ = false;
+	Port::ReadHandler handler_;
+#if defined(__linux__)
+	static const int kBatchSize = 16;
+	static const int kMaxDatagram = 2048;
+	std::vector<uint8_t> batch_buffer_;
+	mmsghdr batch_msgs_[kBatchSize];
+	iovec batch_iovs_[kBatchSize];
+	sockaddr_in batch_addrs_[kBatchSize];
+#endif
+
+	// remembers the first sender if we don't have a remote yet, returns false for packets from anyone else.
+	bool acceptSender(const sockaddr_in& other)
+	{
+		if (remoteaddr.sin_port == 0)
+		{
+			// we now have it.
+			remoteaddr.sin_family = other.sin_family;
+			remoteaddr.sin_addr = other.sin_addr;
+			remoteaddr.sin_port = other.sin_port;
+			return true;
+		}
+		// otherwise this is from someone we are not interested in.
+		return other.sin_addr.s_addr == remoteaddr.sin_addr.s_addr;
+	}
+
+	bool waitReadable()
+	{
+#ifdef _WIN32
+		// closesocket already wakes up a blocked recvfrom on windows.
+		return true;
+#else
+		pollfd pfd;
+		pfd.fd = sock;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return ::poll(&pfd, 1, kReadTimeoutMs) > 0;
+#endif
+	}
+
 public:
 
 	bool isClosed() {
@@ -173,6 +222,106 @@ public:
 		return hr;
 	}
 
+	int writeBatch(const uint8_t* const* buffers, const int* counts, int packets)
+	{
+#if defined(__linux__)
+		if (remoteaddr.sin_port == 0)
+		{
+			// same as write, we don't know who to send to yet.
+			return 0;
+		}
+
+		// one sendmmsg system call for up to kBatchSize datagrams.
+		int sent = 0;
+		while (sent < packets)
+		{
+			mmsghdr msgs[kBatchSize];
+			iovec iovs[kBatchSize];
+			int batch = std::min(packets - sent, static_cast<int>(kBatchSize));
+			memset(msgs, 0, sizeof(mmsghdr) * batch);
+			for (int i = 0; i < batch; i++)
+			{
+				iovs[i].iov_base = const_cast<uint8_t*>(buffers[sent + i]);
+				iovs[i].iov_len = counts[sent + i];
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_name = &remoteaddr;
+				msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			}
+			int rc = sendmmsg(sock, msgs, batch, 0);
+			if (rc < 0)
+			{
+				int hr = WSAGetLastError();
+				if (hr == EINTR) {
+					continue;
+				}
+				remoteaddr.sin_port = 0;
+				throw std::runtime_error(Utils::stringf("UdpClientPort socket send failed with error: %d\n", hr));
+			}
+			sent += rc;
+		}
+		return sent;
+#else
+		for (int i = 0; i < packets; i++)
+		{
+			write(buffers[i], counts[i]);
+		}
+		return packets;
+#endif
+	}
+
+	bool startAsyncRead(Port::ReadHandler handler)
+	{
+#if defined(__linux__)
+		if (closed_ || async_) {
+			return false;
+		}
+		handler_ = handler;
+
+		// preallocate the receive batch, recvmmsg fills up to kBatchSize datagrams per wake up.
+		batch_buffer_.resize(kBatchSize * kMaxDatagram);
+		memset(batch_msgs_, 0, sizeof(batch_msgs_));
+		for (int i = 0; i < kBatchSize; i++)
+		{
+			batch_iovs_[i].iov_base = &batch_buffer_[i * kMaxDatagram];
+			batch_iovs_[i].iov_len = kMaxDatagram;
+			batch_msgs_[i].msg_hdr.msg_iov = &batch_iovs_[i];
+			batch_msgs_[i].msg_hdr.msg_iovlen = 1;
+			batch_msgs_[i].msg_hdr.msg_name = &batch_addrs_[i];
+		}
+
+		async_ = SocketEventLoop::shared().add(static_cast<int>(sock), [this]() { onReadable(); });
+		return async_;
+#else
+		unused(handler);
+		return false;
+#endif
+	}
+
+#if defined(__linux__)
+	void onReadable()
+	{
+		for (int i = 0; i < kBatchSize; i++)
+		{
+			batch_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		}
+		int count = recvmmsg(sock, batch_msgs_, kBatchSize, MSG_DONTWAIT, nullptr);
+		if (count <= 0)
+		{
+			// EAGAIN, EINTR or a pending ICMP error which this call has now cleared, the loop calls us again if needed.
+			return;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			int len = static_cast<int>(batch_msgs_[i].msg_len);
+			if (len > 0 && acceptSender(batch_addrs_[i]))
+			{
+				handler_(&batch_buffer_[i * kMaxDatagram], len);
+			}
+		}
+	}
+#endif
+
 	int read(uint8_t* result, int bytesToRead)
 	{
 		sockaddr_in other;
@@ -182,6 +331,11 @@ public:
 
 		while (!closed_)
 		{
+			if (!waitReadable())
+			{
+				continue;
+			}
+
 			socklen_t addrlen = sizeof(sockaddr_in);
 			#if defined (__APPLE__)
 			int rc = ::read(sock, reinterpret_cast<char*>(result), bytesToRead);
@@ -224,16 +378,8 @@ public:
 				}
 			}
 
-			if (remoteaddr.sin_port == 0)
-			{
-				// we now have it.
-				remoteaddr.sin_family = other.sin_family;
-				remoteaddr.sin_addr = other.sin_addr;
-				remoteaddr.sin_port = other.sin_port;
-			}
-			else if (other.sin_addr.s_addr != remoteaddr.sin_addr.s_addr)
+			if (!acceptSender(other))
 			{
-				// this is from someone we are not interested in.
 				continue;
 			}
 
@@ -256,10 +402,18 @@ public:
 		if (!closed_) {
 			closed_ = true;
 
+			if (async_) {
+				// after this returns the event loop is no longer touching this socket or our buffers.
+				SocketEventLoop::shared().remove(static_cast<int>(sock));
+				async_ = false;
+			}
+
 #ifdef _WIN32
 			closesocket(sock);
 #else
 			int fd = static_cast<int>(sock);
+			// wake up a reader blocked on this socket right away.
+			::shutdown(fd, SHUT_RDWR);
 			::close(fd);
 #endif
 		}
@@ -308,6 +462,16 @@ UdpClientPort::read(uint8_t* buffer, int bytesToRead)
 	return impl_->read(buffer, bytesToRead);
 }
 
+int UdpClientPort::writeBatch(const uint8_t* const* buffers, const int* counts, int packets)
+{
+	return impl_->writeBatch(buffers, counts, packets);
+}
+
+bool UdpClientPort::startAsyncRead(ReadHandler handler)
+{
+	return impl_->startAsyncRead(handler);
+}
+
 bool UdpClientPort::isClosed()
 {
 	return impl_->isClosed();
@@ -25,6 +25,12 @@ public:
 	// read some bytes from the port, return the number of bytes read or -1 if error.
 	int read(uint8_t* buffer, int bytesToRead);
 
+	// send each buffer as its own datagram, using a single sendmmsg call on Linux.
+	int writeBatch(const uint8_t* const* buffers, const int* counts, int packets);
+
+	// deliver received datagrams from the shared SocketEventLoop thread, batched with recvmmsg (Linux only).
+	bool startAsyncRead(ReadHandler handler);
+
 	// close the port.
 	void close();
 
@@ -9,6 +9,8 @@ import os
 import inspect
 import types
 import re
+import struct
+import socket
 
 
 class MsgpackMixin:
@@ -31,6 +33,15 @@ class AirSimImageType:
     Segmentation = 5
     SurfaceNormals = 6
 
+# how the server encodes an image, anything but Default is done on the server's encoder threads.
+# DepthU16 is depth as uint16 millimeters, Lz4 data is the uncompressed size as uint32 followed by an LZ4 block
+class ImageEncoding:
+    Default = 0
+    Raw = 1
+    PngFast = 2
+    Lz4 = 3
+    DepthU16 = 4
+
 class DrivetrainType:
     MaxDegreeOfFreedom = 0
     ForwardOnly = 1
@@ -98,12 +109,14 @@ class ImageRequest(MsgpackMixin):
     image_type = AirSimImageType.Scene
     pixels_as_float = False
     compress = False
+    encoding = ImageEncoding.Default
 
-    def __init__(self, camera_id, image_type, pixels_as_float = False, compress = True):
+    def __init__(self, camera_id, image_type, pixels_as_float = False, compress = True, encoding = ImageEncoding.Default):
         self.camera_id = camera_id
         self.image_type = image_type
         self.pixels_as_float = pixels_as_float
         self.compress = compress
+        self.encoding = encoding
 
 
 class ImageResponse(MsgpackMixin):
@@ -118,6 +131,7 @@ class ImageResponse(MsgpackMixin):
     width = 0
     height = 0
     image_type = AirSimImageType.Scene
+    encoding = ImageEncoding.Default
 
 class CarControls(MsgpackMixin):
     throttle = np.float32(0)
@@ -138,6 +152,237 @@ class CarControls(MsgpackMixin):
             manual_gear = -1
             throttle = - abs(throttle_val)
 
+class TelemetryFields:
+    Kinematics = 1
+    Gps = 2
+    RCData = 4
+    Collision = 8
+    LandedState = 16
+    All = 31
+
+class TelemetryFrame:
+    sequence = 0
+    step = 0
+    timestamp = 0
+    fields = 0
+    position = None
+    velocity = None
+    orientation = None
+    gps_location = None
+    rc_data = None
+    collision_info = None
+    landed_state = None
+
+    # decodes a batch from getTelemetryFrames, layout is documented in DroneTelemetry.hpp
+    @staticmethod
+    def decode_batch(data):
+        version, count, dropped = struct.unpack_from('<HHI', data, 0)
+        if version != 1:
+            raise ValueError('unsupported telemetry version %d' % version)
+        frames = []
+        offset = 8
+        for i in range(count):
+            size, fields, sequence, step, timestamp = struct.unpack_from('<HHIQQ', data, offset)
+            frame = TelemetryFrame()
+            frame.fields, frame.sequence, frame.step, frame.timestamp = fields, sequence, step, timestamp
+            p = offset + 24
+            if fields & TelemetryFields.Kinematics:
+                v = struct.unpack_from('<10f', data, p)
+                frame.position = Vector3r(v[0], v[1], v[2])
+                frame.velocity = Vector3r(v[3], v[4], v[5])
+                frame.orientation = Quaternionr(v[7], v[8], v[9], v[6])
+                p += 40
+            if fields & TelemetryFields.Gps:
+                frame.gps_location = GeoPoint()
+                frame.gps_location.latitude, frame.gps_location.longitude, frame.gps_location.altitude = struct.unpack_from('<ddf', data, p)
+                p += 20
+            if fields & TelemetryFields.RCData:
+                v = struct.unpack_from('<Q4f8IB', data, p)
+                frame.rc_data = {'timestamp': v[0], 'pitch': v[1], 'roll': v[2], 'throttle': v[3], 'yaw': v[4],
+                    'switches': list(v[5:13]), 'is_initialized': bool(v[13] & 1), 'is_valid': bool(v[13] & 2)}
+                p += 57
+            if fields & TelemetryFields.Collision:
+                v = struct.unpack_from('<B10fQIi', data, p)
+                c = CollisionInfo()
+                c.has_collided = bool(v[0])
+                c.normal = Vector3r(v[1], v[2], v[3])
+                c.impact_point = Vector3r(v[4], v[5], v[6])
+                c.position = Vector3r(v[7], v[8], v[9])
+                c.penetration_depth, c.time_stamp, c.collision_count, c.object_id = v[10], v[11], v[12], v[13]
+                frame.collision_info = c
+                p += 57
+            if fields & TelemetryFields.LandedState:
+                frame.landed_state = struct.unpack_from('<B', data, p)[0]
+            frames.append(frame)
+            offset += size
+        return frames, dropped
+
+class WorldSnapshotFields:
+    Kinematics = 1
+    Collision = 2
+    Imu = 4
+    Gps = 8
+    Barometer = 16
+    Magnetometer = 32
+    All = 63
+
+# state of all vehicles at one physics step, each column is a numpy array with a row per vehicle
+# (in vehicle_names order), columns of groups that were not requested are None
+class WorldSnapshot:
+    # (group, name, dtype, components) in the order server sends them
+    columns = [
+        (WorldSnapshotFields.Kinematics, 'position', '<f4', 3),
+        (WorldSnapshotFields.Kinematics, 'orientation', '<f4', 4), # w, x, y, z
+        (WorldSnapshotFields.Kinematics, 'linear_velocity', '<f4', 3),
+        (WorldSnapshotFields.Kinematics, 'angular_velocity', '<f4', 3),
+        (WorldSnapshotFields.Kinematics, 'linear_acceleration', '<f4', 3),
+        (WorldSnapshotFields.Kinematics, 'angular_acceleration', '<f4', 3),
+        (WorldSnapshotFields.Collision, 'has_collided', 'u1', 1),
+        (WorldSnapshotFields.Collision, 'collision_normal', '<f4', 3),
+        (WorldSnapshotFields.Collision, 'collision_impact_point', '<f4', 3),
+        (WorldSnapshotFields.Collision, 'collision_penetration_depth', '<f4', 1),
+        (WorldSnapshotFields.Collision, 'collision_time_stamp', '<u8', 1),
+        (WorldSnapshotFields.Collision, 'collision_count', '<u4', 1),
+        (WorldSnapshotFields.Collision, 'collision_object_id', '<i4', 1),
+        (WorldSnapshotFields.Imu, 'imu_valid', 'u1', 1),
+        (WorldSnapshotFields.Imu, 'imu_orientation', '<f4', 4),
+        (WorldSnapshotFields.Imu, 'imu_angular_velocity', '<f4', 3),
+        (WorldSnapshotFields.Imu, 'imu_linear_acceleration', '<f4', 3),
+        (WorldSnapshotFields.Gps, 'gps_valid', 'u1', 1),
+        (WorldSnapshotFields.Gps, 'gps_geo_point', '<f8', 3), # latitude, longitude, altitude
+        (WorldSnapshotFields.Gps, 'gps_eph', '<f4', 1),
+        (WorldSnapshotFields.Gps, 'gps_epv', '<f4', 1),
+        (WorldSnapshotFields.Gps, 'gps_velocity', '<f4', 3),
+        (WorldSnapshotFields.Gps, 'gps_fix_type', 'u1', 1),
+        (WorldSnapshotFields.Barometer, 'barometer_valid', 'u1', 1),
+        (WorldSnapshotFields.Barometer, 'barometer_altitude', '<f4', 1),
+        (WorldSnapshotFields.Barometer, 'barometer_pressure', '<f4', 1),
+        (WorldSnapshotFields.Barometer, 'barometer_qnh', '<f4', 1),
+        (WorldSnapshotFields.Magnetometer, 'magnetometer_valid', 'u1', 1),
+        (WorldSnapshotFields.Magnetometer, 'magnetic_field_body', '<f4', 3)
+    ]
+
+    step = 0
+    timestamp = 0
+    fields = 0
+    vehicle_names = []
+
+    # data is the byte array returned by simGetWorldSnapshot RPC
+    @staticmethod
+    def decode(data):
+        version, fields, count, step, timestamp = struct.unpack_from('<HHIQQ', data, 0)
+        if version != 1:
+            raise ValueError('unsupported world snapshot version %d' % version)
+        snapshot = WorldSnapshot()
+        snapshot.fields, snapshot.step, snapshot.timestamp = fields, step, timestamp
+        snapshot.vehicle_names = []
+        offset = 24
+        for i in range(count):
+            length = struct.unpack_from('<H', data, offset)[0]
+            snapshot.vehicle_names.append(bytes(data[offset + 2 : offset + 2 + length]).decode('utf-8'))
+            offset += 2 + length
+        for group, name, dtype, components in WorldSnapshot.columns:
+            column = None
+            if fields & group:
+                column = np.frombuffer(data, dtype, count * components, offset)
+                if components > 1:
+                    column = column.reshape(count, components)
+                offset += column.nbytes
+            setattr(snapshot, name, column)
+        return snapshot
+
+# image from RawImageClient, image is a numpy view into the received frame: (height, width, channels) uint8
+# for uncompressed images, (height, width) float32 for pixels_as_float and the encoded file as uint8 when compressed
+class RawImageResponse:
+    image = None
+    camera_position = Vector3r()
+    camera_orientation = Quaternionr()
+    time_stamp = np.uint64(0)
+    message = ''
+    pixels_as_float = False
+    compress = True
+    width = 0
+    height = 0
+    channels = 0
+    image_type = AirSimImageType.Scene
+    encoding = ImageEncoding.Default
+
+# binary image channel next to RPC, listens on the RPC port + 10000 (51451 for multirotor, 52451 for car).
+# Images come back as raw bytes in one frame instead of msgpack, so depth is not sent float by float
+# and nothing is copied after the socket read.
+class RawImageClient:
+    request_magic = 0x51524941
+    response_magic = 0x53524941
+    version = 1
+    image_header_size = 72
+
+    def __init__(self, ip = "127.0.0.1", port = 51451):
+        self.sock = socket.create_connection((ip, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+    def close(self):
+        self.sock.close()
+
+    # requests is a list of ImageRequest, returns a list of RawImageResponse
+    def getImages(self, requests):
+        data = bytearray(struct.pack('<IHH', RawImageClient.request_magic, RawImageClient.version, len(requests)))
+        for request in requests:
+            data += struct.pack('<BBBBB', request.camera_id, request.image_type, request.pixels_as_float, request.compress,
+                request.encoding)
+        self.sock.sendall(data)
+
+        magic, version, count, error_length, reserved, body_size = struct.unpack('<IHHIIQ', self._receive(24))
+        if magic != RawImageClient.response_magic or version != RawImageClient.version:
+            raise ValueError('invalid raw image response')
+        body = self._receive(body_size)
+        if error_length > 0:
+            raise RuntimeError(bytes(body[0:error_length]).decode('utf-8', 'replace'))
+
+        responses = []
+        message_offset = error_length + count * RawImageClient.image_header_size
+        for i in range(count):
+            (payload_offset, payload_size, time_stamp, px, py, pz, qw, qx, qy, qz, width, height,
+                image_type, pixels_as_float, compress, channels, message_length, encoding) = struct.unpack_from(
+                '<QQQ7fiiBBBBIB3x', body, error_length + i * RawImageClient.image_header_size)
+            response = RawImageResponse()
+            response.camera_position = Vector3r(px, py, pz)
+            response.camera_orientation = Quaternionr(qx, qy, qz, qw)
+            response.time_stamp, response.width, response.height, response.channels = time_stamp, width, height, channels
+            response.image_type, response.pixels_as_float, response.compress = image_type, pixels_as_float != 0, compress != 0
+            response.encoding = encoding
+            response.message = bytes(body[message_offset : message_offset + message_length]).decode('utf-8', 'replace')
+            message_offset += message_length
+
+            if response.pixels_as_float and encoding in (ImageEncoding.Default, ImageEncoding.Raw):
+                response.image = np.frombuffer(body, np.float32, payload_size // 4, payload_offset)
+            elif encoding == ImageEncoding.DepthU16:
+                response.image = np.frombuffer(body, np.dtype('<u2'), payload_size // 2, payload_offset)
+            else:
+                response.image = np.frombuffer(body, np.uint8, payload_size, payload_offset)
+            if channels > 0 and response.image.size == width * height * channels:
+                response.image = response.image.reshape(height, width) if channels == 1 else response.image.reshape(height, width, channels)
+            responses.append(response)
+        return responses
+
+    def _receive(self, size):
+        buffer = bytearray(size)
+        view = memoryview(buffer)
+        received = 0
+        while received < size:
+            count = self.sock.recv_into(view[received:], size - received)
+            if count == 0:
+                raise IOError('raw image connection closed')
+            received += count
+        return buffer
+
+class ApiCallStats(MsgpackMixin):
+    name = ''
+    count = 0
+    fast_path_count = 0
+    mean_ms = 0.0
+    max_ms = 0.0
+    last_ms = 0.0
+
 class CarState(MsgpackMixin):
     speed = np.float32(0)
     gear = 0
@@ -202,6 +447,10 @@ class AirSimClientBase:
     def getCollisionInfo(self):
         return CollisionInfo.from_msgpack(self.client.call('getCollisionInfo'))
 
+    # state of every vehicle in the world taken at one physics step, fields uses WorldSnapshotFields members combined with |
+    def simGetWorldSnapshot(self, fields = WorldSnapshotFields.All):
+        return WorldSnapshot.decode(self.client.call('simGetWorldSnapshot', fields))
+
     @staticmethod
     def stringToUint8Array(bstr):
         return np.fromstring(bstr, np.uint8)
@@ -471,6 +720,19 @@ class MultirotorClient(AirSimClientBase, object):
         return self.client.call('isSimulationMode')
     def getServerDebugInfo(self):
         return self.client.call('getServerDebugInfo')
+    # server side latency of each control call as a list of ApiCallStats, reset starts counting from zero again
+    def getApiCallStats(self, reset = False):
+        return [ApiCallStats.from_msgpack(item) for item in self.client.call('getApiCallStats', reset)]
+
+    # telemetry streaming: subscribe once and call getTelemetryFrames in a loop instead of polling each getter
+    # fields is a combination of TelemetryFields, a frame is sampled every every_n_steps physics steps
+    def subscribeTelemetry(self, fields = TelemetryFields.All, every_n_steps = 1, queue_size = 256):
+        return self.client.call('subscribeTelemetry', fields, every_n_steps, queue_size)
+    def unsubscribeTelemetry(self, subscription_id):
+        return self.client.call('unsubscribeTelemetry', subscription_id)
+    # waits up to max_wait_ms, returns (frames, number of frames server dropped since last call)
+    def getTelemetryFrames(self, subscription_id, max_wait_ms = 1000):
+        return TelemetryFrame.decode_batch(self.client.call('getTelemetryFrames', subscription_id, max_wait_ms))
 
 
     # APIs for control
@@ -486,6 +748,10 @@ class MultirotorClient(AirSimClientBase, object):
     def moveOnPath(self, path, velocity, max_wait_seconds = 60, drivetrain = DrivetrainType.MaxDegreeOfFreedom, yaw_mode = YawMode(), lookahead = -1, adaptive_lookahead = 1):
         return self.client.call('moveOnPath', path, velocity, max_wait_seconds, drivetrain, yaw_mode, lookahead, adaptive_lookahead)
 
+    # extends the path of a moveOnPath that is still running, False if it is over
+    def appendToPath(self, path):
+        return self.client.call('appendToPath', path)
+
     def moveToZ(self, z, velocity, max_wait_seconds = 60, yaw_mode = YawMode(), lookahead = -1, adaptive_lookahead = 1):
         return self.client.call('moveToZ', z, velocity, max_wait_seconds, yaw_mode, lookahead, adaptive_lookahead)
 
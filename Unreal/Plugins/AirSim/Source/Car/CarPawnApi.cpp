@@ -12,15 +12,9 @@ CarPawnApi::CarPawnApi(VehiclePawnWrapper* pawn, UWheeledVehicleMovementComponen
 std::vector<VehicleCameraBase::ImageResponse> CarPawnApi::simGetImages(
     const std::vector<VehicleCameraBase::ImageRequest>& request)
 {
-    std::vector<VehicleCameraBase::ImageResponse> response;
-
-    for (const auto& item : request) {
-        VehicleCameraBase* camera = pawn_->getCameraConnector(item.camera_id);
-        const auto& item_response = camera->getImage(item.image_type, item.pixels_as_float, item.compress);
-        response.push_back(item_response);
-    }
-
-    return response;
+    return image_encoder_.getImages(request, [this](uint8_t camera_id) -> VehicleCameraBase* {
+        return pawn_->getCameraConnector(camera_id);
+    });
 }
 
 bool CarPawnApi::simSetSegmentationObjectID(const std::string& mesh_name, int object_id, 
@@ -48,6 +42,13 @@ msr::airlib::CollisionInfo CarPawnApi::getCollisionInfo()
     return pawn_->getCollisionInfo();
 }
 
+msr::airlib::WorldSnapshot CarPawnApi::simGetWorldSnapshot(unsigned int fields)
+{
+    //car is moved by Unreal physics, there is no World to take a consistent snapshot from
+    unused(fields);
+    throw std::logic_error("simGetWorldSnapshot() call is not supported for car");
+}
+
 std::vector<uint8_t> CarPawnApi::simGetImage(uint8_t camera_id, VehicleCameraBase::ImageType image_type)
 {
     std::vector<VehicleCameraBase::ImageRequest> request = { VehicleCameraBase::ImageRequest(camera_id, image_type) };
@@ -5,6 +5,7 @@
 #include "VehiclePawnWrapper.h"
 #include "WheeledVehicleMovementComponent4W.h"
 #include "physics/Kinematics.hpp"
+#include "controllers/ImageEncoder.hpp"
 
 
 class CarPawnApi : public msr::airlib::CarApiBase {
@@ -25,6 +26,8 @@ public:
 
     virtual msr::airlib::CollisionInfo getCollisionInfo() override;
 
+    virtual msr::airlib::WorldSnapshot simGetWorldSnapshot(unsigned int fields) override;
+
     virtual std::vector<uint8_t> simGetImage(uint8_t camera_id, VehicleCameraBase::ImageType image_type) override;
 
     virtual void setCarControls(const CarApiBase::CarControls& controls) override;
@@ -52,4 +55,5 @@ private:
     UWheeledVehicleMovementComponent* movement_;
     bool api_control_enabled_ = false;
     CarControls last_controls_;
+    msr::airlib::ImageEncoder image_encoder_;
 };
\ No newline at end of file
@@ -265,6 +265,18 @@ void MultiRotorConnector::printLogMessage(const std::string& message, std::strin
     vehicle_pawn_wrapper_->printLogMessage(message, message_param, severity);
 }
 
+void MultiRotorConnector::addToWorldSnapshot(msr::airlib::WorldSnapshotSource* source)
+{
+    std::string name = std::string(TCHAR_TO_UTF8(*(vehicle_pawn_wrapper_->getPawn()->GetName())));
+    source->addVehicle(name, &vehicle_, &vehicle_.getSensors());
+    world_snapshot_source_ = source;
+}
+
+msr::airlib::WorldSnapshotSource* MultiRotorConnector::getWorldSnapshotSource()
+{
+    return world_snapshot_source_;
+}
+
 int MultiRotorConnector::getSegmentationObjectID(const std::string& mesh_name)
 {
     return UAirBlueprintLib::GetMeshStencilID(mesh_name);
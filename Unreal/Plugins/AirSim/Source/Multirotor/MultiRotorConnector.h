@@ -64,6 +64,9 @@ public:
 
     virtual void printLogMessage(const std::string& message, std::string message_param = "", unsigned char severity = 0) override;
 
+    virtual void addToWorldSnapshot(msr::airlib::WorldSnapshotSource* source) override;
+    virtual msr::airlib::WorldSnapshotSource* getWorldSnapshotSource() override;
+
 
 private:
     void detectUsbRc();
@@ -79,6 +82,7 @@ private:
     msr::airlib::MultiRotorParams* vehicle_params_;
     std::unique_ptr<msr::airlib::DroneApi> controller_cancelable_;
     std::unique_ptr<msr::airlib::ControlServerBase> rpclib_server_;
+    msr::airlib::WorldSnapshotSource* world_snapshot_source_ = nullptr;
 
     struct RotorInfo {
         real_T rotor_speed = 0;
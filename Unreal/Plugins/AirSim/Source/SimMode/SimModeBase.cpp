@@ -139,6 +139,7 @@ void ASimModeBase::readSettings()
         else
             physics_engine_name = "PhysX";
     }
+    physics_thread_count = settings.getInt("PhysicsThreadCount", 1);
 
     enable_collision_passthrough = settings.getBool("EnableCollisionPassthrogh", false);
     clock_type = settings.getString("ClockType", "");
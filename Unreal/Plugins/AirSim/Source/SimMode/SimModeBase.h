@@ -57,6 +57,7 @@ protected: //settings
     std::string api_server_address;
     std::string default_vehicle_config;
     std::string physics_engine_name;
+    int physics_thread_count;
     std::string usage_scenario;
     bool enable_collision_passthrough;
     RecordingSettings recording_settings;
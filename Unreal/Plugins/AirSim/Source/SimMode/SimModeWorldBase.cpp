@@ -20,6 +20,23 @@ void ASimModeWorldBase::BeginPlay()
     physics_world_.reset(new msr::airlib::PhysicsWorld(
         createPhysicsEngine(), toUpdatableObjects(vehicles_), 
         getPhysicsLoopPeriod()));
+    if (physics_thread_count > 1)
+        physics_world_->setParallelUpdate(static_cast<unsigned int>(physics_thread_count));
+
+    //lets API of any vehicle return state of all vehicles in one call
+    world_snapshot_source_.reset(new msr::airlib::WorldSnapshotSource(physics_world_.get()));
+    for (auto& vehicle : vehicles_)
+        vehicle->addToWorldSnapshot(world_snapshot_source_.get());
+
+    msr::airlib::Settings physics_loop_settings;
+    if (msr::airlib::Settings::singleton().getChild("PhysicsLoop", physics_loop_settings)) {
+        common_utils::ScheduledExecutor::PacingParams pacing_params;
+        pacing_params.absolute_deadline = physics_loop_settings.getBool("AbsoluteDeadline", pacing_params.absolute_deadline);
+        pacing_params.spin_nanos = static_cast<uint64_t>(physics_loop_settings.getInt("SpinMicros", 0)) * 1000;
+        pacing_params.realtime_priority = physics_loop_settings.getInt("RealtimePriority", pacing_params.realtime_priority);
+        pacing_params.cpu_affinity = physics_loop_settings.getInt("CpuAffinity", pacing_params.cpu_affinity);
+        physics_world_->setPacingParams(pacing_params);
+    }
 
     if (usage_scenario == kUsageScenarioComputerVision) {
         if (default_vehicle_config != "SimpleFlight")
@@ -51,6 +68,7 @@ void ASimModeWorldBase::setupClock()
 void ASimModeWorldBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
     //remove everything that we created in BeginPlay
+    world_snapshot_source_.reset();
     physics_world_.reset();
     physics_engine_.reset();
     vehicles_.clear();
@@ -104,9 +122,16 @@ ASimModeWorldBase::PhysicsEngineBase* ASimModeWorldBase::createPhysicsEngine()
     else if (physics_engine_name == "FastPhysicsEngine") {
         msr::airlib::Settings fast_phys_settings;
         if (msr::airlib::Settings::singleton().getChild("FastPhysicsEngine", fast_phys_settings)) {
-            physics_engine_.reset(
-                new msr::airlib::FastPhysicsEngine(fast_phys_settings.getBool("EnableGroundLock", true))
-            );
+            bool enable_ground_lock = fast_phys_settings.getBool("EnableGroundLock", true);
+            //batched update steps all vehicles together using SoA buffers
+            if (fast_phys_settings.getBool("BatchedUpdate", false))
+                physics_engine_.reset(
+                    new msr::airlib::BatchedFastPhysicsEngine(enable_ground_lock)
+                );
+            else
+                physics_engine_.reset(
+                    new msr::airlib::FastPhysicsEngine(enable_ground_lock)
+                );
         }
         else {
             physics_engine_.reset(
@@ -5,8 +5,10 @@
 #include <vector>
 #include "controllers/VehicleConnectorBase.hpp"
 #include "physics/FastPhysicsEngine.hpp"
+#include "physics/BatchedFastPhysicsEngine.hpp"
 #include "physics/World.hpp"
 #include "physics/PhysicsWorld.hpp"
+#include "physics/WorldSnapshotSource.hpp"
 #include "common/StateReporterWrapper.hpp"
 #include "api/ControlServerBase.hpp"
 #include "SimModeBase.h"
@@ -50,6 +52,7 @@ private:
 
 private:
     std::unique_ptr<msr::airlib::PhysicsWorld> physics_world_;
+    std::unique_ptr<msr::airlib::WorldSnapshotSource> world_snapshot_source_;
     
     std::unique_ptr<PhysicsEngineBase> physics_engine_;
 